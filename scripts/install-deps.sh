@@ -43,6 +43,7 @@ if command -v apt-get &>/dev/null; then
         libxcb-randr0-dev \
         libxkbcommon-dev \
         libssl-dev \
+        zlib1g-dev \
         libcap-dev \
         nlohmann-json3-dev \
         libgtest-dev \
@@ -68,6 +69,7 @@ elif command -v dnf &>/dev/null; then
         libxcb-devel \
         libxkbcommon-devel \
         openssl-devel \
+        zlib-devel \
         libcap-devel \
         json-devel \
         gtest-devel \
@@ -93,6 +95,7 @@ elif command -v pacman &>/dev/null; then
         libxcb \
         libxkbcommon \
         openssl \
+        zlib \
         libcap \
         nlohmann-json \
         gtest \
@@ -0,0 +1,624 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "browser/ContentBlocker.h"
+
+#include <QFile>
+#include <QHash>
+#include <QVarLengthArray>
+#include <QDebug>
+
+#include <cstring>
+
+namespace openlock {
+
+namespace {
+
+enum Anchor : quint8 {
+    AnchorDomain = 1,   // "||"
+    AnchorStart = 2,    // leading "|"
+    AnchorEnd = 4,      // trailing "|"
+};
+
+const quint32 kAllTypes = (ContentBlocker::Other << 1) - 1;
+const quint32 kDefaultTypes = kAllTypes & ~ContentBlocker::Document;
+const int kTokenFilterBits = 1 << 19;
+
+inline bool isTokenChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '%';
+}
+
+// '^' matches anything but a letter, a digit, or one of _ - . %
+inline bool isSeparator(char c)
+{
+    return !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+             c == '_' || c == '-' || c == '.' || c == '%');
+}
+
+inline char toLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : c;
+}
+
+// FNV-1a over lowercase bytes; 0 marks an empty slot
+quint32 hashToken(const char* data, int length)
+{
+    quint32 h = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        h ^= static_cast<uchar>(toLowerAscii(data[i]));
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+// Matches one '*'-free piece of a pattern at pos. '^' may also match
+// the end of the URL, but only as the last character of the pattern.
+bool segmentMatchesAt(const char* segment, int segmentLength, bool lastSegment,
+                      const char* url, int length, int pos, int* endOut)
+{
+    for (int k = 0; k < segmentLength; k++) {
+        const char c = segment[k];
+        if (pos == length) {
+            if (c == '^' && lastSegment && k == segmentLength - 1) break;
+            return false;
+        }
+        if (c == '^' ? !isSeparator(url[pos]) : url[pos] != c) return false;
+        pos++;
+    }
+    *endOut = pos;
+    return true;
+}
+
+// Literal tokens a regex rule needs as whole URL tokens: unescaped runs
+// outside character classes with a literal, unquantified separator on
+// both sides. Any alternation makes every token optional.
+std::vector<std::pair<int, int>> regexTokens(const QByteArray& source)
+{
+    std::vector<std::pair<int, int>> tokens;    // offset, length
+    if (source.contains('|')) return tokens;
+
+    const QByteArray s = source.toLower();
+    const int n = static_cast<int>(s.size());
+    const char* separators = "/-_=&:,;";
+    const char* quantifiers = "?*{";
+
+    auto isAlnum = [](char c) { return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'); };
+    auto boundedBefore = [&](int i) {
+        if (i == 0) return false;
+        if (i >= 2 && s[i - 2] == '\\') return !isAlnum(s[i - 1]);
+        return strchr(separators, s[i - 1]) != nullptr;
+    };
+    auto boundedAfter = [&](int j) {
+        if (j >= n) return false;
+        int next = j + 1;
+        if (s[j] == '\\') {
+            if (next >= n || isAlnum(s[next])) return false;
+            next++;
+        } else if (!strchr(separators, s[j])) {
+            return false;
+        }
+        return next >= n || !strchr(quantifiers, s[next]);
+    };
+
+    bool inClass = false;
+    for (int i = 0; i < n;) {
+        const char c = s[i];
+        if (c == '\\') {
+            i += 2;
+        } else if (inClass) {
+            inClass = c != ']';
+            i++;
+        } else if (c == '[') {
+            inClass = true;
+            i++;
+        } else if (!isTokenChar(c)) {
+            i++;
+        } else {
+            int j = i;
+            while (j < n && isTokenChar(s[j])) j++;
+            if (boundedBefore(i) && boundedAfter(j)) tokens.push_back({i, j - i});
+            i = j;
+        }
+    }
+    return tokens;
+}
+
+quint32 contentTypeFromOption(const QByteArray& name)
+{
+    static const QHash<QByteArray, quint32> types = {
+        {"document", ContentBlocker::Document},
+        {"doc", ContentBlocker::Document},
+        {"subdocument", ContentBlocker::Subdocument},
+        {"frame", ContentBlocker::Subdocument},
+        {"stylesheet", ContentBlocker::Stylesheet},
+        {"css", ContentBlocker::Stylesheet},
+        {"script", ContentBlocker::Script},
+        {"image", ContentBlocker::Image},
+        {"font", ContentBlocker::Font},
+        {"object", ContentBlocker::Object},
+        {"object-subrequest", ContentBlocker::Object},
+        {"xmlhttprequest", ContentBlocker::Xhr},
+        {"xhr", ContentBlocker::Xhr},
+        {"ping", ContentBlocker::Ping},
+        {"beacon", ContentBlocker::Ping},
+        {"media", ContentBlocker::Media},
+        {"websocket", ContentBlocker::WebSocket},
+        {"other", ContentBlocker::Other},
+        {"all", kAllTypes},
+    };
+    return types.value(name, 0);
+}
+
+} // namespace
+
+ContentBlocker::ContentBlocker() = default;
+ContentBlocker::~ContentBlocker() = default;
+
+bool ContentBlocker::loadFromFiles(const QStringList& paths)
+{
+    bool ok = true;
+    QByteArray text;
+    for (const QString& path : paths) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Cannot open content filter list:" << path;
+            ok = false;
+            continue;
+        }
+        text += file.readAll();
+        text += '\n';
+    }
+
+    setRules(text);
+    return ok;
+}
+
+void ContentBlocker::setRules(const QByteArray& text)
+{
+    m_importantRules.clear();
+    m_blockRules.clear();
+    m_exceptionRules.clear();
+    m_skippedRules = 0;
+
+    for (const QByteArray& rawLine : text.split('\n')) {
+        const QByteArray line = rawLine.trimmed();
+        if (line.isEmpty() || line.startsWith('!') || line.startsWith('[')) continue;
+
+        Rule rule;
+        bool exception = false;
+        if (!parseRule(line, &rule, &exception)) {
+            m_skippedRules++;
+            continue;
+        }
+        RuleIndex& index = exception ? m_exceptionRules
+                         : rule.important ? m_importantRules
+                                          : m_blockRules;
+        index.rules.push_back(std::move(rule));
+    }
+
+    buildIndex(m_importantRules);
+    buildIndex(m_blockRules);
+    buildIndex(m_exceptionRules);
+}
+
+bool ContentBlocker::shouldBlock(const Request& request) const
+{
+    if (m_importantRules.rules.empty() && m_blockRules.rules.empty()) return false;
+
+    const int length = static_cast<int>(request.url.size());
+    const char* original = request.url.constData();
+
+    QVarLengthArray<char, 512> lower(length);
+    for (int i = 0; i < length; i++) lower[i] = toLowerAscii(original[i]);
+    const char* url = lower.constData();
+
+    // Host bounds, skipping any user info
+    int hostBegin = 0;
+    for (int i = 0; i + 2 < length && url[i] != '/'; i++) {
+        if (url[i] == ':' && url[i + 1] == '/' && url[i + 2] == '/') {
+            hostBegin = i + 3;
+            break;
+        }
+    }
+    int authorityEnd = hostBegin;
+    while (authorityEnd < length && url[authorityEnd] != '/' && url[authorityEnd] != '?' &&
+           url[authorityEnd] != '#') {
+        if (url[authorityEnd] == '@') hostBegin = authorityEnd + 1;
+        authorityEnd++;
+    }
+    int hostEnd = hostBegin;
+    while (hostEnd < authorityEnd && url[hostEnd] != ':') hostEnd++;
+
+    // $important block rules win over exceptions, whichever other block
+    // rules also match
+    if (findMatch(m_importantRules, request, url, length, hostBegin, hostEnd) >= 0) return true;
+    if (findMatch(m_blockRules, request, url, length, hostBegin, hostEnd) < 0) return false;
+
+    return findMatch(m_exceptionRules, request, url, length, hostBegin, hostEnd) < 0;
+}
+
+int ContentBlocker::ruleCount() const
+{
+    return static_cast<int>(m_importantRules.rules.size() + m_blockRules.rules.size() +
+                            m_exceptionRules.rules.size());
+}
+
+int ContentBlocker::skippedRuleCount() const { return m_skippedRules; }
+
+bool ContentBlocker::parseRule(const QByteArray& line, Rule* rule, bool* exception) const
+{
+    // Element hiding and scriptlet rules are not network rules
+    if (line.contains("##") || line.contains("#@#") || line.contains("#?#") ||
+        line.contains("#$#") || line.contains("#%#")) {
+        return false;
+    }
+
+    QByteArray pattern = line;
+    *exception = pattern.startsWith("@@");
+    if (*exception) pattern.remove(0, 2);
+
+    // Options follow the last '$', if it is followed by an option name
+    quint32 types = 0;
+    quint32 negatedTypes = 0;
+    const qsizetype dollar = pattern.lastIndexOf('$');
+    if (dollar >= 0) {
+        const QByteArray options = pattern.mid(dollar + 1);
+        int nameLength = 0;
+        while (nameLength < options.size() &&
+               (isTokenChar(toLowerAscii(options[nameLength])) ||
+                options[nameLength] == '~' || options[nameLength] == '-' ||
+                options[nameLength] == '_')) {
+            nameLength++;
+        }
+        const bool looksLikeOptions = nameLength > 0 &&
+            (nameLength == options.size() || options[nameLength] == ',' ||
+             options[nameLength] == '=');
+
+        if (looksLikeOptions) {
+            pattern.truncate(dollar);
+            for (const QByteArray& rawOption : options.split(',')) {
+                QByteArray option = rawOption.toLower();
+                const bool negated = option.startsWith('~');
+                if (negated) option.remove(0, 1);
+
+                if (option == "third-party" || option == "3p") {
+                    rule->party = negated ? -1 : 1;
+                } else if (option == "first-party" || option == "1p") {
+                    rule->party = negated ? 1 : -1;
+                } else if (option == "match-case") {
+                    rule->matchCase = true;
+                } else if (option == "important") {
+                    rule->important = true;
+                } else if (option.startsWith("domain=") && !negated) {
+                    for (const QByteArray& domain : rawOption.mid(7).toLower().split('|')) {
+                        if (domain.startsWith('~')) {
+                            rule->excludeDomains << QString::fromUtf8(domain.mid(1));
+                        } else if (!domain.isEmpty()) {
+                            rule->includeDomains << QString::fromUtf8(domain);
+                        }
+                    }
+                } else if (quint32 type = contentTypeFromOption(option)) {
+                    (negated ? negatedTypes : types) |= type;
+                } else {
+                    // $popup, $csp, $redirect, $removeparam, ...
+                    return false;
+                }
+            }
+        }
+    }
+
+    rule->types = types ? types : (kDefaultTypes & ~negatedTypes);
+    if (rule->types == 0) return false;
+
+    // "/regex/"
+    if (pattern.size() > 2 && pattern.startsWith('/') && pattern.endsWith('/')) {
+        rule->isRegex = true;
+        rule->pattern = pattern.mid(1, pattern.size() - 2);
+        rule->regex = QRegularExpression(
+            QString::fromUtf8(rule->pattern),
+            rule->matchCase ? QRegularExpression::NoPatternOption
+                            : QRegularExpression::CaseInsensitiveOption);
+        if (!rule->regex.isValid()) return false;
+        rule->regex.optimize();
+        return true;
+    }
+
+    if (pattern.startsWith("||")) {
+        rule->anchors |= AnchorDomain;
+        pattern.remove(0, 2);
+    } else if (pattern.startsWith('|')) {
+        rule->anchors |= AnchorStart;
+        pattern.remove(0, 1);
+    }
+    if (pattern.endsWith('|')) {
+        rule->anchors |= AnchorEnd;
+        pattern.chop(1);
+    }
+
+    // A leading or trailing '*' cancels the anchor on that side
+    if (pattern.startsWith('*')) {
+        rule->anchors &= ~(AnchorDomain | AnchorStart);
+        while (pattern.startsWith('*')) pattern.remove(0, 1);
+    }
+    if (pattern.endsWith('*')) {
+        rule->anchors &= ~AnchorEnd;
+        while (pattern.endsWith('*')) pattern.chop(1);
+    }
+
+    rule->pattern = rule->matchCase ? pattern : pattern.toLower();
+    return true;
+}
+
+void ContentBlocker::buildIndex(RuleIndex& index)
+{
+    struct Candidate {
+        quint32 hash;
+        int offset;
+        int length;
+    };
+
+    // Collect the tokens of each rule that are guaranteed to line up with a
+    // whole token of any URL the rule matches, i.e. not touching a '*' or
+    // an unanchored pattern end
+    std::vector<std::vector<Candidate>> candidates(index.rules.size());
+    QHash<quint32, int> frequency;
+
+    for (size_t r = 0; r < index.rules.size(); r++) {
+        const Rule& rule = index.rules[r];
+        if (rule.isRegex) {
+            for (const auto& [offset, length] : regexTokens(rule.pattern)) {
+                const quint32 hash = hashToken(rule.pattern.constData() + offset, length);
+                candidates[r].push_back({hash, -1, length});
+                frequency[hash]++;
+            }
+            continue;
+        }
+
+        const QByteArray lower = rule.pattern.toLower();
+        const char* p = lower.constData();
+        const int n = static_cast<int>(lower.size());
+        const int firstWildcard = static_cast<int>(lower.indexOf('*'));
+
+        for (int i = 0; i < n;) {
+            if (!isTokenChar(p[i])) {
+                i++;
+                continue;
+            }
+            int j = i;
+            while (j < n && isTokenChar(p[j])) j++;
+
+            const bool leftBounded = i > 0 ? p[i - 1] != '*'
+                                           : (rule.anchors & (AnchorDomain | AnchorStart)) != 0;
+            const bool rightBounded = j < n ? p[j] != '*' : (rule.anchors & AnchorEnd) != 0;
+            if (leftBounded && rightBounded) {
+                const quint32 hash = hashToken(p + i, j - i);
+                const bool fixed = firstWildcard < 0 || firstWildcard > i;
+                candidates[r].push_back({hash, fixed ? i : -1, j - i});
+                frequency[hash]++;
+            }
+            i = j;
+        }
+    }
+
+    // Index each rule under its rarest token, preferring longer ones
+    QHash<quint32, std::vector<quint32>> buckets;
+    for (size_t r = 0; r < index.rules.size(); r++) {
+        if (candidates[r].empty()) {
+            index.untokenized.push_back(static_cast<quint32>(r));
+            continue;
+        }
+
+        const Candidate* best = &candidates[r].front();
+        for (const Candidate& candidate : candidates[r]) {
+            const int count = frequency.value(candidate.hash);
+            const int bestCount = frequency.value(best->hash);
+            if (count < bestCount || (count == bestCount && candidate.length > best->length)) {
+                best = &candidate;
+            }
+        }
+        index.rules[r].tokenOffset = best->offset;
+        buckets[best->hash].push_back(static_cast<quint32>(r));
+    }
+
+    if (buckets.isEmpty()) return;
+
+    size_t capacity = 16;
+    while (capacity < static_cast<size_t>(buckets.size()) * 2) capacity <<= 1;
+    index.tokenSlots.assign(capacity, TokenSlot());
+    index.tokenFilter.assign(kTokenFilterBits / 64, 0);
+
+    for (auto it = buckets.cbegin(); it != buckets.cend(); ++it) {
+        const quint32 hash = it.key();
+        size_t slot = hash & (capacity - 1);
+        while (index.tokenSlots[slot].hash) slot = (slot + 1) & (capacity - 1);
+
+        index.tokenSlots[slot] = {hash, static_cast<quint32>(index.ruleIds.size()),
+                             static_cast<quint32>(it.value().size())};
+        index.ruleIds.insert(index.ruleIds.end(), it.value().begin(), it.value().end());
+
+        const quint32 bit = hash >> 13;
+        index.tokenFilter[bit / 64] |= quint64(1) << (bit % 64);
+    }
+}
+
+int ContentBlocker::findMatch(const RuleIndex& index, const Request& request, const char* url,
+                              int length, int hostBegin, int hostEnd) const
+{
+    if (index.rules.empty()) return -1;
+
+    const char* original = request.url.constData();
+
+    for (int i = 0; i < length;) {
+        if (!isTokenChar(url[i])) {
+            i++;
+            continue;
+        }
+        int j = i;
+        while (j < length && isTokenChar(url[j])) j++;
+
+        if (const TokenSlot* slot = index.find(hashToken(url + i, j - i))) {
+            for (quint32 k = 0; k < slot->count; k++) {
+                const quint32 id = index.ruleIds[slot->begin + k];
+                if (ruleMatches(index.rules[id], request, url, original, length,
+                                hostBegin, hostEnd, i)) {
+                    return static_cast<int>(id);
+                }
+            }
+        }
+        i = j;
+    }
+
+    for (quint32 id : index.untokenized) {
+        if (ruleMatches(index.rules[id], request, url, original, length, hostBegin, hostEnd, -1)) {
+            return static_cast<int>(id);
+        }
+    }
+    return -1;
+}
+
+bool ContentBlocker::ruleMatches(const Rule& rule, const Request& request, const char* url,
+                                 const char* original, int length, int hostBegin, int hostEnd,
+                                 int tokenPos) const
+{
+    if (!(rule.types & request.type)) return false;
+    if (rule.party > 0 && !request.thirdParty) return false;
+    if (rule.party < 0 && request.thirdParty) return false;
+
+    if (!rule.excludeDomains.isEmpty() && domainMatches(request.documentHost, rule.excludeDomains)) {
+        return false;
+    }
+    if (!rule.includeDomains.isEmpty() && !domainMatches(request.documentHost, rule.includeDomains)) {
+        return false;
+    }
+
+    if (rule.isRegex) {
+        return rule.regex.match(QString::fromLatin1(original, length)).hasMatch();
+    }
+
+    const char* subject = rule.matchCase ? original : url;
+    const bool anchorEnd = rule.anchors & AnchorEnd;
+
+    auto startAllowed = [&](int start) {
+        if (rule.anchors & AnchorStart) return start == 0;
+        if (rule.anchors & AnchorDomain) {
+            return start >= hostBegin && start < hostEnd &&
+                   (start == hostBegin || url[start - 1] == '.');
+        }
+        return true;
+    };
+
+    // The token sits at a fixed offset, so there is one place to try
+    if (tokenPos >= 0 && rule.tokenOffset >= 0) {
+        const int start = tokenPos - rule.tokenOffset;
+        return start >= 0 && startAllowed(start) &&
+               globMatchesAt(rule.pattern, anchorEnd, subject, length, start);
+    }
+
+    if (rule.anchors & AnchorStart) {
+        return globMatchesAt(rule.pattern, anchorEnd, subject, length, 0);
+    }
+    if (rule.anchors & AnchorDomain) {
+        for (int start = hostBegin; start < hostEnd; start++) {
+            if (startAllowed(start) && globMatchesAt(rule.pattern, anchorEnd, subject, length, start)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char first = rule.pattern.isEmpty() ? 0 : rule.pattern.at(0);
+    for (int start = 0; start <= length; start++) {
+        if (first && first != '^' && (start == length || subject[start] != first)) continue;
+        if (globMatchesAt(rule.pattern, anchorEnd, subject, length, start)) return true;
+    }
+    return false;
+}
+
+bool ContentBlocker::globMatchesAt(const QByteArray& pattern, bool anchorEnd, const char* url,
+                                   int length, int pos)
+{
+    // Leftmost match of each '*'-separated piece is enough; only the last
+    // piece of an end-anchored pattern has to be placed at the very end
+    const char* p = pattern.constData();
+    const int n = static_cast<int>(pattern.size());
+
+    int segmentStart = 0;
+    bool first = true;
+    for (;;) {
+        const char* star = static_cast<const char*>(memchr(p + segmentStart, '*', n - segmentStart));
+        const int segmentEnd = star ? static_cast<int>(star - p) : n;
+        const int segmentLength = segmentEnd - segmentStart;
+        const bool last = !star;
+        int end = 0;
+
+        if (first) {
+            if (!segmentMatchesAt(p + segmentStart, segmentLength, last, url, length, pos, &end)) {
+                return false;
+            }
+            if (last) return !anchorEnd || end == length;
+            pos = end;
+        } else if (last && anchorEnd) {
+            for (int at = length; at >= pos; at--) {
+                if (segmentMatchesAt(p + segmentStart, segmentLength, true, url, length, at, &end) &&
+                    end == length) {
+                    return true;
+                }
+            }
+            return false;
+        } else {
+            bool found = false;
+            for (int at = pos; at <= length; at++) {
+                if (segmentMatchesAt(p + segmentStart, segmentLength, last, url, length, at, &end)) {
+                    found = true;
+                    pos = end;
+                    break;
+                }
+            }
+            if (!found) return false;
+            if (last) return true;
+        }
+
+        first = false;
+        segmentStart = segmentEnd + 1;
+    }
+}
+
+bool ContentBlocker::domainMatches(const QString& host, const QStringList& domains)
+{
+    for (const QString& domain : domains) {
+        if (host.size() == domain.size()) {
+            if (host.compare(domain, Qt::CaseInsensitive) == 0) return true;
+        } else if (host.size() > domain.size() && host.endsWith(domain, Qt::CaseInsensitive) &&
+                   host[host.size() - domain.size() - 1] == '.') {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ContentBlocker::RuleIndex::clear()
+{
+    rules.clear();
+    tokenSlots.clear();
+    tokenFilter.clear();
+    ruleIds.clear();
+    untokenized.clear();
+}
+
+const ContentBlocker::TokenSlot* ContentBlocker::RuleIndex::find(quint32 hash) const
+{
+    if (tokenSlots.empty()) return nullptr;
+
+    const quint32 bit = hash >> 13;
+    if (!(tokenFilter[bit / 64] & (quint64(1) << (bit % 64)))) return nullptr;
+
+    const size_t mask = tokenSlots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        if (tokenSlots[slot].hash == hash) return &tokenSlots[slot];
+        if (!tokenSlots[slot].hash) return nullptr;
+    }
+}
+
+} // namespace openlock
@@ -0,0 +1,117 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+namespace openlock {
+
+// Adblock/EasyList network rules, used to drop analytics, chat widgets
+// and ad trackers from exam pages.
+//
+// Supported: "||domain^" and "|" anchors, '*' and '^', "/regex/", "@@"
+// exceptions and the options third-party/first-party, resource types
+// (and their ~negations), domain=, match-case and important. Cosmetic
+// rules and rules with options we cannot honour ($popup, $csp,
+// $redirect, ...) are skipped rather than applied loosely.
+//
+// Each rule is indexed under its least common token, so a request only
+// evaluates rules sharing a token with its URL.
+class ContentBlocker {
+public:
+    enum ContentType : quint32 {
+        Document    = 1u << 0,
+        Subdocument = 1u << 1,
+        Stylesheet  = 1u << 2,
+        Script      = 1u << 3,
+        Image       = 1u << 4,
+        Font        = 1u << 5,
+        Object      = 1u << 6,
+        Xhr         = 1u << 7,
+        Ping        = 1u << 8,
+        Media       = 1u << 9,
+        WebSocket   = 1u << 10,
+        Other       = 1u << 11,
+    };
+
+    struct Request {
+        QByteArray url;             // QUrl::toEncoded() form
+        QString documentHost;       // host of the top-level document
+        ContentType type = Other;
+        bool thirdParty = false;
+    };
+
+    ContentBlocker();
+    ~ContentBlocker();
+
+    ContentBlocker(const ContentBlocker&) = delete;
+    ContentBlocker& operator=(const ContentBlocker&) = delete;
+
+    // Replaces the rule set with the rules of all given lists
+    bool loadFromFiles(const QStringList& paths);
+    void setRules(const QByteArray& text);
+
+    bool shouldBlock(const Request& request) const;
+
+    int ruleCount() const;
+    int skippedRuleCount() const;
+
+private:
+    struct Rule {
+        QByteArray pattern;         // lowercased unless matchCase; regex source for "/.../"
+        QRegularExpression regex;   // "/.../" rules
+        QStringList includeDomains; // domain=
+        QStringList excludeDomains; // domain=~
+        quint32 types = 0;
+        int tokenOffset = -1;       // token position in pattern, -1 if not fixed
+        quint8 anchors = 0;
+        qint8 party = 0;            // 1 third-party only, -1 first-party only
+        bool isRegex = false;
+        bool matchCase = false;
+        bool important = false;
+    };
+
+    // Rule ids sharing a token; the token table is open-addressed with a
+    // bitmap in front so tokens no rule uses are rejected without a probe
+    struct TokenSlot {
+        quint32 hash = 0;
+        quint32 begin = 0;
+        quint32 count = 0;
+    };
+
+    struct RuleIndex {
+        std::vector<Rule> rules;
+        std::vector<TokenSlot> tokenSlots;
+        std::vector<quint64> tokenFilter;
+        std::vector<quint32> ruleIds;
+        std::vector<quint32> untokenized;
+
+        void clear();
+        const TokenSlot* find(quint32 hash) const;
+    };
+
+    bool parseRule(const QByteArray& line, Rule* rule, bool* exception) const;
+    void buildIndex(RuleIndex& index);
+
+    int findMatch(const RuleIndex& index, const Request& request, const char* url, int length,
+                  int hostBegin, int hostEnd) const;
+    bool ruleMatches(const Rule& rule, const Request& request, const char* url, const char* original,
+                     int length, int hostBegin, int hostEnd, int tokenPos) const;
+
+    static bool globMatchesAt(const QByteArray& pattern, bool anchorEnd, const char* url,
+                              int length, int pos);
+    static bool domainMatches(const QString& host, const QStringList& domains);
+
+    RuleIndex m_importantRules;     // block rules with $important
+    RuleIndex m_blockRules;
+    RuleIndex m_exceptionRules;
+    int m_skippedRules = 0;
+};
+
+} // namespace openlock
@@ -0,0 +1,581 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "browser/DomainBlocklist.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtEndian>
+#include <QVarLengthArray>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+namespace openlock {
+
+namespace {
+
+const char kMagic[8] = {'O', 'L', 'D', 'O', 'M', 'B', 'L', '1'};
+const int kRankBlockBits = 512;
+const int kSelectSampleRate = 64;
+const quint32 kBloomHashes = 6;
+const int kBloomBitsPerDomain = 12;
+
+// "www.example.com" <-> "com.example.www"
+QByteArray reverseLabels(const QByteArray& domain)
+{
+    QByteArray reversed;
+    reversed.reserve(domain.size());
+    qsizetype end = domain.size();
+    while (end >= 0) {
+        qsizetype dot = end > 0 ? domain.lastIndexOf('.', end - 1) : -1;
+        if (!reversed.isEmpty()) reversed.append('.');
+        reversed.append(domain.constData() + dot + 1, end - dot - 1);
+        if (dot < 0) break;
+        end = dot;
+    }
+    return reversed;
+}
+
+QByteArray normalizeDomain(QString domain)
+{
+    domain = domain.trimmed().toLower();
+    if (domain.startsWith("*.")) domain.remove(0, 2);
+    while (domain.startsWith('.')) domain.remove(0, 1);
+    while (domain.endsWith('.')) domain.chop(1);
+    if (domain.isEmpty() || domain.contains('/') || domain.contains(':')) return {};
+    return QUrl::toAce(domain);
+}
+
+quint64 hashDomain(const char* data, int length)
+{
+    // FNV-1a, folded so both halves are usable
+    quint64 h = 14695981039346656037ULL;
+    for (int i = 0; i < length; i++) {
+        h ^= static_cast<uchar>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+// Blocked Bloom filter: all probes of a key fall into one 512-bit block
+template <typename Visit>
+bool forEachBloomBit(quint64 hash, quint64 blocks, Visit visit)
+{
+    const quint64 block = (hash >> 32) % blocks;
+    const quint32 h2 = static_cast<quint32>(hash);
+    for (quint32 i = 0; i < kBloomHashes; i++) {
+        quint32 bit = ((h2 + i * 0x9E3779B9u * (h2 | 1)) >> 23) & 511;
+        if (!visit(block * 8 + bit / 64, quint64(1) << (bit % 64))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// Native little-endian, every section 8-byte aligned
+struct DomainBlocklist::Header {
+    char magic[8];
+    quint32 domainCount;
+    quint32 bloomHashes;
+    quint64 nodeCount;
+    quint64 loudsBits;
+    quint64 bloomBlocks;        // 512-bit blocks, 0 = no prefilter
+    quint64 loudsOffset;
+    quint64 rankOffset;
+    quint64 selectOffset;
+    quint64 labelOffset;
+    quint64 terminalOffset;
+    quint64 bloomOffset;
+    quint64 totalSize;
+};
+
+DomainBlocklist::DomainBlocklist() = default;
+
+DomainBlocklist::~DomainBlocklist()
+{
+    reset();
+}
+
+bool DomainBlocklist::loadFromFile(const QString& path)
+{
+    reset();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open domain blocklist:" << path;
+        return false;
+    }
+
+    // Compiled image
+    char magic[sizeof(kMagic)] = {};
+    if (file.peek(magic, sizeof(magic)) == sizeof(magic) &&
+        memcmp(magic, kMagic, sizeof(kMagic)) == 0) {
+        if (!readImage(file, 0, file.size())) {
+            qWarning() << "Invalid compiled domain blocklist:" << path;
+            return false;
+        }
+        return true;
+    }
+
+    return build(parseDomainList(file.readAll()));
+}
+
+bool DomainBlocklist::loadImage(const QString& path, qint64 offset, qint64 size)
+{
+    reset();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open domain blocklist:" << path;
+        return false;
+    }
+    if (!readImage(file, offset, size)) {
+        qWarning() << "Invalid compiled domain blocklist in" << path << "at" << offset;
+        return false;
+    }
+    return true;
+}
+
+bool DomainBlocklist::readImage(QFile& file, qint64 offset, qint64 size)
+{
+    // Copied rather than mapped: a mapping would follow later writes to
+    // the file, past the checks attach() made
+    if (offset < 0 || size < 0 || size > file.size() - offset || !file.seek(offset)) {
+        return false;
+    }
+    m_image.assign(size_t((size + 7) / 8), 0);
+    if (file.read(reinterpret_cast<char*>(m_image.data()), size) != size ||
+        !attach(reinterpret_cast<const uchar*>(m_image.data()), size)) {
+        reset();
+        return false;
+    }
+    return true;
+}
+
+bool DomainBlocklist::build(const QStringList& domains, bool bloomPrefilter)
+{
+    reset();
+
+    std::vector<QByteArray> keys;
+    keys.reserve(domains.size());
+    for (const QString& domain : domains) {
+        QByteArray normalized = normalizeDomain(domain);
+        if (!normalized.isEmpty()) {
+            keys.push_back(reverseLabels(normalized));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    if (keys.empty()) {
+        qWarning() << "Domain blocklist is empty";
+        return false;
+    }
+
+    // Breadth-first over the sorted keys. Each node emits one 1-bit per
+    // child and a terminating 0-bit; its children's labels follow in BFS
+    // order. Subtrees below a listed domain's '.' edge are pruned, since
+    // the parent already covers them.
+    std::vector<quint64> louds;
+    std::vector<quint64> terminal;
+    std::vector<uchar> labels{0};   // root has no edge label
+    quint64 bit = 0;
+    quint64 node = 0;
+
+    auto setBit = [](std::vector<quint64>& bits, quint64 pos) {
+        if (pos / 64 >= bits.size()) bits.resize(pos / 64 + 1, 0);
+        bits[pos / 64] |= quint64(1) << (pos % 64);
+    };
+
+    struct Range { quint32 begin; quint32 end; };
+    std::vector<Range> level{{0, static_cast<quint32>(keys.size())}};
+    std::vector<Range> next;
+    qsizetype depth = 0;
+
+    while (!level.empty()) {
+        next.clear();
+        for (Range range : level) {
+            quint32 i = range.begin;
+            bool isListed = keys[i].size() == depth;
+            if (isListed) {
+                setBit(terminal, node);
+                i++;
+            }
+
+            while (i < range.end) {
+                const char label = keys[i][depth];
+                quint32 j = i + 1;
+                while (j < range.end && keys[j][depth] == label) j++;
+
+                if (!(isListed && label == '.')) {
+                    setBit(louds, bit++);
+                    labels.push_back(static_cast<uchar>(label));
+                    next.push_back({i, j});
+                }
+                i = j;
+            }
+
+            bit++;      // end of this node's children
+            node++;
+        }
+        level.swap(next);
+        depth++;
+    }
+
+    const quint64 loudsWords = (bit + 63) / 64 + 1;
+    const quint64 terminalWords = (node + 63) / 64 + 1;
+    louds.resize(loudsWords, 0);
+    terminal.resize(terminalWords, 0);
+
+    // Rank samples: ones before each 512-bit block
+    const quint64 wordsPerBlock = kRankBlockBits / 64;
+    std::vector<quint32> rank((loudsWords + wordsPerBlock - 1) / wordsPerBlock + 1, 0);
+    quint64 ones = 0;
+    for (quint64 w = 0; w < loudsWords; w++) {
+        if (w % wordsPerBlock == 0) rank[w / wordsPerBlock] = static_cast<quint32>(ones);
+        ones += qPopulationCount(louds[w]);
+    }
+    rank.back() = static_cast<quint32>(ones);
+
+    // Select samples: position of every 64th zero
+    std::vector<quint32> select;
+    select.reserve(node / kSelectSampleRate + 1);
+    quint64 zeros = 0;
+    for (quint64 pos = 0; pos < bit; pos++) {
+        if (!(louds[pos / 64] & (quint64(1) << (pos % 64)))) {
+            if (zeros % kSelectSampleRate == 0) select.push_back(static_cast<quint32>(pos));
+            zeros++;
+        }
+    }
+
+    // Bloom prefilter over the forward domain names
+    std::vector<quint64> bloom;
+    quint64 bloomBlocks = 0;
+    if (bloomPrefilter) {
+        bloomBlocks = (keys.size() * kBloomBitsPerDomain + 511) / 512;
+        bloom.assign(bloomBlocks * 8, 0);
+        for (const QByteArray& key : keys) {
+            QByteArray domain = reverseLabels(key);
+            forEachBloomBit(hashDomain(domain.constData(), domain.size()), bloomBlocks,
+                            [&](quint64 word, quint64 mask) {
+                bloom[word] |= mask;
+                return true;
+            });
+        }
+    }
+
+    // Serialize
+    std::vector<quint64> image(sizeof(Header) / 8, 0);
+    auto appendSection = [&](const void* data, size_t bytes) {
+        quint64 offset = image.size() * 8;
+        size_t start = image.size();
+        image.resize(start + (bytes + 7) / 8, 0);
+        if (bytes) memcpy(image.data() + start, data, bytes);
+        return offset;
+    };
+
+    Header header = {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.domainCount = static_cast<quint32>(keys.size());
+    header.bloomHashes = kBloomHashes;
+    header.nodeCount = node;
+    header.loudsBits = bit;
+    header.bloomBlocks = bloomBlocks;
+    header.loudsOffset = appendSection(louds.data(), louds.size() * 8);
+    header.rankOffset = appendSection(rank.data(), rank.size() * 4);
+    header.selectOffset = appendSection(select.data(), select.size() * 4);
+    header.labelOffset = appendSection(labels.data(), labels.size());
+    header.terminalOffset = appendSection(terminal.data(), terminal.size() * 8);
+    header.bloomOffset = appendSection(bloom.data(), bloom.size() * 8);
+    header.totalSize = image.size() * 8;
+    memcpy(image.data(), &header, sizeof(header));
+
+    m_image = std::move(image);
+    return attach(reinterpret_cast<const uchar*>(m_image.data()),
+                  static_cast<qint64>(m_image.size() * 8));
+}
+
+bool DomainBlocklist::saveCompiled(const QString& path) const
+{
+    if (!m_data) return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write compiled domain blocklist:" << path;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(m_data), m_size);
+    return file.commit();
+}
+
+QByteArray DomainBlocklist::compiledImage() const
+{
+    if (!m_data) return {};
+    return QByteArray(reinterpret_cast<const char*>(m_data), m_size);
+}
+
+bool DomainBlocklist::contains(const QString& host) const
+{
+    if (!m_header || host.isEmpty()) return false;
+
+    // ASCII hosts (nearly all of them) are lowercased on the stack; only
+    // internationalized names go through QUrl::toAce
+    QVarLengthArray<char, 256> ascii;
+    QByteArray ace;
+    const char* data = nullptr;
+    int length = 0;
+    if (std::all_of(host.cbegin(), host.cend(), [](QChar c) { return c.unicode() < 0x80; })) {
+        ascii.resize(host.size());
+        for (qsizetype i = 0; i < host.size(); i++) {
+            const char c = char(host[i].unicode());
+            ascii[i] = (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+        }
+        data = ascii.constData();
+        length = static_cast<int>(ascii.size());
+    } else {
+        ace = QUrl::toAce(host);
+        data = ace.constData();
+        length = static_cast<int>(ace.size());
+    }
+    while (length > 0 && data[length - 1] == '.') length--;
+
+    if (m_bloom && !mightContain(data, length)) {
+        return false;
+    }
+
+    // Walk the reversed labels; a listed node at a label boundary means
+    // the host is that domain or one of its subdomains
+    quint64 node = 0;
+    int end = length;
+    for (;;) {
+        int start = end;
+        while (start > 0 && data[start - 1] != '.') start--;
+
+        for (int i = start; i < end; i++) {
+            if (!child(node, static_cast<uchar>(data[i]), &node)) return false;
+        }
+        if (isTerminal(node)) return true;
+
+        if (start == 0 || !child(node, '.', &node)) return false;
+        end = start - 1;
+    }
+}
+
+bool DomainBlocklist::isEmpty() const { return !m_header || m_header->domainCount == 0; }
+int DomainBlocklist::domainCount() const { return m_header ? static_cast<int>(m_header->domainCount) : 0; }
+qint64 DomainBlocklist::sizeInBytes() const { return m_size; }
+
+QStringList DomainBlocklist::parseDomainList(const QByteArray& text)
+{
+    static const QStringList ignoredHosts = {
+        "localhost", "localhost.localdomain", "local", "broadcasthost",
+        "ip6-localhost", "ip6-loopback", "0.0.0.0"
+    };
+
+    QStringList domains;
+    for (QByteArray line : text.split('\n')) {
+        int comment = line.indexOf('#');
+        if (comment >= 0) line.truncate(comment);
+        line = line.simplified();
+        if (line.isEmpty() || line.startsWith('!')) continue;
+
+        QList<QByteArray> fields = line.split(' ');
+
+        // Hosts-file form: address followed by one or more names
+        int first = 0;
+        if (fields.size() > 1 && (fields[0].contains(':') ||
+                                  (fields[0].count('.') == 3 && fields[0].at(0) >= '0' &&
+                                   fields[0].at(0) <= '9'))) {
+            first = 1;
+        }
+
+        for (int i = first; i < fields.size(); i++) {
+            QString name = QString::fromUtf8(fields[i]);
+            // Tolerate adblock-style "||example.com^"
+            if (name.startsWith("||")) name.remove(0, 2);
+            if (name.endsWith('^')) name.chop(1);
+            if (!ignoredHosts.contains(name, Qt::CaseInsensitive)) {
+                domains << name;
+            }
+        }
+    }
+    return domains;
+}
+
+bool DomainBlocklist::attach(const uchar* data, qint64 size)
+{
+    if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN) return false;
+    if (size < static_cast<qint64>(sizeof(Header)) || reinterpret_cast<quintptr>(data) % 8) {
+        return false;
+    }
+
+    // Every node has a label byte and every Bloom block 64 bytes, which
+    // bounds the counts before any size is computed from them
+    const auto* header = reinterpret_cast<const Header*>(data);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->totalSize != static_cast<quint64>(size) ||
+        header->nodeCount == 0 || header->nodeCount > static_cast<quint64>(size) ||
+        header->loudsBits != 2 * header->nodeCount - 1 ||
+        header->bloomBlocks > static_cast<quint64>(size) / 64) {
+        return false;
+    }
+
+    const quint64 loudsWords = (header->loudsBits + 63) / 64 + 1;
+    const quint64 wordsPerBlock = kRankBlockBits / 64;
+    struct Section { quint64 offset; quint64 bytes; };
+    const Section sections[] = {
+        {header->loudsOffset, loudsWords * 8},
+        {header->rankOffset, ((loudsWords + wordsPerBlock - 1) / wordsPerBlock + 1) * 4},
+        {header->selectOffset, ((header->nodeCount + kSelectSampleRate - 1) / kSelectSampleRate) * 4},
+        {header->labelOffset, header->nodeCount},
+        {header->terminalOffset, ((header->nodeCount + 63) / 64 + 1) * 8},
+        {header->bloomOffset, header->bloomBlocks * 64},
+    };
+    for (const Section& section : sections) {
+        if (section.offset % 8 || section.offset > static_cast<quint64>(size) ||
+            section.bytes > static_cast<quint64>(size) - section.offset) {
+            return false;
+        }
+    }
+
+    // Lookups trust the directories and the bit counts, so check them
+    // against the bitvector: a node index then never leaves nodeCount
+    // and select0 never scans past the last zero
+    const auto* louds = reinterpret_cast<const quint64*>(data + header->loudsOffset);
+    const auto* rank = reinterpret_cast<const quint32*>(data + header->rankOffset);
+    const auto* select = reinterpret_cast<const quint32*>(data + header->selectOffset);
+    const quint64 lastWord = header->loudsBits / 64;
+    const quint64 tailMask = (quint64(1) << (header->loudsBits % 64)) - 1;
+    quint64 ones = 0;
+    quint64 zeros = 0;
+    for (quint64 w = 0; w < loudsWords; w++) {
+        if (w % wordsPerBlock == 0 && rank[w / wordsPerBlock] != ones) return false;
+
+        // Bits past loudsBits must be clear
+        const quint64 valid = w < lastWord ? ~quint64(0) : w == lastWord ? tailMask : 0;
+        if (louds[w] & ~valid) return false;
+        ones += qPopulationCount(louds[w]);
+
+        for (quint64 clear = ~louds[w] & valid; clear; clear &= clear - 1) {
+            if (zeros == header->nodeCount) return false;
+            if (zeros % kSelectSampleRate == 0 &&
+                select[zeros / kSelectSampleRate] != w * 64 + qCountTrailingZeroBits(clear)) {
+                return false;
+            }
+            zeros++;
+        }
+    }
+    if (ones != header->nodeCount - 1 || zeros != header->nodeCount ||
+        rank[(loudsWords + wordsPerBlock - 1) / wordsPerBlock] != ones) {
+        return false;
+    }
+
+    m_header = header;
+    m_louds = reinterpret_cast<const quint64*>(data + header->loudsOffset);
+    m_rank = reinterpret_cast<const quint32*>(data + header->rankOffset);
+    m_select = reinterpret_cast<const quint32*>(data + header->selectOffset);
+    m_labels = data + header->labelOffset;
+    m_terminal = reinterpret_cast<const quint64*>(data + header->terminalOffset);
+    m_bloom = header->bloomBlocks ? reinterpret_cast<const quint64*>(data + header->bloomOffset)
+                                  : nullptr;
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+void DomainBlocklist::reset()
+{
+    m_header = nullptr;
+    m_louds = nullptr;
+    m_rank = nullptr;
+    m_select = nullptr;
+    m_labels = nullptr;
+    m_terminal = nullptr;
+    m_bloom = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_image.clear();
+    m_image.shrink_to_fit();
+}
+
+bool DomainBlocklist::mightContain(const char* host, int length) const
+{
+    // Any label suffix of the host may be the listed domain
+    int start = 0;
+    for (;;) {
+        bool maybe = forEachBloomBit(hashDomain(host + start, length - start), m_header->bloomBlocks,
+                                     [&](quint64 word, quint64 mask) {
+            return (m_bloom[word] & mask) != 0;
+        });
+        if (maybe) return true;
+
+        const char* dot = static_cast<const char*>(memchr(host + start, '.', length - start));
+        if (!dot) return false;
+        start = static_cast<int>(dot - host) + 1;
+    }
+}
+
+bool DomainBlocklist::child(quint64 node, uchar label, quint64* childOut) const
+{
+    // Children of node i sit between the (i-1)th and ith 0-bit
+    const quint64 begin = node == 0 ? 0 : select0(node - 1) + 1;
+    const quint64 end = select0(node);
+    const quint64 first = rank1(begin) + 1;
+
+    // Sibling labels are sorted
+    const uchar* siblings = m_labels + first;
+    quint64 lo = 0;
+    quint64 hi = end - begin;
+    while (lo < hi) {
+        quint64 mid = (lo + hi) / 2;
+        if (siblings[mid] < label) lo = mid + 1;
+        else hi = mid;
+    }
+
+    if (lo == end - begin || siblings[lo] != label) return false;
+    *childOut = first + lo;
+    return true;
+}
+
+quint64 DomainBlocklist::rank1(quint64 pos) const
+{
+    const quint64 wordsPerBlock = kRankBlockBits / 64;
+    quint64 word = (pos / kRankBlockBits) * wordsPerBlock;
+    quint64 ones = m_rank[pos / kRankBlockBits];
+    for (const quint64 endWord = pos / 64; word < endWord; word++) {
+        ones += qPopulationCount(m_louds[word]);
+    }
+    if (pos % 64) {
+        ones += qPopulationCount(m_louds[word] & ((quint64(1) << (pos % 64)) - 1));
+    }
+    return ones;
+}
+
+quint64 DomainBlocklist::select0(quint64 index) const
+{
+    const quint64 start = m_select[index / kSelectSampleRate];
+    quint64 remaining = index % kSelectSampleRate;
+    quint64 word = start / 64;
+    quint64 zeros = ~m_louds[word] & (~quint64(0) << (start % 64));
+
+    for (;;) {
+        const quint64 count = qPopulationCount(zeros);
+        if (remaining < count) {
+            for (quint64 i = 0; i < remaining; i++) zeros &= zeros - 1;
+            return word * 64 + qCountTrailingZeroBits(zeros);
+        }
+        remaining -= count;
+        zeros = ~m_louds[++word];
+    }
+}
+
+bool DomainBlocklist::isTerminal(quint64 node) const
+{
+    return (m_terminal[node / 64] >> (node % 64)) & 1;
+}
+
+} // namespace openlock
@@ -0,0 +1,83 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+class QFile;
+
+namespace openlock {
+
+// Blocks hosts from very large domain lists (answer-sharing sites, AI
+// assistants) without holding them as regexes.
+//
+// Domains are stored as a LOUDS-encoded character trie over their
+// reversed labels ("www.example.com" -> "com.example.www"), with a
+// blocked Bloom filter in front so hosts that are not listed usually
+// cost one cache line per label. The compiled image is position
+// independent and is read as-is into private memory when loaded from
+// disk, so the file cannot change under the checks; a 500k entry list
+// takes roughly 4 MB.
+class DomainBlocklist {
+public:
+    DomainBlocklist();
+    ~DomainBlocklist();
+
+    DomainBlocklist(const DomainBlocklist&) = delete;
+    DomainBlocklist& operator=(const DomainBlocklist&) = delete;
+
+    // Loads a compiled image or a text list; text lists are compiled on
+    // every load
+    bool loadFromFile(const QString& path);
+
+    // Reads a compiled image stored at offset inside a larger file, such
+    // as an exam config bundle
+    bool loadImage(const QString& path, qint64 offset, qint64 size);
+
+    bool build(const QStringList& domains, bool bloomPrefilter = true);
+    bool saveCompiled(const QString& path) const;
+    QByteArray compiledImage() const;
+
+    // True if the host or any of its parent domains is listed
+    bool contains(const QString& host) const;
+
+    bool isEmpty() const;
+    int domainCount() const;
+    qint64 sizeInBytes() const;
+
+    // Hosts-file lines ("0.0.0.0 example.com") or one domain per line
+    static QStringList parseDomainList(const QByteArray& text);
+
+private:
+    struct Header;
+
+    bool readImage(QFile& file, qint64 offset, qint64 size);
+    bool attach(const uchar* data, qint64 size);
+    void reset();
+
+    bool mightContain(const char* host, int length) const;
+    bool child(quint64 node, uchar label, quint64* childOut) const;
+    quint64 rank1(quint64 pos) const;
+    quint64 select0(quint64 index) const;
+    bool isTerminal(quint64 node) const;
+
+    std::vector<quint64> m_image;       // built or read from disk
+
+    const Header* m_header = nullptr;
+    const quint64* m_louds = nullptr;
+    const quint32* m_rank = nullptr;    // ones before each 512-bit block
+    const quint32* m_select = nullptr;  // position of every 64th zero
+    const uchar* m_labels = nullptr;    // edge label of each node, BFS order
+    const quint64* m_terminal = nullptr;
+    const quint64* m_bloom = nullptr;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+} // namespace openlock
@@ -0,0 +1,55 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "browser/HostSet.h"
+
+#include <QUrl>
+#include <QDebug>
+
+namespace openlock {
+
+HostSet::HostSet(const QStringList& entries)
+{
+    for (const QString& entry : entries) {
+        add(entry);
+    }
+}
+
+void HostSet::add(const QString& entry)
+{
+    QString host = entry.trimmed().toLower();
+    if (host.contains("://")) {
+        host = QUrl(host).host();
+    }
+    if (host.endsWith('.')) {
+        host.chop(1);
+    }
+
+    if (host.startsWith("*.")) {
+        m_suffixes.insert(host.mid(2));
+    } else if (host.startsWith('.')) {
+        m_suffixes.insert(host.mid(1));
+    } else if (!host.isEmpty() && !host.contains('*')) {
+        m_exact.insert(host);
+    } else if (!entry.trimmed().isEmpty()) {
+        qWarning() << "Ignoring unsupported host entry:" << entry;
+    }
+}
+
+bool HostSet::contains(const QString& host) const
+{
+    if (m_exact.contains(host)) return true;
+    if (m_suffixes.isEmpty()) return false;
+
+    // Parent domains only: "*.example.edu" does not match "example.edu"
+    for (int dot = host.indexOf('.'); dot >= 0; dot = host.indexOf('.', dot + 1)) {
+        if (m_suffixes.contains(QString::fromRawData(host.constData() + dot + 1,
+                                                     host.size() - dot - 1))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace openlock
@@ -0,0 +1,35 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+namespace openlock {
+
+// Set of hosts for per-request checks. Entries are exact hosts
+// ("moodle.school.edu"), "*.suffix" for a domain's subdomains, or URLs
+// whose host is taken. Exact hosts are one hash lookup; suffix entries
+// add one lookup per label of the checked host.
+class HostSet {
+public:
+    HostSet() = default;
+    explicit HostSet(const QStringList& entries);
+
+    void add(const QString& entry);
+
+    // host as returned by QUrl::host()
+    bool contains(const QString& host) const;
+
+    bool isEmpty() const { return m_exact.isEmpty() && m_suffixes.isEmpty(); }
+    int size() const { return int(m_exact.size() + m_suffixes.size()); }
+
+private:
+    QSet<QString> m_exact;
+    QSet<QString> m_suffixes;   // "*.example.edu" stored as "example.edu"
+};
+
+} // namespace openlock
@@ -6,10 +6,12 @@
 
 #include <QDebug>
 
+#include <atomic>
+#include <optional>
+
 namespace openlock {
 
-NavigationFilter::NavigationFilter(QObject* parent)
-    : QObject(parent)
+NavigationFilter::Rules::Rules()
 {
     // Default SSO domains that should always be allowed for auth redirects
     m_ssoDomains = {
@@ -29,57 +31,85 @@ NavigationFilter::NavigationFilter(QObject* parent)
     };
 }
 
-NavigationFilter::~NavigationFilter() = default;
-
-FilterResult NavigationFilter::checkUrl(const QUrl& url) const
+FilterResult NavigationFilter::Rules::check(const QUrl& url, const QString& urlString) const
 {
     // Block dangerous schemes
     if (isBlockedScheme(url)) {
         return FilterResult::Blocked;
     }
 
+    // Domain blocklist overrides everything, SSO included
+    if (m_domainBlocklist && m_domainBlocklist->contains(url.host())) {
+        return FilterResult::Blocked;
+    }
+
+    // SEB URL filter rules: first matching rule decides. A block rule
+    // applies to SSO hosts too, so it is checked before the exemption.
+    std::optional<UrlFilterAction> sebAction;
+    if (!m_urlFilter.isEmpty()) {
+        sebAction = m_urlFilter.match(url, urlString);
+        if (sebAction && *sebAction == UrlFilterAction::Block) {
+            return FilterResult::Blocked;
+        }
+    }
+
     // Always allow SSO domains for authentication
     if (isSSODomain(url)) {
         return FilterResult::AllowedSSO;
     }
 
+    if (sebAction) {
+        return FilterResult::Allowed;
+    }
+
     // Check blocked patterns first (explicit blocks override allows)
-    if (matchesPattern(url, m_blockedPatterns)) {
+    if (matchesPattern(urlString, m_blockedPatterns)) {
         return FilterResult::Blocked;
     }
 
     // If we have allowed patterns, URL must match at least one
     if (!m_allowedPatterns.isEmpty()) {
-        if (matchesPattern(url, m_allowedPatterns)) {
+        if (matchesPattern(urlString, m_allowedPatterns)) {
             return FilterResult::Allowed;
         }
         return FilterResult::Blocked;
     }
 
+    // An active SEB URL filter blocks whatever its rules did not allow
+    if (!m_urlFilter.isEmpty()) {
+        return FilterResult::Blocked;
+    }
+
     // No whitelist configured — allow everything not explicitly blocked
     return FilterResult::Allowed;
 }
 
-void NavigationFilter::addAllowedPattern(const QString& pattern)
+bool NavigationFilter::Rules::needsUrlString() const
+{
+    // The URL filter serializes lazily for its regex rules
+    return !m_allowedPatterns.isEmpty() || !m_blockedPatterns.isEmpty();
+}
+
+void NavigationFilter::Rules::addAllowedPattern(const QString& pattern)
 {
     m_allowedPatterns.append(QRegularExpression(
         globToUrlRegex(pattern),
         QRegularExpression::CaseInsensitiveOption));
 }
 
-void NavigationFilter::addBlockedPattern(const QString& pattern)
+void NavigationFilter::Rules::addBlockedPattern(const QString& pattern)
 {
     m_blockedPatterns.append(QRegularExpression(
         globToUrlRegex(pattern),
         QRegularExpression::CaseInsensitiveOption));
 }
 
-void NavigationFilter::addSSODomain(const QString& domain)
+void NavigationFilter::Rules::addSSODomain(const QString& domain)
 {
     m_ssoDomains.append(domain);
 }
 
-void NavigationFilter::setAllowedPatterns(const QStringList& patterns)
+void NavigationFilter::Rules::setAllowedPatterns(const QStringList& patterns)
 {
     m_allowedPatterns.clear();
     for (const auto& p : patterns) {
@@ -87,7 +117,7 @@ void NavigationFilter::setAllowedPatterns(const QStringList& patterns)
     }
 }
 
-void NavigationFilter::setBlockedPatterns(const QStringList& patterns)
+void NavigationFilter::Rules::setBlockedPatterns(const QStringList& patterns)
 {
     m_blockedPatterns.clear();
     for (const auto& p : patterns) {
@@ -95,12 +125,22 @@ void NavigationFilter::setBlockedPatterns(const QStringList& patterns)
     }
 }
 
-void NavigationFilter::setSSODomains(const QStringList& domains)
+void NavigationFilter::Rules::setSSODomains(const QStringList& domains)
 {
     m_ssoDomains = domains;
 }
 
-QString NavigationFilter::globToUrlRegex(const QString& glob)
+void NavigationFilter::Rules::setUrlFilterRules(const QList<UrlFilterRule>& rules)
+{
+    m_urlFilter = UrlFilterTable(rules);
+}
+
+void NavigationFilter::Rules::setDomainBlocklist(std::shared_ptr<const DomainBlocklist> blocklist)
+{
+    m_domainBlocklist = std::move(blocklist);
+}
+
+QString NavigationFilter::Rules::globToUrlRegex(const QString& glob)
 {
     // URL-aware glob: * matches any characters (including /)
     QString regex;
@@ -113,20 +153,20 @@ QString NavigationFilter::globToUrlRegex(const QString& glob)
     return regex;
 }
 
-bool NavigationFilter::matchesPattern(const QUrl& url, const QList<QRegularExpression>& patterns) const
+bool NavigationFilter::Rules::matchesPattern(const QString& urlString,
+                                             const QList<QRegularExpression>& patterns)
 {
-    QString urlStr = url.toString();
     for (const auto& pattern : patterns) {
-        if (pattern.match(urlStr).hasMatch()) {
+        if (pattern.match(urlString).hasMatch()) {
             return true;
         }
     }
     return false;
 }
 
-bool NavigationFilter::isSSODomain(const QUrl& url) const
+bool NavigationFilter::Rules::isSSODomain(const QUrl& url) const
 {
-    QString host = url.host().toLower();
+    const QString host = url.host();
     for (const QString& ssoDomain : m_ssoDomains) {
         if (host.contains(ssoDomain, Qt::CaseInsensitive)) {
             return true;
@@ -135,7 +175,7 @@ bool NavigationFilter::isSSODomain(const QUrl& url) const
     return false;
 }
 
-bool NavigationFilter::isBlockedScheme(const QUrl& url) const
+bool NavigationFilter::Rules::isBlockedScheme(const QUrl& url)
 {
     QString scheme = url.scheme().toLower();
     return scheme == "file" || scheme == "about" || scheme == "chrome" ||
@@ -143,4 +183,95 @@ bool NavigationFilter::isBlockedScheme(const QUrl& url) const
            scheme == "ftp";
 }
 
+NavigationFilter::NavigationFilter(QObject* parent)
+    : QObject(parent)
+    , m_rules(std::make_shared<const Rules>())
+{
+}
+
+NavigationFilter::~NavigationFilter() = default;
+
+std::shared_ptr<const NavigationFilter::Rules> NavigationFilter::rules() const
+{
+    return std::atomic_load(&m_rules);
+}
+
+void NavigationFilter::setRules(std::shared_ptr<const Rules> rules)
+{
+    if (!rules) rules = std::make_shared<const Rules>();
+    std::atomic_store(&m_rules, std::move(rules));
+}
+
+std::shared_ptr<NavigationFilter::Rules> NavigationFilter::copyRules() const
+{
+    return std::make_shared<Rules>(*rules());
+}
+
+FilterResult NavigationFilter::checkUrl(const QUrl& url) const
+{
+    const auto rules = this->rules();
+    return rules->check(url, rules->needsUrlString() ? url.toString() : QString());
+}
+
+FilterResult NavigationFilter::checkUrl(const QUrl& url, const QString& urlString) const
+{
+    return rules()->check(url, urlString);
+}
+
+void NavigationFilter::addAllowedPattern(const QString& pattern)
+{
+    auto rules = copyRules();
+    rules->addAllowedPattern(pattern);
+    setRules(std::move(rules));
+}
+
+void NavigationFilter::addBlockedPattern(const QString& pattern)
+{
+    auto rules = copyRules();
+    rules->addBlockedPattern(pattern);
+    setRules(std::move(rules));
+}
+
+void NavigationFilter::addSSODomain(const QString& domain)
+{
+    auto rules = copyRules();
+    rules->addSSODomain(domain);
+    setRules(std::move(rules));
+}
+
+void NavigationFilter::setAllowedPatterns(const QStringList& patterns)
+{
+    auto rules = copyRules();
+    rules->setAllowedPatterns(patterns);
+    setRules(std::move(rules));
+}
+
+void NavigationFilter::setBlockedPatterns(const QStringList& patterns)
+{
+    auto rules = copyRules();
+    rules->setBlockedPatterns(patterns);
+    setRules(std::move(rules));
+}
+
+void NavigationFilter::setSSODomains(const QStringList& domains)
+{
+    auto rules = copyRules();
+    rules->setSSODomains(domains);
+    setRules(std::move(rules));
+}
+
+void NavigationFilter::setUrlFilterRules(const QList<UrlFilterRule>& rules)
+{
+    auto next = copyRules();
+    next->setUrlFilterRules(rules);
+    setRules(std::move(next));
+}
+
+void NavigationFilter::setDomainBlocklist(std::shared_ptr<const DomainBlocklist> blocklist)
+{
+    auto rules = copyRules();
+    rules->setDomainBlocklist(std::move(blocklist));
+    setRules(std::move(rules));
+}
+
 } // namespace openlock
@@ -9,6 +9,10 @@
 #include <QStringList>
 #include <QRegularExpression>
 #include <QList>
+#include <memory>
+
+#include "browser/UrlFilterTable.h"
+#include "browser/DomainBlocklist.h"
 
 namespace openlock {
 
@@ -22,11 +26,60 @@ class NavigationFilter : public QObject {
     Q_OBJECT
 
 public:
+    // Compiled patterns, SEB rules and SSO domains. A filter checks URLs
+    // against one immutable Rules at a time; changes build a new one and
+    // swap it in whole, so a request being checked on the interceptor's
+    // thread sees either the old rules or the new ones.
+    class Rules {
+    public:
+        Rules();        // default SSO domains, nothing else
+
+        FilterResult check(const QUrl& url, const QString& urlString) const;
+        bool needsUrlString() const;
+
+        void addAllowedPattern(const QString& pattern);
+        void addBlockedPattern(const QString& pattern);
+        void addSSODomain(const QString& domain);
+
+        void setAllowedPatterns(const QStringList& patterns);
+        void setBlockedPatterns(const QStringList& patterns);
+        void setSSODomains(const QStringList& domains);
+        void setUrlFilterRules(const QList<UrlFilterRule>& rules);
+        void setDomainBlocklist(std::shared_ptr<const DomainBlocklist> blocklist);
+
+        std::shared_ptr<const DomainBlocklist> domainBlocklist() const { return m_domainBlocklist; }
+
+    private:
+        static bool matchesPattern(const QString& urlString,
+                                   const QList<QRegularExpression>& patterns);
+        static QString globToUrlRegex(const QString& glob);
+        bool isSSODomain(const QUrl& url) const;
+        static bool isBlockedScheme(const QUrl& url);
+
+        QList<QRegularExpression> m_allowedPatterns;
+        QList<QRegularExpression> m_blockedPatterns;
+        QStringList m_ssoDomains;
+        UrlFilterTable m_urlFilter;
+        std::shared_ptr<const DomainBlocklist> m_domainBlocklist;
+    };
+
     explicit NavigationFilter(QObject* parent = nullptr);
     ~NavigationFilter() override;
 
+    // Rules in effect; safe to call from any thread
+    std::shared_ptr<const Rules> rules() const;
+
+    // Replaces the rules at once, e.g. with a set compiled on a worker
+    // thread. Safe to call while other threads check URLs.
+    void setRules(std::shared_ptr<const Rules> rules);
+
     FilterResult checkUrl(const QUrl& url) const;
 
+    // Same, with url already serialized by the caller (QUrl::toString(),
+    // with or without fragment) so it is not serialized again per pattern set
+    FilterResult checkUrl(const QUrl& url, const QString& urlString) const;
+
+    // Each of these copies the current rules, changes the copy and swaps it in
     void addAllowedPattern(const QString& pattern);
     void addBlockedPattern(const QString& pattern);
     void addSSODomain(const QString& domain);
@@ -35,19 +88,20 @@ public:
     void setBlockedPatterns(const QStringList& patterns);
     void setSSODomains(const QStringList& domains);
 
+    // SEB URLFilterRules; once set, URLs no rule or pattern allows are blocked
+    void setUrlFilterRules(const QList<UrlFilterRule>& rules);
+
+    // Large domain list; listed hosts and their subdomains are always blocked
+    void setDomainBlocklist(std::shared_ptr<const DomainBlocklist> blocklist);
+
 signals:
     void urlBlocked(const QUrl& url, const QString& reason);
     void urlAllowed(const QUrl& url);
 
 private:
-    bool matchesPattern(const QUrl& url, const QList<QRegularExpression>& patterns) const;
-    static QString globToUrlRegex(const QString& glob);
-    bool isSSODomain(const QUrl& url) const;
-    bool isBlockedScheme(const QUrl& url) const;
-
-    QList<QRegularExpression> m_allowedPatterns;
-    QList<QRegularExpression> m_blockedPatterns;
-    QStringList m_ssoDomains;
+    std::shared_ptr<Rules> copyRules() const;
+
+    std::shared_ptr<const Rules> m_rules;   // swapped atomically
 };
 
 } // namespace openlock
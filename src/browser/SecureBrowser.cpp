@@ -6,6 +6,7 @@
 #include "browser/NavigationFilter.h"
 #include "browser/DownloadBlocker.h"
 #include "browser/DevToolsBlocker.h"
+#include "browser/DomainBlocklist.h"
 #include "core/Config.h"
 
 #include <QVBoxLayout>
@@ -18,6 +19,7 @@
 #include <QWebEngineScript>
 #include <QWebEngineScriptCollection>
 #include <QKeyEvent>
+#include <QElapsedTimer>
 #include <QDebug>
 
 namespace openlock {
@@ -119,6 +121,8 @@ bool SecureBrowser::initialize(const Config* config)
 
     const auto& examConfig = config->examConfig();
 
+    setupNavigationFilter(examConfig, config->bundledDomainBlocklist());
+
     // Set custom User-Agent
     if (!examConfig.userAgent.isEmpty()) {
         m_profile->setHttpUserAgent(examConfig.userAgent);
@@ -255,6 +259,57 @@ void SecureBrowser::setupProfile()
     });
 }
 
+void SecureBrowser::setupNavigationFilter(const ExamConfig& examConfig,
+                                          std::shared_ptr<const DomainBlocklist> blocklist)
+{
+    // The filter is shared with the request interceptor, which consults it
+    // for every request the profile makes
+    if (!m_navFilter) {
+        m_navFilter = new NavigationFilter(this);
+    }
+
+    // A bundled exam brings its blocklist compiled
+    if (!blocklist && !examConfig.domainBlocklistPath.isEmpty()) {
+        blocklist = loadDomainBlocklist(examConfig.domainBlocklistPath);
+    }
+    m_navFilter->setRules(compileNavigationRules(examConfig, std::move(blocklist)));
+
+    if (examConfig.urlFilterEnabled) {
+        qInfo() << "SEB URL filter enabled with" << examConfig.urlFilterRules.size() << "rules";
+    }
+}
+
+std::shared_ptr<const NavigationFilter::Rules> SecureBrowser::compileNavigationRules(
+    const ExamConfig& examConfig, std::shared_ptr<const DomainBlocklist> domainBlocklist)
+{
+    auto rules = std::make_shared<NavigationFilter::Rules>();
+    rules->setAllowedPatterns(examConfig.allowedUrlPatterns);
+    rules->setBlockedPatterns(examConfig.blockedUrlPatterns);
+    for (const QString& domain : examConfig.ssoAllowedDomains) {
+        rules->addSSODomain(domain);
+    }
+    if (examConfig.urlFilterEnabled) {
+        rules->setUrlFilterRules(examConfig.urlFilterRules);
+    }
+    rules->setDomainBlocklist(std::move(domainBlocklist));
+    return rules;
+}
+
+std::shared_ptr<const DomainBlocklist> SecureBrowser::loadDomainBlocklist(const QString& path)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto blocklist = std::make_shared<DomainBlocklist>();
+    if (!blocklist->loadFromFile(path)) {
+        qWarning() << "Domain blocklist not loaded:" << path;
+        return nullptr;
+    }
+    qInfo() << "Domain blocklist loaded:" << blocklist->domainCount() << "domains,"
+            << blocklist->sizeInBytes() / 1024 << "KiB in" << timer.elapsed() << "ms";
+    return blocklist;
+}
+
 void SecureBrowser::setupToolbar()
 {
     m_toolbar = new QWidget(this);
@@ -10,12 +10,14 @@
 #include <QWebEngineProfile>
 #include <memory>
 
+#include "browser/NavigationFilter.h"
+
 namespace openlock {
 
-class NavigationFilter;
 class DownloadBlocker;
 class DevToolsBlocker;
 class Config;
+struct ExamConfig;
 
 class SecurePage : public QWebEnginePage {
     Q_OBJECT
@@ -46,6 +48,13 @@ public:
     void setNavigationFilter(NavigationFilter* filter);
     NavigationFilter* navigationFilter() const;
 
+    // Navigation rules for examConfig; touches no browser state
+    static std::shared_ptr<const NavigationFilter::Rules> compileNavigationRules(
+        const ExamConfig& examConfig, std::shared_ptr<const DomainBlocklist> domainBlocklist);
+
+    // Null if the list cannot be loaded
+    static std::shared_ptr<const DomainBlocklist> loadDomainBlocklist(const QString& path);
+
     QWebEngineView* webView() const;
 
 signals:
@@ -59,6 +68,8 @@ protected:
 
 private:
     void setupProfile();
+    void setupNavigationFilter(const ExamConfig& examConfig,
+                               std::shared_ptr<const DomainBlocklist> blocklist);
     void setupToolbar();
     void applyHardenedSettings();
     void injectHeaders();
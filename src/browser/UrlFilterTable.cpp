@@ -0,0 +1,249 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "browser/UrlFilterTable.h"
+
+#include <QVarLengthArray>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace openlock {
+
+UrlFilterTable::UrlFilterTable() = default;
+
+UrlFilterTable::UrlFilterTable(const QList<UrlFilterRule>& rules)
+{
+    m_rules.reserve(rules.size());
+    for (const auto& rule : rules) {
+        if (rule.active && !rule.expression.trimmed().isEmpty()) {
+            compile(rule);
+        }
+    }
+}
+
+UrlFilterTable::~UrlFilterTable() = default;
+
+bool UrlFilterTable::isEmpty() const { return m_rules.empty(); }
+int UrlFilterTable::size() const { return static_cast<int>(m_rules.size()); }
+
+std::optional<UrlFilterAction> UrlFilterTable::match(const QUrl& url) const
+{
+    return match(url, QString());
+}
+
+std::optional<UrlFilterAction> UrlFilterTable::match(const QUrl& url,
+                                                     const QString& urlString) const
+{
+    if (m_rules.empty()) return std::nullopt;
+
+    const QString host = url.host();
+
+    // Gather candidates from every label suffix of the host:
+    // a.b.example.com -> a.b.example.com, b.example.com, example.com, com
+    QVarLengthArray<int, 32> candidates;
+    if (!m_hostIndex.isEmpty() && !host.isEmpty()) {
+        qsizetype pos = 0;
+        while (pos >= 0 && pos < host.size()) {
+            // fromRawData: the suffix lookup does not copy the host
+            auto it = m_hostIndex.constFind(
+                QString::fromRawData(host.constData() + pos, host.size() - pos));
+            if (it != m_hostIndex.constEnd()) {
+                for (int idx : it.value()) candidates.append(idx);
+            }
+            pos = host.indexOf('.', pos);
+            if (pos >= 0) pos++;
+        }
+    }
+
+    // Restore config order across buckets so the first match wins
+    for (int idx : m_unindexedRules) candidates.append(idx);
+    std::sort(candidates.begin(), candidates.end());
+
+    QString serialized = urlString;
+    int previous = -1;
+    for (int idx : candidates) {
+        if (idx == previous) continue;
+        previous = idx;
+
+        const CompiledRule& rule = m_rules[idx];
+        if (rule.isRegex && serialized.isNull()) {
+            serialized = url.toString();
+        }
+        if (matches(rule, url, host, serialized)) {
+            return rule.action;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void UrlFilterTable::compile(const UrlFilterRule& rule)
+{
+    CompiledRule compiled;
+    compiled.action = rule.action;
+    const int index = static_cast<int>(m_rules.size());
+
+    if (rule.regex) {
+        compiled.isRegex = true;
+        compiled.urlRegex = QRegularExpression(rule.expression,
+                                               QRegularExpression::CaseInsensitiveOption);
+        if (!compiled.urlRegex.isValid()) {
+            qWarning() << "Skipping invalid URL filter regex:" << rule.expression
+                       << compiled.urlRegex.errorString();
+            return;
+        }
+        compiled.urlRegex.optimize();
+        m_rules.push_back(std::move(compiled));
+        m_unindexedRules.push_back(index);
+        return;
+    }
+
+    // Split scheme://[user:pass@]host[:port][/path][?query][#fragment],
+    // every part except the host being optional
+    QString rest = rule.expression.trimmed();
+
+    int schemeEnd = rest.indexOf("://");
+    if (schemeEnd >= 0) {
+        QString scheme = rest.left(schemeEnd).toLower();
+        if (scheme != "*") compiled.scheme = scheme;
+        rest = rest.mid(schemeEnd + 3);
+    }
+
+    int fragmentStart = rest.indexOf('#');
+    if (fragmentStart >= 0) rest.truncate(fragmentStart);
+
+    int queryStart = rest.indexOf('?');
+    if (queryStart >= 0) {
+        compiled.anyQuery = false;
+        compiled.queryRegex = QRegularExpression(
+            QRegularExpression::anchoredPattern(wildcardToRegex(rest.mid(queryStart + 1))),
+            QRegularExpression::CaseInsensitiveOption);
+        rest.truncate(queryStart);
+    }
+
+    int pathStart = rest.indexOf('/');
+    if (pathStart >= 0) {
+        QString path = rest.mid(pathStart);
+        rest.truncate(pathStart);
+
+        // "/dir" also matches "/dir/..." unless it ends in a wildcard
+        bool trailingWildcard = path.endsWith('*');
+        while (path.endsWith('/')) path.chop(1);
+        if (!path.isEmpty()) {
+            compiled.anyPath = false;
+            QString pattern = wildcardToRegex(path);
+            if (!trailingWildcard) pattern += "(?:/.*)?";
+            compiled.pathRegex = QRegularExpression(
+                QRegularExpression::anchoredPattern(pattern),
+                QRegularExpression::CaseInsensitiveOption);
+        }
+    }
+
+    int userInfoEnd = rest.lastIndexOf('@');
+    if (userInfoEnd >= 0) rest = rest.mid(userInfoEnd + 1);
+
+    int portStart = rest.lastIndexOf(':');
+    if (portStart >= 0 && !rest.endsWith(']')) {
+        bool ok = false;
+        int port = rest.mid(portStart + 1).toInt(&ok);
+        if (ok) compiled.port = port;
+        rest.truncate(portStart);
+    }
+
+    QString host = rest.toLower();
+    if (host.startsWith('.')) {
+        compiled.exactHost = true;
+        host.remove(0, 1);
+    }
+
+    if (host.isEmpty() || host == "*") {
+        // Any host
+        m_rules.push_back(std::move(compiled));
+        m_unindexedRules.push_back(index);
+        return;
+    }
+
+    if (host.contains('*') || host.contains('?')) {
+        compiled.hostWildcard = true;
+        QString pattern = wildcardToRegex(host);
+        if (!compiled.exactHost) pattern = "(?:.*\\.)?" + pattern;
+        compiled.hostRegex = QRegularExpression(QRegularExpression::anchoredPattern(pattern));
+        compiled.hostRegex.optimize();
+
+        // "*.example.com" can only match hosts under example.com, so it
+        // still gets a bucket; "moodle.*" cannot be indexed
+        QString tail = host.mid(host.lastIndexOf('*') + 1);
+        if (tail.startsWith('.') && tail.size() > 1 && !tail.contains('?')) {
+            m_hostIndex[tail.mid(1)].push_back(index);
+        } else {
+            m_unindexedRules.push_back(index);
+        }
+        m_rules.push_back(std::move(compiled));
+        return;
+    }
+
+    compiled.host = host;
+    m_hostIndex[host].push_back(index);
+    m_rules.push_back(std::move(compiled));
+}
+
+bool UrlFilterTable::matches(const CompiledRule& rule, const QUrl& url, const QString& host,
+                             const QString& urlString) const
+{
+    if (rule.isRegex) {
+        return rule.urlRegex.match(urlString).hasMatch();
+    }
+
+    if (!rule.scheme.isEmpty() && url.scheme().compare(rule.scheme, Qt::CaseInsensitive) != 0) {
+        return false;
+    }
+
+    if (!rule.host.isEmpty()) {
+        if (!hostMatchesLiteral(host, rule.host, rule.exactHost)) return false;
+    } else if (rule.hostWildcard) {
+        if (!rule.hostRegex.match(host).hasMatch()) return false;
+    }
+
+    if (rule.port >= 0) {
+        int defaultPort = url.scheme() == QLatin1String("http") ? 80 : 443;
+        if (url.port(defaultPort) != rule.port) return false;
+    }
+
+    if (!rule.anyPath && !rule.pathRegex.match(url.path()).hasMatch()) {
+        return false;
+    }
+
+    if (!rule.anyQuery && !rule.queryRegex.match(url.query()).hasMatch()) {
+        return false;
+    }
+
+    return true;
+}
+
+QString UrlFilterTable::wildcardToRegex(const QString& wildcard)
+{
+    QString regex;
+    regex.reserve(wildcard.size() * 2);
+    for (QChar c : wildcard) {
+        if (c == '*') regex += ".*";
+        else if (c == '?') regex += '.';
+        else regex += QRegularExpression::escape(QString(c));
+    }
+    return regex;
+}
+
+bool UrlFilterTable::hostMatchesLiteral(const QString& host, const QString& ruleHost, bool exact)
+{
+    if (host.size() == ruleHost.size()) {
+        return host == ruleHost;
+    }
+    if (exact || host.size() < ruleHost.size() + 1) {
+        return false;
+    }
+    // Subdomain: host ends with "." + ruleHost
+    return host.endsWith(ruleHost) && host[host.size() - ruleHost.size() - 1] == '.';
+}
+
+} // namespace openlock
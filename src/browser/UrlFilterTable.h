@@ -0,0 +1,89 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QUrl>
+#include <QRegularExpression>
+#include <optional>
+#include <vector>
+
+namespace openlock {
+
+enum class UrlFilterAction {
+    Block = 0,
+    Allow = 1
+};
+
+// One entry of the SEB URLFilterRules array
+struct UrlFilterRule {
+    bool active = true;
+    bool regex = false;
+    QString expression;
+    UrlFilterAction action = UrlFilterAction::Block;
+
+    bool operator==(const UrlFilterRule& other) const
+    {
+        return active == other.active && regex == other.regex &&
+               expression == other.expression && action == other.action;
+    }
+    bool operator!=(const UrlFilterRule& other) const { return !(*this == other); }
+};
+
+// SEB URL filter rules compiled into an ordered decision table.
+// Rules keep SEB's first-match semantics: the earliest active rule in
+// config order that matches decides. Literal hosts are indexed so a
+// lookup only evaluates rules whose host can match, plus the (usually
+// few) regex and leading-wildcard rules.
+class UrlFilterTable {
+public:
+    UrlFilterTable();
+    explicit UrlFilterTable(const QList<UrlFilterRule>& rules);
+    ~UrlFilterTable();
+
+    bool isEmpty() const;
+    int size() const;
+
+    // Action of the first matching rule, or nullopt if no rule matched
+    std::optional<UrlFilterAction> match(const QUrl& url) const;
+
+    // Same; regex rules use urlString (url.toString()) instead of
+    // serializing url again
+    std::optional<UrlFilterAction> match(const QUrl& url, const QString& urlString) const;
+
+private:
+    struct CompiledRule {
+        UrlFilterAction action = UrlFilterAction::Block;
+        QRegularExpression urlRegex;    // regex rules: matched against the full URL
+
+        // Expression rules: scheme://[user:pass@]host[:port][/path][?query][#fragment]
+        QString scheme;                 // empty = any
+        QString host;                   // literal host; empty and !hostWildcard = any
+        QRegularExpression hostRegex;   // used when hostWildcard
+        bool hostWildcard = false;
+        bool exactHost = false;         // ".host" form: no subdomains
+        int port = -1;                  // -1 = any
+        bool anyPath = true;
+        QRegularExpression pathRegex;
+        bool anyQuery = true;
+        QRegularExpression queryRegex;
+        bool isRegex = false;
+    };
+
+    void compile(const UrlFilterRule& rule);
+    bool matches(const CompiledRule& rule, const QUrl& url, const QString& host,
+                 const QString& urlString) const;
+
+    static QString wildcardToRegex(const QString& wildcard);
+    static bool hostMatchesLiteral(const QString& host, const QString& ruleHost, bool exact);
+
+    std::vector<CompiledRule> m_rules;          // config order
+    QHash<QString, std::vector<int>> m_hostIndex;   // host suffix -> rule indices, ascending
+    std::vector<int> m_unindexedRules;          // regex and wildcard-host rules, ascending
+};
+
+} // namespace openlock
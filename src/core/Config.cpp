@@ -3,17 +3,52 @@
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "core/Config.h"
+#include "core/ConfigBundle.h"
+#include "core/SEBKeyTable.h"
+#include "protocol/SEBConfigParser.h"
 
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QXmlStreamReader>
 #include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include <utility>
 
 namespace openlock {
 
+// Plist bytes from the decoder go straight into the parser; the plist is
+// kept because the Browser Exam Key covers it, however the file was packed
+struct Config::SebStream {
+    QByteArray plist;
+    SEBSettings::Parser parser;
+    SEBConfigParser::Decoder decoder;
+
+    explicit SebStream(const QString& password)
+        : decoder(
+              [this](const char* data, qsizetype size) {
+                  plist.append(data, size);
+                  return parser.addData(QByteArrayView(data, size));
+              },
+              password)
+    {
+    }
+};
+
+struct Config::Download {
+    QUrl url;
+    ConfigFormat format = ConfigFormat::SEB;
+    QString password;
+    QNetworkReply* reply = nullptr;
+    QByteArray data;                    // the config file as downloaded
+    std::unique_ptr<SebStream> seb;     // null for .openlock configs
+};
+
 Config::Config(QObject* parent)
     : QObject(parent)
 {
@@ -21,7 +56,7 @@ Config::Config(QObject* parent)
 
 Config::~Config() = default;
 
-bool Config::loadFromFile(const QString& path)
+bool Config::loadFromFile(const QString& path, const QString& password)
 {
     QFile file(path);
     if (!file.open(QIODevice::ReadOnly)) {
@@ -29,41 +64,167 @@ bool Config::loadFromFile(const QString& path)
         return false;
     }
 
-    QByteArray data = file.readAll();
-    m_rawData = data;
+    m_examConfig.sebConfigPassword = password;
 
-    if (isSebFile(path)) {
-        m_format = ConfigFormat::SEB;
-        return parseSebConfig(data);
-    } else {
-        m_format = ConfigFormat::OpenLock;
-        return parseOpenLockConfig(data);
+    return loadData(file.readAll(),
+                    isSebFile(path) ? ConfigFormat::SEB : ConfigFormat::OpenLock);
+}
+
+bool Config::loadFromUrl(const QUrl& url, const QString& password)
+{
+    const QUrl configUrl = configUrlFromSebUrl(url);
+    if (configUrl.scheme() != "https" && configUrl.scheme() != "http") {
+        emit configError("Unsupported config URL: " + url.toString());
+        return false;
     }
+
+    cancelDownload();
+    if (!m_network) m_network = new QNetworkAccessManager(this);
+
+    QNetworkRequest request(configUrl);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    m_download = std::make_unique<Download>();
+    m_download->url = configUrl;
+    m_download->format =
+        isOpenLockFile(configUrl.path()) ? ConfigFormat::OpenLock : ConfigFormat::SEB;
+    m_download->password = password;
+    if (m_download->format == ConfigFormat::SEB) {
+        m_download->seb = std::make_unique<SebStream>(password);
+    }
+
+    QNetworkReply* reply = m_network->get(request);
+    m_download->reply = reply;
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply] { downloadReadyRead(reply); });
+    connect(reply, &QNetworkReply::finished, this, [this, reply] { downloadFinished(reply); });
+    return true;
+}
+
+bool Config::isLoading() const { return m_download != nullptr; }
+
+QUrl Config::configUrlFromSebUrl(const QUrl& url)
+{
+    // seb:// and sebs:// links name the config they open; both are
+    // fetched over HTTPS
+    if (url.scheme() == "seb" || url.scheme() == "sebs") {
+        QUrl https(url);
+        https.setScheme("https");
+        return https;
+    }
+    return url;
+}
+
+bool Config::loadFromBundle(const QString& path, const QString& examId)
+{
+    ConfigBundle bundle;
+    if (!bundle.open(path)) {
+        emit configError("Cannot open config bundle: " + path);
+        return false;
+    }
+
+    const int index = examId.isEmpty() ? bundle.findAt(QDateTime::currentDateTimeUtc())
+                                       : bundle.find(examId);
+    if (index < 0) {
+        emit configError(examId.isEmpty() ? "No exam in " + path + " is scheduled now"
+                                          : "No exam " + examId + " in " + path);
+        return false;
+    }
+
+    std::optional<ConfigBundle::Entry> entry = bundle.entry(index);
+    if (!entry) {
+        emit configError("Corrupt exam " + bundle.examId(index) + " in " + path);
+        return false;
+    }
+
+    m_examConfig = ExamConfig();
+    m_format = entry->format;
+    m_rawData = std::move(entry->rawData);
+    m_bundledBlocklist = bundle.domainBlocklist(index);
+    qInfo() << "Exam" << bundle.examId(index) << "selected from" << path;
+
+    // Only the selected exam is decoded. Its settings and keys are derived
+    // here, as from the file it was packed from.
+    if (m_format == ConfigFormat::OpenLock) {
+        return parseOpenLockConfig(m_rawData);
+    }
+    QString error;
+    if (!parseSebPlist(m_rawData, m_rawData, &error)) {
+        emit configError("Corrupt exam " + bundle.examId(index) + " in " + path + ": " + error);
+        return false;
+    }
+    emit configLoaded();
+    return true;
 }
 
-bool Config::loadFromUrl(const QUrl& url)
+std::shared_ptr<const DomainBlocklist> Config::bundledDomainBlocklist() const
 {
-    // Network loading will be implemented with QNetworkAccessManager
-    Q_UNUSED(url);
-    emit configError("URL config loading not yet implemented");
-    return false;
+    return m_bundledBlocklist;
 }
 
 bool Config::loadFromSebData(const QByteArray& data, const QString& password)
 {
     m_format = ConfigFormat::SEB;
     m_rawData = data;
+    m_examConfig.sebConfigPassword = password;
+    m_bundledBlocklist.reset();
 
-    QByteArray configData = data;
-    if (!password.isEmpty()) {
-        configData = decryptSebConfig(data, password);
-        if (configData.isEmpty()) {
-            emit configError("Failed to decrypt SEB config");
-            return false;
-        }
+    return parseSebConfig(data);
+}
+
+bool Config::loadData(const QByteArray& data, ConfigFormat format)
+{
+    m_rawData = data;
+    m_format = format;
+    m_bundledBlocklist.reset();
+    return format == ConfigFormat::SEB ? parseSebConfig(data) : parseOpenLockConfig(data);
+}
+
+void Config::downloadReadyRead(QNetworkReply* reply)
+{
+    if (!m_download || m_download->reply != reply) return;
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) return;
+
+    // Encrypted configs are decrypted and parsed as the bytes arrive
+    const QByteArray chunk = reply->readAll();
+    m_download->data += chunk;
+    if (m_download->seb) m_download->seb->decoder.addData(chunk);
+}
+
+void Config::downloadFinished(QNetworkReply* reply)
+{
+    reply->deleteLater();
+    if (!m_download || m_download->reply != reply) return;
+    downloadReadyRead(reply);
+    const std::unique_ptr<Download> download = std::move(m_download);
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError) {
+        emit configError("Config download failed: " + reply->errorString());
+        return;
+    }
+
+    if (status != 200) {
+        emit configError(QString("Config download failed: HTTP %1").arg(status));
+        return;
+    }
+
+    m_examConfig.sebConfigPassword = download->password;
+    m_bundledBlocklist.reset();
+    m_rawData = download->data;
+    m_format = download->format;
+    if (download->seb) {
+        finishSebConfig(*download->seb, download->data);
+    } else {
+        parseOpenLockConfig(download->data);
     }
+}
 
-    return parseSebConfig(configData);
+void Config::cancelDownload()
+{
+    if (!m_download) return;
+    const std::unique_ptr<Download> download = std::move(m_download);
+    download->reply->abort();
 }
 
 ConfigFormat Config::format() const { return m_format; }
@@ -76,6 +237,8 @@ QByteArray Config::configKeyHash() const
     return QCryptographicHash::hash(m_rawData, QCryptographicHash::Sha256);
 }
 
+std::shared_ptr<const SEBSettings> Config::sebSettings() const { return m_sebSettings; }
+
 bool Config::isSebFile(const QString& path)
 {
     return path.endsWith(".seb", Qt::CaseInsensitive);
@@ -97,6 +260,9 @@ bool Config::parseOpenLockConfig(const QByteArray& data)
 
     QJsonObject root = doc.object();
 
+    // JSON configs have no plist tree; drop one left by an earlier .seb load
+    m_sebSettings.reset();
+
     // General
     m_examConfig.examName = root["examName"].toString();
     m_examConfig.startUrl = QUrl(root["startUrl"].toString());
@@ -141,6 +307,14 @@ bool Config::parseOpenLockConfig(const QByteArray& data)
     for (const auto& v : network["ssoAllowedDomains"].toArray())
         m_examConfig.ssoAllowedDomains.append(v.toString());
     m_examConfig.allowWebRTC = network["allowWebRTC"].toBool(false);
+    for (const auto& v : network["blockThirdPartyResources"].toArray())
+        m_examConfig.blockedThirdPartyResources.append(v.toString());
+    m_examConfig.domainBlocklistPath = network["domainBlocklist"].toString();
+    for (const auto& v : network["contentFilterLists"].toArray())
+        m_examConfig.contentFilterLists.append(v.toString());
+    for (const auto& v : network["sebHeaderHosts"].toArray())
+        m_examConfig.sebHeaderHosts.append(v.toString());
+    m_examConfig.sebHeadersToAllHosts = network["sebHeadersToAllHosts"].toBool(false);
 
     emit configLoaded();
     return true;
@@ -148,103 +322,59 @@ bool Config::parseOpenLockConfig(const QByteArray& data)
 
 bool Config::parseSebConfig(const QByteArray& data)
 {
-    // SEB config files are XML plist format (Apple-style property lists)
-    // They may be prefixed with a 4-byte header indicating compression/encryption
-    m_examConfig.sebMode = true;
-    m_examConfig.sebConfigData = data;
-
-    QByteArray xmlData = data;
-
-    // Check for SEB config prefix bytes
-    // Prefix 'pswd' (0x70737764) = password encrypted
-    // Prefix 'phsk' (0x7068736B) = public key hash encrypted
-    // Prefix 'plnd' (0x706C6E64) = plaintext, compressed
-    // No prefix / starts with '<' = plain XML
-    if (xmlData.size() > 4) {
-        QByteArray prefix = xmlData.left(4);
-        if (prefix == "pswd" || prefix == "phsk") {
-            if (m_examConfig.sebConfigPassword.isEmpty()) {
-                emit configError("SEB config is encrypted. Password required.");
-                return false;
-            }
-            xmlData = decryptSebConfig(xmlData, m_examConfig.sebConfigPassword);
-            if (xmlData.isEmpty()) return false;
-        } else if (prefix == "plnd") {
-            // Compressed: skip prefix, decompress with zlib
-            xmlData = qUncompress(xmlData.mid(4));
-            if (xmlData.isEmpty()) {
-                emit configError("Failed to decompress SEB config");
-                return false;
-            }
-        }
-    }
-
-    // Parse XML plist
-    QXmlStreamReader xml(xmlData);
+    SebStream stream(m_examConfig.sebConfigPassword);
+    stream.decoder.addData(data);
+    return finishSebConfig(stream, data);
+}
 
-    // Navigate to the root dict
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isStartElement() && xml.name() == QStringLiteral("dict")) {
-            break;
-        }
-    }
+bool Config::finishSebConfig(SebStream& stream, const QByteArray& data)
+{
+    // SEB config files are XML or binary plists (Apple-style property lists)
+    // They may be prefixed with a 4-byte header indicating compression/encryption
 
-    // Parse key-value pairs from the plist dict
-    QString currentKey;
-    while (!xml.atEnd()) {
-        xml.readNext();
-
-        if (xml.isStartElement()) {
-            if (xml.name() == QStringLiteral("key")) {
-                currentKey = xml.readElementText();
-            } else if (xml.name() == QStringLiteral("string")) {
-                QString value = xml.readElementText();
-                if (currentKey == "startURL") {
-                    m_examConfig.startUrl = QUrl(value);
-                } else if (currentKey == "hashedQuitPassword") {
-                    m_examConfig.exitPassword = value;
-                } else if (currentKey == "browserUserAgent") {
-                    m_examConfig.userAgent = value;
-                }
-            } else if (xml.name() == QStringLiteral("true")) {
-                if (currentKey == "allowQuit") m_examConfig.allowQuit = true;
-                else if (currentKey == "enableJavaScript") m_examConfig.enableJavaScript = true;
-                else if (currentKey == "allowDownloads") m_examConfig.allowDownloads = true;
-                else if (currentKey == "enablePrinting") m_examConfig.allowPrint = true;
-                else if (currentKey == "allowBrowsingBackForward") m_examConfig.allowBackForward = true;
-                else if (currentKey == "enableClipboard") m_examConfig.allowClipboard = true;
-            } else if (xml.name() == QStringLiteral("false")) {
-                if (currentKey == "allowQuit") m_examConfig.allowQuit = false;
-                else if (currentKey == "enableJavaScript") m_examConfig.enableJavaScript = false;
-                else if (currentKey == "allowDownloads") m_examConfig.allowDownloads = false;
-                else if (currentKey == "enablePrinting") m_examConfig.allowPrint = false;
-                else if (currentKey == "allowBrowsingBackForward") m_examConfig.allowBackForward = false;
-                else if (currentKey == "enableClipboard") m_examConfig.allowClipboard = false;
-            } else if (xml.name() == QStringLiteral("integer")) {
-                // Handle integer config values as needed
-                xml.readElementText();
-            }
+    SEBConfigParser::Decoder& decoder = stream.decoder;
+    if (!decoder.finish()) {
+        if (decoder.error() == SEBConfigParser::Decoder::Error::Rejected) {
+            emit configError("Plist parse error: " + stream.parser.errorString());
+        } else {
+            emit configError(decoder.errorString());
         }
+        return false;
     }
 
-    if (xml.hasError()) {
-        emit configError("XML parse error: " + xml.errorString());
+    QString error;
+    std::shared_ptr<const SEBSettings> settings = stream.parser.finish(&error);
+    if (!settings) {
+        emit configError("Plist parse error: " + error);
         return false;
     }
+    applySebSettings(std::move(settings), stream.plist, data);
 
     emit configLoaded();
     return true;
 }
 
-QByteArray Config::decryptSebConfig(const QByteArray& encrypted, const QString& password)
+bool Config::parseSebPlist(const QByteArray& plist, const QByteArray& fileData,
+                           QString* error)
 {
-    // SEB uses AES-256-CBC with PBKDF2 key derivation
-    // Implementation requires OpenSSL - full implementation in Phase 4
-    Q_UNUSED(encrypted);
-    Q_UNUSED(password);
-    qWarning() << "SEB config decryption not yet fully implemented";
-    return {};
+    SEBSettings::Parser parser;
+    parser.addData(plist);
+    std::shared_ptr<const SEBSettings> settings = parser.finish(error);
+    if (!settings) return false;
+
+    m_format = ConfigFormat::SEB;
+    applySebSettings(std::move(settings), plist, fileData);
+    return true;
+}
+
+void Config::applySebSettings(std::shared_ptr<const SEBSettings> settings,
+                              const QByteArray& plist, const QByteArray& fileData)
+{
+    m_examConfig.sebMode = true;
+    m_examConfig.sebConfigData = fileData;
+    m_rawData = plist;
+    m_sebSettings = std::move(settings);
+    SEBKeyTable::apply(m_sebSettings->root(), m_examConfig);
 }
 
 } // namespace openlock
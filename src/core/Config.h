@@ -11,8 +11,18 @@
 #include <QVariantMap>
 #include <QJsonObject>
 
+#include "browser/UrlFilterTable.h"
+#include "protocol/SEBSettings.h"
+
+#include <memory>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
 namespace openlock {
 
+class DomainBlocklist;
+
 enum class ConfigFormat {
     OpenLock,   // Native JSON format (.openlock)
     SEB         // Safe Exam Browser plist format (.seb)
@@ -31,6 +41,8 @@ struct ExamConfig {
     bool allowNavigation = true;
     bool allowReload = true;
     bool allowBackForward = false;
+    bool urlFilterEnabled = false;
+    QList<UrlFilterRule> urlFilterRules;    // SEB URLFilterRules, in config order
 
     // Browser
     QString userAgent;
@@ -61,6 +73,11 @@ struct ExamConfig {
     // Network
     QStringList ssoAllowedDomains;
     bool allowWebRTC = false;
+    QStringList blockedThirdPartyResources;    // e.g. "media", "font", "ping"
+    QString domainBlocklistPath;               // hosts file, domain list or compiled image
+    QStringList contentFilterLists;            // EasyList-syntax network rule files
+    QStringList sebHeaderHosts;                // extra hosts that get SEB request headers
+    bool sebHeadersToAllHosts = false;         // every host gets them (leaks the keys)
 };
 
 class Config : public QObject {
@@ -70,16 +87,35 @@ public:
     explicit Config(QObject* parent = nullptr);
     ~Config() override;
 
-    bool loadFromFile(const QString& path);
-    bool loadFromUrl(const QUrl& url);
+    // password opens encrypted .seb files
+    bool loadFromFile(const QString& path, const QString& password = {});
     bool loadFromSebData(const QByteArray& data, const QString& password = {});
 
+    // Starts downloading the config and returns; the result is reported
+    // through configLoaded() or configError(). .seb configs are decrypted
+    // and parsed while the bytes arrive. seb:// and sebs:// URLs are
+    // fetched over HTTPS. Returns false if the URL cannot be fetched.
+    bool loadFromUrl(const QUrl& url, const QString& password = {});
+    bool isLoading() const;
+
+    static QUrl configUrlFromSebUrl(const QUrl& url);
+
+    // Loads one exam from a ConfigBundle: the one with this id or, without
+    // an id, the one scheduled for now
+    bool loadFromBundle(const QString& path, const QString& examId = {});
+
+    // Blocklist the bundle compiled for the loaded exam; null otherwise
+    std::shared_ptr<const DomainBlocklist> bundledDomainBlocklist() const;
+
     ConfigFormat format() const;
     const ExamConfig& examConfig() const;
 
     QByteArray rawConfigData() const;
     QByteArray configKeyHash() const;
 
+    // Parsed .seb settings, null for .openlock configs
+    std::shared_ptr<const SEBSettings> sebSettings() const;
+
     static bool isSebFile(const QString& path);
     static bool isOpenLockFile(const QString& path);
 
@@ -88,13 +124,29 @@ signals:
     void configError(const QString& message);
 
 private:
+    struct SebStream;
+    struct Download;
+
+    bool loadData(const QByteArray& data, ConfigFormat format);
     bool parseOpenLockConfig(const QByteArray& data);
     bool parseSebConfig(const QByteArray& data);
-    QByteArray decryptSebConfig(const QByteArray& encrypted, const QString& password);
+    bool parseSebPlist(const QByteArray& plist, const QByteArray& fileData, QString* error);
+    bool finishSebConfig(SebStream& stream, const QByteArray& data);
+    void downloadReadyRead(QNetworkReply* reply);
+    void downloadFinished(QNetworkReply* reply);
+    void cancelDownload();
+    void applySebSettings(std::shared_ptr<const SEBSettings> settings,
+                          const QByteArray& plist, const QByteArray& fileData);
 
     ConfigFormat m_format = ConfigFormat::OpenLock;
     ExamConfig m_examConfig;
     QByteArray m_rawData;
+    std::shared_ptr<const SEBSettings> m_sebSettings;
+
+    std::shared_ptr<const DomainBlocklist> m_bundledBlocklist;
+
+    QNetworkAccessManager* m_network = nullptr;
+    std::unique_ptr<Download> m_download;
 };
 
 } // namespace openlock
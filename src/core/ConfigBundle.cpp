@@ -0,0 +1,333 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "core/ConfigBundle.h"
+#include "browser/DomainBlocklist.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QTimeZone>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace openlock {
+
+namespace {
+
+constexpr char kMagic[8] = {'O', 'L', 'B', 'U', 'N', 'D', 'L', '1'};
+
+// Bump whenever Entry or its stream layout below changes
+constexpr quint32 kEntryFormat = 2;
+
+void writeEntry(QDataStream& out, const ConfigBundle::Entry& entry)
+{
+    out << quint8(entry.format) << entry.rawData;
+}
+
+bool readEntry(QDataStream& in, ConfigBundle::Entry& entry)
+{
+    quint8 format = 0;
+    in >> format >> entry.rawData;
+
+    entry.format = format == quint8(ConfigFormat::SEB) ? ConfigFormat::SEB
+                                                       : ConfigFormat::OpenLock;
+    return in.status() == QDataStream::Ok;
+}
+
+} // namespace
+
+// Native little-endian, every section 8-byte aligned
+struct ConfigBundle::Header {
+    char magic[8];
+    quint32 entryFormat;        // kEntryFormat
+    quint32 examCount;
+    quint64 slotOffset;         // Slot[examCount], sorted by id
+    quint64 windowOffset;       // quint32[windowCount], slots sorted by window start
+    quint64 windowCount;
+    quint64 totalSize;
+};
+
+struct ConfigBundle::Slot {
+    quint64 idOffset;           // UTF-8, compared bytewise
+    quint32 idLength;
+    quint32 reserved;
+    qint64 windowStart;         // ms since the epoch; both 0 without a window
+    qint64 windowEnd;
+    quint64 entryOffset;        // writeEntry() payload
+    quint64 entrySize;
+    quint64 blocklistOffset;    // compiled DomainBlocklist image
+    quint64 blocklistSize;      // 0 = none
+};
+
+ConfigBundle::ConfigBundle() = default;
+ConfigBundle::~ConfigBundle() = default;
+
+bool ConfigBundle::open(const QString& path)
+{
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_windows = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_file.reset();
+
+    if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN) return false;
+
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open config bundle:" << path;
+        return false;
+    }
+
+    const qint64 size = file->size();
+    const uchar* data = size >= qint64(sizeof(Header)) ? file->map(0, size) : nullptr;
+    const auto* header = reinterpret_cast<const Header*>(data);
+    if (!header || std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->totalSize != quint64(size)) {
+        qWarning() << "Invalid config bundle:" << path;
+        return false;
+    }
+    if (header->entryFormat != kEntryFormat) {
+        qWarning() << "Config bundle was written by another OpenLock version:" << path;
+        return false;
+    }
+
+    // Only the index is checked here; each exam's data is checked when used
+    m_data = data;
+    m_size = size;
+    if (header->slotOffset % 8 || header->windowOffset % 8 ||
+        header->windowCount > header->examCount ||
+        !range(header->slotOffset, quint64(header->examCount) * sizeof(Slot)) ||
+        !range(header->windowOffset, header->windowCount * sizeof(quint32))) {
+        qWarning() << "Invalid config bundle:" << path;
+        m_data = nullptr;
+        m_size = 0;
+        return false;
+    }
+
+    m_header = header;
+    m_slots = reinterpret_cast<const Slot*>(data + header->slotOffset);
+    m_windows = reinterpret_cast<const quint32*>(data + header->windowOffset);
+    m_file = std::move(file);
+    return true;
+}
+
+int ConfigBundle::examCount() const
+{
+    return m_header ? int(m_header->examCount) : 0;
+}
+
+int ConfigBundle::find(const QString& id) const
+{
+    if (!m_header) return -1;
+
+    const QByteArray key = id.toUtf8();
+    int lo = 0;
+    int hi = examCount();
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (idBytes(m_slots[mid]) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < examCount() && idBytes(m_slots[lo]) == key ? lo : -1;
+}
+
+int ConfigBundle::findAt(const QDateTime& time) const
+{
+    if (!m_header || !time.isValid()) return -1;
+
+    // Windows do not overlap, so only the last one starting by then can hold it
+    const qint64 msecs = time.toMSecsSinceEpoch();
+    quint64 lo = 0;
+    quint64 hi = m_header->windowCount;
+    while (lo < hi) {
+        const quint64 mid = lo + (hi - lo) / 2;
+        const Slot* s = slot(int(m_windows[mid]));
+        if (s && s->windowStart <= msecs) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return -1;
+
+    const int index = int(m_windows[lo - 1]);
+    const Slot* s = slot(index);
+    return s && msecs < s->windowEnd ? index : -1;
+}
+
+QString ConfigBundle::examId(int index) const
+{
+    const Slot* s = slot(index);
+    return s ? QString::fromUtf8(idBytes(*s)) : QString();
+}
+
+QDateTime ConfigBundle::windowStart(int index) const
+{
+    const Slot* s = slot(index);
+    if (!s || (s->windowStart == 0 && s->windowEnd == 0)) return {};
+    return QDateTime::fromMSecsSinceEpoch(s->windowStart, QTimeZone::utc());
+}
+
+QDateTime ConfigBundle::windowEnd(int index) const
+{
+    const Slot* s = slot(index);
+    if (!s || (s->windowStart == 0 && s->windowEnd == 0)) return {};
+    return QDateTime::fromMSecsSinceEpoch(s->windowEnd, QTimeZone::utc());
+}
+
+std::optional<ConfigBundle::Entry> ConfigBundle::entry(int index) const
+{
+    const Slot* s = slot(index);
+    const char* data = s ? range(s->entryOffset, s->entrySize) : nullptr;
+    if (!data) return std::nullopt;
+
+    // Read in place from the mapping
+    const QByteArray payload = QByteArray::fromRawData(data, qsizetype(s->entrySize));
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    Entry entry;
+    if (!readEntry(in, entry) || !in.atEnd()) {
+        qWarning() << "Corrupt exam in config bundle:" << examId(index);
+        return std::nullopt;
+    }
+    return entry;
+}
+
+std::shared_ptr<const DomainBlocklist> ConfigBundle::domainBlocklist(int index) const
+{
+    const Slot* s = slot(index);
+    if (!s || s->blocklistSize == 0 || !range(s->blocklistOffset, s->blocklistSize)) {
+        return nullptr;
+    }
+
+    auto blocklist = std::make_shared<DomainBlocklist>();
+    if (!blocklist->loadImage(m_file->fileName(), qint64(s->blocklistOffset),
+                              qint64(s->blocklistSize))) {
+        return nullptr;
+    }
+    return blocklist;
+}
+
+bool ConfigBundle::write(const QString& path, QList<Exam> exams)
+{
+    std::sort(exams.begin(), exams.end(), [](const Exam& a, const Exam& b) {
+        return a.id.toUtf8() < b.id.toUtf8();
+    });
+
+    std::vector<quint32> windows;
+    for (qsizetype i = 0; i < exams.size(); i++) {
+        const Exam& exam = exams[i];
+        if (exam.id.isEmpty() || (i > 0 && exam.id == exams[i - 1].id)) {
+            qWarning() << "Config bundle needs a unique id for every exam:" << exam.id;
+            return false;
+        }
+        if (exam.windowStart.isValid() != exam.windowEnd.isValid() ||
+            (exam.windowStart.isValid() && exam.windowStart >= exam.windowEnd)) {
+            qWarning() << "Invalid time window for exam" << exam.id;
+            return false;
+        }
+        if (exam.windowStart.isValid()) windows.push_back(quint32(i));
+    }
+
+    std::sort(windows.begin(), windows.end(), [&](quint32 a, quint32 b) {
+        return exams[a].windowStart < exams[b].windowStart;
+    });
+    for (size_t i = 1; i < windows.size(); i++) {
+        const Exam& previous = exams[windows[i - 1]];
+        const Exam& exam = exams[windows[i]];
+        if (previous.windowEnd > exam.windowStart) {
+            qWarning() << "Exams" << previous.id << "and" << exam.id << "overlap";
+            return false;
+        }
+    }
+
+    // Header, index, then the ids and every exam's data
+    QByteArray image(qsizetype(sizeof(Header)), '\0');
+    auto appendSection = [&image](const char* data, qsizetype size) {
+        const quint64 offset = quint64(image.size());
+        image.append(data, size);
+        image.append(qsizetype((8 - image.size() % 8) % 8), '\0');
+        return offset;
+    };
+
+    Header header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.entryFormat = kEntryFormat;
+    header.examCount = quint32(exams.size());
+    header.windowCount = windows.size();
+
+    std::vector<Slot> slots(size_t(exams.size()), Slot{});
+    header.slotOffset = appendSection(reinterpret_cast<const char*>(slots.data()),
+                                      qsizetype(slots.size() * sizeof(Slot)));
+    header.windowOffset = appendSection(reinterpret_cast<const char*>(windows.data()),
+                                        qsizetype(windows.size() * sizeof(quint32)));
+
+    for (qsizetype i = 0; i < exams.size(); i++) {
+        const Exam& exam = exams[i];
+        Slot& s = slots[size_t(i)];
+
+        const QByteArray id = exam.id.toUtf8();
+        s.idOffset = appendSection(id.constData(), id.size());
+        s.idLength = quint32(id.size());
+        if (exam.windowStart.isValid()) {
+            s.windowStart = exam.windowStart.toMSecsSinceEpoch();
+            s.windowEnd = exam.windowEnd.toMSecsSinceEpoch();
+        }
+
+        QByteArray payload;
+        {
+            QDataStream out(&payload, QIODevice::WriteOnly);
+            out.setVersion(QDataStream::Qt_6_0);
+            writeEntry(out, exam.entry);
+        }
+        s.entryOffset = appendSection(payload.constData(), payload.size());
+        s.entrySize = quint64(payload.size());
+
+        if (!exam.domainBlocklist.isEmpty()) {
+            s.blocklistOffset = appendSection(exam.domainBlocklist.constData(),
+                                              exam.domainBlocklist.size());
+            s.blocklistSize = quint64(exam.domainBlocklist.size());
+        }
+    }
+
+    header.totalSize = quint64(image.size());
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + header.slotOffset, slots.data(), slots.size() * sizeof(Slot));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write config bundle:" << path;
+        return false;
+    }
+    file.write(image);
+    return file.commit();
+}
+
+bool ConfigBundle::isBundleFile(const QString& path)
+{
+    return path.endsWith(".olbundle", Qt::CaseInsensitive);
+}
+
+const ConfigBundle::Slot* ConfigBundle::slot(int index) const
+{
+    if (!m_header || index < 0 || quint32(index) >= m_header->examCount) return nullptr;
+    return m_slots + index;
+}
+
+const char* ConfigBundle::range(quint64 offset, quint64 size) const
+{
+    if (offset > quint64(m_size) || size > quint64(m_size) - offset) return nullptr;
+    return reinterpret_cast<const char*>(m_data) + offset;
+}
+
+QByteArray ConfigBundle::idBytes(const Slot& slot) const
+{
+    const char* id = range(slot.idOffset, slot.idLength);
+    return id ? QByteArray::fromRawData(id, slot.idLength) : QByteArray();
+}
+
+} // namespace openlock
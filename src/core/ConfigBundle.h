@@ -0,0 +1,98 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "core/Config.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+#include <memory>
+#include <optional>
+
+class QFile;
+
+namespace openlock {
+
+class DomainBlocklist;
+
+// Many exam configs in one file, for lab machines that run a different
+// exam every period. Each exam is stored decoded (decrypted and
+// inflated), next to its domain blocklist compiled to an image. A bundle
+// is trusted like the config files it was packed from and belongs where
+// students cannot write. The SEB keys cover a .seb exam's settings only:
+// a .openlock exam has no keys, and neither key covers the blocklist.
+// Each blocklist image is validated when it is attached, so a damaged
+// one is refused rather than read out of bounds.
+//
+// Opening a bundle maps it and checks the header only. An exam is found
+// by id, or by the time window it is scheduled in, with a binary search
+// over the mapped index; only the exam found is decoded and parsed, so
+// launching costs the same for a bundle of three exams or three hundred.
+class ConfigBundle {
+public:
+    // One decoded exam config
+    struct Entry {
+        ConfigFormat format = ConfigFormat::OpenLock;
+        QByteArray rawData;             // Config::rawConfigData()
+    };
+
+    struct Exam {
+        QString id;
+        QDateTime windowStart;          // both invalid: selected by id only
+        QDateTime windowEnd;
+        Entry entry;
+        QByteArray domainBlocklist;     // DomainBlocklist::compiledImage(), or empty
+    };
+
+    ConfigBundle();
+    ~ConfigBundle();
+
+    ConfigBundle(const ConfigBundle&) = delete;
+    ConfigBundle& operator=(const ConfigBundle&) = delete;
+
+    bool open(const QString& path);
+    bool isOpen() const { return m_header != nullptr; }
+    int examCount() const;
+
+    // Index of the exam, or -1
+    int find(const QString& id) const;
+    int findAt(const QDateTime& time) const;    // windowStart <= time < windowEnd
+
+    QString examId(int index) const;
+    QDateTime windowStart(int index) const;
+    QDateTime windowEnd(int index) const;
+
+    // Decodes one exam; nullopt if its entry is damaged
+    std::optional<Entry> entry(int index) const;
+
+    // Copies the exam's compiled blocklist out of the bundle; null if it
+    // has none
+    std::shared_ptr<const DomainBlocklist> domainBlocklist(int index) const;
+
+    // Fails on empty or duplicate ids and on overlapping windows
+    static bool write(const QString& path, QList<Exam> exams);
+
+    static bool isBundleFile(const QString& path);
+
+private:
+    struct Header;
+    struct Slot;
+
+    const Slot* slot(int index) const;
+    const char* range(quint64 offset, quint64 size) const;
+    QByteArray idBytes(const Slot& slot) const;
+
+    std::unique_ptr<QFile> m_file;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+    const Header* m_header = nullptr;
+    const Slot* m_slots = nullptr;
+    const quint32* m_windows = nullptr;     // slot indexes by window start
+};
+
+} // namespace openlock
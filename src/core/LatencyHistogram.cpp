@@ -0,0 +1,168 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "core/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace openlock {
+
+namespace {
+
+std::atomic<quint64> s_recorderIds{0};
+
+int highestBit(quint64 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+#endif
+}
+
+} // namespace
+
+int LatencyHistogram::bucketFor(quint64 ns)
+{
+    if (ns < quint64(kSubBuckets)) return int(ns);
+
+    const int magnitude = highestBit(ns);
+    if (magnitude > kMaxMagnitude) return kBucketCount - 1;
+
+    // Top kSubBucketBits bits below the leading one pick the sub-bucket
+    const int shift = magnitude - kSubBucketBits;
+    const int sub = int(ns >> shift) - kSubBuckets;
+    return (shift + 1) * kSubBuckets + sub;
+}
+
+quint64 LatencyHistogram::bucketLowerBound(int bucket)
+{
+    const int group = bucket / kSubBuckets;
+    const quint64 sub = quint64(bucket % kSubBuckets);
+    if (group == 0) return sub;
+    return (quint64(kSubBuckets) + sub) << (group - 1);
+}
+
+quint64 LatencyHistogram::bucketUpperBound(int bucket)
+{
+    const int group = bucket / kSubBuckets;
+    const quint64 width = group == 0 ? 1 : quint64(1) << (group - 1);
+    return bucketLowerBound(bucket) + width - 1;
+}
+
+void LatencyHistogram::add(int bucket, quint64 count)
+{
+    if (count == 0 || bucket < 0 || bucket >= kBucketCount) return;
+    m_buckets[bucket] += count;
+    m_count += count;
+    m_totalNs += count * ((bucketLowerBound(bucket) + bucketUpperBound(bucket)) / 2);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (int i = 0; i < kBucketCount; i++) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_totalNs += other.m_totalNs;
+}
+
+quint64 LatencyHistogram::percentile(double p) const
+{
+    if (m_count == 0) return 0;
+
+    const double clamped = std::clamp(p, 0.0, 100.0);
+    const quint64 rank = std::max<quint64>(1, quint64(std::ceil(clamped / 100.0 * m_count)));
+    quint64 seen = 0;
+    for (int i = 0; i < kBucketCount; i++) {
+        seen += m_buckets[i];
+        if (seen >= rank) return bucketUpperBound(i);
+    }
+    return bucketUpperBound(kBucketCount - 1);
+}
+
+quint64 LatencyHistogram::maxNs() const
+{
+    for (int i = kBucketCount - 1; i >= 0; i--) {
+        if (m_buckets[i]) return bucketUpperBound(i);
+    }
+    return 0;
+}
+
+double LatencyHistogram::meanNs() const
+{
+    return m_count ? double(m_totalNs) / double(m_count) : 0.0;
+}
+
+LatencyRecorder::LatencyRecorder(int seriesCount)
+    : m_seriesCount(std::max(seriesCount, 1))
+    , m_id(++s_recorderIds)
+{
+}
+
+LatencyRecorder::~LatencyRecorder() = default;
+
+LatencyRecorder::ThreadCounters* LatencyRecorder::countersForThisThread()
+{
+    // One-entry cache: a thread nearly always records into one recorder.
+    // Keyed by id rather than address, so a recorder allocated where a
+    // destroyed one lived never inherits its counters.
+    struct Cached {
+        quint64 recorderId = 0;
+        ThreadCounters* counters = nullptr;
+    };
+    thread_local Cached cached;
+    if (cached.recorderId == m_id) return cached.counters;
+
+    // Counters are owned by the recorder, so they outlive their thread
+    // and still show up in snapshot()
+    const std::thread::id self = std::this_thread::get_id();
+    QMutexLocker locker(&m_mutex);
+    ThreadCounters* counters = nullptr;
+    for (const auto& entry : m_threads) {
+        if (entry->owner == self) {
+            counters = entry.get();
+            break;
+        }
+    }
+    if (!counters) {
+        m_threads.push_back(std::make_unique<ThreadCounters>(self, m_seriesCount));
+        counters = m_threads.back().get();
+    }
+    cached = {m_id, counters};
+    return counters;
+}
+
+void LatencyRecorder::record(int series, quint64 ns)
+{
+    if (series < 0 || series >= m_seriesCount) return;
+
+    // Only this thread writes these counters: a relaxed load and store
+    // is enough and avoids a locked read-modify-write
+    std::atomic<quint32>& counter =
+        countersForThisThread()->buckets[size_t(series) * LatencyHistogram::kBucketCount +
+                                         LatencyHistogram::bucketFor(ns)];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+LatencyHistogram LatencyRecorder::snapshot(int series) const
+{
+    LatencyHistogram histogram;
+    if (series < 0 || series >= m_seriesCount) return histogram;
+
+    QMutexLocker locker(&m_mutex);
+    for (const auto& counters : m_threads) {
+        const std::atomic<quint32>* row =
+            counters->buckets.get() + size_t(series) * LatencyHistogram::kBucketCount;
+        for (int i = 0; i < LatencyHistogram::kBucketCount; i++) {
+            histogram.add(i, row[i].load(std::memory_order_relaxed));
+        }
+    }
+    return histogram;
+}
+
+} // namespace openlock
@@ -0,0 +1,87 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QtGlobal>
+#include <QMutex>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace openlock {
+
+// Log-linear latency histogram in the style of HdrHistogram: each power
+// of two is split into 8 linear sub-buckets, so any recorded value is
+// reported within 12.5%. Covers 0 ns to ~68 s; larger values land in
+// the last bucket.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxMagnitude = 35;
+    static constexpr int kBucketCount = (kMaxMagnitude - kSubBucketBits + 2) * kSubBuckets;
+
+    static int bucketFor(quint64 ns);
+    static quint64 bucketLowerBound(int bucket);
+    static quint64 bucketUpperBound(int bucket);    // inclusive
+
+    void add(int bucket, quint64 count);
+    void merge(const LatencyHistogram& other);
+
+    quint64 count() const { return m_count; }
+    quint64 totalNs() const { return m_totalNs; }
+
+    // Upper bound of the bucket holding the given percentile (0..100)
+    quint64 percentile(double p) const;
+    quint64 maxNs() const;
+    double meanNs() const;
+
+private:
+    std::array<quint64, kBucketCount> m_buckets{};
+    quint64 m_count = 0;
+    quint64 m_totalNs = 0;      // from bucket midpoints
+};
+
+// Several latency series recorded concurrently. Each thread writes its
+// own counters, claimed on first use, with relaxed single-writer
+// increments: no lock and no shared cache line on the record path.
+// snapshot() merges every thread's counters for one series.
+class LatencyRecorder {
+public:
+    explicit LatencyRecorder(int seriesCount);
+    ~LatencyRecorder();
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    void record(int series, quint64 ns);
+
+    LatencyHistogram snapshot(int series) const;
+    int seriesCount() const { return m_seriesCount; }
+
+private:
+    struct ThreadCounters {
+        ThreadCounters(std::thread::id owner, int seriesCount)
+            : owner(owner)
+            , buckets(new std::atomic<quint32>[size_t(seriesCount) * LatencyHistogram::kBucketCount]())
+        {
+        }
+        const std::thread::id owner;
+        std::unique_ptr<std::atomic<quint32>[]> buckets;    // series-major
+    };
+
+    ThreadCounters* countersForThisThread();
+
+    const int m_seriesCount;
+    const quint64 m_id;                 // distinguishes recorders in the thread cache
+
+    mutable QMutex m_mutex;             // guards m_threads (registration, snapshot)
+    std::vector<std::unique_ptr<ThreadCounters>> m_threads;
+};
+
+} // namespace openlock
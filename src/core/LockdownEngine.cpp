@@ -4,6 +4,7 @@
 
 #include "core/LockdownEngine.h"
 #include "core/Config.h"
+#include "core/ConfigBundle.h"
 #include "kiosk/KioskShell.h"
 #include "guard/ProcessGuard.h"
 #include "input/InputLockdown.h"
@@ -11,11 +12,15 @@
 #include "browser/SecureBrowser.h"
 #include "protocol/SEBProtocol.h"
 #include "protocol/SEBRequestInterceptor.h"
+#include "lms/LMSAdapter.h"
 
 #include <QDebug>
 #include <QFile>
 #include <QWebEngineProfile>
 #include <QCoreApplication>
+#include <QtConcurrent>
+
+#include <utility>
 
 namespace openlock {
 
@@ -33,6 +38,12 @@ LockdownEngine::LockdownEngine(QObject* parent)
             this, [this](const ProcessInfo& proc) {
         emit blockedProcessDetected(proc.name, proc.pid);
     });
+    connect(m_config.get(), &Config::configLoaded, this, [this] {
+        if (!m_configUrl.isEmpty()) configDownloaded();
+    });
+    connect(m_config.get(), &Config::configError, this, [this](const QString& message) {
+        if (!m_configUrl.isEmpty()) configDownloadFailed(message);
+    });
 }
 
 LockdownEngine::~LockdownEngine()
@@ -40,22 +51,68 @@ LockdownEngine::~LockdownEngine()
     if (m_state == LockdownState::Locked || m_state == LockdownState::ExamActive) {
         releaseLockdown();
     }
+    m_integrityCheck.waitForFinished();
 }
 
-bool LockdownEngine::initialize(const QString& configPath)
+bool LockdownEngine::initialize(const QString& configPath, const QString& examId,
+                                const QString& password)
 {
     m_state = LockdownState::Initializing;
     emit stateChanged(m_state);
 
-    // Load configuration
-    if (!configPath.isEmpty()) {
-        if (!m_config->loadFromFile(configPath)) {
+    // Load configuration; bundled exams are stored decoded
+    if (ConfigBundle::isBundleFile(configPath)) {
+        if (!m_config->loadFromBundle(configPath, examId)) {
+            m_state = LockdownState::Error;
+            emit errorOccurred("Failed to load config: " + configPath);
+            return false;
+        }
+    } else if (!configPath.isEmpty()) {
+        if (!m_config->loadFromFile(configPath, password)) {
             m_state = LockdownState::Error;
             emit errorOccurred("Failed to load config: " + configPath);
             return false;
         }
     }
 
+    return setupComponents();
+}
+
+bool LockdownEngine::initializeFromUrl(const QUrl& url, const QString& password)
+{
+    m_state = LockdownState::Initializing;
+    emit stateChanged(m_state);
+
+    if (!m_config->loadFromUrl(url, password)) {
+        m_state = LockdownState::Error;
+        emit errorOccurred("Failed to load config: " + url.toString());
+        return false;
+    }
+    m_configUrl = url;
+
+    // Nothing the integrity checks look at depends on the config
+    const SystemIntegrity* integrity = m_integrity.get();
+    m_integrityCheck = QtConcurrent::run([integrity] { return integrity->performFullCheck(); });
+    qInfo() << "Downloading config from" << url.toString();
+    return true;
+}
+
+void LockdownEngine::configDownloaded()
+{
+    m_configUrl.clear();
+    emit initialized(setupComponents());
+}
+
+void LockdownEngine::configDownloadFailed(const QString& message)
+{
+    const QUrl url = std::exchange(m_configUrl, QUrl());
+    m_state = LockdownState::Error;
+    emit errorOccurred("Failed to load config: " + url.toString() + ": " + message);
+    emit initialized(false);
+}
+
+bool LockdownEngine::setupComponents()
+{
     // Initialize browser with config
     if (!m_browser->initialize(m_config.get())) {
         m_state = LockdownState::Error;
@@ -75,12 +132,33 @@ bool LockdownEngine::initialize(const QString& configPath)
 
     // Install URL request interceptor for SEB headers and URL filtering
     auto* interceptor = new SEBRequestInterceptor(this);
+    m_interceptor = interceptor;
     if (examConfig.sebMode) {
         interceptor->setSEBProtocol(m_sebProtocol.get());
+        const QStringList headerHosts =
+            LMSAdapter::sebHeaderHosts(examConfig.startUrl) + examConfig.sebHeaderHosts;
+        interceptor->setSEBHeaderHosts(headerHosts);
+        interceptor->setSEBHeadersToAllHosts(examConfig.sebHeadersToAllHosts);
+        if (examConfig.sebHeadersToAllHosts) {
+            qWarning() << "SEB request headers are sent to every host;"
+                       << "any site the exam loads sees the exam key hashes";
+        } else if (headerHosts.isEmpty()) {
+            qWarning() << "No SEB header hosts: the start URL has no host and"
+                       << "sebHeaderHosts is empty, so no request gets SEB headers";
+        }
     }
     if (m_browser->navigationFilter()) {
         interceptor->setNavigationFilter(m_browser->navigationFilter());
     }
+    interceptor->setThirdPartyBlockedTypes(
+        SEBRequestInterceptor::resourceTypesFromNames(examConfig.blockedThirdPartyResources));
+    if (!examConfig.contentFilterLists.isEmpty()) {
+        auto blocker = std::make_shared<ContentBlocker>();
+        blocker->loadFromFiles(examConfig.contentFilterLists);
+        qInfo() << "Content blocker loaded" << blocker->ruleCount() << "rules,"
+                << blocker->skippedRuleCount() << "skipped";
+        interceptor->setContentBlocker(std::move(blocker));
+    }
     // Get the profile from the browser's web view and install interceptor
     if (m_browser->webView() && m_browser->webView()->page()) {
         m_browser->webView()->page()->profile()->setUrlRequestInterceptor(interceptor);
@@ -100,6 +178,15 @@ bool LockdownEngine::initialize(const QString& configPath)
     if (!m_processGuard->initialize(blocklistPath)) {
         qWarning() << "Process guard initialization failed";
     }
+    for (const QString& name : examConfig.processBlocklist) {
+        m_processGuard->addToBlocklist(name);
+    }
+    for (const QString& name : examConfig.additionalAllowedProcesses) {
+        m_processGuard->addToAllowlist(name);
+    }
+
+    m_inputLockdown->setClipboardAllowed(examConfig.allowClipboard);
+    m_inputLockdown->setPrintAllowed(examConfig.allowPrint);
 
     m_state = LockdownState::Idle;
     emit stateChanged(m_state);
@@ -153,6 +240,7 @@ bool LockdownEngine::releaseLockdown(const QString& exitPassword)
     m_processGuard->stopMonitoring();
     m_inputLockdown->release();
     m_kiosk->release();
+    logRequestStats();
 
     m_state = LockdownState::Idle;
     emit stateChanged(m_state);
@@ -166,6 +254,23 @@ LockdownState LockdownEngine::state() const { return m_state; }
 Config* LockdownEngine::config() const { return m_config.get(); }
 SecureBrowser* LockdownEngine::browser() const { return m_browser.get(); }
 
+void LockdownEngine::logRequestStats() const
+{
+    if (!m_interceptor) return;
+
+    const auto stats = m_interceptor->headerCacheStats();
+    if (stats.hits + stats.misses > 0) {
+        qInfo().nospace() << "SEB header cache: " << stats.hits << " hits, " << stats.misses
+                          << " misses (" << qRound(stats.hitRate() * 100) << "%), "
+                          << stats.evictions << " evictions, "
+                          << stats.savedNs / 1000 << " us hashing saved";
+    }
+
+    for (const QString& line : m_interceptor->latencySummary()) {
+        qInfo().noquote() << "Interceptor latency" << line;
+    }
+}
+
 bool LockdownEngine::performPreChecks()
 {
     if (!checkSystemIntegrity()) {
@@ -204,13 +309,20 @@ bool LockdownEngine::startInputLockdown()
 
 bool LockdownEngine::checkSystemIntegrity()
 {
-    auto report = m_integrity->performFullCheck();
+    // Reuse the report of the check that ran during the config download
+    auto report = m_integrityCheck.isValid() ? m_integrityCheck.result()
+                                             : m_integrity->performFullCheck();
+    m_integrityCheck = {};
 
     if (!report.passed) {
         if (report.vmDetected) {
             emit errorOccurred("Virtual machine detected: " + report.vmType +
                              ". Exams cannot be taken in a virtual machine.");
         }
+        if (!report.vmChecksTimedOut.isEmpty()) {
+            emit errorOccurred("Virtual machine detection did not finish (" +
+                             report.vmChecksTimedOut.join(", ") + "). Please try again.");
+        }
         if (report.debuggerDetected) {
             emit errorOccurred("Debugger detected: " + report.debuggerType +
                              ". Please detach all debuggers.");
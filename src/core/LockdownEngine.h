@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include "integrity/SystemIntegrity.h"
+
+#include <QFuture>
 #include <QObject>
+#include <QUrl>
 #include <memory>
 
 namespace openlock {
@@ -16,6 +20,7 @@ class InputLockdown;
 class SystemIntegrity;
 class SecureBrowser;
 class SEBProtocol;
+class SEBRequestInterceptor;
 
 enum class LockdownState {
     Idle,
@@ -34,7 +39,15 @@ public:
     explicit LockdownEngine(QObject* parent = nullptr);
     ~LockdownEngine() override;
 
-    bool initialize(const QString& configPath);
+    // examId picks the exam from a .olbundle; without one, the exam
+    // scheduled for now is used. password opens an encrypted .seb.
+    bool initialize(const QString& configPath, const QString& examId = {},
+                    const QString& password = {});
+
+    // Downloads the config and returns; initialized() reports the outcome.
+    // Integrity checks run while the download is in progress.
+    bool initializeFromUrl(const QUrl& url, const QString& password = {});
+
     bool engageLockdown();
     bool releaseLockdown(const QString& exitPassword = {});
     LockdownState state() const;
@@ -43,6 +56,7 @@ public:
     SecureBrowser* browser() const;
 
 signals:
+    void initialized(bool ok);
     void stateChanged(LockdownState newState);
     void lockdownEngaged();
     void lockdownReleased();
@@ -50,11 +64,15 @@ signals:
     void blockedProcessDetected(const QString& processName, int pid);
 
 private:
+    bool setupComponents();
+    void configDownloaded();
+    void configDownloadFailed(const QString& message);
     bool performPreChecks();
     bool startKiosk();
     bool startProcessGuard();
     bool startInputLockdown();
     bool checkSystemIntegrity();
+    void logRequestStats() const;
 
     LockdownState m_state = LockdownState::Idle;
     std::unique_ptr<Config> m_config;
@@ -64,6 +82,10 @@ private:
     std::unique_ptr<SystemIntegrity> m_integrity;
     std::unique_ptr<SecureBrowser> m_browser;
     std::unique_ptr<SEBProtocol> m_sebProtocol;
+    SEBRequestInterceptor* m_interceptor = nullptr;   // owned by this (QObject parent)
+
+    QUrl m_configUrl;                           // set while the config downloads
+    QFuture<IntegrityReport> m_integrityCheck;  // started during the download
 };
 
 } // namespace openlock
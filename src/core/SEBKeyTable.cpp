@@ -0,0 +1,184 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "core/SEBKeyTable.h"
+#include "protocol/SEBKeyIndex.h"
+
+#include <iterator>
+#include <utility>
+
+namespace openlock {
+
+namespace {
+
+using Type = SEBSettings::Type;
+using Value = SEBSettings::Value;
+using Setter = void (*)(ExamConfig&, const Value&);
+
+struct KeyHandler {
+    std::u16string_view key;
+    Type type;
+    Setter apply;
+};
+
+template<bool ExamConfig::*Field>
+void setBool(ExamConfig& config, const Value& value) { config.*Field = value.toBool(); }
+
+// allow* keys for what OpenLock checks for (e.g. allowVirtualMachine)
+template<bool ExamConfig::*Field>
+void setNotBool(ExamConfig& config, const Value& value) { config.*Field = !value.toBool(); }
+
+template<QString ExamConfig::*Field>
+void setString(ExamConfig& config, const Value& value) { config.*Field = value.toString(); }
+
+void setStartUrl(ExamConfig& config, const Value& value)
+{
+    config.startUrl = QUrl(value.toString());
+}
+
+void setUrlFilterRules(ExamConfig& config, const Value& rules)
+{
+    // <array> of <dict> { action: 0 block / 1 allow, active, expression, regex }
+    QList<UrlFilterRule> result;
+    result.reserve(rules.size());
+
+    for (qsizetype i = 0; i < rules.size(); i++) {
+        const Value dict = rules.at(i);
+        if (!dict.isDict()) continue;
+
+        UrlFilterRule rule;
+        rule.expression = dict[u"expression"].toString();
+        if (rule.expression.isEmpty()) continue;
+
+        rule.action = dict[u"action"].toInteger() == 1 ? UrlFilterAction::Allow
+                                                       : UrlFilterAction::Block;
+        rule.active = dict[u"active"].toBool(rule.active);
+        rule.regex = dict[u"regex"].toBool(rule.regex);
+        result.append(rule);
+    }
+
+    config.urlFilterRules = std::move(result);
+}
+
+// <array> of <dict> { active, executable, ... }; inactive entries are
+// kept in exported configs but not enforced
+QStringList activeExecutables(const Value& processes)
+{
+    QStringList names;
+    for (qsizetype i = 0; i < processes.size(); i++) {
+        const Value dict = processes.at(i);
+        if (!dict[u"active"].toBool(true)) continue;
+        const QString executable = dict[u"executable"].toString();
+        if (!executable.isEmpty()) names << executable;
+    }
+    return names;
+}
+
+void setProhibitedProcesses(ExamConfig& config, const Value& processes)
+{
+    config.processBlocklist = activeExecutables(processes);
+}
+
+void setPermittedProcesses(ExamConfig& config, const Value& processes)
+{
+    config.additionalAllowedProcesses = activeExecutables(processes);
+}
+
+void setBrowserViewMode(ExamConfig& config, const Value& value)
+{
+    // 0 window, 1 full screen, 2 touch (full screen too)
+    config.fullscreen = value.toInteger() != 0;
+}
+
+void setAllowedDisplays(ExamConfig& config, const Value& value)
+{
+    config.multiMonitorLockdown = value.toInteger() <= 1;
+}
+
+// Top-level keys only; nested dicts (e.g. in URLFilterRules or embedded
+// certificates) reuse some of the names
+constexpr KeyHandler kHandlers[] = {
+    // General
+    {u"startURL", Type::String, setStartUrl},
+    {u"hashedQuitPassword", Type::String, setString<&ExamConfig::exitPassword>},
+    {u"allowQuit", Type::Bool, setBool<&ExamConfig::allowQuit>},
+
+    // Navigation
+    {u"allowBrowsingBackForward", Type::Bool, setBool<&ExamConfig::allowBackForward>},
+    {u"browserWindowAllowReload", Type::Bool, setBool<&ExamConfig::allowReload>},
+    {u"URLFilterEnable", Type::Bool, setBool<&ExamConfig::urlFilterEnabled>},
+    {u"URLFilterRules", Type::Array, setUrlFilterRules},
+
+    // Browser
+    {u"browserUserAgent", Type::String, setString<&ExamConfig::userAgent>},
+    {u"enableJavaScript", Type::Bool, setBool<&ExamConfig::enableJavaScript>},
+    {u"enablePlugIns", Type::Bool, setBool<&ExamConfig::enablePlugins>},
+    {u"allowDownUploads", Type::Bool, setBool<&ExamConfig::allowDownloads>},
+    {u"allowDownloads", Type::Bool, setBool<&ExamConfig::allowDownloads>},
+    {u"enablePrinting", Type::Bool, setBool<&ExamConfig::allowPrint>},
+    {u"enableClipboard", Type::Bool, setBool<&ExamConfig::allowClipboard>},
+    {u"enableBrowserWindowToolbar", Type::Bool, setBool<&ExamConfig::showToolbar>},
+
+    // Kiosk
+    {u"browserViewMode", Type::Integer, setBrowserViewMode},
+    {u"allowedDisplaysMaxNumber", Type::Integer, setAllowedDisplays},
+    {u"allowSwitchToApplications", Type::Bool, setNotBool<&ExamConfig::blockTaskSwitching>},
+
+    // Security
+    {u"allowVirtualMachine", Type::Bool, setNotBool<&ExamConfig::detectVM>},
+    {u"enablePrintScreen", Type::Bool, setBool<&ExamConfig::allowScreenCapture>},
+    {u"permittedProcesses", Type::Array, setPermittedProcesses},
+    {u"prohibitedProcesses", Type::Array, setProhibitedProcesses},
+};
+
+constexpr std::size_t kKeyCount = std::size(kHandlers);
+
+template<std::size_t... I>
+constexpr std::array<std::u16string_view, kKeyCount> handlerKeys(std::index_sequence<I...>)
+{
+    return {kHandlers[I].key...};
+}
+
+constexpr SEBKeyIndex<kKeyCount> kIndex(handlerKeys(std::make_index_sequence<kKeyCount>()));
+
+static_assert(kIndex.indexOf(u"startURL") == 0);
+static_assert(kIndex.indexOf(u"prohibitedProcesses") == kKeyCount - 1);
+static_assert(kIndex.indexOf(u"starturl") == -1);
+
+} // namespace
+
+int SEBKeyTable::apply(const SEBSettings::Value& root, ExamConfig& config)
+{
+    int applied = 0;
+    for (qsizetype i = 0; i < root.size(); i++) {
+        const int index = kIndex.indexOf(root.keyAt(i));
+        if (index < 0) continue;
+
+        const KeyHandler& handler = kHandlers[index];
+        const Value value = root.at(i);
+        if (value.type() != handler.type) continue;
+
+        handler.apply(config, value);
+        applied++;
+    }
+    return applied;
+}
+
+bool SEBKeyTable::isKnown(QStringView key) { return kIndex.indexOf(key) >= 0; }
+
+SEBSettings::Type SEBKeyTable::expectedType(QStringView key)
+{
+    const int index = kIndex.indexOf(key);
+    return index < 0 ? Type::Invalid : kHandlers[index].type;
+}
+
+int SEBKeyTable::keyCount() { return int(kKeyCount); }
+
+QStringView SEBKeyTable::keyAt(int index)
+{
+    const std::u16string_view key = kHandlers[index].key;
+    return QStringView(key.data(), qsizetype(key.size()));
+}
+
+} // namespace openlock
@@ -0,0 +1,31 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "core/Config.h"
+#include "protocol/SEBSettings.h"
+
+#include <QStringView>
+
+namespace openlock {
+
+// The SEB settings keys OpenLock understands, each with the plist type it
+// expects and the ExamConfig field it sets. The table is a compile-time
+// perfect hash (SEBKeyIndex), so applying a config is one pass over its
+// top-level dict with an O(1) lookup per key. Keys not in the table, and
+// values of another type than expected, are ignored.
+class SEBKeyTable {
+public:
+    // Applies every known top-level key of root in document order (the
+    // last of duplicate keys wins) and returns how many were applied
+    static int apply(const SEBSettings::Value& root, ExamConfig& config);
+
+    static bool isKnown(QStringView key);
+    static SEBSettings::Type expectedType(QStringView key);   // Invalid if unknown
+    static int keyCount();
+    static QStringView keyAt(int index);
+};
+
+} // namespace openlock
@@ -18,6 +18,7 @@ namespace openlock {
 ProcessGuard::ProcessGuard(QObject* parent)
     : QObject(parent)
     , m_blocklist(std::make_unique<ProcessBlocklist>())
+    , m_addedBlocklist(std::make_unique<ProcessBlocklist>())
     , m_timer(new QTimer(this))
 {
     connect(m_timer, &QTimer::timeout, this, &ProcessGuard::performScan);
@@ -35,7 +36,12 @@ bool ProcessGuard::initialize(const QString& blocklistPath)
 
 void ProcessGuard::addToBlocklist(const QString& processName)
 {
-    m_blocklist->add(processName);
+    m_addedBlocklist->add(processName);
+}
+
+void ProcessGuard::removeFromBlocklist(const QString& processName)
+{
+    m_addedBlocklist->remove(processName);
 }
 
 void ProcessGuard::addToAllowlist(const QString& processName)
@@ -43,6 +49,11 @@ void ProcessGuard::addToAllowlist(const QString& processName)
     m_allowlist.insert(processName.toLower());
 }
 
+void ProcessGuard::removeFromAllowlist(const QString& processName)
+{
+    m_allowlist.remove(processName.toLower());
+}
+
 std::vector<ProcessInfo> ProcessGuard::scanForBlockedProcesses() const
 {
     std::vector<ProcessInfo> blocked;
@@ -183,7 +194,8 @@ bool ProcessGuard::isBlocked(const ProcessInfo& proc) const
     if (m_allowlist.contains(proc.name.toLower())) return false;
 
     // Check blocklist
-    return m_blocklist->isBlocked(proc.name, proc.cmdline, proc.exe);
+    return m_blocklist->isBlocked(proc.name, proc.cmdline, proc.exe) ||
+           m_addedBlocklist->isBlocked(proc.name, proc.cmdline, proc.exe);
 }
 
 } // namespace openlock
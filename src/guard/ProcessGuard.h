@@ -30,8 +30,14 @@ public:
     ~ProcessGuard() override;
 
     bool initialize(const QString& blocklistPath);
+
+    // Names blocked or allowed on top of the blocklist file, e.g. by the
+    // exam config. Removing one takes back only what was added here; the
+    // next scan sees the change.
     void addToBlocklist(const QString& processName);
+    void removeFromBlocklist(const QString& processName);
     void addToAllowlist(const QString& processName);
+    void removeFromAllowlist(const QString& processName);
 
     std::vector<ProcessInfo> scanForBlockedProcesses() const;
     bool startMonitoring(int intervalMs = 1000);
@@ -54,6 +60,7 @@ private:
     bool isBlocked(const ProcessInfo& proc) const;
 
     std::unique_ptr<ProcessBlocklist> m_blocklist;
+    std::unique_ptr<ProcessBlocklist> m_addedBlocklist;    // addToBlocklist() names
     QSet<QString> m_allowlist;
     QTimer* m_timer = nullptr;
     bool m_monitoring = false;
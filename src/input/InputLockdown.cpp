@@ -44,7 +44,7 @@ bool InputLockdown::engage()
         success = false;
     }
 
-    if (!m_clipboardGuard->engage()) {
+    if (!m_clipboardAllowed && !m_clipboardGuard->engage()) {
         qWarning() << "Clipboard guard failed";
     }
 
@@ -52,7 +52,7 @@ bool InputLockdown::engage()
         qWarning() << "Shortcut blocker failed";
     }
 
-    if (!m_printBlocker->engage()) {
+    if (!m_printAllowed && !m_printBlocker->engage()) {
         qWarning() << "Print blocker failed";
     }
 
@@ -79,6 +79,9 @@ bool InputLockdown::isEngaged() const { return m_engaged; }
 
 void InputLockdown::setClipboardAllowed(bool allowed)
 {
+    m_clipboardAllowed = allowed;
+    if (!m_engaged) return;
+
     if (allowed) {
         m_clipboardGuard->release();
     } else {
@@ -88,6 +91,9 @@ void InputLockdown::setClipboardAllowed(bool allowed)
 
 void InputLockdown::setPrintAllowed(bool allowed)
 {
+    m_printAllowed = allowed;
+    if (!m_engaged) return;
+
     if (allowed) {
         m_printBlocker->release();
     } else {
@@ -24,6 +24,8 @@ public:
     bool release();
     bool isEngaged() const;
 
+    // Exam config toggles; take effect at once while engaged, otherwise
+    // on the next engage()
     void setClipboardAllowed(bool allowed);
     void setPrintAllowed(bool allowed);
 
@@ -44,6 +46,8 @@ private:
     std::unique_ptr<ShortcutBlocker> m_shortcutBlocker;
     std::unique_ptr<PrintBlocker> m_printBlocker;
     bool m_engaged = false;
+    bool m_clipboardAllowed = false;
+    bool m_printAllowed = false;
 };
 
 } // namespace openlock
@@ -3,10 +3,10 @@
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "integrity/SelfVerifier.h"
+#include "integrity/Sha256Batch.h"
 
 #include <QFile>
 #include <QTextStream>
-#include <QCryptographicHash>
 #include <QCoreApplication>
 #include <QDebug>
 
@@ -42,19 +42,11 @@ QByteArray SelfVerifier::computeBinaryHash() const
         exePath = QFile::symLinkTarget("/proc/self/exe");
     }
 
-    QFile file(exePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Cannot open own binary for hashing:" << exePath;
-        return {};
+    const QByteArray hash = Sha256Batch::hashFiles({exePath}).value(0);
+    if (hash.isEmpty()) {
+        qWarning() << "Cannot hash own binary:" << exePath;
     }
-
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    if (!hash.addData(&file)) {
-        qWarning() << "Failed to hash binary";
-        return {};
-    }
-
-    return hash.result();
+    return hash;
 }
 
 QStringList SelfVerifier::detectInjectedLibraries() const
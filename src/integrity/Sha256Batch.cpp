@@ -0,0 +1,438 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "integrity/Sha256Batch.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <sys/mman.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define OPENLOCK_SHA256_AVX2
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace openlock {
+
+namespace {
+
+struct Job {
+    const uchar* data = nullptr;
+    qint64 size = 0;
+    QByteArray* digest = nullptr;
+};
+
+void opensslSha256(const Job& job)
+{
+    QByteArray digest(32, Qt::Uninitialized);
+    unsigned int length = 0;
+    if (EVP_Digest(job.data, size_t(job.size), reinterpret_cast<unsigned char*>(digest.data()),
+                   &length, EVP_sha256(), nullptr) && length == 32) {
+        *job.digest = digest;
+    } else {
+        job.digest->clear();
+    }
+}
+
+#ifdef OPENLOCK_SHA256_AVX2
+
+#define OPENLOCK_TARGET_AVX2 __attribute__((target("avx2")))
+
+constexpr int kLanes = 8;
+
+constexpr quint32 kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr quint32 kInitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+template <int N>
+OPENLOCK_TARGET_AVX2 inline __m256i rotr(__m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+OPENLOCK_TARGET_AVX2 inline __m256i add(__m256i a, __m256i b)
+{
+    return _mm256_add_epi32(a, b);
+}
+
+// Eight message words for each lane: loads 32 bytes per lane, swaps them
+// to big endian and transposes so register k holds word k of every lane
+OPENLOCK_TARGET_AVX2 inline void loadWords(__m256i* w, const uchar* const* lanes, int offset)
+{
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m256i r[kLanes];
+    for (int i = 0; i < kLanes; i++) {
+        r[i] = _mm256_shuffle_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[i] + offset)), swap);
+    }
+
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    w[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    w[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    w[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    w[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    w[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    w[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    w[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    w[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+OPENLOCK_TARGET_AVX2 inline void compressRound(__m256i a, __m256i b, __m256i c, __m256i& d,
+                                               __m256i e, __m256i f, __m256i g, __m256i& h,
+                                               __m256i kw)
+{
+    const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr<6>(e), rotr<11>(e)), rotr<25>(e));
+    const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    const __m256i t1 = add(add(add(h, s1), ch), kw);
+    const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr<2>(a), rotr<13>(a)), rotr<22>(a));
+    const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b),
+                                        _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    d = add(d, t1);
+    h = add(t1, add(s0, maj));
+}
+
+// Runs `blocks` consecutive 64-byte blocks from each lane pointer through
+// the compression function. state[word][lane], 32-byte aligned.
+OPENLOCK_TARGET_AVX2 void compressX8(quint32 (*state)[kLanes], const uchar* const* lanes,
+                                     qint64 blocks)
+{
+    __m256i s[8];
+    for (int i = 0; i < 8; i++) {
+        s[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[i]));
+    }
+
+    const uchar* p[kLanes];
+    std::copy(lanes, lanes + kLanes, p);
+
+    for (qint64 block = 0; block < blocks; block++) {
+        __m256i w[16];
+        loadWords(w, p, 0);
+        loadWords(w + 8, p, 32);
+
+        // Registers rotate through the roles a..h instead of being moved
+        __m256i v[8] = {s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7]};
+        for (int t = 0; t < 64; t++) {
+            if (t >= 16) {
+                const __m256i w15 = w[(t - 15) & 15];
+                const __m256i w2 = w[(t - 2) & 15];
+                const __m256i sigma0 = _mm256_xor_si256(
+                    _mm256_xor_si256(rotr<7>(w15), rotr<18>(w15)), _mm256_srli_epi32(w15, 3));
+                const __m256i sigma1 = _mm256_xor_si256(
+                    _mm256_xor_si256(rotr<17>(w2), rotr<19>(w2)), _mm256_srli_epi32(w2, 10));
+                w[t & 15] = add(add(w[t & 15], sigma0), add(w[(t - 7) & 15], sigma1));
+            }
+            const __m256i kw = add(w[t & 15], _mm256_set1_epi32(int(kRoundConstants[t])));
+            compressRound(v[(0 - t) & 7], v[(1 - t) & 7], v[(2 - t) & 7], v[(3 - t) & 7],
+                          v[(4 - t) & 7], v[(5 - t) & 7], v[(6 - t) & 7], v[(7 - t) & 7], kw);
+        }
+
+        for (int i = 0; i < 8; i++) s[i] = add(s[i], v[i]);
+        for (int i = 0; i < kLanes; i++) p[i] += 64;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(state[i]), s[i]);
+    }
+}
+
+// One thread's eight lanes. Each lane walks its job's whole blocks in
+// place, then one or two padding blocks built on the side, and takes the
+// next job from the shared queue as soon as it finishes. Idle lanes
+// mirror an active one and their results are ignored.
+void multiBufferWorker(const std::vector<Job>& jobs, std::atomic<size_t>& next)
+{
+    struct Lane {
+        const Job* job = nullptr;
+        qint64 wholeBytes = 0;
+        qint64 offset = 0;
+        int tailBlocks = 0;
+        int tailDone = 0;
+        uchar tail[128];
+    };
+
+    alignas(32) quint32 state[8][kLanes];
+    Lane lanes[kLanes];
+
+    auto startJob = [&](int i) {
+        Lane& lane = lanes[i];
+        const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= jobs.size()) {
+            lane.job = nullptr;
+            return false;
+        }
+
+        const Job& job = jobs[index];
+        lane.job = &job;
+        lane.wholeBytes = job.size & ~qint64(63);
+        lane.offset = 0;
+        lane.tailDone = 0;
+
+        const int remainder = int(job.size - lane.wholeBytes);
+        lane.tailBlocks = remainder + 9 > 64 ? 2 : 1;
+        std::memset(lane.tail, 0, sizeof(lane.tail));
+        if (remainder) std::memcpy(lane.tail, job.data + lane.wholeBytes, size_t(remainder));
+        lane.tail[remainder] = 0x80;
+        qToBigEndian(quint64(job.size) * 8, lane.tail + lane.tailBlocks * 64 - 8);
+
+        for (int word = 0; word < 8; word++) state[word][i] = kInitialState[word];
+        return true;
+    };
+
+    int active = 0;
+    for (int i = 0; i < kLanes; i++) {
+        if (startJob(i)) active++;
+    }
+
+    while (active > 0) {
+        // Advance every lane by as many blocks as the shortest contiguous
+        // run among them
+        const uchar* pointers[kLanes] = {};
+        qint64 run = std::numeric_limits<qint64>::max();
+        int firstActive = -1;
+        for (int i = 0; i < kLanes; i++) {
+            const Lane& lane = lanes[i];
+            if (!lane.job) continue;
+            if (firstActive < 0) firstActive = i;
+
+            if (lane.offset < lane.wholeBytes) {
+                pointers[i] = lane.job->data + lane.offset;
+                run = std::min(run, (lane.wholeBytes - lane.offset) / 64);
+            } else {
+                pointers[i] = lane.tail + lane.tailDone * 64;
+                run = std::min<qint64>(run, lane.tailBlocks - lane.tailDone);
+            }
+        }
+        for (int i = 0; i < kLanes; i++) {
+            if (!lanes[i].job) pointers[i] = pointers[firstActive];
+        }
+
+        compressX8(state, pointers, run);
+
+        for (int i = 0; i < kLanes; i++) {
+            Lane& lane = lanes[i];
+            if (!lane.job) continue;
+
+            if (lane.offset < lane.wholeBytes) {
+                lane.offset += run * 64;
+                continue;
+            }
+            lane.tailDone += int(run);
+            if (lane.tailDone < lane.tailBlocks) continue;
+
+            QByteArray digest(32, Qt::Uninitialized);
+            for (int word = 0; word < 8; word++) {
+                qToBigEndian(state[word][i], digest.data() + word * 4);
+            }
+            *lane.job->digest = digest;
+            if (!startJob(i)) active--;
+        }
+    }
+}
+
+bool cpuHasAvx2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // OPENLOCK_SHA256_AVX2
+
+void runJobs(std::vector<Job>& jobs, Sha256Batch::Backend backend)
+{
+    if (jobs.empty()) return;
+
+    // Largest first, so the long ones do not start last
+    std::sort(jobs.begin(), jobs.end(),
+              [](const Job& a, const Job& b) { return a.size > b.size; });
+
+#ifdef OPENLOCK_SHA256_AVX2
+    if (backend == Sha256Batch::Backend::Avx2x8 && jobs.size() > 1) {
+        // A stream alone in a lane runs at an eighth of the register's
+        // throughput: files too large to share a core fairly with the
+        // others get OpenSSL on a thread of their own
+        const int threads = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+        qint64 totalBytes = 0;
+        for (const Job& job : jobs) totalBytes += job.size;
+        const qint64 laneShare = totalBytes / (qint64(threads) * kLanes);
+
+        std::vector<Job> small;
+        std::vector<const Job*> tasks;     // nullptr: a multi-buffer worker
+        for (const Job& job : jobs) {
+            if (job.size > laneShare) {
+                tasks.push_back(&job);
+            } else {
+                small.push_back(job);
+            }
+        }
+        const size_t workers = std::min<size_t>(size_t(threads), (small.size() + kLanes - 1) / kLanes);
+        tasks.insert(tasks.end(), workers, nullptr);
+
+        std::atomic<size_t> next{0};
+        QtConcurrent::blockingMap(tasks, [&](const Job* job) {
+            if (job) {
+                opensslSha256(*job);
+            } else {
+                multiBufferWorker(small, next);
+            }
+        });
+        return;
+    }
+#else
+    Q_UNUSED(backend);
+#endif
+
+    QtConcurrent::blockingMap(jobs, [](const Job& job) { opensslSha256(job); });
+}
+
+} // namespace
+
+Sha256Batch::Backend Sha256Batch::detectBackend()
+{
+    static const Backend backend = [] {
+        if (!hasShaExtensions() && isSupported(Backend::Avx2x8)) return Backend::Avx2x8;
+        return Backend::OpenSsl;
+    }();
+    return backend;
+}
+
+bool Sha256Batch::isSupported(Backend backend)
+{
+    switch (backend) {
+    case Backend::OpenSsl:
+        return true;
+    case Backend::Avx2x8:
+#ifdef OPENLOCK_SHA256_AVX2
+        return cpuHasAvx2();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+bool Sha256Batch::hasShaExtensions()
+{
+#ifdef OPENLOCK_SHA256_AVX2
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return ebx & (1u << 29);
+    }
+#endif
+    return false;
+}
+
+QString Sha256Batch::backendName(Backend backend)
+{
+    switch (backend) {
+    case Backend::OpenSsl:
+        return hasShaExtensions() ? QStringLiteral("openssl (sha-ni)")
+                                  : QStringLiteral("openssl");
+    case Backend::Avx2x8:
+        return QStringLiteral("avx2 x8");
+    }
+    return {};
+}
+
+QList<QByteArray> Sha256Batch::hash(const QList<QByteArrayView>& buffers, Backend backend)
+{
+    if (!isSupported(backend)) backend = Backend::OpenSsl;
+
+    QList<QByteArray> digests(buffers.size());
+    std::vector<Job> jobs;
+    jobs.reserve(size_t(buffers.size()));
+    for (qsizetype i = 0; i < buffers.size(); i++) {
+        jobs.push_back({reinterpret_cast<const uchar*>(buffers[i].data()), buffers[i].size(),
+                        &digests[i]});
+    }
+    runJobs(jobs, backend);
+    return digests;
+}
+
+QList<QByteArray> Sha256Batch::hashFiles(const QStringList& paths, Backend backend)
+{
+    std::vector<std::unique_ptr<QFile>> files;
+    QList<QByteArrayView> views;
+    QList<int> unreadable;
+    QList<int> unmapped;
+    for (qsizetype i = 0; i < paths.size(); i++) {
+        auto file = std::make_unique<QFile>(paths[i]);
+        views << QByteArrayView();
+        if (!file->open(QIODevice::ReadOnly)) {
+            unreadable << int(i);
+            continue;
+        }
+
+        // Size 0 may be an empty file or procfs/sysfs, which report 0 for
+        // files that do have content; those are streamed below
+        const qint64 size = file->size();
+        uchar* data = size > 0 ? file->map(0, size) : nullptr;
+        if (!data) {
+            unmapped << int(i);
+        } else {
+            // Read ahead aggressively; every page is touched exactly once
+            ::madvise(data, size_t(size), MADV_SEQUENTIAL);
+            views.last() = QByteArrayView(reinterpret_cast<const char*>(data), size);
+        }
+        files.push_back(std::move(file));
+    }
+
+    QList<QByteArray> digests = hash(views, backend);
+
+    for (int i : unreadable) digests[i].clear();
+    for (int i : unmapped) {
+        // Pipes, procfs files and anything else that cannot be mapped
+        QFile file(paths[i]);
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (file.open(QIODevice::ReadOnly) && hash.addData(&file)) {
+            digests[i] = hash.result();
+        } else {
+            digests[i].clear();
+        }
+    }
+    return digests;
+}
+
+} // namespace openlock
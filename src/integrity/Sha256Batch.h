@@ -0,0 +1,43 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+namespace openlock {
+
+// SHA-256 over many independent buffers at once, for integrity hashing of
+// the executable and the libraries shipped with it. The backend is picked
+// at runtime from what the CPU supports:
+//
+//   OpenSsl  one stream per thread; OpenSSL uses the SHA extensions
+//            (SHA-NI) when the CPU has them
+//   Avx2x8   eight streams per thread in the lanes of AVX2 registers,
+//            for CPUs with AVX2 but no SHA extensions
+//
+// Either way the work is spread over the global thread pool.
+class Sha256Batch {
+public:
+    enum class Backend { OpenSsl, Avx2x8 };
+
+    static Backend detectBackend();
+    static bool isSupported(Backend backend);
+    static bool hasShaExtensions();
+    static QString backendName(Backend backend);
+
+    // Digests of buffers, in the same order
+    static QList<QByteArray> hash(const QList<QByteArrayView>& buffers,
+                                  Backend backend = detectBackend());
+
+    // Digests of files, mapped rather than read; empty for unreadable files
+    static QList<QByteArray> hashFiles(const QStringList& paths,
+                                       Backend backend = detectBackend());
+};
+
+} // namespace openlock
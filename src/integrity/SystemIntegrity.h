@@ -11,6 +11,7 @@
 namespace openlock {
 
 class VMDetector;
+struct VMDetectionResult;
 class DebugDetector;
 class SelfVerifier;
 
@@ -18,6 +19,7 @@ struct IntegrityReport {
     bool passed = false;
     bool vmDetected = false;
     QString vmType;
+    QStringList vmChecksTimedOut;   // VM detection incomplete; fails the check
     bool debuggerDetected = false;
     QString debuggerType;
     bool binaryTampered = false;
@@ -50,6 +52,8 @@ signals:
     void integrityViolation(const QString& description);
 
 private:
+    VMDetectionResult detectVM() const;
+
     std::unique_ptr<VMDetector> m_vmDetector;
     std::unique_ptr<DebugDetector> m_debugDetector;
     std::unique_ptr<SelfVerifier> m_selfVerifier;
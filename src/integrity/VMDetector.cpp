@@ -4,12 +4,22 @@
 
 #include "integrity/VMDetector.h"
 
-#include <QProcess>
+#include <QDeadlineTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
 #include <QDir>
 #include <QDebug>
-#include <QNetworkInterface>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #ifdef __x86_64__
 #include <cpuid.h>
@@ -17,36 +27,293 @@
 
 namespace openlock {
 
-VMDetector::VMDetector() = default;
-VMDetector::~VMDetector() = default;
+namespace {
+
+// Reading a few sysfs or procfs files takes well under a millisecond, so
+// a clean machine passes within these; a check that misses one is retried
+// by SystemIntegrity with a deadline of seconds before it counts
+constexpr int kFileCheckDeadlineMs = 100;
 
-VMDetectionResult VMDetector::detect() const
+QByteArray readFile(const QString& path)
 {
-    VMDetectionResult result;
-    int checks = 0;
-    int positives = 0;
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+QString readFirstLine(const QString& path)
+{
+    const QByteArray content = readFile(path);
+    return QString::fromUtf8(content.left(content.indexOf('\n'))).trimmed();
+}
+
+// CPUID leaf 0x40000000 signature, empty without the hypervisor bit
+QByteArray cpuidVendor(bool* hypervisorBit)
+{
+    *hypervisorBit = false;
+#ifdef __x86_64__
+    unsigned int eax, ebx, ecx, edx;
+
+    // Check hypervisor bit (CPUID leaf 1, ECX bit 31)
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 31))) {
+        *hypervisorBit = true;
+        if (__get_cpuid(0x40000000, &eax, &ebx, &ecx, &edx)) {
+            char vendor[13] = {};
+            memcpy(vendor, &ebx, 4);
+            memcpy(vendor + 4, &ecx, 4);
+            memcpy(vendor + 8, &edx, 4);
+            return QByteArray(vendor);
+        }
+    }
+#endif
+    return {};
+}
+
+// Names follow systemd-detect-virt, which this replaces
+QString containerName(const QString& root)
+{
+    const QString fromSystemd = readFirstLine(root + "/run/systemd/container");
+    if (!fromSystemd.isEmpty()) return fromSystemd;
+
+    // Container managers set container= for init; readable by root only
+    for (const QByteArray& variable : readFile(root + "/proc/1/environ").split('\0')) {
+        if (variable.startsWith("container=") && variable.size() > 10) {
+            return QString::fromUtf8(variable.mid(10));
+        }
+    }
+
+    if (QFileInfo::exists(root + "/.dockerenv")) return "docker";
+
+    // OpenVZ and Linux-VServer tag every process with a context id
+    for (const QByteArray& line : readFile(root + "/proc/self/status").split('\n')) {
+        const int colon = line.indexOf(':');
+        if (colon < 0) continue;
+        const QByteArray key = line.left(colon);
+        if ((key == "envID" || key == "VxID") && line.mid(colon + 1).trimmed().toLongLong() > 0) {
+            return key == "envID" ? "openvz" : "vserver";
+        }
+    }
+
+    const QString osRelease = readFirstLine(root + "/proc/sys/kernel/osrelease");
+    if (osRelease.contains("Microsoft") || osRelease.contains("WSL")) return "wsl";
+    return {};
+}
+
+QString virtualMachineName(const QString& root)
+{
+    // Device-tree platforms (ARM, POWER) describe the hypervisor node
+    for (const QString& base : {root + "/proc/device-tree",
+                                root + "/sys/firmware/devicetree/base"}) {
+        const QByteArray compatible = readFile(base + "/hypervisor/compatible");
+        if (compatible.contains("linux,kvm")) return "kvm";
+        if (compatible.contains("xen")) return "xen";
+        if (compatible.contains("vmware")) return "vmware";
+        if (!compatible.isEmpty()) return "vm-other";
+        if (readFile(base + "/compatible").contains("linux,dummy-virt")) return "qemu";
+    }
+
+    // A Xen dom0 runs the hypervisor; only guests count
+    if (readFirstLine(root + "/sys/hypervisor/type") == "xen") {
+        if (!readFile(root + "/proc/xen/capabilities").contains("control_d")) return "xen";
+    }
+
+    // The CPU describes this machine, not the tree under a test root
+    if (root.isEmpty()) {
+        static const QList<QPair<QByteArray, QString>> vendors = {
+            {"KVMKVMKVM", "kvm"},
+            {"Linux KVM Hv", "kvm"},
+            {"TCGTCGTCGTCG", "qemu"},
+            {"VMwareVMware", "vmware"},
+            {"Microsoft Hv", "microsoft"},
+            {"VBoxVBoxVBox", "oracle"},
+            {"XenVMMXenVMM", "xen"},
+            {"prl hyperv", "parallels"},
+            {"bhyve bhyve", "bhyve"},
+            {"ACRNACRNACRN", "acrn"},
+            {"QNXQVMBSQG", "qnx"},
+        };
+        bool hypervisorBit = false;
+        const QByteArray vendor = cpuidVendor(&hypervisorBit).trimmed();
+        for (const auto& [signature, name] : vendors) {
+            if (vendor == signature) return name;
+        }
+    }
+
+    // SMBIOS strings, in systemd's order
+    static const QList<QPair<QString, QString>> dmiVendors = {
+        {"KVM", "kvm"},
+        {"OpenStack", "kvm"},
+        {"KubeVirt", "kvm"},
+        {"Amazon EC2", "amazon"},
+        {"QEMU", "qemu"},
+        {"VMware", "vmware"},
+        {"VMW", "vmware"},
+        {"innotek GmbH", "oracle"},
+        {"VirtualBox", "oracle"},
+        {"Xen", "xen"},
+        {"Bochs", "bochs"},
+        {"Parallels", "parallels"},
+        {"BHYVE", "bhyve"},
+        {"Hyper-V", "microsoft"},
+        {"Apple Virtualization", "apple"},
+        {"Google Compute Engine", "google"},
+    };
+    const QString dmi = root + "/sys/class/dmi/id/";
+    for (const char* field : {"product_name", "sys_vendor", "board_vendor", "bios_vendor",
+                              "product_version"}) {
+        const QString value = readFirstLine(dmi + field);
+        for (const auto& [prefix, name] : dmiVendors) {
+            if (value.startsWith(prefix)) return name;
+        }
+    }
+    // Physical Surface devices share the vendor string
+    if (readFirstLine(dmi + "sys_vendor") == "Microsoft Corporation" &&
+        readFirstLine(dmi + "product_name") == "Virtual Machine") {
+        return "microsoft";
+    }
+
+    if (readFile(root + "/proc/cpuinfo").contains("User Mode Linux")) return "uml";
 
-    // Run all detection methods, accumulate confidence
-    checks++;
-    if (checkSystemdDetectVirt(result)) positives++;
+    const QByteArray sysinfo = readFile(root + "/proc/sysinfo");
+    if (sysinfo.contains("z/VM")) return "zvm";
+    if (sysinfo.contains("KVM/Linux")) return "kvm";
+    return {};
+}
+
+} // namespace
 
-    checks++;
-    if (checkCPUID(result)) positives++;
+VMDetector::VMDetector()
+    : VMDetector(defaultChecks())
+{
+}
 
-    checks++;
-    if (checkDMI(result)) positives++;
+VMDetector::VMDetector(QList<Check> checks)
+    : m_checks(std::move(checks))
+    , m_ownPool(std::make_unique<QThreadPool>())
+{
+    m_ownPool->setMaxThreadCount(std::max(1, int(m_checks.size())));
+}
+
+VMDetector::~VMDetector()
+{
+    // A wedged check keeps its pool thread, and QThreadPool's destructor
+    // would wait for it: a pool still busy is left to finish on its own
+    m_ownPool->clear();
+    if (!m_ownPool->waitForDone(0)) (void)m_ownPool.release();
+}
+
+QList<VMDetector::Check> VMDetector::defaultChecks(const QString& root)
+{
+    QList<Check> checks = {
+        {"hypervisor", kFileCheckDeadlineMs, [root] { return checkHypervisor(root); }},
+        {"mac", kFileCheckDeadlineMs, [root] { return checkMACAddress(root); }},
+        {"dmi", kFileCheckDeadlineMs, [root] { return checkDMI(root); }},
+        {"scsi", kFileCheckDeadlineMs, [root] { return checkScsiDevices(root); }},
+        {"kernel-modules", kFileCheckDeadlineMs, [root] { return checkKernelModules(root); }},
+        {"cpuinfo", kFileCheckDeadlineMs, [root] { return checkProcCpuinfo(root); }},
+    };
+    // Under a test root the CPU would still report the machine running the tests
+    if (root.isEmpty()) checks.append({"cpuid", kFileCheckDeadlineMs, &VMDetector::checkCPUID});
+    return checks;
+}
 
-    checks++;
-    if (checkScsiDevices(result)) positives++;
+VMDetectionResult VMDetector::detect(int deadlineMs) const
+{
+    VMDetectionResult result;
+    const int checks = int(m_checks.size());
+    if (checks == 0) return result;
 
-    checks++;
-    if (checkMACAddress(result)) positives++;
+    auto deadlineOf = [this, deadlineMs](int i) {
+        return deadlineMs > 0 ? deadlineMs : m_checks[i].deadlineMs;
+    };
 
-    checks++;
-    if (checkKernelModules(result)) positives++;
+    // Shared with the tasks, which may outlive this call after a deadline.
+    // Whoever claims a check first runs it: a pool thread or, once the
+    // check has waited a whole deadline without starting, a thread of its
+    // own. Either way its deadline runs from the claim.
+    struct Slot {
+        bool claimed = false;
+        QDeadlineTimer deadline;            // from the claim on
+        std::optional<Finding> finding;
+    };
+    struct State {
+        std::mutex mutex;
+        std::condition_variable reported;
+        std::vector<Slot> slots;
+    };
+    auto state = std::make_shared<State>();
+    state->slots.resize(size_t(checks));
+
+    auto report = [state](int i, const std::function<Finding()>& run) {
+        Finding finding = run();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->slots[size_t(i)].finding = std::move(finding);
+        state->reported.notify_one();
+    };
 
-    checks++;
-    if (checkProcCpuinfo(result)) positives++;
+    QThreadPool* pool = m_pool ? m_pool : m_ownPool.get();
+    std::vector<QDeadlineTimer> startBy;
+    startBy.reserve(size_t(checks));
+    for (int i = 0; i < checks; i++) {
+        const int checkDeadlineMs = deadlineOf(i);
+        startBy.emplace_back(checkDeadlineMs);
+        pool->start([state, report, i, checkDeadlineMs, run = m_checks[i].run] {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                Slot& slot = state->slots[size_t(i)];
+                if (slot.claimed) return;
+                slot.claimed = true;
+                slot.deadline = QDeadlineTimer(checkDeadlineMs);
+            }
+            report(i, run);
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    int positives = 0;
+    for (;;) {
+        positives = 0;
+        qint64 waitMs = -1;
+        int unstarted = -1;
+        for (int i = 0; i < checks; i++) {
+            const Slot& slot = state->slots[size_t(i)];
+            const QDeadlineTimer& deadline = slot.claimed ? slot.deadline : startBy[size_t(i)];
+            if (slot.finding) {
+                if (slot.finding->positive) positives++;
+            } else if (!deadline.hasExpired()) {
+                const qint64 remaining = deadline.remainingTime();
+                waitMs = waitMs < 0 ? remaining : std::min(waitMs, remaining);
+            } else if (!slot.claimed && unstarted < 0) {
+                unstarted = i;
+            }
+        }
+        if (positives > 0 && positives * 100 / checks >= m_confidenceThreshold) break;
+
+        // The pool is saturated, possibly by the caller of detect() itself.
+        // The check may wedge like any other, so it gets a thread that can
+        // be left behind rather than this one.
+        if (unstarted >= 0) {
+            Slot& slot = state->slots[size_t(unstarted)];
+            slot.claimed = true;
+            slot.deadline = QDeadlineTimer(deadlineOf(unstarted));
+            std::thread(report, unstarted, m_checks[unstarted].run).detach();
+            continue;
+        }
+        if (waitMs < 0) break;      // everything reported or timed out
+        state->reported.wait_for(lock, std::chrono::milliseconds(std::max<qint64>(waitMs, 1)));
+    }
+
+    for (int i = 0; i < checks; i++) {
+        const Slot& slot = state->slots[size_t(i)];
+        const std::optional<Finding>& finding = slot.finding;
+        if (!finding) {
+            if (slot.claimed && slot.deadline.hasExpired()) {
+                result.timedOutChecks << m_checks[i].name;
+                qWarning() << "VM check" << m_checks[i].name << "ran past its deadline";
+            }
+        } else if (finding->positive && result.hypervisorName.isEmpty()) {
+            result.hypervisorName = finding->hypervisorName;
+        }
+    }
 
     // Any positive detection means VM
     if (positives > 0) {
@@ -54,57 +321,43 @@ VMDetectionResult VMDetector::detect() const
         result.confidenceScore = (positives * 100) / checks;
     }
 
+    // Checks still queued are not needed any more
+    for (Slot& slot : state->slots) slot.claimed = true;
+    if (pool == m_ownPool.get()) pool->clear();
     return result;
 }
 
-bool VMDetector::checkSystemdDetectVirt(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkHypervisor(const QString& root)
 {
-    QProcess proc;
-    proc.start("systemd-detect-virt", QStringList());
-    proc.waitForFinished(3000);
-
-    QString output = proc.readAllStandardOutput().trimmed();
-
-    if (proc.exitCode() == 0 && output != "none") {
-        result.hypervisorName = output;
-        qInfo() << "systemd-detect-virt:" << output;
-        return true;
+    // What systemd-detect-virt reports, without forking this process: a
+    // container first, as it may run inside a VM
+    const QString container = containerName(root);
+    if (!container.isEmpty()) {
+        qInfo() << "Container detected:" << container;
+        return {true, container};
     }
 
-    return false;
+    const QString vm = virtualMachineName(root);
+    if (!vm.isEmpty()) {
+        qInfo() << "Hypervisor detected:" << vm;
+        return {true, vm};
+    }
+    return {};
 }
 
-bool VMDetector::checkCPUID(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkCPUID()
 {
-#ifdef __x86_64__
-    unsigned int eax, ebx, ecx, edx;
+    bool hypervisorBit = false;
+    const QString vendor = QString::fromLatin1(cpuidVendor(&hypervisorBit)).trimmed();
+    if (!hypervisorBit) return {};
 
-    // Check hypervisor bit (CPUID leaf 1, ECX bit 31)
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
-        if (ecx & (1 << 31)) {
-            // Hypervisor bit set — get hypervisor vendor string
-            if (__get_cpuid(0x40000000, &eax, &ebx, &ecx, &edx)) {
-                char vendor[13] = {};
-                memcpy(vendor, &ebx, 4);
-                memcpy(vendor + 4, &ecx, 4);
-                memcpy(vendor + 8, &edx, 4);
-
-                QString vendorStr = QString::fromLatin1(vendor).trimmed();
-                if (!vendorStr.isEmpty()) {
-                    if (result.hypervisorName.isEmpty()) {
-                        result.hypervisorName = vendorStr;
-                    }
-                    qInfo() << "CPUID hypervisor vendor:" << vendorStr;
-                }
-            }
-            return true;
-        }
+    if (!vendor.isEmpty()) {
+        qInfo() << "CPUID hypervisor vendor:" << vendor;
     }
-#endif
-    return false;
+    return {true, vendor};
 }
 
-bool VMDetector::checkDMI(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkDMI(const QString& root)
 {
     // Check DMI/SMBIOS strings for VM indicators
     QStringList dmiFiles = {
@@ -122,45 +375,39 @@ bool VMDetector::checkDMI(VMDetectionResult& result) const
     };
 
     for (const QString& path : dmiFiles) {
-        QFile file(path);
+        QFile file(root + path);
         if (!file.open(QIODevice::ReadOnly)) continue;
 
         QString content = QTextStream(&file).readLine().trimmed();
         for (const QString& indicator : vmIndicators) {
             if (content.contains(indicator, Qt::CaseInsensitive)) {
-                if (result.hypervisorName.isEmpty()) {
-                    result.hypervisorName = indicator;
-                }
                 qInfo() << "DMI VM indicator:" << content << "in" << path;
-                return true;
+                return {true, indicator};
             }
         }
     }
 
-    return false;
+    return {};
 }
 
-bool VMDetector::checkScsiDevices(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkScsiDevices(const QString& root)
 {
-    QFile file("/proc/scsi/scsi");
-    if (!file.open(QIODevice::ReadOnly)) return false;
+    QFile file(root + "/proc/scsi/scsi");
+    if (!file.open(QIODevice::ReadOnly)) return {};
 
     QString content = file.readAll();
     QStringList vmScsi = {"VBOX", "VMware", "QEMU", "Virtual"};
 
     for (const QString& indicator : vmScsi) {
         if (content.contains(indicator, Qt::CaseInsensitive)) {
-            if (result.hypervisorName.isEmpty()) {
-                result.hypervisorName = indicator;
-            }
-            return true;
+            return {true, indicator};
         }
     }
 
-    return false;
+    return {};
 }
 
-bool VMDetector::checkMACAddress(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkMACAddress(const QString& root)
 {
     // Known VM MAC address OUI prefixes
     QStringList vmOUIs = {
@@ -183,27 +430,26 @@ bool VMDetector::checkMACAddress(VMDetectionResult& result) const
         {"00:1c:42", "Parallels"},
     };
 
-    const auto interfaces = QNetworkInterface::allInterfaces();
-    for (const auto& iface : interfaces) {
-        QString mac = iface.hardwareAddress().toLower();
+    // sysfs has every interface's address; no netlink round trip needed
+    const QString netDir = root + "/sys/class/net";
+    const auto interfaces = QDir(netDir).entryList(QDir::AllEntries | QDir::NoDotAndDotDot);
+    for (const QString& iface : interfaces) {
+        QString mac = readFirstLine(netDir + "/" + iface + "/address").toLower();
         QString prefix = mac.left(8);
 
         if (vmOUIs.contains(prefix)) {
-            if (result.hypervisorName.isEmpty()) {
-                result.hypervisorName = ouiToName.value(prefix, "Unknown VM");
-            }
-            qInfo() << "VM MAC detected:" << mac << "on" << iface.name();
-            return true;
+            qInfo() << "VM MAC detected:" << mac << "on" << iface;
+            return {true, ouiToName.value(prefix, "Unknown VM")};
         }
     }
 
-    return false;
+    return {};
 }
 
-bool VMDetector::checkKernelModules(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkKernelModules(const QString& root)
 {
-    QFile file("/proc/modules");
-    if (!file.open(QIODevice::ReadOnly)) return false;
+    QFile file(root + "/proc/modules");
+    if (!file.open(QIODevice::ReadOnly)) return {};
 
     QString modules = file.readAll();
 
@@ -227,33 +473,29 @@ bool VMDetector::checkKernelModules(VMDetectionResult& result) const
 
     for (auto it = vmModules.constBegin(); it != vmModules.constEnd(); ++it) {
         if (modules.contains(it.key())) {
-            if (result.hypervisorName.isEmpty()) {
-                result.hypervisorName = it.value();
-            }
             qInfo() << "VM kernel module:" << it.key();
-            return true;
+            return {true, it.value()};
         }
     }
 
-    return false;
+    return {};
 }
 
-bool VMDetector::checkProcCpuinfo(VMDetectionResult& result) const
+VMDetector::Finding VMDetector::checkProcCpuinfo(const QString& root)
 {
-    QFile file("/proc/cpuinfo");
-    if (!file.open(QIODevice::ReadOnly)) return false;
+    QFile file(root + "/proc/cpuinfo");
+    if (!file.open(QIODevice::ReadOnly)) return {};
 
     QTextStream stream(&file);
     QString line;
     while (stream.readLineInto(&line)) {
         if (line.startsWith("flags") && line.contains("hypervisor")) {
             qInfo() << "hypervisor flag found in /proc/cpuinfo";
-            return true;
+            return {true, {}};
         }
     }
 
-    Q_UNUSED(result);
-    return false;
+    return {};
 }
 
 } // namespace openlock
@@ -4,7 +4,14 @@
 
 #pragma once
 
+#include <QList>
 #include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <memory>
+
+class QThreadPool;
 
 namespace openlock {
 
@@ -12,23 +19,60 @@ struct VMDetectionResult {
     bool detected = false;
     QString hypervisorName;
     int confidenceScore = 0;  // 0-100, higher = more confident
+    QStringList timedOutChecks;     // ran past their deadline; counted as negative
 };
 
 class VMDetector {
 public:
+    struct Finding {
+        bool positive = false;
+        QString hypervisorName;     // may be empty for a positive
+    };
+
+    // Checks run on pool threads, so they must not touch the detector
+    struct Check {
+        QString name;
+        int deadlineMs = 0;
+        std::function<Finding()> run;
+    };
+
     VMDetector();
+    explicit VMDetector(QList<Check> checks);
     ~VMDetector();
 
-    VMDetectionResult detect() const;
+    // Runs all checks concurrently and returns when each has reported or
+    // run past its deadline, or as soon as the positives alone reach the
+    // confidence threshold. A deadline starts when its check does; a check
+    // no pool thread has picked up within its deadline runs on a thread of
+    // its own. Checks still queued when detect() returns are dropped. The
+    // hypervisor is named by the first positive check in check order,
+    // whichever finished first. A positive deadlineMs replaces every
+    // check's own, e.g. a longer one for a retry.
+    VMDetectionResult detect(int deadlineMs = 0) const;
+
+    // Default (or nullptr): a pool of the detector's own, so the checks do
+    // not queue behind work on the global pool such as the caller itself.
+    // Destroying the detector does not wait for checks still running.
+    void setThreadPool(QThreadPool* pool) { m_pool = pool; }
+    void setConfidenceThreshold(int score) { m_confidenceThreshold = score; }
+
+    // The checks read /proc and /sys below root, e.g. a captured tree in
+    // tests. CPUID is left out unless root is the real one.
+    static QList<Check> defaultChecks(const QString& root = {});
 
 private:
-    bool checkSystemdDetectVirt(VMDetectionResult& result) const;
-    bool checkCPUID(VMDetectionResult& result) const;
-    bool checkDMI(VMDetectionResult& result) const;
-    bool checkScsiDevices(VMDetectionResult& result) const;
-    bool checkMACAddress(VMDetectionResult& result) const;
-    bool checkKernelModules(VMDetectionResult& result) const;
-    bool checkProcCpuinfo(VMDetectionResult& result) const;
+    static Finding checkHypervisor(const QString& root);
+    static Finding checkCPUID();
+    static Finding checkDMI(const QString& root);
+    static Finding checkScsiDevices(const QString& root);
+    static Finding checkMACAddress(const QString& root);
+    static Finding checkKernelModules(const QString& root);
+    static Finding checkProcCpuinfo(const QString& root);
+
+    QList<Check> m_checks;
+    std::unique_ptr<QThreadPool> m_ownPool;
+    QThreadPool* m_pool = nullptr;
+    int m_confidenceThreshold = 50;
 };
 
 } // namespace openlock
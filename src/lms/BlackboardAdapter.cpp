@@ -60,6 +60,23 @@ LMSType LMSAdapter::detectFromUrl(const QUrl& url)
     return LMSType::Unknown;
 }
 
+QStringList LMSAdapter::sebHeaderHosts(const QUrl& startUrl)
+{
+    const QString host = startUrl.host().toLower();
+    if (host.isEmpty()) return {};
+
+    QStringList hosts = { host };
+    switch (detectFromUrl(startUrl)) {
+    case LMSType::Canvas:
+        // New Quizzes run in the Quizzes LTI tool, not on the course host
+        hosts << "*.quiz-lti.instructure.com";
+        break;
+    default:
+        break;
+    }
+    return hosts;
+}
+
 } // namespace openlock
 
 #include "BlackboardAdapter.moc"
@@ -7,6 +7,7 @@
 #include <QObject>
 #include <QUrl>
 #include <QString>
+#include <QStringList>
 
 namespace openlock {
 
@@ -38,6 +39,9 @@ public:
     virtual bool requiresCustomHandshake() const = 0;
 
     static LMSType detectFromUrl(const QUrl& url);
+
+    // Hosts that should receive SEB request headers for an exam at startUrl
+    static QStringList sebHeaderHosts(const QUrl& startUrl);
 };
 
 } // namespace openlock
@@ -9,6 +9,7 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
+#include <QFile>
 #include <QUrl>
 #include <QDebug>
 
@@ -31,11 +32,27 @@ int main(int argc, char* argv[])
 
     QCommandLineOption configOption(
         QStringList() << "c" << "config",
-        "Path to configuration file (.openlock or .seb)",
+        "Path to configuration file (.openlock, .seb or .olbundle)",
         "file"
     );
     parser.addOption(configOption);
 
+    QCommandLineOption examOption(
+        "exam",
+        "Exam to open from a .olbundle (default: the one scheduled now)",
+        "id"
+    );
+    parser.addOption(examOption);
+
+    // Not taken from argv, which every user can read through ps and /proc
+    QCommandLineOption passwordFdOption(
+        "password-fd",
+        "Read the password of an encrypted .seb config from this file descriptor "
+        "(0 for stdin), up to the first newline",
+        "fd"
+    );
+    parser.addOption(passwordFdOption);
+
     QCommandLineOption urlOption(
         QStringList() << "u" << "url",
         "Start URL (LMS login page)",
@@ -60,38 +77,37 @@ int main(int argc, char* argv[])
 
     parser.process(app);
 
-    auto engine = std::make_unique<LockdownEngine>();
-
-    // Load configuration
-    QString configPath = parser.value(configOption);
-    if (!configPath.isEmpty()) {
-        if (!engine->initialize(configPath)) {
-            qCritical() << "Failed to load configuration:" << configPath;
-            return 1;
-        }
-    } else {
-        // Use default config
-        if (!engine->initialize({})) {
-            qCritical() << "Failed to initialize with default configuration";
+    QString password;
+    if (parser.isSet(passwordFdOption)) {
+        bool ok = false;
+        const int fd = parser.value(passwordFdOption).toInt(&ok);
+        QFile input;
+        if (!ok || fd < 0 || !input.open(fd, QIODevice::ReadOnly)) {
+            qCritical() << "Cannot read the config password from descriptor"
+                        << parser.value(passwordFdOption);
             return 1;
         }
+        QByteArray line = input.readLine();
+        if (line.endsWith('\n')) line.chop(1);
+        if (line.endsWith('\r')) line.chop(1);
+        password = QString::fromUtf8(line);
     }
 
+    auto engine = std::make_unique<LockdownEngine>();
+
     // Override start URL if provided
     QUrl startUrl;
     if (parser.isSet(urlOption)) {
         startUrl = QUrl(parser.value(urlOption));
     }
 
-    // Handle positional seb:// URL
+    // A positional seb:// URL names the exam config to download
+    QUrl sebUrl;
     const auto positionalArgs = parser.positionalArguments();
     if (!positionalArgs.isEmpty()) {
-        QString sebUrl = positionalArgs.first();
-        if (sebUrl.startsWith("seb://") || sebUrl.startsWith("sebs://")) {
-            // Convert seb:// to https:// for loading
-            sebUrl.replace("seb://", "https://");
-            sebUrl.replace("sebs://", "https://");
-            startUrl = QUrl(sebUrl);
+        const QUrl url(positionalArgs.first());
+        if (url.scheme() == "seb" || url.scheme() == "sebs") {
+            sebUrl = url;
         }
     }
 
@@ -105,24 +121,59 @@ int main(int argc, char* argv[])
         qWarning() << "*** LOCKDOWN DISABLED - DEVELOPMENT MODE ***";
     }
 
-    // Engage lockdown (unless dev mode)
-    if (!devMode) {
-        if (!engine->engageLockdown()) {
-            qCritical() << "Failed to engage lockdown";
-            return 1;
+    // Runs once the configuration is loaded
+    auto start = [&]() -> bool {
+        // Engage lockdown (unless dev mode)
+        if (!devMode) {
+            if (!engine->engageLockdown()) {
+                qCritical() << "Failed to engage lockdown";
+                return false;
+            }
         }
-    }
 
-    // Show browser
-    SecureBrowser* browser = engine->browser();
-    if (browser) {
-        if (startUrl.isValid()) {
-            browser->navigateTo(startUrl);
-        } else if (browser->currentUrl().isEmpty() || !browser->currentUrl().isValid()) {
-            // No URL configured anywhere -- load a default so the window isn't blank
-            browser->navigateTo(QUrl("https://www.google.com"));
+        // Show browser
+        SecureBrowser* browser = engine->browser();
+        if (browser) {
+            if (startUrl.isValid()) {
+                browser->navigateTo(startUrl);
+            } else if (browser->currentUrl().isEmpty() || !browser->currentUrl().isValid()) {
+                // No URL configured anywhere -- load a default so the window isn't blank
+                browser->navigateTo(QUrl("https://www.google.com"));
+            }
+            browser->show();
+        }
+        return true;
+    };
+
+    // Load configuration
+    QString configPath = parser.value(configOption);
+    if (sebUrl.isValid()) {
+        // The event loop keeps running while the config downloads
+        QObject::connect(engine.get(), &LockdownEngine::initialized, &app, [&](bool ok) {
+            if (!ok) {
+                qCritical() << "Failed to load configuration:" << sebUrl.toString();
+                app.exit(1);
+            } else if (!start()) {
+                app.exit(1);
+            }
+        });
+        if (!engine->initializeFromUrl(sebUrl, password)) {
+            qCritical() << "Failed to load configuration:" << sebUrl.toString();
+            return 1;
+        }
+    } else if (!configPath.isEmpty()) {
+        if (!engine->initialize(configPath, parser.value(examOption), password)) {
+            qCritical() << "Failed to load configuration:" << configPath;
+            return 1;
+        }
+        if (!start()) return 1;
+    } else {
+        // Use default config
+        if (!engine->initialize({})) {
+            qCritical() << "Failed to initialize with default configuration";
+            return 1;
         }
-        browser->show();
+        if (!start()) return 1;
     }
 
     int result = app.exec();
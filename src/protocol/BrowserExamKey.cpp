@@ -3,6 +3,8 @@
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include "protocol/BrowserExamKey.h"
+#include "protocol/SEBKeyMaterial.h"
+#include "integrity/Sha256Batch.h"
 
 #include <QCryptographicHash>
 #include <QMessageAuthenticationCode>
@@ -10,6 +12,7 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QDebug>
 
 namespace openlock {
@@ -49,15 +52,9 @@ QByteArray BrowserExamKey::computeRequestHash(const QUrl& requestUrl) const
     // 1. str = url_without_fragment + hex(rawBEK)
     // 2. header = hex(SHA256(UTF8(str)))
 
-    QByteArray rawBek = computeRawKey();
-    QUrl cleanUrl = stripFragment(requestUrl);
-
-    QByteArray combined;
-    combined.append(cleanUrl.toString().toUtf8());
-    combined.append(rawBek.toHex());
-
-    QByteArray hash = QCryptographicHash::hash(combined, QCryptographicHash::Sha256);
-    return hash.toHex();
+    // Re-derives the key on every call; SEBProtocol caches it in SEBKeyMaterial
+    return SEBKeyMaterial::hashUrlWithKey(SEBKeyMaterial::requestUrlBytes(requestUrl),
+                                          computeRawKey().toHex());
 }
 
 QByteArray BrowserExamKey::computeBinaryFilesHash(const QString& appPath)
@@ -67,6 +64,9 @@ QByteArray BrowserExamKey::computeBinaryFilesHash(const QString& appPath)
     // 2. Concatenate all hex strings
     // 3. SHA256(concatenated) -> final hash
 
+    QElapsedTimer timer;
+    timer.start();
+
     QFileInfo appInfo(appPath);
     QDir appDir = appInfo.dir();
 
@@ -84,24 +84,20 @@ QByteArray BrowserExamKey::computeBinaryFilesHash(const QString& appPath)
 
     binaryFiles.sort();
 
-    QByteArray allHashes;
-    for (const QString& path : binaryFiles) {
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly)) continue;
+    // Hashed on every launch: digests kept where the user can write them
+    // could be swapped for those of the genuine binaries
+    const QList<QByteArray> digests = Sha256Batch::hashFiles(binaryFiles);
 
-        QByteArray fileHash = QCryptographicHash::hash(
-            file.readAll(), QCryptographicHash::Sha256);
-        allHashes.append(fileHash.toHex());
+    QByteArray allHashes;
+    for (const QByteArray& digest : digests) {
+        // Unreadable files are skipped
+        if (!digest.isEmpty()) allHashes.append(digest.toHex());
     }
 
-    return QCryptographicHash::hash(allHashes, QCryptographicHash::Sha256);
-}
+    qInfo() << "Binary files hash:" << binaryFiles.size() << "files hashed in"
+            << timer.elapsed() << "ms";
 
-QUrl BrowserExamKey::stripFragment(const QUrl& url)
-{
-    QUrl clean = url;
-    clean.setFragment(QString());
-    return clean;
+    return QCryptographicHash::hash(allHashes, QCryptographicHash::Sha256);
 }
 
 } // namespace openlock
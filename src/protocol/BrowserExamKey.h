@@ -26,11 +26,11 @@ public:
     // header = hex(SHA256(UTF8(url_no_fragment + hex(rawBEK))))
     QByteArray computeRequestHash(const QUrl& requestUrl) const;
 
+    // SHA-256 over the hex digests of the executable and the shared
+    // libraries beside it, hashed in parallel by Sha256Batch
     static QByteArray computeBinaryFilesHash(const QString& appPath);
 
 private:
-    static QUrl stripFragment(const QUrl& url);
-
     QByteArray m_examKeySalt;        // 32-byte random salt from .seb config
     QByteArray m_configPlistXml;     // XML plist of current settings
     QByteArray m_binaryFilesHash;    // SHA-256 of concatenated file hashes
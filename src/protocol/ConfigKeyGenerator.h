@@ -8,8 +8,12 @@
 #include <QUrl>
 #include <QVariantMap>
 
+#include <memory>
+
 namespace openlock {
 
+class SEBSettings;
+
 class ConfigKeyGenerator {
 public:
     ConfigKeyGenerator();
@@ -17,6 +21,8 @@ public:
 
     void setConfigData(const QByteArray& data);
     void setSettingsMap(const QVariantMap& settings);
+    // Parsed .seb tree shared with Config; takes precedence over the map
+    void setSettings(std::shared_ptr<const SEBSettings> settings);
 
     // Compute the raw Config Key (32 bytes)
     // ConfigKey = SHA256(UTF8(SEB_JSON_string))
@@ -28,12 +34,9 @@ public:
     QByteArray computeRequestHash(const QUrl& requestUrl) const;
 
 private:
-    QString settingsToSebJson(const QVariantMap& settings) const;
-    QString variantToJson(const QVariant& value) const;
-    static QUrl stripFragment(const QUrl& url);
-
     QByteArray m_configData;
     QVariantMap m_settingsMap;
+    std::shared_ptr<const SEBSettings> m_settings;
 };
 
 } // namespace openlock
@@ -0,0 +1,490 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "protocol/PlistReader.h"
+
+#include <QDateTime>
+
+#include <cmath>
+#include <cstring>
+
+namespace openlock {
+
+namespace {
+
+constexpr qsizetype kTrailerSize = 32;
+
+// Binary plist dates count seconds from 2001-01-01 00:00 UTC
+constexpr double kAppleEpochSecs = 978307200.0;
+
+constexpr int kMaxDepth = 512;
+
+// Shared objects reach the sink once per reference. Real configs share
+// keys and short values, which stays well below this ratio of text and
+// data handed to the sink to the size of the document.
+constexpr quint64 kMaxExpansion = 16;
+
+} // namespace
+
+void PlistSink::latin1Key(QLatin1String key) { this->key(QString(key)); }
+
+void PlistSink::latin1String(QLatin1String value) { string(QString(value)); }
+
+PlistXmlReader::PlistXmlReader(PlistSink& sink)
+    : m_sink(sink)
+{
+    m_text.reserve(256);
+}
+
+bool PlistXmlReader::parse(const QByteArray& xml, PlistSink& sink, QString* error)
+{
+    PlistXmlReader reader(sink);
+    const bool ok = reader.addData(xml) && reader.finish();
+    if (!ok && error) *error = reader.errorString();
+    return ok;
+}
+
+bool PlistXmlReader::addData(QByteArrayView chunk)
+{
+    if (hasError()) return false;
+    m_xml.addData(chunk.toByteArray());
+    return drain();
+}
+
+bool PlistXmlReader::finish()
+{
+    if (hasError()) return false;
+    if (!m_sawRoot || !m_containers.isEmpty() || m_capture != Capture::None) {
+        fail(QStringLiteral("Incomplete property list"));
+        return false;
+    }
+    return true;
+}
+
+bool PlistXmlReader::drain()
+{
+    while (!m_xml.atEnd()) {
+        switch (m_xml.readNext()) {
+        case QXmlStreamReader::StartElement:
+            if (!startElement(m_xml.name())) return false;
+            break;
+        case QXmlStreamReader::EndElement:
+            if (!endElement(m_xml.name())) return false;
+            break;
+        case QXmlStreamReader::Characters:
+            if (m_capture != Capture::None) m_text.append(m_xml.text());
+            break;
+        case QXmlStreamReader::Invalid:
+            if (m_xml.error() == QXmlStreamReader::PrematureEndOfDocumentError) {
+                return true;    // wait for more data
+            }
+            fail(m_xml.errorString());
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+bool PlistXmlReader::startElement(QStringView name)
+{
+    if (m_capture != Capture::None) {
+        fail(QStringLiteral("Unexpected <%1> inside a value").arg(name));
+        return false;
+    }
+    if (name == u"plist") return true;
+    if (m_sawRoot && m_containers.isEmpty()) {
+        fail(QStringLiteral("More than one top-level value"));
+        return false;
+    }
+    m_sawRoot = true;
+
+    // Inside a dict keys and values alternate, starting with a key; arrays
+    // and the top level hold values only
+    const bool inDict = !m_containers.isEmpty() && m_containers.last();
+    if (name == u"key") {
+        if (!inDict || m_keyPending) {
+            fail(inDict ? QStringLiteral("<key> without a value in <dict>")
+                        : QStringLiteral("<key> outside a <dict>"));
+            return false;
+        }
+        m_keyPending = true;
+    } else if (inDict) {
+        if (!m_keyPending) {
+            fail(QStringLiteral("Value <%1> in <dict> without a <key>").arg(name));
+            return false;
+        }
+        m_keyPending = false;
+    }
+
+    // The settings tree and SEB-JSON writer recurse per level; same limit
+    // as binary plists
+    if ((name == u"dict" || name == u"array") && m_containers.size() >= kMaxDepth) {
+        fail(QStringLiteral("Property list nests too deeply"));
+        return false;
+    }
+
+    if (name == u"dict") {
+        m_containers.append(true);
+        m_sink.beginDict();
+    } else if (name == u"array") {
+        m_containers.append(false);
+        m_sink.beginArray();
+    } else if (name == u"true" || name == u"false") {
+        m_sink.boolean(name == u"true");
+    } else {
+        if (name == u"key") m_capture = Capture::Key;
+        else if (name == u"string") m_capture = Capture::String;
+        else if (name == u"data") m_capture = Capture::Data;
+        else if (name == u"date") m_capture = Capture::Date;
+        else if (name == u"integer") m_capture = Capture::Integer;
+        else if (name == u"real") m_capture = Capture::Real;
+        else {
+            fail(QStringLiteral("Unsupported plist element <%1>").arg(name));
+            return false;
+        }
+        m_text.resize(0);
+    }
+    return true;
+}
+
+bool PlistXmlReader::endElement(QStringView name)
+{
+    if (name == u"plist" || name == u"true" || name == u"false") return true;
+
+    if (name == u"dict" || name == u"array") {
+        if (name == u"dict" && m_keyPending) {
+            fail(QStringLiteral("<key> without a value in <dict>"));
+            return false;
+        }
+        m_containers.removeLast();
+        if (name == u"dict") m_sink.endDict();
+        else m_sink.endArray();
+        return true;
+    }
+
+    const Capture capture = m_capture;
+    m_capture = Capture::None;
+
+    switch (capture) {
+    case Capture::Key:
+        m_sink.key(m_text);
+        break;
+    case Capture::String:
+        m_sink.string(m_text);
+        break;
+    case Capture::Data:
+        // Base64, usually wrapped over several lines
+        m_sink.data(QByteArray::fromBase64(m_text.toLatin1()));
+        break;
+    case Capture::Date: {
+        const QDateTime date = QDateTime::fromString(m_text.trimmed(), Qt::ISODate);
+        if (!date.isValid()) {
+            fail(QStringLiteral("Invalid plist date: %1").arg(m_text));
+            return false;
+        }
+        m_sink.date(date.toMSecsSinceEpoch());
+        break;
+    }
+    case Capture::Integer: {
+        bool ok = false;
+        const qint64 value = QStringView(m_text).trimmed().toLongLong(&ok);
+        if (!ok) {
+            fail(QStringLiteral("Invalid plist integer: %1").arg(m_text));
+            return false;
+        }
+        m_sink.integer(value);
+        break;
+    }
+    case Capture::Real: {
+        bool ok = false;
+        const double value = QStringView(m_text).trimmed().toDouble(&ok);
+        if (!ok) {
+            fail(QStringLiteral("Invalid plist real: %1").arg(m_text));
+            return false;
+        }
+        m_sink.real(value);
+        break;
+    }
+    case Capture::None:
+        break;
+    }
+    return true;
+}
+
+void PlistXmlReader::fail(const QString& message)
+{
+    if (m_error.isEmpty()) m_error = message;
+}
+
+PlistBinaryReader::PlistBinaryReader(QByteArrayView data, PlistSink& sink)
+    : m_data(data)
+    , m_sink(sink)
+{
+}
+
+bool PlistBinaryReader::isBinary(QByteArrayView data)
+{
+    return data.startsWith("bplist00");
+}
+
+bool PlistBinaryReader::parse(QByteArrayView data, PlistSink& sink, QString* error)
+{
+    PlistBinaryReader reader(data, sink);
+    const bool ok = reader.readTrailer() && reader.walk(reader.m_topObject, 0);
+    if (!ok && error) *error = reader.m_error;
+    return ok;
+}
+
+bool PlistBinaryReader::readTrailer()
+{
+    if (!isBinary(m_data) || m_data.size() < kMagicSize + kTrailerSize) {
+        fail(QStringLiteral("Not a binary property list"));
+        return false;
+    }
+
+    // Six unused bytes, offset size, reference size, then object count,
+    // top object and offset table position as big-endian 64-bit values
+    const quint64 trailer = quint64(m_data.size() - kTrailerSize);
+    m_offsetSize = quint8(m_data[qsizetype(trailer) + 6]);
+    m_refSize = quint8(m_data[qsizetype(trailer) + 7]);
+    m_objectCount = readUInt(trailer + 8, 8);
+    m_topObject = readUInt(trailer + 16, 8);
+    m_offsetTable = readUInt(trailer + 24, 8);
+
+    const bool sizesValid = m_offsetSize >= 1 && m_offsetSize <= 8 &&
+                            m_refSize >= 1 && m_refSize <= 8;
+    if (!sizesValid || m_topObject >= m_objectCount || m_offsetTable < quint64(kMagicSize) ||
+        m_offsetTable > trailer ||
+        m_objectCount > (trailer - m_offsetTable) / quint64(m_offsetSize)) {
+        fail(QStringLiteral("Corrupt binary property list trailer"));
+        return false;
+    }
+    return true;
+}
+
+bool PlistBinaryReader::walk(quint64 ref, int depth)
+{
+    if (depth > kMaxDepth) {
+        fail(QStringLiteral("Property list nests too deeply"));
+        return false;
+    }
+
+    quint64 offset = 0;
+    quint8 marker = 0;
+    if (!objectAt(ref, &offset, &marker)) return false;
+    const quint8 info = marker & 0x0F;
+    quint64 count = 0;
+
+    switch (marker >> 4) {
+    case 0x0:
+        if (info == 0x8 || info == 0x9) {
+            m_sink.boolean(info == 0x9);
+            return true;
+        }
+        break;
+    case 0x1: {
+        // 1, 2 and 4 byte integers are unsigned, 8 bytes signed; 16 bytes
+        // hold unsigned values above INT64_MAX, of which we keep the low half
+        if (info > 4) break;
+        const quint64 size = quint64(1) << info;
+        if (!fits(offset, size, 1)) break;
+        const int used = int(qMin<quint64>(size, 8));
+        m_sink.integer(qint64(readUInt(offset + size - quint64(used), used)));
+        return true;
+    }
+    case 0x2:
+        if (info == 2 && fits(offset, 4, 1)) {
+            const quint32 bits = quint32(readUInt(offset, 4));
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            m_sink.real(value);
+            return true;
+        }
+        if (info == 3 && fits(offset, 8, 1)) {
+            const quint64 bits = readUInt(offset, 8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            m_sink.real(value);
+            return true;
+        }
+        break;
+    case 0x3:
+        if (info == 3 && fits(offset, 8, 1)) {
+            const quint64 bits = readUInt(offset, 8);
+            double secs;
+            std::memcpy(&secs, &bits, sizeof(secs));
+            if (!std::isfinite(secs) || std::abs(secs) > 1e14) break;
+            m_sink.date(qint64(std::llround((secs + kAppleEpochSecs) * 1000)));
+            return true;
+        }
+        break;
+    case 0x4:
+        if (!readCount(&offset, info, &count)) return false;
+        if (!fits(offset, count, 1)) break;
+        if (!expand(count)) return false;
+        m_sink.data(QByteArray(m_data.data() + offset, qsizetype(count)));
+        return true;
+    case 0x5:
+    case 0x6:
+        if (!readCount(&offset, info, &count)) return false;
+        return readText(offset, marker, count, false);
+    case 0xA:
+        if (!readCount(&offset, info, &count)) return false;
+        if (!fits(offset, count, quint64(m_refSize))) break;
+        m_sink.beginArray();
+        for (quint64 i = 0; i < count; i++) {
+            if (!walk(readUInt(offset + i * quint64(m_refSize), m_refSize), depth + 1)) {
+                return false;
+            }
+        }
+        m_sink.endArray();
+        return true;
+    case 0xD: {
+        // All key references, then all value references
+        if (!readCount(&offset, info, &count)) return false;
+        if (!fits(offset, count, 2 * quint64(m_refSize))) break;
+        const quint64 values = offset + count * quint64(m_refSize);
+        m_sink.beginDict();
+        for (quint64 i = 0; i < count; i++) {
+            if (!walkKey(readUInt(offset + i * quint64(m_refSize), m_refSize)) ||
+                !walk(readUInt(values + i * quint64(m_refSize), m_refSize), depth + 1)) {
+                return false;
+            }
+        }
+        m_sink.endDict();
+        return true;
+    }
+    default:
+        break;
+    }
+
+    fail(QStringLiteral("Unsupported or truncated binary plist object 0x%1 at %2")
+             .arg(marker, 2, 16, QLatin1Char('0'))
+             .arg(offset - 1));
+    return false;
+}
+
+bool PlistBinaryReader::walkKey(quint64 ref)
+{
+    quint64 offset = 0;
+    quint8 marker = 0;
+    quint64 count = 0;
+    if (!objectAt(ref, &offset, &marker)) return false;
+    if (marker >> 4 != 0x5 && marker >> 4 != 0x6) {
+        fail(QStringLiteral("Dictionary key at %1 is not a string").arg(offset - 1));
+        return false;
+    }
+    return readCount(&offset, marker & 0x0F, &count) && readText(offset, marker, count, true);
+}
+
+bool PlistBinaryReader::objectAt(quint64 ref, quint64* offset, quint8* marker)
+{
+    // A tree references each object once. Objects shared between parents
+    // are legal but are walked once per reference, so the walk is bounded
+    // by the document size; expand() bounds the bytes the leaves produce.
+    if (++m_visits > quint64(m_data.size())) {
+        fail(QStringLiteral("Property list references too many objects"));
+        return false;
+    }
+    if (ref >= m_objectCount) {
+        fail(QStringLiteral("Object reference %1 out of range").arg(ref));
+        return false;
+    }
+    *offset = readUInt(m_offsetTable + ref * quint64(m_offsetSize), m_offsetSize);
+    if (*offset < quint64(kMagicSize) || *offset >= m_offsetTable) {
+        fail(QStringLiteral("Object offset %1 out of range").arg(*offset));
+        return false;
+    }
+    *marker = quint8(m_data[qsizetype(*offset)]);
+    ++*offset;
+    return true;
+}
+
+bool PlistBinaryReader::readCount(quint64* offset, quint8 info, quint64* count)
+{
+    if (info != 0x0F) {
+        *count = info;
+        return true;
+    }
+
+    // Longer counts follow as an integer object
+    if (*offset >= m_offsetTable) {
+        fail(QStringLiteral("Truncated binary property list"));
+        return false;
+    }
+    const quint8 marker = quint8(m_data[qsizetype(*offset)]);
+    const quint64 size = quint64(1) << (marker & 0x0F);
+    if (marker >> 4 != 0x1 || (marker & 0x0F) > 3 || !fits(*offset + 1, size, 1)) {
+        fail(QStringLiteral("Invalid object length at %1").arg(*offset));
+        return false;
+    }
+    *count = readUInt(*offset + 1, int(size));
+    *offset += 1 + size;
+    return true;
+}
+
+bool PlistBinaryReader::readText(quint64 offset, quint8 marker, quint64 count, bool isKey)
+{
+    if (marker >> 4 == 0x5) {
+        // ASCII, passed on in place
+        if (!fits(offset, count, 1)) {
+            fail(QStringLiteral("Truncated string at %1").arg(offset));
+            return false;
+        }
+        if (!expand(count)) return false;
+        const QLatin1String text(m_data.data() + offset, qsizetype(count));
+        if (isKey) m_sink.latin1Key(text);
+        else m_sink.latin1String(text);
+        return true;
+    }
+
+    // UTF-16 big-endian; count is in code units
+    if (!fits(offset, count, 2)) {
+        fail(QStringLiteral("Truncated string at %1").arg(offset));
+        return false;
+    }
+    if (!expand(2 * count)) return false;
+    m_utf16.resize(qsizetype(count));
+    for (qsizetype i = 0; i < m_utf16.size(); i++) {
+        m_utf16[i] = char16_t(readUInt(offset + 2 * quint64(i), 2));
+    }
+    const QStringView text(m_utf16.constData(), m_utf16.size());
+    if (isKey) m_sink.key(text);
+    else m_sink.string(text);
+    return true;
+}
+
+bool PlistBinaryReader::fits(quint64 offset, quint64 count, quint64 unit) const
+{
+    return offset <= m_offsetTable && count <= (m_offsetTable - offset) / unit;
+}
+
+bool PlistBinaryReader::expand(quint64 bytes)
+{
+    // Counts are bounded by the document size, so this cannot overflow
+    m_emitted += bytes;
+    if (m_emitted > kMaxExpansion * quint64(m_data.size())) {
+        fail(QStringLiteral("Property list expands too far through shared objects"));
+        return false;
+    }
+    return true;
+}
+
+quint64 PlistBinaryReader::readUInt(quint64 offset, int size) const
+{
+    quint64 value = 0;
+    for (int i = 0; i < size; i++) {
+        value = (value << 8) | quint8(m_data[qsizetype(offset) + i]);
+    }
+    return value;
+}
+
+void PlistBinaryReader::fail(const QString& message)
+{
+    if (m_error.isEmpty()) m_error = message;
+}
+
+} // namespace openlock
@@ -0,0 +1,120 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QLatin1String>
+#include <QString>
+#include <QStringView>
+#include <QVarLengthArray>
+#include <QXmlStreamReader>
+
+namespace openlock {
+
+// Receives a property list as a stream of events, in document order.
+// Containers nest: every beginDict()/beginArray() is closed by the
+// matching end call, and inside a dict each value follows its key().
+// Views are only valid for the duration of the call.
+class PlistSink {
+public:
+    virtual ~PlistSink() = default;
+
+    virtual void beginDict() = 0;
+    virtual void key(QStringView key) = 0;
+    virtual void endDict() = 0;
+    virtual void beginArray() = 0;
+    virtual void endArray() = 0;
+
+    virtual void string(QStringView value) = 0;
+    virtual void data(const QByteArray& value) = 0;
+    virtual void date(qint64 msecsSinceEpoch) = 0;     // UTC
+    virtual void integer(qint64 value) = 0;
+    virtual void real(double value) = 0;
+    virtual void boolean(bool value) = 0;
+
+    // ASCII text as stored in a binary plist, before any conversion; by
+    // default widened and passed to key() and string()
+    virtual void latin1Key(QLatin1String key);
+    virtual void latin1String(QLatin1String value);
+};
+
+// XML property list reader. Data can arrive in pieces, as it does from a
+// network reply or a decryption stream: addData() parses as far as the
+// input allows, finish() checks that a complete plist was seen.
+class PlistXmlReader {
+public:
+    explicit PlistXmlReader(PlistSink& sink);
+
+    bool addData(QByteArrayView chunk);
+    bool finish();
+
+    bool hasError() const { return !m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+
+    // Whole document in one call
+    static bool parse(const QByteArray& xml, PlistSink& sink, QString* error = nullptr);
+
+private:
+    enum class Capture { None, Key, String, Data, Date, Integer, Real };
+
+    bool drain();
+    bool startElement(QStringView name);
+    bool endElement(QStringView name);
+    void fail(const QString& message);
+
+    PlistSink& m_sink;
+    QXmlStreamReader m_xml;
+    QString m_text;         // text of the element being captured, reused
+    Capture m_capture = Capture::None;
+    QVarLengthArray<bool, 32> m_containers;     // open dicts (true) and arrays
+    bool m_keyPending = false;      // innermost dict has a key awaiting its value
+    bool m_sawRoot = false;
+    QString m_error;
+};
+
+// Binary property list (bplist00) reader, for configs exported on macOS.
+// Works in place on a complete document, typically a mapped file: the
+// trailer and offset table are read where they are, and each object is
+// decoded from the buffer only when the walk from the top object reaches
+// it. ASCII strings reach the sink as views into the buffer; UTF-16
+// strings are byte-swapped into one reused buffer.
+class PlistBinaryReader {
+public:
+    static constexpr qsizetype kMagicSize = 8;
+
+    // Starts with the "bplist00" magic
+    static bool isBinary(QByteArrayView data);
+
+    static bool parse(QByteArrayView data, PlistSink& sink, QString* error = nullptr);
+
+private:
+    PlistBinaryReader(QByteArrayView data, PlistSink& sink);
+
+    bool readTrailer();
+    bool walk(quint64 ref, int depth);
+    bool walkKey(quint64 ref);
+    bool objectAt(quint64 ref, quint64* offset, quint8* marker);
+    bool readCount(quint64* offset, quint8 info, quint64* count);
+    bool readText(quint64 offset, quint8 marker, quint64 count, bool isKey);
+    bool fits(quint64 offset, quint64 count, quint64 unit) const;   // before the offset table
+    bool expand(quint64 bytes);     // charges text and data passed to the sink
+    quint64 readUInt(quint64 offset, int size) const;
+    void fail(const QString& message);
+
+    QByteArrayView m_data;
+    PlistSink& m_sink;
+    int m_offsetSize = 0;
+    int m_refSize = 0;
+    quint64 m_objectCount = 0;
+    quint64 m_topObject = 0;
+    quint64 m_offsetTable = 0;      // objects end where the offset table starts
+    quint64 m_visits = 0;
+    quint64 m_emitted = 0;
+    QVarLengthArray<char16_t, 256> m_utf16;
+    QString m_error;
+};
+
+} // namespace openlock
@@ -0,0 +1,146 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "protocol/RequestHashCache.h"
+#include "protocol/SEBKeyMaterial.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <limits>
+
+namespace openlock {
+
+double RequestHashCache::Stats::hitRate() const
+{
+    const quint64 lookups = hits + misses;
+    return lookups ? double(hits) / double(lookups) : 0.0;
+}
+
+RequestHashCache::RequestHashCache(int capacity)
+    : m_capacity(std::max(capacity, kShardCount))
+    , m_shardCapacity((m_capacity + kShardCount - 1) / kShardCount)
+{
+}
+
+RequestHashCache::~RequestHashCache() = default;
+
+void RequestHashCache::Shard::reset(quint64 newGeneration)
+{
+    generation = newGeneration;
+    index.clear();
+    entries.clear();
+    hand = 0;
+}
+
+RequestHashCache::Headers RequestHashCache::headersFor(const SEBKeyMaterial& keys,
+                                                       const QByteArray& url)
+{
+    Shard& shard = m_shards[qHash(url) % kShardCount];
+
+    {
+        QMutexLocker locker(&shard.mutex);
+        if (shard.generation == keys.generation()) {
+            auto it = shard.index.constFind(url);
+            if (it != shard.index.constEnd()) {
+                Entry& entry = shard.entries[it.value()];
+                entry.referenced = true;
+                Headers headers = entry.headers;
+                const quint32 costNs = entry.costNs;
+                locker.unlock();
+
+                m_hits.fetch_add(1, std::memory_order_relaxed);
+                m_savedNs.fetch_add(costNs, std::memory_order_relaxed);
+                return headers;
+            }
+        }
+    }
+
+    // Hash outside the lock; two threads missing on the same URL both
+    // compute it and the second insert is dropped
+    QElapsedTimer timer;
+    timer.start();
+    Entry entry;
+    entry.headers.requestHash = keys.requestHash(url);
+    entry.headers.configKeyHash = keys.configKeyHash(url);
+    const qint64 costNs = timer.nsecsElapsed();
+    entry.costNs = quint32(std::min<qint64>(costNs, std::numeric_limits<quint32>::max()));
+
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    m_hashNs.fetch_add(quint64(costNs), std::memory_order_relaxed);
+
+    Headers headers = entry.headers;
+    if (url.size() > kMaxUrlLength || headers.requestHash.isEmpty()) {
+        return headers;
+    }
+
+    QMutexLocker locker(&shard.mutex);
+    if (shard.generation != keys.generation()) {
+        // A request still holding the previous snapshot must not evict
+        // entries for the current keys
+        if (keys.generation() < shard.generation) return headers;
+        shard.reset(keys.generation());
+    }
+    if (!shard.index.contains(url)) {
+        // Deep copy: callers pass a per-thread buffer they keep reusing
+        entry.url = QByteArray(url.constData(), url.size());
+        insert(shard, std::move(entry));
+    }
+    return headers;
+}
+
+void RequestHashCache::insert(Shard& shard, Entry entry)
+{
+    if (int(shard.entries.size()) < m_shardCapacity) {
+        shard.index.insert(entry.url, int(shard.entries.size()));
+        shard.entries.push_back(std::move(entry));
+        return;
+    }
+
+    // Clock sweep: entries hit since the hand last passed get another round
+    const int count = int(shard.entries.size());
+    while (shard.entries[shard.hand].referenced) {
+        shard.entries[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % count;
+    }
+
+    const int slot = shard.hand;
+    shard.index.remove(shard.entries[slot].url);
+    shard.index.insert(entry.url, slot);
+    shard.entries[slot] = std::move(entry);
+    shard.hand = (slot + 1) % count;
+
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RequestHashCache::clear()
+{
+    for (Shard& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.reset(shard.generation);
+    }
+}
+
+int RequestHashCache::size() const
+{
+    int total = 0;
+    for (const Shard& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        total += int(shard.entries.size());
+    }
+    return total;
+}
+
+RequestHashCache::Stats RequestHashCache::stats() const
+{
+    Stats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.evictions = m_evictions.load(std::memory_order_relaxed);
+    stats.hashNs = m_hashNs.load(std::memory_order_relaxed);
+    stats.savedNs = m_savedNs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace openlock
@@ -0,0 +1,95 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+
+#include <atomic>
+#include <vector>
+
+namespace openlock {
+
+class SEBKeyMaterial;
+
+// Bounded cache of SEB header values per request URL. Quiz pages poll the
+// same autosave, timer and keepalive endpoints many times a minute; a hit
+// returns the shared header bytes instead of hashing twice.
+//
+// Entries belong to one key-material generation: the first lookup with a
+// newer generation drops everything cached for the old keys. The table is
+// split into independently locked shards with clock eviction, so lookups
+// from the IO thread and worker threads rarely contend.
+class RequestHashCache {
+public:
+    struct Headers {
+        QByteArray requestHash;     // X-SafeExamBrowser-RequestHash
+        QByteArray configKeyHash;   // X-SafeExamBrowser-ConfigKeyHash
+    };
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        quint64 hashNs = 0;         // time spent hashing on misses
+        quint64 savedNs = 0;        // hashing time hits did not spend
+
+        double hitRate() const;
+    };
+
+    explicit RequestHashCache(int capacity = 2048);
+    ~RequestHashCache();
+
+    RequestHashCache(const RequestHashCache&) = delete;
+    RequestHashCache& operator=(const RequestHashCache&) = delete;
+
+    // Header values for a URL in SEBKeyMaterial::requestUrlBytes() form,
+    // computed with keys on a miss
+    Headers headersFor(const SEBKeyMaterial& keys, const QByteArray& url);
+
+    void clear();
+    int size() const;
+    int capacity() const { return m_capacity; }
+
+    Stats stats() const;
+
+    // URLs longer than this are hashed every time rather than cached
+    static constexpr int kMaxUrlLength = 2048;
+
+private:
+    static constexpr int kShardCount = 8;
+
+    struct Entry {
+        QByteArray url;
+        Headers headers;
+        quint32 costNs = 0;         // what computing headers took
+        bool referenced = false;
+    };
+
+    struct Shard {
+        mutable QMutex mutex;
+        quint64 generation = 0;
+        QHash<QByteArray, int> index;   // url -> entries slot
+        std::vector<Entry> entries;
+        int hand = 0;
+
+        void reset(quint64 newGeneration);
+    };
+
+    void insert(Shard& shard, Entry entry);
+
+    const int m_capacity;
+    const int m_shardCapacity;
+    Shard m_shards[kShardCount];
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_evictions{0};
+    std::atomic<quint64> m_hashNs{0};
+    std::atomic<quint64> m_savedNs{0};
+};
+
+} // namespace openlock
@@ -2,222 +2,576 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
-// SEB config decryption using RNCryptor v3 format.
-// Reference: https://github.com/RNCryptor/RNCryptor-Spec/blob/master/RNCryptor-Spec-v3.md
+#include "protocol/SEBConfigParser.h"
 
-#include <QByteArray>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QFuture>
+#include <QMessageAuthenticationCode>
+#include <QtConcurrent>
 
 #include <openssl/evp.h>
-#include <openssl/hmac.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <cstring>
+#include <utility>
 
 namespace openlock {
 
-class SEBConfigParser {
+namespace {
+
+// SEB uses SHA-1 PRF with 10000 iterations
+QByteArray pbkdf2(const QByteArray& password, const unsigned char* salt, int saltSize)
+{
+    QByteArray key(32, Qt::Uninitialized);
+    if (!PKCS5_PBKDF2_HMAC(password.constData(), int(password.size()), salt, saltSize, 10000,
+                           EVP_sha1(), int(key.size()),
+                           reinterpret_cast<unsigned char*>(key.data()))) {
+        return {};
+    }
+    return key;
+}
+
+// Every stage works on pieces of at most this size
+constexpr qsizetype kChunkSize = 16 * 1024;
+
+using Output = std::function<bool(const char* data, qsizetype size)>;
+
+// Streaming gunzip. Input that does not start with the gzip magic is
+// passed through unless gzip is required.
+class Gunzip {
 public:
-    // RNCryptor v3 binary layout:
-    //   [0]    version byte = 0x03
-    //   [1]    options byte = 0x01 (password-based)
-    //   [2-9]  encryption salt (8 bytes)
-    //   [10-17] HMAC salt (8 bytes)
-    //   [18-33] IV (16 bytes)
-    //   [34..n-33] AES-256-CBC ciphertext (PKCS7 padded)
-    //   [n-32..n-1] HMAC-SHA256 tag (32 bytes)
+    Gunzip(bool required, Output out)
+        : m_required(required)
+        , m_out(std::move(out))
+    {
+    }
 
-    static QByteArray decryptRNCryptorV3(const QByteArray& data, const QString& password)
+    ~Gunzip()
     {
-        const int kHeaderSize = 2;
-        const int kSaltSize = 8;
-        const int kIVSize = 16;
-        const int kHMACSize = 32;
-        const int kMinSize = kHeaderSize + kSaltSize + kSaltSize + kIVSize + kHMACSize;
+        if (m_mode == Mode::Inflate || m_mode == Mode::Done) inflateEnd(&m_stream);
+    }
 
-        if (data.size() < kMinSize) {
-            qWarning() << "RNCryptor data too small:" << data.size();
-            return {};
+    Gunzip(const Gunzip&) = delete;
+    Gunzip& operator=(const Gunzip&) = delete;
+
+    void setRequired(bool required) { m_required = required; }
+
+    // False on corrupt input or when the output refuses data
+    bool feed(const char* data, qsizetype size)
+    {
+        if (m_mode == Mode::Detect) {
+            if (m_head.size() + size < 2) {
+                m_head.append(data, size);
+                return true;
+            }
+            const auto first = static_cast<unsigned char>(m_head.isEmpty() ? data[0] : m_head[0]);
+            const auto second = static_cast<unsigned char>(m_head.isEmpty() ? data[1] : data[0]);
+            if (first == 0x1f && second == 0x8b) {
+                std::memset(&m_stream, 0, sizeof(m_stream));
+                if (inflateInit2(&m_stream, 16 + MAX_WBITS) != Z_OK) return false;
+                m_mode = Mode::Inflate;
+            } else if (m_required) {
+                return false;
+            } else {
+                m_mode = Mode::Pass;
+            }
+            const QByteArray head = std::exchange(m_head, {});
+            if (!head.isEmpty() && !process(head.constData(), head.size())) return false;
         }
+        return process(data, size);
+    }
 
-        const unsigned char* raw = reinterpret_cast<const unsigned char*>(data.constData());
-        int pos = 0;
+    bool finish()
+    {
+        switch (m_mode) {
+        case Mode::Detect:
+            if (m_required) return false;
+            m_mode = Mode::Pass;
+            return m_head.isEmpty() || m_out(m_head.constData(), m_head.size());
+        case Mode::Inflate:
+            return false;   // truncated
+        case Mode::Pass:
+        case Mode::Done:
+            return true;
+        }
+        return false;
+    }
 
-        // Version and options
-        unsigned char version = raw[pos++];
-        unsigned char options = raw[pos++];
+private:
+    enum class Mode { Detect, Pass, Inflate, Done };
 
-        if (version != 0x03 && version != 0x02) {
-            qWarning() << "Unsupported RNCryptor version:" << (int)version;
-            return {};
+    bool process(const char* data, qsizetype size)
+    {
+        if (m_mode == Mode::Pass) return m_out(data, size);
+
+        if (m_buffer.isEmpty()) m_buffer = QByteArray(kChunkSize, Qt::Uninitialized);
+        auto* buffer = reinterpret_cast<Bytef*>(m_buffer.data());
+        while (size > 0 && m_mode == Mode::Inflate) {
+            const qsizetype piece = std::min(size, kChunkSize);
+            m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            m_stream.avail_in = uInt(piece);
+            do {
+                m_stream.next_out = buffer;
+                m_stream.avail_out = uInt(kChunkSize);
+                const int ret = inflate(&m_stream, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return false;
+                const qsizetype produced = kChunkSize - qsizetype(m_stream.avail_out);
+                if (produced > 0 && !m_out(m_buffer.constData(), produced)) return false;
+                if (ret == Z_STREAM_END) {
+                    // Anything after the gzip member is ignored
+                    m_mode = Mode::Done;
+                    break;
+                }
+                if (ret == Z_BUF_ERROR) break;
+            } while (m_stream.avail_in > 0 || m_stream.avail_out == 0);
+            data += piece;
+            size -= piece;
         }
-        if (options != 0x01) {
-            qWarning() << "RNCryptor: not password-based (options=" << (int)options << ")";
-            return {};
+        return true;
+    }
+
+    bool m_required;
+    Output m_out;
+    Mode m_mode = Mode::Detect;
+    QByteArray m_head;      // first byte, until the magic can be checked
+    z_stream m_stream;
+    QByteArray m_buffer;
+};
+
+// Streaming RNCryptor v2/v3 decryption. The last 32 bytes seen so far
+// are held back as the candidate HMAC tag; everything before them is
+// authenticated and decrypted as it arrives.
+class RNCryptorReader {
+public:
+    static constexpr int kHeaderSize = 2;
+    static constexpr int kSaltSize = 8;
+    static constexpr int kIVSize = 16;
+    static constexpr int kHMACSize = 32;
+    static constexpr int kPreambleSize = kHeaderSize + kSaltSize + kSaltSize + kIVSize;
+
+    enum class Result { Ok, Invalid, Unauthenticated, OutputFailed };
+
+    RNCryptorReader(const QString& password, SEBConfigParser::KeyCache* cache, Output out)
+        : m_password(password)
+        , m_cache(cache)
+        , m_out(std::move(out))
+        , m_hmac(QCryptographicHash::Sha256)
+    {
+    }
+
+    ~RNCryptorReader()
+    {
+        if (m_cipher) EVP_CIPHER_CTX_free(m_cipher);
+    }
+
+    RNCryptorReader(const RNCryptorReader&) = delete;
+    RNCryptorReader& operator=(const RNCryptorReader&) = delete;
+
+    // False when the input cannot be RNCryptor data. Output failures are
+    // remembered and reported by finish(), after the HMAC check.
+    bool feed(const char* data, qsizetype size)
+    {
+        if (m_invalid) return false;
+
+        if (m_preamble.size() < kPreambleSize) {
+            const qsizetype take = std::min(size, kPreambleSize - m_preamble.size());
+            m_preamble.append(data, take);
+            data += take;
+            size -= take;
+            if (m_preamble.size() < kPreambleSize) return true;
+            if (!start()) {
+                m_invalid = true;
+                return false;
+            }
+        }
+
+        const qsizetype total = m_tail.size() + size;
+        if (total <= kHMACSize) {
+            m_tail.append(data, size);
+            return true;
+        }
+        qsizetype release = total - kHMACSize;
+        const qsizetype fromTail = std::min(release, m_tail.size());
+        if (fromTail > 0) {
+            decrypt(m_tail.constData(), fromTail);
+            m_tail.remove(0, fromTail);
+            release -= fromTail;
         }
+        decrypt(data, release);
+        m_tail.append(data + release, size - release);
+        return true;
+    }
 
-        // Encryption salt
-        const unsigned char* encSalt = raw + pos;
-        pos += kSaltSize;
+    Result finish()
+    {
+        if (m_invalid || m_preamble.size() < kPreambleSize || m_tail.size() < kHMACSize ||
+            m_ciphertextSize == 0) {
+            if (!m_invalid) qWarning() << "RNCryptor data too small";
+            return Result::Invalid;
+        }
 
-        // HMAC salt
-        const unsigned char* hmacSalt = raw + pos;
-        pos += kSaltSize;
+        const QByteArray computed = m_hmac.result();
+        if (std::memcmp(computed.constData(), m_tail.constData(), kHMACSize) != 0) {
+            qWarning() << "RNCryptor HMAC verification failed (wrong password?)";
+            return Result::Unauthenticated;
+        }
+        if (m_outputFailed) return Result::OutputFailed;
 
-        // IV
-        const unsigned char* iv = raw + pos;
-        pos += kIVSize;
+        unsigned char last[16];
+        int lastSize = 0;
+        if (!EVP_DecryptFinal_ex(m_cipher, last, &lastSize)) {
+            qWarning() << "AES decryption final block failed";
+            return Result::Invalid;
+        }
+        if (lastSize > 0 && !m_out(reinterpret_cast<const char*>(last), lastSize)) {
+            return Result::OutputFailed;
+        }
+        return Result::Ok;
+    }
 
-        // Ciphertext (everything except the last 32 bytes = HMAC)
-        int ciphertextLen = data.size() - pos - kHMACSize;
-        if (ciphertextLen <= 0) {
-            qWarning() << "RNCryptor: no ciphertext";
-            return {};
+private:
+    bool start()
+    {
+        const auto* raw = reinterpret_cast<const unsigned char*>(m_preamble.constData());
+        const unsigned char version = raw[0];
+        const unsigned char options = raw[1];
+        if (version != 0x03 && version != 0x02) {
+            qWarning() << "Unsupported RNCryptor version:" << (int)version;
+            return false;
+        }
+        if (options != 0x01) {
+            qWarning() << "RNCryptor: not password-based (options=" << (int)options << ")";
+            return false;
         }
-        const unsigned char* ciphertext = raw + pos;
-        pos += ciphertextLen;
 
-        // HMAC tag
-        const unsigned char* expectedHmac = raw + pos;
+        const unsigned char* encSalt = raw + kHeaderSize;
+        const unsigned char* hmacSalt = encSalt + kSaltSize;
+        const unsigned char* iv = hmacSalt + kSaltSize;
 
-        // Derive keys using PBKDF2
-        // SEB uses SHA-1 PRF with 10000 iterations
-        QByteArray passwordBytes = password.toUtf8();
-        unsigned char encKey[32];
-        unsigned char hmacKey[32];
+        QByteArray passwordBytes = m_password.toUtf8();
 
-        int passLen = passwordBytes.size();
         // Note: RNCryptor v2 had a bug using character count instead of byte count.
         // v3 uses byte count correctly.
         if (version == 0x02) {
-            passLen = password.length(); // character count (the v2 bug)
+            passwordBytes.truncate(m_password.length()); // character count (the v2 bug)
         }
 
-        if (!PKCS5_PBKDF2_HMAC(
-                passwordBytes.constData(), passLen,
-                encSalt, kSaltSize,
-                10000, EVP_sha1(),
-                32, encKey)) {
+        // The two derivations are independent: the HMAC key is derived on the
+        // pool while this thread derives the encryption key
+        SEBConfigParser::KeyCache* cache = m_cache;
+        auto derive = [&passwordBytes, cache](const unsigned char* salt) {
+            return cache ? cache->derive(passwordBytes, salt, kSaltSize)
+                         : pbkdf2(passwordBytes, salt, kSaltSize);
+        };
+        QFuture<QByteArray> hmacKeyFuture = QtConcurrent::run(derive, hmacSalt);
+        const QByteArray encKey = derive(encSalt);
+        const QByteArray hmacKey = hmacKeyFuture.result();
+
+        if (encKey.isEmpty()) {
             qWarning() << "PBKDF2 encryption key derivation failed";
-            return {};
+            return false;
         }
-
-        if (!PKCS5_PBKDF2_HMAC(
-                passwordBytes.constData(), passLen,
-                hmacSalt, kSaltSize,
-                10000, EVP_sha1(),
-                32, hmacKey)) {
+        if (hmacKey.isEmpty()) {
             qWarning() << "PBKDF2 HMAC key derivation failed";
-            return {};
+            return false;
         }
 
-        // Verify HMAC
         // HMAC covers header + ciphertext (everything except the HMAC itself)
-        unsigned int hmacLen = 0;
-        unsigned char computedHmac[32];
-        HMAC(EVP_sha256(),
-             hmacKey, 32,
-             raw, data.size() - kHMACSize,
-             computedHmac, &hmacLen);
-
-        if (memcmp(computedHmac, expectedHmac, kHMACSize) != 0) {
-            qWarning() << "RNCryptor HMAC verification failed (wrong password?)";
-            return {};
-        }
+        m_hmac.setKey(hmacKey);
+        m_hmac.addData(m_preamble.constData(), m_preamble.size());
 
-        // Decrypt AES-256-CBC
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-        if (!ctx) return {};
-
-        QByteArray decrypted(ciphertextLen + 16, '\0');
-        int outLen = 0;
-        int totalLen = 0;
+        m_cipher = EVP_CIPHER_CTX_new();
+        return m_cipher &&
+               EVP_DecryptInit_ex(m_cipher, EVP_aes_256_cbc(), nullptr,
+                                  reinterpret_cast<const unsigned char*>(encKey.constData()), iv);
+    }
 
-        if (!EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, encKey, iv)) {
-            EVP_CIPHER_CTX_free(ctx);
-            return {};
+    void decrypt(const char* data, qsizetype size)
+    {
+        m_hmac.addData(data, size);
+        m_ciphertextSize += size;
+
+        // After a failure the rest is only authenticated, so that finish()
+        // can blame the password rather than the config
+        if (m_outputFailed) return;
+
+        if (m_buffer.isEmpty()) m_buffer = QByteArray(kChunkSize + 16, Qt::Uninitialized);
+        auto* buffer = reinterpret_cast<unsigned char*>(m_buffer.data());
+        while (size > 0) {
+            const qsizetype piece = std::min(size, kChunkSize);
+            int produced = 0;
+            if (!EVP_DecryptUpdate(m_cipher, buffer, &produced,
+                                   reinterpret_cast<const unsigned char*>(data), int(piece)) ||
+                (produced > 0 && !m_out(m_buffer.constData(), produced))) {
+                m_outputFailed = true;
+                return;
+            }
+            data += piece;
+            size -= piece;
         }
+    }
 
-        if (!EVP_DecryptUpdate(ctx,
-                               reinterpret_cast<unsigned char*>(decrypted.data()), &outLen,
-                               ciphertext, ciphertextLen)) {
-            EVP_CIPHER_CTX_free(ctx);
-            return {};
-        }
-        totalLen = outLen;
+    QString m_password;
+    SEBConfigParser::KeyCache* m_cache;
+    Output m_out;
+    QMessageAuthenticationCode m_hmac;
+    EVP_CIPHER_CTX* m_cipher = nullptr;
+    QByteArray m_preamble;
+    QByteArray m_tail;          // candidate HMAC tag
+    QByteArray m_buffer;
+    qsizetype m_ciphertextSize = 0;
+    bool m_invalid = false;
+    bool m_outputFailed = false;
+};
 
-        if (!EVP_DecryptFinal_ex(ctx,
-                                  reinterpret_cast<unsigned char*>(decrypted.data()) + totalLen,
-                                  &outLen)) {
-            EVP_CIPHER_CTX_free(ctx);
-            qWarning() << "AES decryption final block failed";
-            return {};
-        }
-        totalLen += outLen;
+} // namespace
 
-        EVP_CIPHER_CTX_free(ctx);
-        decrypted.resize(totalLen);
+QByteArray SEBConfigParser::KeyCache::derive(const QByteArray& password,
+                                             const unsigned char* salt, int saltSize)
+{
+    QCryptographicHash id(QCryptographicHash::Sha256);
+    id.addData(QByteArrayView(reinterpret_cast<const char*>(salt), saltSize));
+    id.addData(password);
+    const QByteArray cacheKey = id.result();
 
-        return decrypted;
+    std::promise<QByteArray> promise;
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_keys.constFind(cacheKey);
+        if (it != m_keys.constEnd()) {
+            const std::shared_future<QByteArray> key = it.value();
+            lock.unlock();
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return key.get();
+        }
+        m_keys.insert(cacheKey, promise.get_future().share());
     }
 
-    // Full .seb file decryption flow:
-    // 1. Outer gzip decompress
-    // 2. Read 4-byte prefix
-    // 3. Decrypt based on prefix type
-    // 4. Inner gzip decompress
-    // 5. Result is XML plist
-    static QByteArray decryptSebFile(const QByteArray& data, const QString& password)
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    const QByteArray key = pbkdf2(password, salt, saltSize);
+    promise.set_value(key);
+    return key;
+}
+
+QByteArray SEBConfigParser::decryptRNCryptorV3(const QByteArray& data, const QString& password,
+                                               KeyCache* cache)
+{
+    QByteArray decrypted;
+    decrypted.reserve(data.size());
+    RNCryptorReader reader(password, cache, [&decrypted](const char* plain, qsizetype size) {
+        decrypted.append(plain, size);
+        return true;
+    });
+    reader.feed(data.constData(), data.size());
+    if (reader.finish() != RNCryptorReader::Result::Ok) return {};
+    return decrypted;
+}
+
+// Stages, from the file to the sink:
+//   outer gunzip -> 4-byte prefix -> RNCryptor (pswd/pwcc) -> inner gunzip -> sink
+// plnd skips decryption and requires the inner gzip; anything else is
+// taken for a plain XML plist.
+struct SEBConfigParser::Decoder::State {
+    enum class Container { Unknown, Encrypted, Compressed, Plain };
+
+    State(Sink sink, const QString& password, KeyCache* cache)
+        : sink(std::move(sink))
+        , password(password)
+        , cache(cache)
+        , outer(false, [this](const char* data, qsizetype size) { return container(data, size); })
+        , inner(false, [this](const char* data, qsizetype size) { return output(data, size); })
     {
-        QByteArray working = data;
+    }
 
-        // Try gzip decompression first (outer layer)
-        QByteArray decompressed = tryGzipDecompress(working);
-        if (!decompressed.isEmpty()) {
-            working = decompressed;
+    bool fail(Error code, const QString& message)
+    {
+        if (error == Error::None) {
+            error = code;
+            errorString = message;
         }
+        return false;
+    }
 
-        if (working.size() < 4) return {};
-
-        // Check prefix
-        QByteArray prefix = working.left(4);
-
-        if (prefix == "pswd" || prefix == "pwcc") {
-            // Password-encrypted (RNCryptor v3)
-            QByteArray encrypted = working.mid(4);
-            QByteArray decrypted = decryptRNCryptorV3(encrypted, password);
-            if (decrypted.isEmpty()) return {};
+    bool output(const char* data, qsizetype size)
+    {
+        return this->sink(data, size) || fail(Error::Rejected, QStringLiteral("Config rejected"));
+    }
 
-            // Inner gzip decompress
-            QByteArray innerDecomp = tryGzipDecompress(decrypted);
-            return innerDecomp.isEmpty() ? decrypted : innerDecomp;
+    bool container(const char* data, qsizetype size)
+    {
+        if (kind == Container::Unknown) {
+            const qsizetype take = std::min(size, 4 - prefix.size());
+            prefix.append(data, take);
+            data += take;
+            size -= take;
+            if (prefix.size() < 4) return true;
+            if (!start()) return false;
         }
 
-        if (prefix == "plnd") {
-            // Plain compressed
-            return tryGzipDecompress(working.mid(4));
+        switch (kind) {
+        case Container::Encrypted:
+            if (!cipher->feed(data, size)) {
+                return fail(Error::Corrupt, QStringLiteral("Invalid encrypted SEB config"));
+            }
+            return true;
+        case Container::Compressed:
+            return inner.feed(data, size) ||
+                   fail(Error::Corrupt, QStringLiteral("Failed to decompress SEB config"));
+        case Container::Plain:
+            return output(data, size);
+        case Container::Unknown:
+            break;
         }
+        return false;
+    }
 
-        if (working.startsWith("<?xm")) {
-            // Raw XML plist, no encryption
-            return working;
+    // Prefix 'pswd' = password encrypted
+    // Prefix 'pwcc' = password encrypted, for configuring the client
+    // Prefix 'phsk' = public key hash encrypted
+    // Prefix 'plnd' = plaintext, compressed
+    // Anything else = plain XML
+    bool start()
+    {
+        if (prefix == "pswd" || prefix == "pwcc") {
+            if (password.isEmpty()) {
+                return fail(Error::PasswordRequired,
+                            QStringLiteral("SEB config is encrypted. Password required."));
+            }
+            kind = Container::Encrypted;
+            cipher = std::make_unique<RNCryptorReader>(
+                password, cache, [this](const char* data, qsizetype size) {
+                    return inner.feed(data, size) ||
+                           fail(Error::Corrupt, QStringLiteral("Failed to decompress SEB config"));
+                });
+            return true;
         }
-
-        qWarning() << "Unknown .seb file prefix:" << prefix.toHex();
-        return {};
+        if (prefix == "phsk") {
+            return fail(Error::Unsupported,
+                        QStringLiteral("Certificate-encrypted SEB configs are not supported"));
+        }
+        if (prefix == "plnd") {
+            kind = Container::Compressed;
+            inner.setRequired(true);
+            return true;
+        }
+        kind = Container::Plain;
+        return output(prefix.constData(), prefix.size());
     }
 
-private:
-    static QByteArray tryGzipDecompress(const QByteArray& data)
+    bool finish()
     {
-        // Check gzip magic bytes (0x1f, 0x8b)
-        if (data.size() < 2) return {};
-        if (static_cast<unsigned char>(data[0]) != 0x1f ||
-            static_cast<unsigned char>(data[1]) != 0x8b) {
-            return {};
+        if (error != Error::None && kind != Container::Encrypted) return false;
+        if (!outer.finish()) return fail(Error::Corrupt, QStringLiteral("Truncated SEB config"));
+
+        switch (kind) {
+        case Container::Unknown:
+            if (prefix.isEmpty()) return fail(Error::Corrupt, QStringLiteral("Empty SEB config"));
+            kind = Container::Plain;
+            return output(prefix.constData(), prefix.size());
+        case Container::Encrypted:
+            switch (cipher->finish()) {
+            case RNCryptorReader::Result::Ok:
+                break;
+            case RNCryptorReader::Result::Unauthenticated:
+                // Overrides whatever the garbage decrypted with a wrong key caused
+                error = Error::WrongPassword;
+                errorString = QStringLiteral("Failed to decrypt SEB config (wrong password?)");
+                return false;
+            case RNCryptorReader::Result::Invalid:
+                return fail(Error::Corrupt, QStringLiteral("Invalid encrypted SEB config"));
+            case RNCryptorReader::Result::OutputFailed:
+                return fail(Error::Corrupt, QStringLiteral("Failed to decompress SEB config"));
+            }
+            [[fallthrough]];
+        case Container::Compressed:
+            return error == Error::None &&
+                   (inner.finish() ||
+                    fail(Error::Corrupt, QStringLiteral("Failed to decompress SEB config")));
+        case Container::Plain:
+            return true;
         }
-
-        return qUncompress(data);
+        return false;
     }
+
+    Sink sink;
+    QString password;
+    KeyCache* cache;
+    Error error = Error::None;
+    QString errorString;
+
+    Container kind = Container::Unknown;
+    QByteArray prefix;
+    Gunzip outer;
+    std::unique_ptr<RNCryptorReader> cipher;
+    Gunzip inner;
 };
 
+SEBConfigParser::Decoder::Decoder(Sink sink, const QString& password, KeyCache* cache)
+    : m_state(std::make_unique<State>(std::move(sink), password, cache))
+{
+}
+
+SEBConfigParser::Decoder::~Decoder() = default;
+
+bool SEBConfigParser::Decoder::addData(QByteArrayView chunk)
+{
+    if (m_state->error != Error::None && m_state->kind != State::Container::Encrypted) {
+        return false;
+    }
+    const char* data = chunk.data();
+    qsizetype size = chunk.size();
+    while (size > 0) {
+        const qsizetype piece = std::min(size, kChunkSize);
+        if (!m_state->outer.feed(data, piece)) {
+            return m_state->fail(Error::Corrupt, QStringLiteral("Failed to decompress SEB config"));
+        }
+        data += piece;
+        size -= piece;
+    }
+    return true;
+}
+
+bool SEBConfigParser::Decoder::finish()
+{
+    return m_state->finish();
+}
+
+SEBConfigParser::Decoder::Error SEBConfigParser::Decoder::error() const
+{
+    return m_state->error;
+}
+
+QString SEBConfigParser::Decoder::errorString() const
+{
+    return m_state->errorString;
+}
+
+QByteArray SEBConfigParser::decryptSebFile(const QByteArray& data, const QString& password,
+                                           KeyCache* cache)
+{
+    QByteArray plist;
+    Decoder decoder(
+        [&plist](const char* plain, qsizetype size) {
+            plist.append(plain, size);
+            return true;
+        },
+        password, cache);
+    if (!decoder.addData(data) || !decoder.finish()) {
+        qWarning() << "Cannot open .seb file:" << decoder.errorString();
+        return {};
+    }
+    return plist;
+}
+
+bool SEBConfigParser::isPasswordProtected(const QByteArray& data)
+{
+    // Without a password decoding stops at the prefix of an encrypted
+    // file; anything else stops at its first output
+    Decoder probe([](const char*, qsizetype) { return false; });
+    probe.addData(data);
+    return probe.error() == Decoder::Error::PasswordRequired;
+}
+
 } // namespace openlock
@@ -0,0 +1,106 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace openlock {
+
+// SEB config decryption using RNCryptor v3 format.
+// Reference: https://github.com/RNCryptor/RNCryptor-Spec/blob/master/RNCryptor-Spec-v3.md
+class SEBConfigParser {
+public:
+    // PBKDF2 keys (10 000 SHA-1 iterations each) shared between
+    // decryptions. Keys depend on password and salt, so files exported
+    // together (copies of one encrypted .seb for many quizzes) derive
+    // them once. Thread-safe; concurrent requests for the same key wait
+    // for the first derivation instead of repeating it.
+    class KeyCache {
+    public:
+        // 32-byte key, empty if derivation failed
+        QByteArray derive(const QByteArray& password, const unsigned char* salt, int saltSize);
+
+        quint64 hits() const { return m_hits.load(std::memory_order_relaxed); }
+        quint64 misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+    private:
+        QMutex m_mutex;
+        // Keyed by SHA-256(salt + password), so no password is kept
+        QHash<QByteArray, std::shared_future<QByteArray>> m_keys;
+        std::atomic<quint64> m_hits{0};
+        std::atomic<quint64> m_misses{0};
+    };
+
+    // Decodes a .seb file as it is read. The outer gunzip, RNCryptor
+    // decryption and inner gunzip run chunk by chunk, so memory stays
+    // bounded by the chunk size instead of a multiple of the config size.
+    // The HMAC is computed alongside decryption and checked by finish():
+    // until then output is unauthenticated and must be dropped if
+    // finish() fails.
+    class Decoder {
+    public:
+        enum class Error {
+            None,
+            PasswordRequired,   // pswd/pwcc without a password
+            WrongPassword,      // HMAC mismatch
+            Unsupported,        // phsk (certificate-encrypted)
+            Corrupt,            // truncated, bad gzip or cipher data
+            Rejected,           // the sink returned false
+        };
+
+        // Receives the plist bytes; returning false stops decoding
+        using Sink = std::function<bool(const char* data, qsizetype size)>;
+
+        explicit Decoder(Sink sink, const QString& password = {}, KeyCache* cache = nullptr);
+        ~Decoder();
+
+        // False once decoding has failed. Inside an encrypted payload a
+        // failure is only final at finish(), when the HMAC tells a wrong
+        // password from a broken config.
+        bool addData(QByteArrayView chunk);
+        bool finish();
+
+        Error error() const;
+        QString errorString() const;
+
+    private:
+        struct State;
+        std::unique_ptr<State> m_state;
+    };
+
+    // RNCryptor v3 binary layout:
+    //   [0]    version byte = 0x03
+    //   [1]    options byte = 0x01 (password-based)
+    //   [2-9]  encryption salt (8 bytes)
+    //   [10-17] HMAC salt (8 bytes)
+    //   [18-33] IV (16 bytes)
+    //   [34..n-33] AES-256-CBC ciphertext (PKCS7 padded)
+    //   [n-32..n-1] HMAC-SHA256 tag (32 bytes)
+    static QByteArray decryptRNCryptorV3(const QByteArray& data, const QString& password,
+                                         KeyCache* cache = nullptr);
+
+    // Full .seb file decryption flow, through a Decoder:
+    // 1. Outer gzip decompress
+    // 2. Read 4-byte prefix
+    // 3. Decrypt based on prefix type
+    // 4. Inner gzip decompress
+    // 5. Result is XML plist
+    static QByteArray decryptSebFile(const QByteArray& data, const QString& password,
+                                     KeyCache* cache = nullptr);
+
+    // Whether decryptSebFile() needs a password for this file
+    static bool isPasswordProtected(const QByteArray& data);
+};
+
+} // namespace openlock
@@ -0,0 +1,404 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "protocol/SEBJsonWriter.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QVariantList>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace openlock {
+
+namespace {
+
+// QString::compare(Qt::CaseInsensitive) folds each UTF-16 unit on every
+// comparison; folding each key once gives the same order
+QString foldedKey(QStringView key)
+{
+    QString folded;
+    folded.reserve(key.size());
+    for (qsizetype i = 0; i < key.size(); i++) {
+        char32_t c = key[i].unicode();
+        if (QChar::isHighSurrogate(c) && i + 1 < key.size() && key[i + 1].isLowSurrogate()) {
+            c = QChar::toCaseFolded(QChar::surrogateToUcs4(char16_t(c), key[++i].unicode()));
+            folded += QChar(QChar::highSurrogate(c));
+            folded += QChar(QChar::lowSurrogate(c));
+        } else {
+            folded += QChar(char16_t(QChar::toCaseFolded(c)));
+        }
+    }
+    return folded;
+}
+
+constexpr char kBase64Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+} // namespace
+
+SEBJsonWriter::SEBJsonWriter(Sink sink)
+    : m_sink(std::move(sink))
+{
+}
+
+SEBJsonWriter::~SEBJsonWriter() = default;
+
+void SEBJsonWriter::writeSettings(const QVariantMap& settings)
+{
+    writeDictionary(settings, u"originatorVersion");
+    flush();
+}
+
+void SEBJsonWriter::writeSettings(const SEBSettings::Value& settings)
+{
+    writeDictionary(settings, u"originatorVersion");
+    flush();
+}
+
+namespace {
+
+template <typename Settings>
+QByteArray jsonOf(const Settings& settings)
+{
+    QByteArray json;
+    SEBJsonWriter writer([&json](const char* data, qsizetype size) { json.append(data, size); });
+    writer.writeSettings(settings);
+    return json;
+}
+
+template <typename Settings>
+QByteArray sha256Of(const Settings& settings)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    SEBJsonWriter writer([&hash](const char* data, qsizetype size) {
+        hash.addData(QByteArrayView(data, size));
+    });
+    writer.writeSettings(settings);
+    return hash.result();
+}
+
+} // namespace
+
+QByteArray SEBJsonWriter::toJson(const QVariantMap& settings)
+{
+    return jsonOf(settings);
+}
+
+QByteArray SEBJsonWriter::sha256(const QVariantMap& settings)
+{
+    return sha256Of(settings);
+}
+
+QByteArray SEBJsonWriter::toJson(const SEBSettings& settings)
+{
+    return jsonOf(settings.root());
+}
+
+QByteArray SEBJsonWriter::sha256(const SEBSettings& settings)
+{
+    return sha256Of(settings.root());
+}
+
+void SEBJsonWriter::flush()
+{
+    if (m_used == 0) return;
+    m_sink(m_buffer, m_used);
+    m_total += quint64(m_used);
+    m_used = 0;
+}
+
+void SEBJsonWriter::writeDictionary(const QVariantMap& dict, QStringView skipKey)
+{
+    struct SortKey {
+        QString folded;
+        QVariantMap::const_iterator it;
+    };
+    std::vector<SortKey> keys;
+    keys.reserve(size_t(dict.size()));
+    for (auto it = dict.constBegin(); it != dict.constEnd(); ++it) {
+        if (!skipKey.isEmpty() && it.key() == skipKey) continue;
+        keys.push_back({foldedKey(it.key()), it});
+    }
+    // Keys differing only in case keep the map's (case-sensitive) order
+    std::sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b) {
+        const int order = a.folded.compare(b.folded);
+        return order != 0 ? order < 0 : a.it.key() < b.it.key();
+    });
+
+    put('{');
+    bool first = true;
+    for (const SortKey& key : keys) {
+        if (!first) put(',');
+        first = false;
+
+        put('"');
+        writeUtf8(key.it.key());
+        put('"');
+        put(':');
+        writeValue(key.it.value());
+    }
+    put('}');
+}
+
+void SEBJsonWriter::writeValue(const QVariant& value)
+{
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        if (value.toBool()) {
+            writeLatin1("true", 4);
+        } else {
+            writeLatin1("false", 5);
+        }
+        return;
+
+    case QMetaType::Int:
+    case QMetaType::LongLong: {
+        char digits[24];
+        const int length = std::snprintf(digits, sizeof(digits), "%lld", value.toLongLong());
+        writeLatin1(digits, length);
+        return;
+    }
+
+    case QMetaType::Double:
+    case QMetaType::Float:
+        writeReal(value.toDouble());
+        return;
+
+    case QMetaType::QString:
+        put('"');
+        writeUtf8(value.toString());
+        put('"');
+        return;
+
+    case QMetaType::QByteArray:
+        // Data -> Base64
+        put('"');
+        writeBase64(value.toByteArray());
+        put('"');
+        return;
+
+    case QMetaType::QDateTime:
+        put('"');
+        writeLatin1(value.toDateTime().toString(Qt::ISODate));
+        put('"');
+        return;
+
+    case QMetaType::QVariantMap:
+        writeDictionary(value.toMap());
+        return;
+
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        put('[');
+        for (qsizetype i = 0; i < list.size(); i++) {
+            if (i > 0) put(',');
+            writeValue(list[i]);
+        }
+        put(']');
+        return;
+    }
+
+    default:
+        put('"');
+        writeUtf8(value.toString());
+        put('"');
+        return;
+    }
+}
+
+void SEBJsonWriter::writeDictionary(const SEBSettings::Value& dict, QStringView skipKey)
+{
+    struct SortKey {
+        QString folded;
+        QStringView key;
+        qsizetype index;
+    };
+    std::vector<SortKey> keys;
+    keys.reserve(size_t(dict.size()));
+    for (qsizetype i = 0; i < dict.size(); i++) {
+        const QStringView key = dict.keyAt(i);
+        if (!skipKey.isEmpty() && key == skipKey) continue;
+        keys.push_back({foldedKey(key), key, i});
+    }
+    // Same order as the QVariantMap path; document order among duplicates
+    std::stable_sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b) {
+        const int order = a.folded.compare(b.folded);
+        return order != 0 ? order < 0 : a.key.compare(b.key) < 0;
+    });
+
+    put('{');
+    bool first = true;
+    for (size_t i = 0; i < keys.size(); i++) {
+        // A repeated key keeps its last value, like a QVariantMap would
+        if (i + 1 < keys.size() && keys[i + 1].key == keys[i].key) continue;
+        if (!first) put(',');
+        first = false;
+
+        put('"');
+        writeUtf8(keys[i].key);
+        put('"');
+        put(':');
+        writeValue(dict.at(keys[i].index));
+    }
+    put('}');
+}
+
+void SEBJsonWriter::writeValue(const SEBSettings::Value& value)
+{
+    using Type = SEBSettings::Type;
+
+    switch (value.type()) {
+    case Type::Bool:
+        if (value.toBool()) {
+            writeLatin1("true", 4);
+        } else {
+            writeLatin1("false", 5);
+        }
+        return;
+
+    case Type::Integer: {
+        char digits[24];
+        const int length = std::snprintf(digits, sizeof(digits), "%lld",
+                                         static_cast<long long>(value.toInteger()));
+        writeLatin1(digits, length);
+        return;
+    }
+
+    case Type::Real:
+        writeReal(value.toReal());
+        return;
+
+    case Type::String:
+        put('"');
+        writeUtf8(value.stringView());
+        put('"');
+        return;
+
+    case Type::Data:
+        put('"');
+        writeBase64(value.toData());
+        put('"');
+        return;
+
+    case Type::Date:
+        put('"');
+        writeLatin1(value.toDateTime().toString(Qt::ISODate));
+        put('"');
+        return;
+
+    case Type::Dict:
+        writeDictionary(value);
+        return;
+
+    case Type::Array:
+        put('[');
+        for (qsizetype i = 0; i < value.size(); i++) {
+            if (i > 0) put(',');
+            writeValue(value.at(i));
+        }
+        put(']');
+        return;
+
+    case Type::Invalid:
+        writeLatin1("\"\"", 2);
+        return;
+    }
+}
+
+void SEBJsonWriter::writeReal(double value)
+{
+    // Proper rounding (0.10000000000000001 -> 0.1)
+    QString s = QString::number(value, 'g', 15);
+    // Ensure it still looks like a number
+    if (!s.contains('.') && !s.contains('e') && !s.contains('E')) {
+        s += ".0";
+    }
+    writeLatin1(s);
+}
+
+void SEBJsonWriter::writeUtf8(QStringView text)
+{
+    for (qsizetype i = 0; i < text.size(); i++) {
+        char32_t c = text[i].unicode();
+        if (c < 0x80) {
+            put(char(c));
+            continue;
+        }
+        if (QChar::isHighSurrogate(c) && i + 1 < text.size() && text[i + 1].isLowSurrogate()) {
+            c = QChar::surrogateToUcs4(char16_t(c), text[++i].unicode());
+        } else if (QChar::isSurrogate(c)) {
+            c = QChar::ReplacementCharacter;
+        }
+
+        reserve(4);
+        char* dst = m_buffer + m_used;
+        if (c < 0x800) {
+            *dst++ = char(0xc0 | (c >> 6));
+        } else if (c < 0x10000) {
+            *dst++ = char(0xe0 | (c >> 12));
+            *dst++ = char(0x80 | ((c >> 6) & 0x3f));
+        } else {
+            *dst++ = char(0xf0 | (c >> 18));
+            *dst++ = char(0x80 | ((c >> 12) & 0x3f));
+            *dst++ = char(0x80 | ((c >> 6) & 0x3f));
+        }
+        *dst++ = char(0x80 | (c & 0x3f));
+        m_used = dst - m_buffer;
+    }
+}
+
+void SEBJsonWriter::writeBase64(const QByteArray& data)
+{
+    // Same output as QByteArray::toBase64(), without the 4/3-size copy
+    const auto* src = reinterpret_cast<const uchar*>(data.constData());
+    const qsizetype whole = data.size() - data.size() % 3;
+
+    for (qsizetype i = 0; i < whole; i += 3) {
+        reserve(4);
+        char* dst = m_buffer + m_used;
+        const quint32 triple = (quint32(src[i]) << 16) | (quint32(src[i + 1]) << 8) | src[i + 2];
+        dst[0] = kBase64Alphabet[(triple >> 18) & 0x3f];
+        dst[1] = kBase64Alphabet[(triple >> 12) & 0x3f];
+        dst[2] = kBase64Alphabet[(triple >> 6) & 0x3f];
+        dst[3] = kBase64Alphabet[triple & 0x3f];
+        m_used += 4;
+    }
+
+    const qsizetype rest = data.size() - whole;
+    if (rest == 0) return;
+
+    const quint32 triple = (quint32(src[whole]) << 16) |
+                           (rest == 2 ? quint32(src[whole + 1]) << 8 : 0);
+    reserve(4);
+    char* dst = m_buffer + m_used;
+    dst[0] = kBase64Alphabet[(triple >> 18) & 0x3f];
+    dst[1] = kBase64Alphabet[(triple >> 12) & 0x3f];
+    dst[2] = rest == 2 ? kBase64Alphabet[(triple >> 6) & 0x3f] : '=';
+    dst[3] = '=';
+    m_used += 4;
+}
+
+void SEBJsonWriter::writeLatin1(const char* data, qsizetype size)
+{
+    while (size > 0) {
+        if (m_used == kBufferSize) flush();
+        const qsizetype chunk = std::min(size, kBufferSize - m_used);
+        std::memcpy(m_buffer + m_used, data, size_t(chunk));
+        m_used += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void SEBJsonWriter::writeLatin1(const QString& text)
+{
+    // Numbers and ISO dates: ASCII only
+    for (QChar c : text) put(char(c.unicode()));
+}
+
+} // namespace openlock
@@ -0,0 +1,78 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "protocol/SEBSettings.h"
+
+#include <QByteArray>
+#include <QStringView>
+#include <QVariant>
+#include <QVariantMap>
+
+#include <functional>
+
+namespace openlock {
+
+// Writes the canonical SEB-JSON of a settings dictionary, the input of
+// the Config Key, straight into a sink through a small fixed buffer:
+//
+//   - keys sorted case-insensitively at every level, no whitespace
+//   - "originatorVersion" left out of the top-level dictionary
+//   - data as Base64, dates as ISO 8601, booleans as true/false
+//
+// Nothing proportional to the config is held in memory, so hashing a
+// config with large embedded resources costs one buffer.
+class SEBJsonWriter {
+public:
+    using Sink = std::function<void(const char* data, qsizetype size)>;
+
+    explicit SEBJsonWriter(Sink sink);
+    ~SEBJsonWriter();
+
+    SEBJsonWriter(const SEBJsonWriter&) = delete;
+    SEBJsonWriter& operator=(const SEBJsonWriter&) = delete;
+
+    // Top-level settings dictionary; flushes the buffer when done
+    void writeSettings(const QVariantMap& settings);
+    void writeSettings(const SEBSettings::Value& settings);
+
+    quint64 bytesWritten() const { return m_total + quint64(m_used); }
+
+    static QByteArray toJson(const QVariantMap& settings);
+    static QByteArray sha256(const QVariantMap& settings);
+    static QByteArray toJson(const SEBSettings& settings);
+    static QByteArray sha256(const SEBSettings& settings);
+
+    static constexpr qsizetype kBufferSize = 4096;
+
+private:
+    void writeDictionary(const QVariantMap& dict, QStringView skipKey = {});
+    void writeValue(const QVariant& value);
+    void writeDictionary(const SEBSettings::Value& dict, QStringView skipKey = {});
+    void writeValue(const SEBSettings::Value& value);
+    void writeReal(double value);
+    void writeUtf8(QStringView text);
+    void writeBase64(const QByteArray& data);
+    void writeLatin1(const char* data, qsizetype size);
+    void writeLatin1(const QString& text);
+
+    void put(char c)
+    {
+        if (m_used == kBufferSize) flush();
+        m_buffer[m_used++] = c;
+    }
+    void reserve(qsizetype n)
+    {
+        if (m_used + n > kBufferSize) flush();
+    }
+    void flush();
+
+    Sink m_sink;
+    char m_buffer[kBufferSize];
+    qsizetype m_used = 0;
+    quint64 m_total = 0;
+};
+
+} // namespace openlock
@@ -0,0 +1,153 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "protocol/SEBKeyBatch.h"
+#include "protocol/SEBKeyMaterial.h"
+#include "protocol/SEBProtocol.h"
+#include "core/Config.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+namespace openlock {
+
+namespace {
+
+QByteArray csvField(const QString& value)
+{
+    QByteArray field = value.toUtf8();
+    if (field.contains(',') || field.contains('"') || field.contains('\n') ||
+        field.contains('\r')) {
+        field.replace("\"", "\"\"");
+        field = '"' + field + '"';
+    }
+    return field;
+}
+
+} // namespace
+
+SEBKeyBatch::SEBKeyBatch(const QByteArray& binaryFilesHash, const QStringList& passwords)
+    : m_binaryFilesHash(binaryFilesHash)
+    , m_passwords(passwords)
+{
+}
+
+QList<SEBKeyBatch::Entry> SEBKeyBatch::run(const QStringList& files, const QDir& root)
+{
+    QThreadPool* pool = m_pool ? m_pool : QThreadPool::globalInstance();
+    return QtConcurrent::blockingMapped(pool, files, [this, &root](const QString& file) {
+        return process(file, root);
+    });
+}
+
+SEBKeyBatch::Entry SEBKeyBatch::process(const QString& file, const QDir& root)
+{
+    Entry entry;
+    entry.file = file;
+    entry.quiz = QDir(root.absolutePath()).relativeFilePath(QFileInfo(file).absoluteFilePath());
+    if (entry.quiz.endsWith(".seb", Qt::CaseInsensitive)) entry.quiz.chop(4);
+
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly)) {
+        entry.error = "Cannot open file: " + input.errorString();
+        return entry;
+    }
+    const QByteArray data = input.readAll();
+
+    // Encrypted configs are opened here to try the candidate passwords
+    // against the shared key cache. Config keeps the plist XML as the
+    // Browser Exam Key input either way, so the keys match the browser's.
+    QByteArray configData = data;
+    if (SEBConfigParser::isPasswordProtected(data)) {
+        configData = decrypt(data, &entry.error);
+        if (configData.isEmpty()) return entry;
+    }
+
+    Config config;
+    QObject::connect(&config, &Config::configError, [&entry](const QString& message) {
+        entry.error = message;
+    });
+    if (!config.loadFromSebData(configData)) {
+        if (entry.error.isEmpty()) entry.error = "Invalid SEB config";
+        return entry;
+    }
+
+    const auto keys = SEBProtocol::deriveKeys(config, m_binaryFilesHash);
+    entry.startUrl = config.examConfig().startUrl.toString();
+    entry.browserExamKey = keys->examKeyHex();
+    entry.configKey = keys->configKeyHex();
+    return entry;
+}
+
+QByteArray SEBKeyBatch::decrypt(const QByteArray& data, QString* error)
+{
+    if (m_passwords.isEmpty()) {
+        *error = "Config is password protected and no password was given";
+        return {};
+    }
+
+    // Quizzes exported together usually share a password: start with the
+    // one that worked last, so a wrong guess costs a derivation only once
+    const int first = m_lastPassword.load(std::memory_order_relaxed);
+    for (int i = 0; i < m_passwords.size(); i++) {
+        const int index = (first + i) % int(m_passwords.size());
+        QByteArray plain = SEBConfigParser::decryptSebFile(data, m_passwords[index], &m_keyCache);
+        if (!plain.isEmpty()) {
+            m_lastPassword.store(index, std::memory_order_relaxed);
+            return plain;
+        }
+    }
+
+    *error = "None of the passwords decrypts the config";
+    return {};
+}
+
+QStringList SEBKeyBatch::sebFiles(const QString& dir, bool recursive)
+{
+    QStringList files;
+    QDirIterator it(dir, {"*.seb"}, QDir::Files,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) files << it.next();
+    files.sort();
+    return files;
+}
+
+QByteArray SEBKeyBatch::toCsv(const QList<Entry>& entries)
+{
+    QByteArray csv = "quiz,file,start_url,browser_exam_key,config_key,error\n";
+    for (const Entry& entry : entries) {
+        csv += csvField(entry.quiz) + ',' + csvField(entry.file) + ',' +
+               csvField(entry.startUrl) + ',' + entry.browserExamKey + ',' + entry.configKey +
+               ',' + csvField(entry.error) + '\n';
+    }
+    return csv;
+}
+
+QByteArray SEBKeyBatch::toJson(const QList<Entry>& entries)
+{
+    // An array, like the CSV rows: two DIR arguments can both hold "final.seb"
+    QJsonArray quizzes;
+    for (const Entry& entry : entries) {
+        QJsonObject object;
+        object["quiz"] = entry.quiz;
+        object["file"] = entry.file;
+        if (entry.error.isEmpty()) {
+            object["startUrl"] = entry.startUrl;
+            object["browserExamKey"] = QString::fromLatin1(entry.browserExamKey);
+            object["configKey"] = QString::fromLatin1(entry.configKey);
+        } else {
+            object["error"] = entry.error;
+        }
+        quizzes.append(object);
+    }
+    return QJsonDocument(quizzes).toJson(QJsonDocument::Indented);
+}
+
+} // namespace openlock
@@ -0,0 +1,66 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include "protocol/SEBConfigParser.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+
+class QThreadPool;
+
+namespace openlock {
+
+// Browser Exam Keys and Config Keys for many .seb files at once, as
+// administrators enter them into the LMS quiz settings. Files are
+// decrypted and hashed in parallel; PBKDF2 keys are shared between files
+// through one SEBConfigParser::KeyCache.
+class SEBKeyBatch {
+public:
+    struct Entry {
+        QString quiz;               // path relative to the batch root, without .seb
+        QString file;
+        QString startUrl;
+        QByteArray browserExamKey;  // hex
+        QByteArray configKey;       // hex
+        QString error;              // empty on success
+    };
+
+    // Password-protected files are tried with each candidate password,
+    // starting with the one that opened the previous file
+    SEBKeyBatch(const QByteArray& binaryFilesHash, const QStringList& passwords = {});
+
+    // Global pool unless set
+    void setThreadPool(QThreadPool* pool) { m_pool = pool; }
+
+    // Entries in the order of files
+    QList<Entry> run(const QStringList& files, const QDir& root = QDir());
+
+    const SEBConfigParser::KeyCache& keyCache() const { return m_keyCache; }
+
+    // *.seb below dir, sorted
+    static QStringList sebFiles(const QString& dir, bool recursive);
+
+    // One row or array element per entry, in order
+    static QByteArray toCsv(const QList<Entry>& entries);
+    static QByteArray toJson(const QList<Entry>& entries);
+
+private:
+    Entry process(const QString& file, const QDir& root);
+    QByteArray decrypt(const QByteArray& data, QString* error);
+
+    QByteArray m_binaryFilesHash;
+    QStringList m_passwords;
+    QThreadPool* m_pool = nullptr;
+    SEBConfigParser::KeyCache m_keyCache;
+    std::atomic<int> m_lastPassword{0};
+};
+
+} // namespace openlock
@@ -0,0 +1,127 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QStringView>
+#include <QtGlobal>
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+namespace openlock {
+
+// Perfect hash over a fixed set of SEB settings keys, built at compile
+// time (hash and displace: a first hash picks a bucket, a per-bucket seed
+// for the second hash gives every key its own slot). A lookup is two
+// hashes and one string compare, however many keys the table knows.
+//
+//   constexpr SEBKeyIndex<2> index({u"startURL", u"allowQuit"});
+//   index.indexOf(u"allowQuit") == 1
+//
+// Duplicate keys, or a set no seed separates, fail to compile.
+template<std::size_t N>
+class SEBKeyIndex {
+public:
+    static constexpr std::size_t kBuckets = N / 2 + 1;
+    static constexpr std::size_t kSlots = [] {
+        std::size_t slots = 1;
+        while (slots < N + N / 4 + 1) slots *= 2;
+        return slots;
+    }();
+
+    constexpr explicit SEBKeyIndex(const std::array<std::u16string_view, N>& keys)
+        : m_keys(keys)
+    {
+        for (std::size_t i = 0; i < N; i++) {
+            for (std::size_t j = 0; j < i; j++) {
+                if (keys[i] == keys[j]) throw std::logic_error("duplicate SEB key");
+            }
+        }
+        for (auto& slot : m_slots) slot = -1;
+
+        std::array<std::size_t, N> bucketOf = {};
+        std::array<std::size_t, kBuckets> bucketSize = {};
+        for (std::size_t i = 0; i < N; i++) {
+            bucketOf[i] = hash(keys[i], 0) % kBuckets;
+            bucketSize[bucketOf[i]]++;
+        }
+
+        // Largest buckets first, while most slots are still free
+        std::array<std::size_t, kBuckets> order = {};
+        for (std::size_t b = 0; b < kBuckets; b++) {
+            std::size_t at = b;
+            while (at > 0 && bucketSize[order[at - 1]] < bucketSize[b]) {
+                order[at] = order[at - 1];
+                at--;
+            }
+            order[at] = b;
+        }
+
+        for (std::size_t b : order) {
+            if (bucketSize[b] == 0) break;
+            m_seeds[b] = findSeed(b, bucketOf);
+            for (std::size_t i = 0; i < N; i++) {
+                if (bucketOf[i] == b) m_slots[hash(keys[i], m_seeds[b]) % kSlots] = qint16(i);
+            }
+        }
+    }
+
+    // Position of key in the array the index was built from, or -1
+    constexpr int indexOf(std::u16string_view key) const
+    {
+        const std::size_t bucket = hash(key, 0) % kBuckets;
+        const int i = m_slots[hash(key, m_seeds[bucket]) % kSlots];
+        return i >= 0 && m_keys[i] == key ? i : -1;
+    }
+
+    constexpr int indexOf(const char16_t* key) const
+    {
+        return indexOf(std::u16string_view(key));
+    }
+
+    int indexOf(QStringView key) const
+    {
+        return indexOf(std::u16string_view(key.utf16(), std::size_t(key.size())));
+    }
+
+    constexpr std::u16string_view keyAt(std::size_t index) const { return m_keys[index]; }
+    static constexpr std::size_t size() { return N; }
+
+private:
+    // FNV-1a over UTF-16 code units, seeded
+    static constexpr quint32 hash(std::u16string_view key, quint32 seed)
+    {
+        quint32 h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (char16_t c : key) {
+            h ^= quint32(c);
+            h *= 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    constexpr quint32 findSeed(std::size_t bucket, const std::array<std::size_t, N>& bucketOf)
+    {
+        for (quint32 seed = 1; seed < 0x10000; seed++) {
+            std::array<bool, kSlots> taken = {};
+            bool fits = true;
+            for (std::size_t i = 0; i < N && fits; i++) {
+                if (bucketOf[i] != bucket) continue;
+                const std::size_t slot = hash(m_keys[i], seed) % kSlots;
+                fits = m_slots[slot] < 0 && !taken[slot];
+                taken[slot] = true;
+            }
+            if (fits) return seed;
+        }
+        throw std::logic_error("no perfect hash seed for SEB keys");
+    }
+
+    std::array<std::u16string_view, N> m_keys;
+    std::array<quint32, kBuckets> m_seeds = {};
+    std::array<qint16, kSlots> m_slots = {};
+};
+
+} // namespace openlock
@@ -0,0 +1,122 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "protocol/SEBKeyMaterial.h"
+
+#include <QDebug>
+
+#include <openssl/evp.h>
+
+#include <memory>
+
+namespace openlock {
+
+namespace {
+
+const EVP_MD* sha256()
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    // Fetch once instead of on every EVP_DigestInit_ex
+    static EVP_MD* md = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+    return md;
+#else
+    return EVP_sha256();
+#endif
+}
+
+// One digest context per thread, reused for every request
+EVP_MD_CTX* threadDigestContext()
+{
+    struct Deleter {
+        void operator()(EVP_MD_CTX* ctx) const { EVP_MD_CTX_free(ctx); }
+    };
+    thread_local std::unique_ptr<EVP_MD_CTX, Deleter> ctx(EVP_MD_CTX_new());
+    return ctx.get();
+}
+
+} // namespace
+
+SEBKeyMaterial::SEBKeyMaterial(const QByteArray& examKey, const QByteArray& configKey,
+                               quint64 generation)
+    : m_examKey(examKey)
+    , m_examKeyHex(examKey.toHex())
+    , m_configKey(configKey)
+    , m_configKeyHex(configKey.toHex())
+    , m_generation(generation)
+{
+}
+
+QByteArray SEBKeyMaterial::requestHash(const QByteArray& url) const
+{
+    return hashUrlWithKey(url, m_examKeyHex);
+}
+
+QByteArray SEBKeyMaterial::configKeyHash(const QByteArray& url) const
+{
+    return hashUrlWithKey(url, m_configKeyHex);
+}
+
+QByteArray SEBKeyMaterial::hashUrlWithKey(const QByteArray& url, const QByteArray& keyHex)
+{
+    // The key is a suffix, so there is no reusable midstate; the digest
+    // covers the URL plus 64 hex characters.
+    EVP_MD_CTX* ctx = threadDigestContext();
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+
+    if (!ctx ||
+        !EVP_DigestInit_ex(ctx, sha256(), nullptr) ||
+        !EVP_DigestUpdate(ctx, url.constData(), url.size()) ||
+        !EVP_DigestUpdate(ctx, keyHex.constData(), keyHex.size()) ||
+        !EVP_DigestFinal_ex(ctx, digest, &digestLength)) {
+        qWarning() << "SEB request hash: SHA-256 failed";
+        return {};
+    }
+
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(digest), digestLength).toHex();
+}
+
+QByteArray SEBKeyMaterial::requestUrlBytes(const QUrl& url)
+{
+    return url.toString(QUrl::RemoveFragment).toUtf8();
+}
+
+void SEBKeyMaterial::requestUrlBytes(QStringView urlString, QByteArray& out)
+{
+    // At most three bytes per UTF-16 unit; a surrogate pair is two units
+    // for four bytes. resize() keeps the capacity of an unshared buffer.
+    out.resize(urlString.size() * 3);
+    char* dst = out.data();
+    qsizetype n = 0;
+
+    for (qsizetype i = 0; i < urlString.size(); i++) {
+        char32_t c = urlString[i].unicode();
+        if (c < 0x80) {
+            dst[n++] = char(c);
+            continue;
+        }
+        if (QChar::isHighSurrogate(c) && i + 1 < urlString.size() &&
+            urlString[i + 1].isLowSurrogate()) {
+            c = QChar::surrogateToUcs4(char16_t(c), urlString[++i].unicode());
+        } else if (QChar::isSurrogate(c)) {
+            c = QChar::ReplacementCharacter;
+        }
+
+        if (c < 0x800) {
+            dst[n++] = char(0xc0 | (c >> 6));
+        } else if (c < 0x10000) {
+            dst[n++] = char(0xe0 | (c >> 12));
+            dst[n++] = char(0x80 | ((c >> 6) & 0x3f));
+        } else {
+            dst[n++] = char(0xf0 | (c >> 18));
+            dst[n++] = char(0x80 | ((c >> 12) & 0x3f));
+            dst[n++] = char(0x80 | ((c >> 6) & 0x3f));
+        }
+        dst[n++] = char(0x80 | (c & 0x3f));
+    }
+
+    out.resize(n);
+}
+
+} // namespace openlock
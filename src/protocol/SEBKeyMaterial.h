@@ -0,0 +1,51 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QStringView>
+#include <QUrl>
+
+namespace openlock {
+
+// Browser Exam Key and Config Key for one configuration, derived once at
+// SEBProtocol::initialize and never modified afterwards. Request hashing
+// only needs the hex forms, so per-request cost no longer depends on the
+// size of the config.
+class SEBKeyMaterial {
+public:
+    SEBKeyMaterial(const QByteArray& examKey, const QByteArray& configKey, quint64 generation);
+
+    const QByteArray& examKey() const { return m_examKey; }
+    const QByteArray& examKeyHex() const { return m_examKeyHex; }
+    const QByteArray& configKey() const { return m_configKey; }
+    const QByteArray& configKeyHex() const { return m_configKeyHex; }
+
+    // Changes whenever the protocol is re-initialized
+    quint64 generation() const { return m_generation; }
+
+    // Header values for a URL already in requestUrlBytes() form
+    QByteArray requestHash(const QByteArray& url) const;
+    QByteArray configKeyHash(const QByteArray& url) const;
+
+    // hex(SHA256(url + keyHex)): one digest on a per-thread EVP context
+    static QByteArray hashUrlWithKey(const QByteArray& url, const QByteArray& keyHex);
+
+    // The URL string SEB hashes: fragment removed, UTF-8
+    static QByteArray requestUrlBytes(const QUrl& url);
+
+    // Same, from url.toString(QUrl::RemoveFragment), written into out's
+    // existing buffer so a reused buffer does not allocate
+    static void requestUrlBytes(QStringView urlString, QByteArray& out);
+
+private:
+    const QByteArray m_examKey;
+    const QByteArray m_examKeyHex;
+    const QByteArray m_configKey;
+    const QByteArray m_configKeyHex;
+    const quint64 m_generation;
+};
+
+} // namespace openlock
@@ -5,17 +5,22 @@
 #include "protocol/SEBProtocol.h"
 #include "protocol/BrowserExamKey.h"
 #include "protocol/ConfigKeyGenerator.h"
+#include "protocol/SEBKeyMaterial.h"
 #include "core/Config.h"
 
 #include <QCoreApplication>
 #include <QDebug>
 
+#include <atomic>
+
 namespace openlock {
 
+namespace {
+std::atomic<quint64> s_keyGeneration{0};
+}
+
 SEBProtocol::SEBProtocol(QObject* parent)
     : QObject(parent)
-    , m_examKey(std::make_unique<BrowserExamKey>())
-    , m_configKey(std::make_unique<ConfigKeyGenerator>())
 {
 }
 
@@ -32,34 +37,58 @@ bool SEBProtocol::initialize(const Config* config)
     // Compute binary files hash
     QString appPath = QCoreApplication::applicationFilePath();
     QByteArray binaryHash = BrowserExamKey::computeBinaryFilesHash(appPath);
-    m_examKey->setBinaryFilesHash(binaryHash);
+
+    // Derive both keys once; requests only hash URL + key hex from here on
+    auto keys = deriveKeys(*config, binaryHash, ++s_keyGeneration);
+    std::atomic_store(&m_keyMaterial, std::move(keys));
+
+    qInfo() << "SEB protocol initialized";
+    qInfo() << "Binary hash:" << binaryHash.toHex().left(16) << "...";
+
+    return true;
+}
+
+std::shared_ptr<const SEBKeyMaterial> SEBProtocol::deriveKeys(const Config& config,
+                                                              const QByteArray& binaryFilesHash,
+                                                              quint64 generation)
+{
+    BrowserExamKey examKey;
+    examKey.setBinaryFilesHash(binaryFilesHash);
 
     // Set config XML (raw config data as plist XML)
-    m_examKey->setConfigPlistXml(config->rawConfigData());
+    examKey.setConfigPlistXml(config.rawConfigData());
 
     // examKeySalt would come from the .seb config; for now use raw data hash as fallback
     // TODO: Extract examKeySalt from parsed .seb config
-    m_examKey->setExamKeySalt(config->configKeyHash());
+    examKey.setExamKeySalt(config.configKeyHash());
+    const QByteArray examKeyRaw = examKey.computeRawKey();
 
-    // Config Key setup
-    m_configKey->setConfigData(config->rawConfigData());
-    // TODO: Pass parsed settings map for proper SEB-JSON generation
-    // m_configKey->setSettingsMap(config->settingsMap());
+    ConfigKeyGenerator configKey;
+    configKey.setConfigData(config.rawConfigData());
+    // Same tree Config was populated from; null for JSON configs
+    configKey.setSettings(config.sebSettings());
+    const QByteArray configKeyRaw = configKey.computeRawKey();
 
-    qInfo() << "SEB protocol initialized";
-    qInfo() << "Binary hash:" << binaryHash.toHex().left(16) << "...";
-
-    return true;
+    return std::make_shared<const SEBKeyMaterial>(examKeyRaw, configKeyRaw, generation);
 }
 
 QByteArray SEBProtocol::computeRequestHash(const QUrl& requestUrl) const
 {
-    return m_examKey->computeRequestHash(requestUrl);
+    auto keys = keyMaterial();
+    if (!keys) return {};
+    return keys->requestHash(SEBKeyMaterial::requestUrlBytes(requestUrl));
 }
 
 QByteArray SEBProtocol::computeConfigKeyHash(const QUrl& requestUrl) const
 {
-    return m_configKey->computeRequestHash(requestUrl);
+    auto keys = keyMaterial();
+    if (!keys) return {};
+    return keys->configKeyHash(SEBKeyMaterial::requestUrlBytes(requestUrl));
+}
+
+std::shared_ptr<const SEBKeyMaterial> SEBProtocol::keyMaterial() const
+{
+    return std::atomic_load(&m_keyMaterial);
 }
 
 QString SEBProtocol::requestHashHeaderName()
@@ -72,6 +101,18 @@ QString SEBProtocol::configKeyHeaderName()
     return QStringLiteral("X-SafeExamBrowser-ConfigKeyHash");
 }
 
+const QByteArray& SEBProtocol::requestHashHeader()
+{
+    static const QByteArray name = QByteArrayLiteral("X-SafeExamBrowser-RequestHash");
+    return name;
+}
+
+const QByteArray& SEBProtocol::configKeyHeader()
+{
+    static const QByteArray name = QByteArrayLiteral("X-SafeExamBrowser-ConfigKeyHash");
+    return name;
+}
+
 QString SEBProtocol::sebUserAgent()
 {
     return QStringLiteral("SEB/3.0 OpenLock/0.1.0");
@@ -11,8 +11,7 @@
 
 namespace openlock {
 
-class BrowserExamKey;
-class ConfigKeyGenerator;
+class SEBKeyMaterial;
 class Config;
 
 class SEBProtocol : public QObject {
@@ -24,20 +23,34 @@ public:
 
     bool initialize(const Config* config);
 
+    // Browser Exam Key and Config Key the browser sends for config when
+    // its binaries hash to binaryFilesHash. Does not touch any instance
+    // state, so openlock-keygen derives keys for many configs at once.
+    static std::shared_ptr<const SEBKeyMaterial> deriveKeys(const Config& config,
+                                                            const QByteArray& binaryFilesHash,
+                                                            quint64 generation = 0);
+
     // Compute per-request header values (already hex-encoded)
     QByteArray computeRequestHash(const QUrl& requestUrl) const;
     QByteArray computeConfigKeyHash(const QUrl& requestUrl) const;
 
+    // Keys derived by the last initialize(); null before that. Safe to
+    // call from the request interceptor's thread.
+    std::shared_ptr<const SEBKeyMaterial> keyMaterial() const;
+
     static QString requestHashHeaderName();   // X-SafeExamBrowser-RequestHash
     static QString configKeyHeaderName();     // X-SafeExamBrowser-ConfigKeyHash
     static QString sebUserAgent();
 
+    // Header names as sent, so the interceptor never converts per request
+    static const QByteArray& requestHashHeader();
+    static const QByteArray& configKeyHeader();
+
 signals:
     void protocolError(const QString& message);
 
 private:
-    std::unique_ptr<BrowserExamKey> m_examKey;
-    std::unique_ptr<ConfigKeyGenerator> m_configKey;
+    std::shared_ptr<const SEBKeyMaterial> m_keyMaterial;   // swapped atomically
 };
 
 } // namespace openlock
@@ -4,12 +4,70 @@
 
 #include "protocol/SEBRequestInterceptor.h"
 #include "protocol/SEBProtocol.h"
+#include "protocol/SEBKeyMaterial.h"
 #include "browser/NavigationFilter.h"
 
+#include <QHash>
+#include <QElapsedTimer>
 #include <QDebug>
 
+#include <algorithm>
+#include <iterator>
+
 namespace openlock {
 
+namespace {
+
+// Buffers reused by every request the calling thread intercepts; once
+// they have grown to the longest URL seen they are not reallocated
+struct RequestScratch {
+    QByteArray urlBytes;    // SEBKeyMaterial::requestUrlBytes() form
+    QString origin;         // scheme://host[:port], frame-origin cache key
+
+    RequestScratch()
+    {
+        urlBytes.reserve(1024);
+        origin.reserve(128);
+    }
+};
+
+RequestScratch& threadScratch()
+{
+    thread_local RequestScratch scratch;
+    return scratch;
+}
+
+const QHash<QString, QWebEngineUrlRequestInfo::ResourceType>& resourceTypesByName()
+{
+    static const QHash<QString, QWebEngineUrlRequestInfo::ResourceType> byName = {
+        {"main_frame", QWebEngineUrlRequestInfo::ResourceTypeMainFrame},
+        {"sub_frame", QWebEngineUrlRequestInfo::ResourceTypeSubFrame},
+        {"stylesheet", QWebEngineUrlRequestInfo::ResourceTypeStylesheet},
+        {"script", QWebEngineUrlRequestInfo::ResourceTypeScript},
+        {"image", QWebEngineUrlRequestInfo::ResourceTypeImage},
+        {"font", QWebEngineUrlRequestInfo::ResourceTypeFontResource},
+        {"object", QWebEngineUrlRequestInfo::ResourceTypeObject},
+        {"media", QWebEngineUrlRequestInfo::ResourceTypeMedia},
+        {"worker", QWebEngineUrlRequestInfo::ResourceTypeWorker},
+        {"prefetch", QWebEngineUrlRequestInfo::ResourceTypePrefetch},
+        {"favicon", QWebEngineUrlRequestInfo::ResourceTypeFavicon},
+        {"xhr", QWebEngineUrlRequestInfo::ResourceTypeXhr},
+        {"ping", QWebEngineUrlRequestInfo::ResourceTypePing},
+        {"csp_report", QWebEngineUrlRequestInfo::ResourceTypeCspReport},
+        {"other", QWebEngineUrlRequestInfo::ResourceTypeSubResource},
+    };
+    return byName;
+}
+
+QString formatNs(quint64 ns)
+{
+    if (ns < 10000) return QString("%1ns").arg(ns);
+    if (ns < 10000000) return QString("%1us").arg(ns / 1000.0, 0, 'f', 1);
+    return QString("%1ms").arg(ns / 1000000.0, 0, 'f', 1);
+}
+
+} // namespace
+
 SEBRequestInterceptor::SEBRequestInterceptor(QObject* parent)
     : QWebEngineUrlRequestInterceptor(parent)
 {
@@ -25,63 +83,394 @@ void SEBRequestInterceptor::setSEBProtocol(SEBProtocol* protocol)
 void SEBRequestInterceptor::setNavigationFilter(NavigationFilter* filter)
 {
     m_navFilter = filter;
+    clearOriginCache();
+}
+
+void SEBRequestInterceptor::setContentBlocker(std::shared_ptr<const ContentBlocker> blocker)
+{
+    m_contentBlocker = std::move(blocker);
+}
+
+void SEBRequestInterceptor::setSEBHeaderHosts(const QStringList& hosts)
+{
+    m_sebHeaderHosts = HostSet(hosts);
+}
+
+void SEBRequestInterceptor::setSEBHeadersToAllHosts(bool all)
+{
+    m_sebHeadersToAllHosts = all;
+}
+
+void SEBRequestInterceptor::setThirdPartyBlockedTypes(const QList<ResourceType>& types)
+{
+    m_thirdPartyBlockedMask = 0;
+    for (ResourceType type : types) {
+        if (type < 64) {
+            m_thirdPartyBlockedMask |= quint64(1) << type;
+        }
+    }
+}
+
+void SEBRequestInterceptor::clearOriginCache()
+{
+    QWriteLocker locker(&m_originLock);
+    m_allowedFrameOrigins.clear();
 }
 
 void SEBRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo& info)
 {
-    QUrl url = info.requestUrl();
-    QString scheme = url.scheme().toLower();
+    QElapsedTimer timer;
+    timer.start();
 
-    // Block dangerous URL schemes
-    if (isBlockedScheme(scheme)) {
+    const ResourceType type = info.resourceType();
+    const Verdict verdict = evaluate(info.requestUrl(), info.firstPartyUrl(), type);
+    if (verdict.block) {
         info.block(true);
-        return;
+    } else {
+        // Browser Exam Key and Config Key request hashes — URL-specific, hex-encoded
+        if (!verdict.sebHeaders.requestHash.isEmpty()) {
+            info.setHttpHeader(SEBProtocol::requestHashHeader(), verdict.sebHeaders.requestHash);
+        }
+        if (!verdict.sebHeaders.configKeyHash.isEmpty()) {
+            info.setHttpHeader(SEBProtocol::configKeyHeader(), verdict.sebHeaders.configKeyHash);
+        }
     }
 
-    // Only allow http/https
-    if (scheme != "http" && scheme != "https") {
-        info.block(true);
-        return;
+    const Outcome outcome = verdict.block ? Outcome::Blocked
+                          : verdict.sso   ? Outcome::AllowedSSO
+                                          : Outcome::Allowed;
+    m_latency.record(latencySeries(type, outcome), quint64(timer.nsecsElapsed()));
+}
+
+SEBRequestInterceptor::Verdict SEBRequestInterceptor::evaluate(const QUrl& url,
+                                                              const QUrl& firstPartyUrl,
+                                                              ResourceType type)
+{
+    Verdict verdict;
+
+    // Only http and https load; file:, data:, javascript:, blob: and every
+    // other scheme are blocked
+    if (!isHttpScheme(url.scheme())) {
+        verdict.block = true;
+        return verdict;
     }
 
-    // Check navigation filter for sub-resource requests
-    if (m_navFilter) {
-        auto result = m_navFilter->checkUrl(url);
-        if (result == FilterResult::Blocked) {
-            info.block(true);
-            return;
+    // One decoded serialization feeds the navigation filter and, as UTF-8
+    // in the scratch buffer, the header hashers. It is one allocation, as
+    // QUrl cannot print into a caller's buffer; the content blocker's
+    // percent-encoded form below is a second one, made only when a blocker
+    // is installed. Hosts are taken once and shared, which costs a
+    // reference count rather than a copy.
+    RequestScratch& scratch = threadScratch();
+    const QString urlString = url.toString(QUrl::RemoveFragment);
+    SEBKeyMaterial::requestUrlBytes(urlString, scratch.urlBytes);
+
+    const QString host = url.host();
+    const QString firstPartyHost = firstPartyUrl.host();
+    const bool thirdParty = !firstPartyUrl.isEmpty() && siteOf(host) != siteOf(firstPartyHost);
+
+    // Ads, analytics and chat widgets are dropped before any filter work
+    if (m_contentBlocker) {
+        // EasyList rules are written against percent-encoded, punycode
+        // URLs, which is not the form SEB hashes
+        ContentBlocker::Request request;
+        request.url = url.toEncoded(QUrl::RemoveUserInfo | QUrl::RemoveFragment);
+        request.documentHost = firstPartyHost;
+        request.type = contentTypeOf(type);
+        request.thirdParty = thirdParty;
+        if (m_contentBlocker->shouldBlock(request)) {
+            verdict.block = true;
+            return verdict;
         }
     }
 
-    // Inject SEB headers if protocol is active
-    if (m_protocol) {
-        // Browser Exam Key request hash — URL-specific, hex-encoded
-        QByteArray requestHash = m_protocol->computeRequestHash(url);
-        if (!requestHash.isEmpty()) {
-            info.setHttpHeader(
-                SEBProtocol::requestHashHeaderName().toUtf8(),
-                requestHash
-            );
+    if (isFrameNavigation(type)) {
+        // Navigations and sub-frames always get the full filter evaluation
+        if (m_navFilter) {
+            const FilterResult result = m_navFilter->checkUrl(url, urlString);
+            if (result == FilterResult::Blocked) {
+                verdict.block = true;
+                return verdict;
+            }
+            verdict.sso = result == FilterResult::AllowedSSO;
+            rememberFrameOrigin(url, host);
+        }
+    } else {
+        // Configured third-party media, fonts, pings, ... never load
+        if (thirdParty && type < 64 && (m_thirdPartyBlockedMask & (quint64(1) << type))) {
+            verdict.block = true;
+            return verdict;
         }
 
-        // Config Key request hash — URL-specific, hex-encoded
-        QByteArray configKeyHash = m_protocol->computeConfigKeyHash(url);
-        if (!configKeyHash.isEmpty()) {
-            info.setHttpHeader(
-                SEBProtocol::configKeyHeaderName().toUtf8(),
-                configKeyHash
-            );
+        // Passive same-origin sub-resources of a frame the filter already
+        // allowed skip the pattern scan. XHR, workers and plugins can pull
+        // in arbitrary documents, so they are always evaluated in full.
+        bool cached = false;
+        if (!thirdParty && isPassiveSubResource(type) && host == firstPartyHost &&
+            isSameSchemeAndPort(url, firstPartyUrl)) {
+            cached = isAllowedFrameOrigin(url, host);
         }
+
+        if (m_navFilter && !cached) {
+            const FilterResult result = m_navFilter->checkUrl(url, urlString);
+            if (result == FilterResult::Blocked) {
+                verdict.block = true;
+                return verdict;
+            }
+            verdict.sso = result == FilterResult::AllowedSSO;
+        }
+    }
+
+    // SEB headers go to LMS hosts only: CDN, font and analytics requests
+    // neither need nor get the exam keys
+    if (!m_sebHeadersToAllHosts && !m_sebHeaderHosts.contains(host)) {
+        return verdict;
     }
+
+    auto keys = m_protocol ? m_protocol->keyMaterial() : nullptr;
+    if (keys) {
+        verdict.sebHeaders = m_headerCache.headersFor(*keys, scratch.urlBytes);
+    }
+    return verdict;
+}
+
+RequestHashCache::Stats SEBRequestInterceptor::headerCacheStats() const
+{
+    return m_headerCache.stats();
+}
+
+LatencyHistogram SEBRequestInterceptor::latencyHistogram(ResourceType type, Outcome outcome) const
+{
+    return m_latency.snapshot(latencySeries(type, outcome));
 }
 
-bool SEBRequestInterceptor::isBlockedScheme(const QString& scheme) const
+QStringList SEBRequestInterceptor::latencySummary() const
 {
-    static const QStringList blocked = {
-        "file", "about", "chrome", "chrome-devtools",
-        "data", "blob", "javascript", "ftp", "view-source"
+    static const char* outcomeNames[] = {"allowed", "sso", "blocked"};
+
+    QStringList lines;
+    for (int slot = 0; slot < kLatencyTypeSlots; slot++) {
+        for (int outcome = 0; outcome < 3; outcome++) {
+            const LatencyHistogram histogram = m_latency.snapshot(slot * 3 + outcome);
+            if (histogram.count() == 0) continue;
+
+            const QString typeName = slot == kLatencyTypeSlots - 1
+                ? QStringLiteral("unknown")
+                : resourceTypeName(static_cast<ResourceType>(slot));
+            lines << QString("%1 %2: n=%3 mean=%4 p50=%5 p99=%6 max=%7")
+                         .arg(typeName, QLatin1String(outcomeNames[outcome]))
+                         .arg(histogram.count())
+                         .arg(formatNs(quint64(histogram.meanNs())),
+                              formatNs(histogram.percentile(50)),
+                              formatNs(histogram.percentile(99)),
+                              formatNs(histogram.maxNs()));
+        }
+    }
+    return lines;
+}
+
+QString SEBRequestInterceptor::resourceTypeName(ResourceType type)
+{
+    const auto& byName = resourceTypesByName();
+    for (auto it = byName.constBegin(); it != byName.constEnd(); ++it) {
+        if (it.value() == type) return it.key();
+    }
+    return QString("type%1").arg(int(type));
+}
+
+int SEBRequestInterceptor::latencySeries(ResourceType type, Outcome outcome)
+{
+    // ResourceTypeUnknown (255) and future types share the last slot
+    const int slot = std::min(int(type), kLatencyTypeSlots - 1);
+    return slot * 3 + int(outcome);
+}
+
+QList<SEBRequestInterceptor::ResourceType> SEBRequestInterceptor::resourceTypesFromNames(
+    const QStringList& names)
+{
+    const auto& byName = resourceTypesByName();
+
+    QList<ResourceType> types;
+    for (const QString& name : names) {
+        auto it = byName.constFind(name.toLower());
+        if (it != byName.constEnd()) {
+            types.append(it.value());
+        } else {
+            qWarning() << "Unknown resource type in config:" << name;
+        }
+    }
+    return types;
+}
+
+bool SEBRequestInterceptor::isHttpScheme(QStringView scheme)
+{
+    // Length and first byte leave one candidate to compare; QUrl stores
+    // schemes lowercased, the case-insensitive compare is a safety net
+    if (scheme.isEmpty() || (scheme[0].unicode() | 0x20) != 'h') return false;
+    switch (scheme.size()) {
+    case 4:
+        return scheme.compare(u"http", Qt::CaseInsensitive) == 0;
+    case 5:
+        return scheme.compare(u"https", Qt::CaseInsensitive) == 0;
+    default:
+        return false;
+    }
+}
+
+ContentBlocker::ContentType SEBRequestInterceptor::contentTypeOf(ResourceType type)
+{
+    switch (type) {
+    case QWebEngineUrlRequestInfo::ResourceTypeMainFrame:
+        return ContentBlocker::Document;
+    case QWebEngineUrlRequestInfo::ResourceTypeSubFrame:
+        return ContentBlocker::Subdocument;
+    case QWebEngineUrlRequestInfo::ResourceTypeStylesheet:
+        return ContentBlocker::Stylesheet;
+    case QWebEngineUrlRequestInfo::ResourceTypeScript:
+        return ContentBlocker::Script;
+    case QWebEngineUrlRequestInfo::ResourceTypeImage:
+    case QWebEngineUrlRequestInfo::ResourceTypeFavicon:
+        return ContentBlocker::Image;
+    case QWebEngineUrlRequestInfo::ResourceTypeFontResource:
+        return ContentBlocker::Font;
+    case QWebEngineUrlRequestInfo::ResourceTypeObject:
+    case QWebEngineUrlRequestInfo::ResourceTypePluginResource:
+        return ContentBlocker::Object;
+    case QWebEngineUrlRequestInfo::ResourceTypeXhr:
+        return ContentBlocker::Xhr;
+    case QWebEngineUrlRequestInfo::ResourceTypePing:
+    case QWebEngineUrlRequestInfo::ResourceTypeCspReport:
+        return ContentBlocker::Ping;
+    case QWebEngineUrlRequestInfo::ResourceTypeMedia:
+        return ContentBlocker::Media;
+    default:
+        return ContentBlocker::Other;
+    }
+}
+
+bool SEBRequestInterceptor::isFrameNavigation(ResourceType type)
+{
+    switch (type) {
+    case QWebEngineUrlRequestInfo::ResourceTypeMainFrame:
+    case QWebEngineUrlRequestInfo::ResourceTypeSubFrame:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 4, 0)
+    case QWebEngineUrlRequestInfo::ResourceTypeNavigationPreloadMainFrame:
+    case QWebEngineUrlRequestInfo::ResourceTypeNavigationPreloadSubFrame:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SEBRequestInterceptor::isPassiveSubResource(ResourceType type)
+{
+    switch (type) {
+    case QWebEngineUrlRequestInfo::ResourceTypeStylesheet:
+    case QWebEngineUrlRequestInfo::ResourceTypeScript:
+    case QWebEngineUrlRequestInfo::ResourceTypeImage:
+    case QWebEngineUrlRequestInfo::ResourceTypeFontResource:
+    case QWebEngineUrlRequestInfo::ResourceTypeMedia:
+    case QWebEngineUrlRequestInfo::ResourceTypeFavicon:
+    case QWebEngineUrlRequestInfo::ResourceTypePrefetch:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SEBRequestInterceptor::isThirdParty(const QUrl& url, const QUrl& firstPartyUrl)
+{
+    if (firstPartyUrl.isEmpty()) return false;
+    const QString host = url.host();
+    const QString firstPartyHost = firstPartyUrl.host();
+    return siteOf(host) != siteOf(firstPartyHost);
+}
+
+QStringView SEBRequestInterceptor::siteOf(QStringView host)
+{
+    // Approximates the registrable domain without a public suffix list:
+    // the last two labels, or three under a country code whose registry
+    // hands out names below a generic second level ("ac.uk", "com.au").
+    // Other second levels under a country code are registrable themselves,
+    // so "moodle.tum.de" and "www.tum.de" are one site.
+    static constexpr QStringView kSecondLevels[] = {
+        u"ac", u"co", u"com", u"edu", u"go", u"gob", u"gov", u"govt", u"ltd",
+        u"mil", u"ne", u"net", u"nhs", u"or", u"org", u"plc", u"sch",
     };
-    return blocked.contains(scheme);
+
+    qsizetype last = host.lastIndexOf(u'.');
+    if (last <= 0) return host;
+    qsizetype second = host.lastIndexOf(u'.', last - 1);
+    if (second < 0) return host;
+
+    if (host.size() - last - 1 == 2) {
+        const QStringView label = host.sliced(second + 1, last - second - 1);
+        const bool registrySuffix = std::any_of(
+            std::begin(kSecondLevels), std::end(kSecondLevels),
+            [&](QStringView known) { return label == known; });
+        if (registrySuffix) {
+            qsizetype third = host.lastIndexOf(u'.', second - 1);
+            return third < 0 ? host : host.sliced(third + 1);
+        }
+    }
+    return host.sliced(second + 1);
+}
+
+bool SEBRequestInterceptor::isSameSchemeAndPort(const QUrl& url, const QUrl& other)
+{
+    // The rest of an origin; callers compare the hosts they already hold
+    return url.port() == other.port() && url.scheme() == other.scheme();
+}
+
+void SEBRequestInterceptor::writeOrigin(QString& out, const QUrl& url, QStringView host)
+{
+    // scheme://host[:port], what QUrl::adjusted() with everything but the
+    // authority removed would print, written into a reused buffer
+    out.resize(0);
+    out += url.scheme();
+    out += QLatin1String("://");
+    if (host.contains(u':')) {
+        out += u'[';
+        out += host;
+        out += u']';
+    } else {
+        out += host;
+    }
+
+    int port = url.port();
+    if (port >= 0) {
+        char16_t digits[5];
+        int count = 0;
+        do {
+            digits[4 - count++] = char16_t(u'0' + port % 10);
+            port /= 10;
+        } while (port > 0 && count < 5);
+        out += u':';
+        out += QStringView(digits + 5 - count, count);
+    }
+}
+
+bool SEBRequestInterceptor::isAllowedFrameOrigin(const QUrl& url, QStringView host) const
+{
+    QString& origin = threadScratch().origin;
+    writeOrigin(origin, url, host);
+
+    QReadLocker locker(&m_originLock);
+    return m_allowedFrameOrigins.contains(origin);
+}
+
+void SEBRequestInterceptor::rememberFrameOrigin(const QUrl& url, QStringView host)
+{
+    QString& origin = threadScratch().origin;
+    writeOrigin(origin, url, host);
+    {
+        QReadLocker locker(&m_originLock);
+        if (m_allowedFrameOrigins.contains(origin)) return;
+    }
+    // Deep copy, the scratch buffer is overwritten by the next request
+    QWriteLocker locker(&m_originLock);
+    m_allowedFrameOrigins.insert(QString(origin.constData(), origin.size()));
 }
 
 } // namespace openlock
@@ -5,7 +5,18 @@
 #pragma once
 
 #include <QWebEngineUrlRequestInterceptor>
+#include <QWebEngineUrlRequestInfo>
 #include <QByteArray>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+#include <QStringView>
+#include <memory>
+
+#include "browser/ContentBlocker.h"
+#include "browser/HostSet.h"
+#include "protocol/RequestHashCache.h"
+#include "core/LatencyHistogram.h"
 
 namespace openlock {
 
@@ -16,19 +27,90 @@ class SEBRequestInterceptor : public QWebEngineUrlRequestInterceptor {
     Q_OBJECT
 
 public:
+    using ResourceType = QWebEngineUrlRequestInfo::ResourceType;
+
     explicit SEBRequestInterceptor(QObject* parent = nullptr);
     ~SEBRequestInterceptor() override;
 
     void setSEBProtocol(SEBProtocol* protocol);
     void setNavigationFilter(NavigationFilter* filter);
 
+    // Adblock-syntax network rules, evaluated before the navigation filter
+    void setContentBlocker(std::shared_ptr<const ContentBlocker> blocker);
+
+    // Hosts whose requests carry the SEB key headers; the keys are never
+    // hashed for, or sent to, anything else. Empty sends them nowhere.
+    void setSEBHeaderHosts(const QStringList& hosts);
+
+    // Sends the SEB key headers with every request, whatever the hosts
+    void setSEBHeadersToAllHosts(bool all);
+
+    // Sub-resource types blocked outright when loaded from a third-party site
+    void setThirdPartyBlockedTypes(const QList<ResourceType>& types);
+
+    // Forget frame origins allowed so far (call when filter rules change)
+    void clearOriginCache();
+
     void interceptRequest(QWebEngineUrlRequestInfo& info) override;
 
+    // What interceptRequest() does with a request, without needing a
+    // QWebEngineUrlRequestInfo (benchmarks drive this directly)
+    struct Verdict {
+        bool block = false;
+        bool sso = false;                       // allowed as an SSO redirect
+        RequestHashCache::Headers sebHeaders;   // empty when no headers are sent
+    };
+    Verdict evaluate(const QUrl& url, const QUrl& firstPartyUrl, ResourceType type);
+
+    // Hit rate and hashing time saved by the per-URL SEB header cache
+    RequestHashCache::Stats headerCacheStats() const;
+
+    // interceptRequest() time per resource type and outcome, merged
+    // across the threads that intercepted
+    enum class Outcome { Allowed, AllowedSSO, Blocked };
+    LatencyHistogram latencyHistogram(ResourceType type, Outcome outcome) const;
+
+    // One line per resource type and outcome that saw requests
+    QStringList latencySummary() const;
+
+    // Config name of a resource type ("script", "xhr", ...)
+    static QString resourceTypeName(ResourceType type);
+
+    // Maps config names ("image", "font", "media", "ping", ...) to resource types
+    static QList<ResourceType> resourceTypesFromNames(const QStringList& names);
+
+    // Registrable part of host ("moodle.school.ac.uk" -> "school.ac.uk"),
+    // a view into host; requests to another site are third-party
+    static QStringView siteOf(QStringView host);
+    static bool isThirdParty(const QUrl& url, const QUrl& firstPartyUrl);
+
 private:
-    bool isBlockedScheme(const QString& scheme) const;
+    static bool isHttpScheme(QStringView scheme);
+    static ContentBlocker::ContentType contentTypeOf(ResourceType type);
+    static bool isFrameNavigation(ResourceType type);
+    static bool isPassiveSubResource(ResourceType type);
+    static bool isSameSchemeAndPort(const QUrl& url, const QUrl& other);
+    static void writeOrigin(QString& out, const QUrl& url, QStringView host);
+
+    static constexpr int kLatencyTypeSlots = 32;    // last slot collects larger values
+    static int latencySeries(ResourceType type, Outcome outcome);
+
+    bool isAllowedFrameOrigin(const QUrl& url, QStringView host) const;
+    void rememberFrameOrigin(const QUrl& url, QStringView host);
 
     SEBProtocol* m_protocol = nullptr;
     NavigationFilter* m_navFilter = nullptr;
+    std::shared_ptr<const ContentBlocker> m_contentBlocker;
+
+    quint64 m_thirdPartyBlockedMask = 0;    // bit per ResourceType value
+
+    mutable QReadWriteLock m_originLock;
+    QSet<QString> m_allowedFrameOrigins;    // origins of frames the filter allowed
+
+    HostSet m_sebHeaderHosts;
+    bool m_sebHeadersToAllHosts = false;
+    RequestHashCache m_headerCache;         // URL -> SEB header values
+    LatencyRecorder m_latency{kLatencyTypeSlots * 3};
 };
 
 } // namespace openlock
@@ -0,0 +1,434 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include "protocol/SEBSettings.h"
+#include "protocol/PlistReader.h"
+
+#include <QTimeZone>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace openlock {
+
+struct SEBSettings::Node {
+    struct Entry {
+        const char16_t* key;        // nullptr for array elements
+        qsizetype keyLength;
+        const Node* value;
+    };
+
+    Type type = Type::Invalid;
+    qsizetype size = 0;             // entries, elements, UTF-16 units
+    union {
+        bool boolean;
+        qint64 integer;             // Integer; Date in ms since epoch
+        double real;
+        const char16_t* text;
+        const Entry* entries;
+        const QByteArray* data;
+    };
+
+    Node() : integer(0) {}
+};
+
+// Bump allocator: nodes and strings are small and all die together
+struct SEBSettings::Storage {
+    static constexpr size_t kBlockSize = 16 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    size_t remaining = 0;
+    size_t allocated = 0;
+    std::vector<std::unique_ptr<QByteArray>> payloads;
+
+    void* allocate(size_t size, size_t align)
+    {
+        size_t padding = (align - reinterpret_cast<quintptr>(cursor) % align) % align;
+        if (!cursor || padding + size > remaining) {
+            const size_t blockSize = std::max(kBlockSize, size + align);
+            blocks.push_back(std::make_unique<char[]>(blockSize));
+            cursor = blocks.back().get();
+            remaining = blockSize;
+            allocated += blockSize;
+            padding = (align - reinterpret_cast<quintptr>(cursor) % align) % align;
+        }
+        void* result = cursor + padding;
+        cursor += padding + size;
+        remaining -= padding + size;
+        return result;
+    }
+
+    template <typename T>
+    T* allocateArray(qsizetype count)
+    {
+        return static_cast<T*>(allocate(sizeof(T) * size_t(std::max<qsizetype>(count, 1)), alignof(T)));
+    }
+
+    Node* newNode(Type type)
+    {
+        Node* node = new (allocate(sizeof(Node), alignof(Node))) Node;
+        node->type = type;
+        return node;
+    }
+
+    const char16_t* copyText(QStringView text)
+    {
+        char16_t* copy = allocateArray<char16_t>(text.size());
+        if (!text.isEmpty()) std::memcpy(copy, text.utf16(), size_t(text.size()) * sizeof(char16_t));
+        return copy;
+    }
+
+    // Widened straight into the arena
+    const char16_t* copyText(QLatin1String text)
+    {
+        char16_t* copy = allocateArray<char16_t>(text.size());
+        for (qsizetype i = 0; i < text.size(); i++) copy[i] = char16_t(uchar(text.data()[i]));
+        return copy;
+    }
+};
+
+// Builds the tree from plist events. Entries of every open container
+// collect on one shared stack and move into the arena when it closes, so
+// the parse allocates nothing per container beyond the arena.
+class SEBSettings::Builder : public PlistSink {
+public:
+    explicit Builder(Storage& storage) : m_storage(storage) {}
+
+    const Node* root() const { return m_root; }
+
+    void beginDict() override { open(); }
+    void beginArray() override { open(); }
+    void endDict() override { close(Type::Dict); }
+    void endArray() override { close(Type::Array); }
+
+    void key(QStringView key) override
+    {
+        m_key = m_storage.copyText(key);
+        m_keyLength = key.size();
+    }
+
+    void latin1Key(QLatin1String key) override
+    {
+        m_key = m_storage.copyText(key);
+        m_keyLength = key.size();
+    }
+
+    void string(QStringView value) override { addString(value); }
+    void latin1String(QLatin1String value) override { addString(value); }
+
+    void data(const QByteArray& value) override
+    {
+        m_storage.payloads.push_back(std::make_unique<QByteArray>(value));
+        Node* node = m_storage.newNode(Type::Data);
+        node->data = m_storage.payloads.back().get();
+        node->size = value.size();
+        add(node);
+    }
+
+    void date(qint64 msecsSinceEpoch) override
+    {
+        Node* node = m_storage.newNode(Type::Date);
+        node->integer = msecsSinceEpoch;
+        add(node);
+    }
+
+    void integer(qint64 value) override
+    {
+        Node* node = m_storage.newNode(Type::Integer);
+        node->integer = value;
+        add(node);
+    }
+
+    void real(double value) override
+    {
+        Node* node = m_storage.newNode(Type::Real);
+        node->real = value;
+        add(node);
+    }
+
+    void boolean(bool value) override
+    {
+        Node* node = m_storage.newNode(Type::Bool);
+        node->boolean = value;
+        add(node);
+    }
+
+private:
+    template <typename Text>
+    void addString(Text value)
+    {
+        Node* node = m_storage.newNode(Type::String);
+        node->text = m_storage.copyText(value);
+        node->size = value.size();
+        add(node);
+    }
+
+    struct Frame {
+        size_t firstEntry;
+        const char16_t* key;        // the parent's key for this container
+        qsizetype keyLength;
+    };
+
+    void open()
+    {
+        m_frames.push_back({m_entries.size(), m_key, m_keyLength});
+        m_key = nullptr;
+        m_keyLength = 0;
+    }
+
+    void close(Type type)
+    {
+        if (m_frames.empty()) return;
+        const Frame frame = m_frames.back();
+        m_frames.pop_back();
+
+        const qsizetype count = qsizetype(m_entries.size() - frame.firstEntry);
+        Node::Entry* entries = m_storage.allocateArray<Node::Entry>(count);
+        std::copy(m_entries.begin() + qsizetype(frame.firstEntry), m_entries.end(), entries);
+        m_entries.resize(frame.firstEntry);
+
+        Node* node = m_storage.newNode(type);
+        node->entries = entries;
+        node->size = count;
+
+        m_key = frame.key;
+        m_keyLength = frame.keyLength;
+        add(node);
+    }
+
+    void add(const Node* node)
+    {
+        if (m_frames.empty()) {
+            if (!m_root) m_root = node;
+            return;
+        }
+        m_entries.push_back({m_key, m_keyLength, node});
+        m_key = nullptr;
+        m_keyLength = 0;
+    }
+
+    Storage& m_storage;
+    std::vector<Frame> m_frames;
+    std::vector<Node::Entry> m_entries;
+    const char16_t* m_key = nullptr;
+    qsizetype m_keyLength = 0;
+    const Node* m_root = nullptr;
+};
+
+SEBSettings::SEBSettings()
+    : m_storage(std::make_unique<Storage>())
+{
+}
+
+SEBSettings::~SEBSettings() = default;
+
+std::shared_ptr<const SEBSettings> SEBSettings::fromXml(const QByteArray& xml, QString* error)
+{
+    Parser parser;
+    parser.addData(xml);
+    return parser.finish(error);
+}
+
+std::shared_ptr<const SEBSettings> SEBSettings::fromBinary(QByteArrayView plist,
+                                                           QString* error)
+{
+    std::shared_ptr<SEBSettings> settings(new SEBSettings);
+    Builder builder(*settings->m_storage);
+    QString parseError;
+    if (!PlistBinaryReader::parse(plist, builder, &parseError)) {
+        if (error) *error = parseError;
+        return nullptr;
+    }
+    if (!builder.root() || builder.root()->type != Type::Dict) {
+        if (error) *error = QStringLiteral("Property list has no settings dictionary");
+        return nullptr;
+    }
+    settings->m_root = builder.root();
+    return settings;
+}
+
+SEBSettings::Parser::Parser()
+    : m_settings(new SEBSettings)
+    , m_builder(std::make_unique<Builder>(*m_settings->m_storage))
+    , m_reader(std::make_unique<PlistXmlReader>(*m_builder))
+{
+}
+
+SEBSettings::Parser::~Parser() = default;
+
+bool SEBSettings::Parser::addData(QByteArrayView chunk)
+{
+    switch (m_format) {
+    case Format::Xml:
+        return m_reader->addData(chunk);
+    case Format::Binary:
+        m_binary.append(chunk.data(), chunk.size());
+        return true;
+    case Format::Unknown:
+        break;
+    }
+
+    // The first bytes tell the formats apart
+    m_binary.append(chunk.data(), chunk.size());
+    if (m_binary.size() < PlistBinaryReader::kMagicSize) return true;
+    if (PlistBinaryReader::isBinary(m_binary)) {
+        m_format = Format::Binary;
+        return true;
+    }
+    m_format = Format::Xml;
+    const QByteArray head = std::exchange(m_binary, QByteArray());
+    return m_reader->addData(head);
+}
+
+std::shared_ptr<const SEBSettings> SEBSettings::Parser::finish(QString* error)
+{
+    if (m_format == Format::Unknown) {
+        m_format = Format::Xml;
+        m_reader->addData(std::exchange(m_binary, QByteArray()));
+    }
+
+    if (m_format == Format::Binary) {
+        // The offset table is at the end: binary plists parse in one go
+        if (!PlistBinaryReader::parse(m_binary, *m_builder, &m_binaryError)) {
+            if (error) *error = m_binaryError;
+            return nullptr;
+        }
+    } else if (!m_reader->finish()) {
+        if (error) *error = m_reader->errorString();
+        return nullptr;
+    }
+
+    if (!m_builder->root() || m_builder->root()->type != Type::Dict) {
+        if (error) *error = QStringLiteral("Property list has no settings dictionary");
+        return nullptr;
+    }
+    m_settings->m_root = m_builder->root();
+    return std::move(m_settings);
+}
+
+QString SEBSettings::Parser::errorString() const
+{
+    return m_format == Format::Binary ? m_binaryError : m_reader->errorString();
+}
+
+qsizetype SEBSettings::memoryUsage() const
+{
+    qsizetype total = qsizetype(m_storage->allocated);
+    for (const auto& payload : m_storage->payloads) total += payload->size();
+    return total;
+}
+
+SEBSettings::Type SEBSettings::Value::type() const
+{
+    return m_node ? m_node->type : Type::Invalid;
+}
+
+bool SEBSettings::Value::toBool(bool defaultValue) const
+{
+    return type() == Type::Bool ? m_node->boolean : defaultValue;
+}
+
+qint64 SEBSettings::Value::toInteger(qint64 defaultValue) const
+{
+    return type() == Type::Integer ? m_node->integer : defaultValue;
+}
+
+double SEBSettings::Value::toReal(double defaultValue) const
+{
+    if (type() == Type::Real) return m_node->real;
+    if (type() == Type::Integer) return double(m_node->integer);
+    return defaultValue;
+}
+
+QStringView SEBSettings::Value::stringView() const
+{
+    if (type() != Type::String) return {};
+    return QStringView(m_node->text, m_node->size);
+}
+
+QString SEBSettings::Value::toString(const QString& defaultValue) const
+{
+    return type() == Type::String ? stringView().toString() : defaultValue;
+}
+
+QByteArray SEBSettings::Value::toData() const
+{
+    return type() == Type::Data ? *m_node->data : QByteArray();
+}
+
+QDateTime SEBSettings::Value::toDateTime() const
+{
+    if (type() != Type::Date) return {};
+    return QDateTime::fromMSecsSinceEpoch(m_node->integer, QTimeZone::utc());
+}
+
+qsizetype SEBSettings::Value::size() const
+{
+    return isDict() || isArray() ? m_node->size : 0;
+}
+
+SEBSettings::Value SEBSettings::Value::at(qsizetype index) const
+{
+    if (index < 0 || index >= size()) return {};
+    return Value(m_node->entries[index].value);
+}
+
+QStringView SEBSettings::Value::keyAt(qsizetype index) const
+{
+    if (!isDict() || index < 0 || index >= m_node->size) return {};
+    const Node::Entry& entry = m_node->entries[index];
+    return QStringView(entry.key, entry.keyLength);
+}
+
+SEBSettings::Value SEBSettings::Value::value(QStringView key) const
+{
+    if (!isDict()) return {};
+    // Last one wins for duplicate keys, as in toVariant()
+    for (qsizetype i = m_node->size - 1; i >= 0; i--) {
+        const Node::Entry& entry = m_node->entries[i];
+        if (QStringView(entry.key, entry.keyLength) == key) return Value(entry.value);
+    }
+    return {};
+}
+
+QVariant SEBSettings::Value::toVariant() const
+{
+    switch (type()) {
+    case Type::Dict: {
+        QVariantMap map;
+        for (qsizetype i = 0; i < m_node->size; i++) {
+            map.insert(keyAt(i).toString(), at(i).toVariant());
+        }
+        return map;
+    }
+    case Type::Array: {
+        QVariantList list;
+        list.reserve(m_node->size);
+        for (qsizetype i = 0; i < m_node->size; i++) list << at(i).toVariant();
+        return list;
+    }
+    case Type::String:
+        return toString();
+    case Type::Data:
+        return toData();
+    case Type::Date:
+        return toDateTime();
+    case Type::Integer:
+        return m_node->integer;
+    case Type::Real:
+        return m_node->real;
+    case Type::Bool:
+        return m_node->boolean;
+    case Type::Invalid:
+        break;
+    }
+    return {};
+}
+
+} // namespace openlock
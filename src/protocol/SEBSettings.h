@@ -0,0 +1,122 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QDateTime>
+#include <QString>
+#include <QStringView>
+#include <QVariant>
+
+#include <memory>
+
+namespace openlock {
+
+class PlistXmlReader;
+
+// Typed tree of a SEB settings plist, parsed once and shared read-only by
+// Config (ExamConfig fields) and ConfigKeyGenerator (SEB-JSON). Nodes,
+// keys and strings live in one arena owned by the tree; <data> payloads
+// are kept in the buffers they were decoded into. Values are cheap
+// handles that stay valid as long as the SEBSettings does.
+class SEBSettings {
+    struct Node;
+
+public:
+    enum class Type : quint8 { Invalid, Dict, Array, String, Data, Date, Integer, Real, Bool };
+
+    class Value {
+    public:
+        Value() = default;
+
+        Type type() const;
+        bool isValid() const { return m_node != nullptr; }
+        bool isDict() const { return type() == Type::Dict; }
+        bool isArray() const { return type() == Type::Array; }
+
+        // Scalars; the default when the value has another type
+        bool toBool(bool defaultValue = false) const;
+        qint64 toInteger(qint64 defaultValue = 0) const;
+        double toReal(double defaultValue = 0) const;       // Real or Integer
+        QStringView stringView() const;
+        QString toString(const QString& defaultValue = {}) const;
+        QByteArray toData() const;                          // shares the decoded buffer
+        QDateTime toDateTime() const;                       // UTC
+
+        // Containers: dict entries in document order, array elements
+        qsizetype size() const;
+        Value at(qsizetype index) const;
+        QStringView keyAt(qsizetype index) const;
+        Value value(QStringView key) const;                 // Invalid if absent
+        Value operator[](QStringView key) const { return value(key); }
+
+        // Deep copy for code still working on QVariantMap
+        QVariant toVariant() const;
+
+    private:
+        friend class SEBSettings;
+        explicit Value(const Node* node) : m_node(node) {}
+
+        const Node* m_node = nullptr;
+    };
+
+    ~SEBSettings();
+
+    SEBSettings(const SEBSettings&) = delete;
+    SEBSettings& operator=(const SEBSettings&) = delete;
+
+    // Parses an XML plist; nullptr (and error) if it is malformed or its
+    // top-level value is not a dict
+    static std::shared_ptr<const SEBSettings> fromXml(const QByteArray& xml,
+                                                      QString* error = nullptr);
+
+    // Same for a binary (bplist00) plist, read in place; plist need not
+    // outlive the tree
+    static std::shared_ptr<const SEBSettings> fromBinary(QByteArrayView plist,
+                                                         QString* error = nullptr);
+
+    class Builder;
+
+    // Incremental parse of an XML or binary plist, for one that arrives in
+    // pieces. XML is parsed as it arrives; a binary plist is kept until
+    // finish(), since its offset table comes last.
+    class Parser {
+    public:
+        Parser();
+        ~Parser();
+
+        bool addData(QByteArrayView chunk);
+
+        // The tree, or nullptr (and error) as for fromXml()
+        std::shared_ptr<const SEBSettings> finish(QString* error = nullptr);
+
+        QString errorString() const;
+
+    private:
+        enum class Format { Unknown, Xml, Binary };
+
+        std::shared_ptr<SEBSettings> m_settings;
+        std::unique_ptr<Builder> m_builder;
+        std::unique_ptr<PlistXmlReader> m_reader;
+        Format m_format = Format::Unknown;
+        QByteArray m_binary;            // binary plist so far, or the first bytes
+        QString m_binaryError;
+    };
+
+    Value root() const { return Value(m_root); }
+
+    // Memory held by the tree, payloads included
+    qsizetype memoryUsage() const;
+
+private:
+    SEBSettings();
+
+    struct Storage;
+    std::unique_ptr<Storage> m_storage;
+    const Node* m_root = nullptr;
+};
+
+} // namespace openlock
@@ -0,0 +1,123 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Packs the exam configs of a lab's schedule into one .olbundle, decoded
+// and with their domain blocklists compiled, for openlock --config.
+//
+//   openlock-bundle -o FILE MANIFEST
+//
+// The manifest lists the exams; config and blocklist paths are relative
+// to it. Exams without a window are only opened with --exam ID.
+//
+//   {"exams": [{"id": "cs101-midterm", "config": "cs101.seb",
+//               "start": "2026-03-02T09:00:00Z", "end": "2026-03-02T10:30:00Z"}]}
+
+#include "browser/DomainBlocklist.h"
+#include "core/Config.h"
+#include "core/ConfigBundle.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+
+using namespace openlock;
+
+namespace {
+
+bool bundleExam(const QJsonObject& spec, const QDir& base, ConfigBundle::Exam* exam)
+{
+    exam->id = spec.value("id").toString();
+    if (spec.contains("start") || spec.contains("end")) {
+        exam->windowStart = QDateTime::fromString(spec.value("start").toString(), Qt::ISODate);
+        exam->windowEnd = QDateTime::fromString(spec.value("end").toString(), Qt::ISODate);
+        if (!exam->windowStart.isValid() || !exam->windowEnd.isValid()) {
+            std::fprintf(stderr, "%s: start and end must be ISO 8601 times\n",
+                         qPrintable(exam->id));
+            return false;
+        }
+    }
+
+    const QString path = base.absoluteFilePath(spec.value("config").toString());
+    Config config;
+    QObject::connect(&config, &Config::configError, [&](const QString& message) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(path), qPrintable(message));
+    });
+    if (!config.loadFromFile(path)) return false;
+
+    // Stored decoded; the lab machine parses it and derives the keys
+    exam->entry.format = config.format();
+    exam->entry.rawData = config.rawConfigData();
+
+    const QString& blocklistPath = config.examConfig().domainBlocklistPath;
+    if (!blocklistPath.isEmpty()) {
+        DomainBlocklist blocklist;
+        if (!blocklist.loadFromFile(base.absoluteFilePath(blocklistPath))) return false;
+        exam->domainBlocklist = blocklist.compiledImage();
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("openlock-bundle");
+    app.setApplicationVersion("0.1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Pack exam configs and their compiled domain blocklists into one .olbundle");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Bundle to write (.olbundle)", "file");
+    parser.addOption(outputOption);
+    parser.addPositionalArgument("manifest", "JSON list of exams, ids and time windows",
+                                 "manifest");
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1 || !parser.isSet(outputOption)) {
+        parser.showHelp(1);
+    }
+
+    const QString manifestPath = parser.positionalArguments().first();
+    QFile manifestFile(manifestPath);
+    if (!manifestFile.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Cannot read %s\n", qPrintable(manifestPath));
+        return 1;
+    }
+    QJsonParseError error;
+    const QJsonDocument manifest = QJsonDocument::fromJson(manifestFile.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(manifestPath),
+                     qPrintable(error.errorString()));
+        return 1;
+    }
+
+    const QDir base = QFileInfo(manifestPath).absoluteDir();
+    QList<ConfigBundle::Exam> exams;
+    for (const QJsonValue& spec : manifest.object().value("exams").toArray()) {
+        ConfigBundle::Exam exam;
+        if (!bundleExam(spec.toObject(), base, &exam)) return 2;
+        exams << exam;
+    }
+
+    const QString output = parser.value(outputOption);
+    if (!ConfigBundle::write(output, exams)) {
+        std::fprintf(stderr, "Cannot write %s\n", qPrintable(output));
+        return 1;
+    }
+    std::fprintf(stderr, "%d exams written to %s\n", int(exams.size()), qPrintable(output));
+    return 0;
+}
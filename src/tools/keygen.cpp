@@ -0,0 +1,138 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Prints the Browser Exam Key and Config Key of every .seb file in a
+// directory, for entering into the LMS quiz settings.
+//
+//   openlock-keygen [-p PASSWORD]... [--format csv|json] [-o FILE] DIR...
+
+#include "protocol/BrowserExamKey.h"
+#include "protocol/SEBKeyBatch.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace openlock;
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("openlock-keygen");
+    app.setApplicationVersion("0.1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Compute SEB Browser Exam Keys and Config Keys for a directory of .seb files");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption passwordOption(QStringList() << "p" << "password",
+                                      "Password for encrypted configs (repeatable)", "password");
+    QCommandLineOption passwordFileOption("password-file",
+                                          "File with one candidate password per line", "file");
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+                                    "Output format: csv or json", "format", "csv");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Write to file instead of stdout", "file");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Worker threads (default: one per core)", "n");
+    QCommandLineOption recursiveOption(QStringList() << "r" << "recursive",
+                                       "Include .seb files in subdirectories");
+    QCommandLineOption appOption("app", "OpenLock executable whose files the Browser Exam Key "
+                                        "covers (default: openlock next to this tool)", "path",
+                                 QCoreApplication::applicationDirPath() + "/openlock");
+    parser.addOption(passwordOption);
+    parser.addOption(passwordFileOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(recursiveOption);
+    parser.addOption(appOption);
+    parser.addPositionalArgument("paths", "Directories or .seb files", "paths...");
+    parser.process(app);
+
+    const QString format = parser.value(formatOption).toLower();
+    if (format != "csv" && format != "json") {
+        std::fprintf(stderr, "Unknown format: %s\n", qPrintable(format));
+        return 1;
+    }
+    if (parser.positionalArguments().isEmpty()) parser.showHelp(1);
+
+    QStringList passwords = parser.values(passwordOption);
+    if (parser.isSet(passwordFileOption)) {
+        QFile file(parser.value(passwordFileOption));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::fprintf(stderr, "Cannot read %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        while (!file.atEnd()) {
+            const QString line = QString::fromUtf8(file.readLine()).trimmed();
+            if (!line.isEmpty()) passwords << line;
+        }
+    }
+
+    const QString appPath = parser.value(appOption);
+    if (!QFileInfo(appPath).isFile()) {
+        std::fprintf(stderr, "OpenLock executable not found: %s (use --app)\n",
+                     qPrintable(appPath));
+        return 1;
+    }
+
+    QThreadPool pool;
+    if (parser.isSet(jobsOption)) {
+        pool.setMaxThreadCount(std::max(1, parser.value(jobsOption).toInt()));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    SEBKeyBatch batch(BrowserExamKey::computeBinaryFilesHash(appPath), passwords);
+    batch.setThreadPool(&pool);
+
+    QList<SEBKeyBatch::Entry> entries;
+    const bool recursive = parser.isSet(recursiveOption);
+    for (const QString& path : parser.positionalArguments()) {
+        const QFileInfo info(path);
+        if (info.isDir()) {
+            entries += batch.run(SEBKeyBatch::sebFiles(path, recursive), QDir(path));
+        } else {
+            entries += batch.run({path}, info.absoluteDir());
+        }
+    }
+
+    const QByteArray output =
+        format == "json" ? SEBKeyBatch::toJson(entries) : SEBKeyBatch::toCsv(entries);
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            file.write(output) != output.size()) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+    } else {
+        std::fwrite(output.constData(), 1, size_t(output.size()), stdout);
+    }
+
+    int failed = 0;
+    for (const auto& entry : entries) {
+        if (entry.error.isEmpty()) continue;
+        failed++;
+        std::fprintf(stderr, "%s: %s\n", qPrintable(entry.file), qPrintable(entry.error));
+    }
+    std::fprintf(stderr,
+                 "%d configs, %d failed, %d threads, %.1f s; PBKDF2 keys derived %llu, reused %llu\n",
+                 int(entries.size()), failed, pool.maxThreadCount(), timer.elapsed() / 1000.0,
+                 static_cast<unsigned long long>(batch.keyCache().misses()),
+                 static_cast<unsigned long long>(batch.keyCache().hits()));
+
+    return failed == 0 ? 0 : 2;
+}
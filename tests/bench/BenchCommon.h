@@ -0,0 +1,121 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Shared helpers for the headless benchmarks in tests/bench.
+
+#pragma once
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QUrl>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace openlock::bench {
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceEntry {
+    QString resourceType;   // main_frame, sub_frame, script, image, xhr, ...
+    QUrl url;
+};
+
+struct LatencyStats {
+    size_t samples = 0;
+    double p50Ns = 0;
+    double p99Ns = 0;
+    double maxNs = 0;
+    double throughputPerSec = 0;
+};
+
+inline QString dataDir()
+{
+    return QStringLiteral(OPENLOCK_TEST_DATA_DIR);
+}
+
+// Trace format: one "<resource-type> <url>" per line, '#' starts a comment
+inline std::vector<TraceEntry> loadTrace(const QString& path)
+{
+    std::vector<TraceEntry> entries;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::fprintf(stderr, "Cannot open trace: %s\n", qPrintable(path));
+        return entries;
+    }
+
+    QTextStream stream(&file);
+    QString line;
+    while (stream.readLineInto(&line)) {
+        line = line.trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        int space = line.indexOf(' ');
+        if (space <= 0) continue;
+
+        entries.push_back({line.left(space), QUrl(line.mid(space + 1))});
+    }
+
+    return entries;
+}
+
+inline QStringList traceFiles(const QString& dir)
+{
+    QStringList files;
+    const auto infos = QDir(dir).entryInfoList({"*.trace"}, QDir::Files, QDir::Name);
+    for (const auto& info : infos) {
+        files << info.absoluteFilePath();
+    }
+    return files;
+}
+
+inline qint64 elapsedNs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// Sorts the samples in place
+inline LatencyStats summarize(std::vector<qint64>& samplesNs)
+{
+    LatencyStats stats;
+    stats.samples = samplesNs.size();
+    if (samplesNs.empty()) return stats;
+
+    std::sort(samplesNs.begin(), samplesNs.end());
+
+    auto percentile = [&](double p) {
+        size_t idx = static_cast<size_t>(p * (samplesNs.size() - 1) + 0.5);
+        return static_cast<double>(samplesNs[idx]);
+    };
+
+    double totalNs = 0;
+    for (qint64 ns : samplesNs) totalNs += ns;
+
+    stats.p50Ns = percentile(0.50);
+    stats.p99Ns = percentile(0.99);
+    stats.maxNs = static_cast<double>(samplesNs.back());
+    stats.throughputPerSec = totalNs > 0 ? samplesNs.size() * 1e9 / totalNs : 0;
+    return stats;
+}
+
+inline void printHeader(const char* firstColumn)
+{
+    std::printf("%-22s %8s %9s %11s %11s %11s %14s\n",
+                firstColumn, "rules", "samples", "p50 (ns)", "p99 (ns)", "max (ns)", "ops/s");
+}
+
+inline void printRow(const QString& name, int rules, const LatencyStats& stats)
+{
+    std::printf("%-22s %8d %9zu %11.0f %11.0f %11.0f %14.0f\n",
+                qPrintable(name), rules, stats.samples,
+                stats.p50Ns, stats.p99Ns, stats.maxNs, stats.throughputPerSec);
+}
+
+} // namespace openlock::bench
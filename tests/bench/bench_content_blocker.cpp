@@ -0,0 +1,183 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Replays LMS request traces through ContentBlocker::shouldBlock with an
+// EasyList-sized rule set: a synthetic one by default, or real lists
+// passed with --rules.
+//
+//   bench_content_blocker [--trace-dir DIR] [--rules FILE]... [--quick] [--max-p99-ns N]
+
+#include "BenchCommon.h"
+#include "browser/ContentBlocker.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QRandomGenerator>
+
+using namespace openlock;
+using namespace openlock::bench;
+
+namespace {
+
+// Roughly EasyList's mix: mostly "||host^" rules, then path and query
+// fragments, a few exceptions, domain-scoped rules and regexes
+QByteArray syntheticRules(int count)
+{
+    QRandomGenerator rng(29);
+    auto word = [&rng]() {
+        QByteArray w;
+        const int length = 3 + rng.bounded(8);
+        for (int i = 0; i < length; i++) w += char('a' + rng.bounded(26));
+        return w;
+    };
+    const char* tlds[] = {"com", "net", "org", "io", "de", "co.uk", "info"};
+
+    QByteArray text = "[Adblock Plus 2.0]\n! Synthetic rule set\n"
+                      "||google-analytics.com^\n"
+                      "||googletagmanager.com^$third-party\n"
+                      "/analytics.js$script\n"
+                      "||intercom.io^$third-party\n"
+                      "@@||example.edu/lib/analytics/$script\n";
+
+    for (int i = 0; i < count; i++) {
+        const int kind = rng.bounded(100);
+        if (kind < 72) {
+            text += "||" + word() + "." + tlds[rng.bounded(7)] + "^";
+            if (kind % 3 == 0) text += "$third-party";
+        } else if (kind < 82) {
+            text += "/" + word() + "/" + word() + ".";
+        } else if (kind < 88) {
+            text += "-" + word() + "-ad.";
+        } else if (kind < 92) {
+            text += "&" + word() + "=";
+        } else if (kind < 96) {
+            text += "||" + word() + ".com/" + word() + "$script,domain=" + word() + ".com";
+        } else if (kind < 99) {
+            text += "@@||" + word() + "." + tlds[rng.bounded(7)] + "/" + word() + "/";
+        } else {
+            text += "/\\/" + word() + "\\/[0-9a-f]{8}\\.js/";
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+ContentBlocker::ContentType contentTypeOf(const QString& name)
+{
+    if (name == "main_frame") return ContentBlocker::Document;
+    if (name == "sub_frame") return ContentBlocker::Subdocument;
+    if (name == "stylesheet") return ContentBlocker::Stylesheet;
+    if (name == "script") return ContentBlocker::Script;
+    if (name == "image" || name == "favicon") return ContentBlocker::Image;
+    if (name == "font") return ContentBlocker::Font;
+    if (name == "xhr") return ContentBlocker::Xhr;
+    if (name == "ping") return ContentBlocker::Ping;
+    if (name == "media") return ContentBlocker::Media;
+    return ContentBlocker::Other;
+}
+
+QString siteOf(const QString& host)
+{
+    const QStringList labels = host.split('.');
+    return labels.size() <= 2 ? host : labels.mid(labels.size() - 2).join('.');
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ContentBlocker trace replay benchmark");
+    parser.addHelpOption();
+
+    QCommandLineOption traceDirOption("trace-dir", "Directory with *.trace files", "dir",
+                                      dataDir() + "/traces");
+    QCommandLineOption rulesOption("rules", "EasyList-format rule file (repeatable)", "file");
+    QCommandLineOption quickOption("quick", "Smaller rule set and fewer samples (smoke run)");
+    QCommandLineOption maxP99Option("max-p99-ns",
+                                    "Fail if any run's p99 latency exceeds this budget",
+                                    "ns", "0");
+    parser.addOption(traceDirOption);
+    parser.addOption(rulesOption);
+    parser.addOption(quickOption);
+    parser.addOption(maxP99Option);
+    parser.process(app);
+
+    const QStringList traces = traceFiles(parser.value(traceDirOption));
+    if (traces.isEmpty()) {
+        std::fprintf(stderr, "No traces found in %s\n", qPrintable(parser.value(traceDirOption)));
+        return 1;
+    }
+
+    const bool quick = parser.isSet(quickOption);
+    ContentBlocker blocker;
+
+    auto buildStart = Clock::now();
+    if (parser.isSet(rulesOption)) {
+        if (!blocker.loadFromFiles(parser.values(rulesOption))) return 1;
+    } else {
+        blocker.setRules(syntheticRules(quick ? 5000 : 60000));
+    }
+    auto buildEnd = Clock::now();
+
+    std::printf("%d rules (%d skipped), compiled in %.1f ms\n\n", blocker.ruleCount(),
+                blocker.skippedRuleCount(), elapsedNs(buildStart, buildEnd) / 1e6);
+
+    const double maxP99Ns = parser.value(maxP99Option).toDouble();
+    bool withinBudget = true;
+    printHeader("trace");
+
+    for (const QString& path : traces) {
+        const auto entries = loadTrace(path);
+        if (entries.empty()) continue;
+
+        // Requests as the interceptor would build them
+        std::vector<ContentBlocker::Request> requests;
+        requests.reserve(entries.size());
+        QString documentHost;
+        for (const auto& entry : entries) {
+            if (entry.resourceType == "main_frame") documentHost = entry.url.host();
+
+            ContentBlocker::Request request;
+            request.url = entry.url.toEncoded(QUrl::RemoveUserInfo | QUrl::RemoveFragment);
+            request.documentHost = documentHost;
+            request.type = contentTypeOf(entry.resourceType);
+            request.thirdParty = siteOf(entry.url.host()) != siteOf(documentHost);
+            requests.push_back(std::move(request));
+        }
+
+        const size_t samples = quick ? std::min<size_t>(requests.size(), 2000) : requests.size();
+
+        for (size_t i = 0; i < std::min<size_t>(samples, 200); i++) {
+            blocker.shouldBlock(requests[i]);
+        }
+
+        std::vector<qint64> latencies;
+        latencies.reserve(samples);
+        size_t blocked = 0;
+
+        for (size_t i = 0; i < samples; i++) {
+            auto start = Clock::now();
+            const bool result = blocker.shouldBlock(requests[i]);
+            auto end = Clock::now();
+            blocked += result;
+            latencies.push_back(elapsedNs(start, end));
+        }
+
+        LatencyStats stats = summarize(latencies);
+        printRow(QFileInfo(path).completeBaseName(), blocker.ruleCount(), stats);
+        std::printf("  %zu of %zu requests blocked\n", blocked, samples);
+
+        if (maxP99Ns > 0 && stats.p99Ns > maxP99Ns) {
+            std::fprintf(stderr, "  p99 %.0f ns exceeds budget of %.0f ns\n",
+                         stats.p99Ns, maxP99Ns);
+            withinBudget = false;
+        }
+    }
+
+    return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Replays LMS request traces through SEBRequestInterceptor::evaluate with
+// a navigation filter, content blocker and SEB keys configured, and
+// counts heap allocations per request once the per-thread buffers and
+// the header cache are warm. The QUrls are built up front: QtWebEngine
+// hands the interceptor a finished QUrl, so its parse is not counted.
+//
+//   bench_interceptor [--trace-dir DIR] [--quick] [--max-allocs N]
+
+#include "BenchCommon.h"
+#include "core/Config.h"
+#include "core/LatencyHistogram.h"
+#include "browser/NavigationFilter.h"
+#include "lms/LMSAdapter.h"
+#include "protocol/SEBProtocol.h"
+#include "protocol/SEBRequestInterceptor.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QHash>
+
+#include <atomic>
+
+using namespace openlock;
+using namespace openlock::bench;
+
+// Allocation counter: glibc lets a program interpose malloc and forward
+// to the real allocator. Qt's containers allocate through malloc, so
+// this sees QString/QByteArray growth as well as operator new.
+#if defined(__GLIBC__)
+namespace {
+std::atomic<quint64> s_allocations{0};
+}
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+
+static quint64 allocationCount() { return s_allocations.load(std::memory_order_relaxed); }
+static constexpr bool kCountsAllocations = true;
+#else
+static quint64 allocationCount() { return 0; }
+static constexpr bool kCountsAllocations = false;
+#endif
+
+namespace {
+
+struct Request {
+    QUrl url;
+    QUrl firstPartyUrl;
+    SEBRequestInterceptor::ResourceType type;
+};
+
+SEBRequestInterceptor::ResourceType resourceTypeOf(const QString& name)
+{
+    static QHash<QString, SEBRequestInterceptor::ResourceType> cache;
+    auto it = cache.constFind(name);
+    if (it != cache.constEnd()) return it.value();
+
+    const auto types = SEBRequestInterceptor::resourceTypesFromNames({name});
+    const auto type = types.isEmpty() ? QWebEngineUrlRequestInfo::ResourceTypeSubResource
+                                      : types.first();
+    cache.insert(name, type);
+    return type;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("SEBRequestInterceptor allocation benchmark");
+    parser.addHelpOption();
+
+    QCommandLineOption traceDirOption("trace-dir", "Directory with *.trace files", "dir",
+                                      dataDir() + "/traces");
+    QCommandLineOption quickOption("quick", "Fewer samples (smoke run)");
+    QCommandLineOption maxAllocsOption("max-allocs",
+                                       "Fail if warm requests average more allocations than this",
+                                       "n", "-1");
+    parser.addOption(traceDirOption);
+    parser.addOption(quickOption);
+    parser.addOption(maxAllocsOption);
+    parser.process(app);
+
+    const QStringList traces = traceFiles(parser.value(traceDirOption));
+    if (traces.isEmpty()) {
+        std::fprintf(stderr, "No traces found in %s\n", qPrintable(parser.value(traceDirOption)));
+        return 1;
+    }
+    if (!kCountsAllocations) {
+        std::printf("Allocation counting needs glibc; reporting latency only\n\n");
+    }
+
+    const bool quick = parser.isSet(quickOption);
+    const double maxAllocs = parser.value(maxAllocsOption).toDouble();
+    bool withinBudget = true;
+
+    // Default exam config: SEB keys over an empty config
+    Config config;
+    SEBProtocol protocol;
+    if (!protocol.initialize(&config)) return 1;
+
+    NavigationFilter filter;
+    filter.setBlockedPatterns({"*/admin/*", "*/message/*", "*chat*", "*.openai.com/*"});
+
+    auto blocker = std::make_shared<ContentBlocker>();
+    blocker->setRules(
+        "||google-analytics.com^\n"
+        "||googletagmanager.com^$third-party\n"
+        "||doubleclick.net^\n"
+        "/analytics.js$script\n"
+        "||intercom.io^$third-party\n");
+
+    // What one latency sample costs the interceptor: the timer read plus
+    // the per-thread counter increment
+    {
+        LatencyRecorder recorder(1);
+        const int iterations = quick ? 200000 : 2000000;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            recorder.record(0, quint64(timer.nsecsElapsed()) + quint64(i & 1023));
+        }
+        auto end = Clock::now();
+        std::printf("latency record: %.1f ns per sample\n\n",
+                    double(elapsedNs(start, end)) / iterations);
+    }
+
+    std::printf("%-22s %9s %11s %11s %13s %13s %13s\n", "trace", "samples", "p50 (ns)",
+                "p99 (ns)", "allocs/req", "max allocs", "url string");
+
+    for (const QString& path : traces) {
+        const auto entries = loadTrace(path);
+        if (entries.empty()) continue;
+
+        std::vector<Request> requests;
+        requests.reserve(entries.size());
+        QUrl firstParty;
+        for (const auto& entry : entries) {
+            if (entry.resourceType == "main_frame") firstParty = entry.url;
+            requests.push_back({entry.url, firstParty, resourceTypeOf(entry.resourceType)});
+        }
+
+        SEBRequestInterceptor interceptor;
+        interceptor.setSEBProtocol(&protocol);
+        interceptor.setNavigationFilter(&filter);
+        interceptor.setContentBlocker(blocker);
+        interceptor.setSEBHeaderHosts(LMSAdapter::sebHeaderHosts(requests.front().firstPartyUrl));
+
+        // Warm-up pass: grows the per-thread buffers to the longest URL,
+        // fills the header cache and the frame-origin cache
+        for (const Request& request : requests) {
+            interceptor.evaluate(request.url, request.firstPartyUrl, request.type);
+        }
+
+        const size_t samples = quick ? std::min<size_t>(requests.size(), 2000) : requests.size();
+        std::vector<qint64> latencies;
+        latencies.reserve(samples);
+        quint64 totalAllocations = 0;
+        quint64 maxAllocations = 0;
+
+        for (size_t i = 0; i < samples; i++) {
+            const Request& request = requests[i];
+            const quint64 before = allocationCount();
+            auto start = Clock::now();
+            auto verdict = interceptor.evaluate(request.url, request.firstPartyUrl, request.type);
+            auto end = Clock::now();
+            const quint64 allocations = allocationCount() - before;
+
+            latencies.push_back(elapsedNs(start, end));
+            totalAllocations += allocations;
+            maxAllocations = std::max(maxAllocations, allocations);
+            Q_UNUSED(verdict);
+        }
+
+        // For scale: what the one QUrl serialization per request costs
+        // by itself
+        quint64 serializeAllocations = 0;
+        for (size_t i = 0; i < samples; i++) {
+            const quint64 before = allocationCount();
+            {
+                const QString s = requests[i].url.toString(QUrl::RemoveFragment);
+                Q_UNUSED(s);
+            }
+            serializeAllocations += allocationCount() - before;
+        }
+
+        LatencyStats stats = summarize(latencies);
+        const double allocsPerRequest = samples ? double(totalAllocations) / samples : 0;
+        std::printf("%-22s %9zu %11.0f %11.0f %13.2f %13llu %13.2f\n",
+                    qPrintable(QFileInfo(path).completeBaseName()), stats.samples,
+                    stats.p50Ns, stats.p99Ns, allocsPerRequest,
+                    static_cast<unsigned long long>(maxAllocations),
+                    samples ? double(serializeAllocations) / samples : 0);
+
+        const auto cacheStats = interceptor.headerCacheStats();
+        std::printf("  header cache: %.1f%% hits, %.1f us hashing saved\n",
+                    cacheStats.hitRate() * 100, cacheStats.savedNs / 1e3);
+
+        if (kCountsAllocations && maxAllocs >= 0 && allocsPerRequest > maxAllocs) {
+            std::fprintf(stderr, "  %.2f allocations per request exceeds budget of %.2f\n",
+                         allocsPerRequest, maxAllocs);
+            withinBudget = false;
+        }
+    }
+
+    return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Replays recorded LMS request traces through NavigationFilter::checkUrl
+// with glob pattern sets and SEB URL filter rule sets of increasing size.
+// Links QtCore only, so it runs on headless CI machines without a display
+// or QtWebEngine.
+//
+//   bench_navigation_filter [--trace-dir DIR] [--quick] [--max-p99-ns N]
+
+#include "BenchCommon.h"
+#include "browser/NavigationFilter.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+
+using namespace openlock;
+using namespace openlock::bench;
+
+namespace {
+
+// Realistic exam rules first, then synthetic filler up to the requested count
+void applyPatternSet(NavigationFilter& filter, int count)
+{
+    QStringList allowed = {
+        "*.example.edu/*",
+        "*.instructure.com/*",
+        "*.cloudfront.net/dist/*",
+        "*/mod/quiz/*",
+        "*/webapps/assessment/*",
+        "*.gstatic.com/*",
+    };
+    QStringList blocked = {
+        "*/admin/*",
+        "*/message/*",
+        "*chat*",
+        "*.openai.com/*",
+    };
+
+    for (int i = 0; allowed.size() + blocked.size() < count; i++) {
+        if (i % 4 == 3) {
+            blocked << QString("*/tool%1/*").arg(i);
+        } else {
+            allowed << QString("*.campus%1.example.org/*").arg(i);
+        }
+    }
+
+    while (allowed.size() + blocked.size() > count) {
+        if (allowed.size() > blocked.size()) allowed.removeLast();
+        else blocked.removeLast();
+    }
+
+    filter.setAllowedPatterns(allowed);
+    filter.setBlockedPatterns(blocked);
+}
+
+// Same shape as applyPatternSet, expressed as SEB URLFilterRules
+void applySebRuleSet(NavigationFilter& filter, int count)
+{
+    auto rule = [](const QString& expression, UrlFilterAction action) {
+        UrlFilterRule r;
+        r.expression = expression;
+        r.action = action;
+        return r;
+    };
+
+    QList<UrlFilterRule> rules = {
+        rule("example.edu/admin", UrlFilterAction::Block),
+        rule("example.edu/message", UrlFilterAction::Block),
+        rule("openai.com", UrlFilterAction::Block),
+        rule("example.edu", UrlFilterAction::Allow),
+        rule("instructure.com", UrlFilterAction::Allow),
+        rule("*.cloudfront.net/dist", UrlFilterAction::Allow),
+        rule("gstatic.com", UrlFilterAction::Allow),
+        rule("^https?://[^/]+/.*chat", UrlFilterAction::Block),
+    };
+    rules.last().regex = true;
+
+    for (int i = 0; rules.size() < count; i++) {
+        if (i % 4 == 3) {
+            rules << rule(QString("campus%1.example.org/tool%1").arg(i), UrlFilterAction::Block);
+        } else {
+            rules << rule(QString("campus%1.example.org").arg(i), UrlFilterAction::Allow);
+        }
+    }
+    while (rules.size() > count) rules.removeLast();
+
+    filter.setUrlFilterRules(rules);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("NavigationFilter trace replay benchmark");
+    parser.addHelpOption();
+
+    QCommandLineOption traceDirOption("trace-dir", "Directory with *.trace files", "dir",
+                                      dataDir() + "/traces");
+    QCommandLineOption quickOption("quick", "Replay a tenth of the samples (smoke run)");
+    QCommandLineOption maxP99Option("max-p99-ns",
+                                    "Fail if any run's p99 latency exceeds this budget",
+                                    "ns", "0");
+    parser.addOption(traceDirOption);
+    parser.addOption(quickOption);
+    parser.addOption(maxP99Option);
+    parser.process(app);
+
+    const QStringList traces = traceFiles(parser.value(traceDirOption));
+    if (traces.isEmpty()) {
+        std::fprintf(stderr, "No traces found in %s\n", qPrintable(parser.value(traceDirOption)));
+        return 1;
+    }
+
+    const double maxP99Ns = parser.value(maxP99Option).toDouble();
+    const int ruleCounts[] = {10, 1000, 10000};
+
+    // Glob patterns are a linear regex scan, so bound the work per run at
+    // roughly 20M pattern evaluations to keep the 10k-rule runs sane.
+    const qint64 evaluationBudget = parser.isSet(quickOption) ? 2000000 : 20000000;
+
+    bool withinBudget = true;
+    printHeader("trace/rules");
+
+    for (const QString& path : traces) {
+        const auto entries = loadTrace(path);
+        if (entries.empty()) continue;
+
+        const QString traceName = QFileInfo(path).completeBaseName();
+
+        for (int run = 0; run < 6; run++) {
+            const int rules = ruleCounts[run / 2];
+            const bool sebRules = run % 2 == 1;
+
+            NavigationFilter filter;
+            if (sebRules) applySebRuleSet(filter, rules);
+            else applyPatternSet(filter, rules);
+
+            const QString name = traceName + (sebRules ? "/seb" : "/glob");
+
+            // SEB rule tables are host-indexed and don't need the budget
+            size_t samples = sebRules ? entries.size()
+                : std::min<size_t>(entries.size(), std::max<qint64>(evaluationBudget / rules, 100));
+            if (sebRules && parser.isSet(quickOption)) samples = std::min<size_t>(samples, 2000);
+
+            // Warm up regex JIT and QUrl caches
+            for (size_t i = 0; i < std::min<size_t>(samples, 200); i++) {
+                filter.checkUrl(entries[i].url);
+            }
+
+            std::vector<qint64> latencies;
+            latencies.reserve(samples);
+
+            for (size_t i = 0; i < samples; i++) {
+                const QUrl& url = entries[i].url;
+                auto start = Clock::now();
+                volatile FilterResult result = filter.checkUrl(url);
+                auto end = Clock::now();
+                Q_UNUSED(result);
+                latencies.push_back(elapsedNs(start, end));
+            }
+
+            LatencyStats stats = summarize(latencies);
+            printRow(name, rules, stats);
+
+            if (maxP99Ns > 0 && stats.p99Ns > maxP99Ns) {
+                std::fprintf(stderr, "  p99 %.0f ns exceeds budget of %.0f ns\n",
+                             stats.p99Ns, maxP99Ns);
+                withinBudget = false;
+            }
+        }
+    }
+
+    return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Parses a full-size exported .seb config (every settings page filled in,
+// URL filter rules, process lists, embedded certificates) and applies it
+// to an ExamConfig. "value() per key" looks every key SEBKeyTable knows up
+// in the root dict, as the if/else chains in Config did before the table;
+// it is a lower bound for them, since it runs no setters. The same config
+// as a binary plist (as macOS SEB saves it) is parsed for comparison.
+//
+//   bench_seb_parse [--config FILE] [--binary FILE] [--quick]
+
+#include "BenchCommon.h"
+#include "core/Config.h"
+#include "core/SEBKeyTable.h"
+#include "protocol/SEBSettings.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+
+#include <functional>
+
+using namespace openlock;
+using namespace openlock::bench;
+
+namespace {
+
+int lookupEachKey(const SEBSettings::Value& root)
+{
+    int found = 0;
+    for (int i = 0; i < SEBKeyTable::keyCount(); i++) {
+        const QStringView key = SEBKeyTable::keyAt(i);
+        if (root[key].type() == SEBKeyTable::expectedType(key)) found++;
+    }
+    return found;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("SEB config parse benchmark");
+    parser.addHelpOption();
+
+    QCommandLineOption configOption("config", "Exported .seb config to parse", "file",
+                                    dataDir() + "/seb/full_export.seb");
+    QCommandLineOption binaryOption("binary", "The same config as a binary plist", "file",
+                                    dataDir() + "/seb/full_export.bplist");
+    QCommandLineOption quickOption("quick", "Fewer samples (smoke run)");
+    parser.addOption(configOption);
+    parser.addOption(binaryOption);
+    parser.addOption(quickOption);
+    parser.process(app);
+
+    QFile file(parser.value(configOption));
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Cannot open config: %s\n", qPrintable(file.fileName()));
+        return 1;
+    }
+    const QByteArray xml = file.readAll();
+
+    QFile binaryFile(parser.value(binaryOption));
+    if (!binaryFile.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Cannot open config: %s\n", qPrintable(binaryFile.fileName()));
+        return 1;
+    }
+    const QByteArray binary = binaryFile.readAll();
+
+    QString error;
+    const auto settings = SEBSettings::fromXml(xml, &error);
+    if (!settings) {
+        std::fprintf(stderr, "Cannot parse config: %s\n", qPrintable(error));
+        return 1;
+    }
+    const SEBSettings::Value root = settings->root();
+    if (!SEBSettings::fromBinary(binary, &error)) {
+        std::fprintf(stderr, "Cannot parse binary config: %s\n", qPrintable(error));
+        return 1;
+    }
+
+    ExamConfig reference;
+    const int applied = SEBKeyTable::apply(root, reference);
+    const int found = lookupEachKey(root);
+    std::printf("%s: %.1f KiB (binary %.1f KiB), %d top-level keys, %d known, %d applied\n\n",
+                qPrintable(QFileInfo(file).fileName()), xml.size() / 1024.0,
+                binary.size() / 1024.0, int(root.size()), SEBKeyTable::keyCount(), applied);
+
+    struct Stage {
+        const char* name;
+        std::function<bool()> run;
+    };
+    const std::vector<Stage> stages = {
+        {"plist parse", [&] { return SEBSettings::fromXml(xml) != nullptr; }},
+        {"plist parse: binary", [&] { return SEBSettings::fromBinary(binary) != nullptr; }},
+        {"apply: SEBKeyTable", [&] {
+             ExamConfig config;
+             return SEBKeyTable::apply(root, config) == applied;
+         }},
+        {"apply: value() per key", [&] { return lookupEachKey(root) == found; }},
+        {"Config::loadFromSebData", [&] {
+             Config config;
+             return config.loadFromSebData(xml);
+         }},
+    };
+
+    const int iterations = parser.isSet(quickOption) ? 50 : 2000;
+    std::printf("%-26s %9s %11s %11s %11s\n", "stage", "samples", "p50 (us)", "p99 (us)",
+                "max (us)");
+
+    bool ok = true;
+    for (const Stage& stage : stages) {
+        std::vector<qint64> samples;
+        samples.reserve(iterations);
+        for (int i = 0; i < iterations; i++) {
+            const auto start = Clock::now();
+            ok = stage.run() && ok;
+            samples.push_back(elapsedNs(start, Clock::now()));
+        }
+        const LatencyStats stats = summarize(samples);
+        std::printf("%-26s %9zu %11.2f %11.2f %11.2f\n", stage.name, stats.samples,
+                    stats.p50Ns / 1000, stats.p99Ns / 1000, stats.maxNs / 1000);
+    }
+
+    if (!ok) std::fprintf(stderr, "A stage failed or disagreed with the first run\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+// Hashes the installed Qt libraries (what BrowserExamKey hashes when
+// OpenLock ships with a bundled QtWebEngine) with the previous
+// QCryptographicHash paths and with each Sha256Batch backend the CPU
+// supports. Files are read once before timing, so every run sees a warm
+// page cache.
+//
+//   bench_sha256 [--lib-dir DIR] [--quick] [--repeat N]
+
+#include "BenchCommon.h"
+#include "integrity/Sha256Batch.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QLibraryInfo>
+#include <QtConcurrent>
+
+#include <functional>
+#include <limits>
+
+using namespace openlock;
+using namespace openlock::bench;
+
+namespace {
+
+QList<QByteArray> qtSequential(const QStringList& paths)
+{
+    // computeBinaryFilesHash before Sha256Batch: readAll, one file at a time
+    QList<QByteArray> digests;
+    for (const QString& path : paths) {
+        QFile file(path);
+        digests << (file.open(QIODevice::ReadOnly)
+                        ? QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha256)
+                        : QByteArray());
+    }
+    return digests;
+}
+
+QList<QByteArray> qtParallel(const QStringList& paths)
+{
+    // One QCryptographicHash stream per file on the thread pool
+    return QtConcurrent::blockingMapped(paths, [](const QString& path) {
+        QFile file(path);
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+        const uchar* data = file.size() > 0 ? file.map(0, file.size()) : nullptr;
+        if (data) {
+            hash.addData(QByteArrayView(reinterpret_cast<const char*>(data), file.size()));
+        } else if (!hash.addData(&file)) {
+            return QByteArray();
+        }
+        return hash.result();
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Bulk SHA-256 benchmark over shared libraries");
+    parser.addHelpOption();
+
+    QCommandLineOption libDirOption("lib-dir", "Directory with the libraries to hash", "dir",
+                                    QLibraryInfo::path(QLibraryInfo::LibrariesPath));
+    QCommandLineOption quickOption("quick", "Hash at most 256 MiB once (smoke run)");
+    QCommandLineOption repeatOption("repeat", "Runs per method; the fastest is reported",
+                                    "n", "3");
+    parser.addOption(libDirOption);
+    parser.addOption(quickOption);
+    parser.addOption(repeatOption);
+    parser.process(app);
+
+    const bool quick = parser.isSet(quickOption);
+    const int repeat = quick ? 1 : std::max(1, parser.value(repeatOption).toInt());
+    const qint64 byteLimit = quick ? qint64(256) << 20 : std::numeric_limits<qint64>::max();
+
+    // Real files only: the .so and .so.6 symlinks point at the same library
+    QStringList paths;
+    qint64 totalBytes = 0;
+    const auto infos = QDir(parser.value(libDirOption))
+                           .entryInfoList({"libQt6*.so*"}, QDir::Files | QDir::NoSymLinks,
+                                          QDir::Name);
+    for (const auto& info : infos) {
+        if (totalBytes + info.size() > byteLimit) continue;
+        paths << info.absoluteFilePath();
+        totalBytes += info.size();
+    }
+    if (paths.isEmpty()) {
+        std::fprintf(stderr, "No Qt libraries found in %s\n",
+                     qPrintable(parser.value(libDirOption)));
+        return 1;
+    }
+
+    // Warm the page cache
+    qtSequential(paths);
+
+    std::printf("%d files, %.1f MiB, %d threads, SHA extensions: %s\n\n", int(paths.size()),
+                totalBytes / 1048576.0, QThreadPool::globalInstance()->maxThreadCount(),
+                Sha256Batch::hasShaExtensions() ? "yes" : "no");
+    std::printf("%-28s %10s %10s\n", "method", "ms", "MB/s");
+
+    struct Method {
+        QString name;
+        std::function<QList<QByteArray>()> run;
+    };
+    std::vector<Method> methods = {
+        {"qt sequential (readAll)", [&] { return qtSequential(paths); }},
+        {"qt parallel (mmap)", [&] { return qtParallel(paths); }},
+    };
+    for (auto backend : {Sha256Batch::Backend::OpenSsl, Sha256Batch::Backend::Avx2x8}) {
+        if (!Sha256Batch::isSupported(backend)) continue;
+        methods.push_back({"batch " + Sha256Batch::backendName(backend),
+                           [&paths, backend] { return Sha256Batch::hashFiles(paths, backend); }});
+    }
+
+    const QList<QByteArray> expected = qtSequential(paths);
+    bool allMatch = true;
+    for (const Method& method : methods) {
+        qint64 bestNs = std::numeric_limits<qint64>::max();
+        QList<QByteArray> digests;
+        for (int i = 0; i < repeat; i++) {
+            auto start = Clock::now();
+            digests = method.run();
+            bestNs = std::min(bestNs, elapsedNs(start, Clock::now()));
+        }
+
+        const bool match = digests == expected;
+        allMatch = allMatch && match;
+        std::printf("%-28s %10.1f %10.0f%s\n", qPrintable(method.name), bestNs / 1e6,
+                    totalBytes / (bestNs / 1e9) / 1e6, match ? "" : "  DIGEST MISMATCH");
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#pragma once
+
+#include <QByteArray>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <zlib.h>
+
+namespace openlock::test {
+
+// gzip member, as SEB wraps configs and encrypted payloads
+inline QByteArray gzip(const QByteArray& data)
+{
+    z_stream stream{};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    QByteArray compressed(int(deflateBound(&stream, uLong(data.size()))), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = uInt(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = uInt(compressed.size());
+    deflate(&stream, Z_FINISH);
+    compressed.resize(int(stream.total_out));
+    deflateEnd(&stream);
+    return compressed;
+}
+
+// "pswd" + RNCryptor v3 with fixed salts and IV, as SEB writes it
+inline QByteArray encryptSeb(const QByteArray& plain, const QByteArray& password,
+                             const QByteArray& encSalt = QByteArray(8, 'e'),
+                             const QByteArray& hmacSalt = QByteArray(8, 'h'))
+{
+    auto bytes = [](const QByteArray& s) {
+        return reinterpret_cast<const unsigned char*>(s.constData());
+    };
+    unsigned char encKey[32];
+    unsigned char hmacKey[32];
+    PKCS5_PBKDF2_HMAC(password.constData(), int(password.size()), bytes(encSalt), 8, 10000,
+                      EVP_sha1(), 32, encKey);
+    PKCS5_PBKDF2_HMAC(password.constData(), int(password.size()), bytes(hmacSalt), 8, 10000,
+                      EVP_sha1(), 32, hmacKey);
+
+    const QByteArray iv(16, 'i');
+    QByteArray message = QByteArray("\x03\x01", 2) + encSalt + hmacSalt + iv;
+
+    QByteArray ciphertext(plain.size() + 16, '\0');
+    int length = 0;
+    int finalLength = 0;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, encKey, bytes(iv));
+    EVP_EncryptUpdate(ctx, reinterpret_cast<unsigned char*>(ciphertext.data()), &length,
+                      bytes(plain), int(plain.size()));
+    EVP_EncryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(ciphertext.data()) + length,
+                        &finalLength);
+    EVP_CIPHER_CTX_free(ctx);
+    ciphertext.resize(length + finalLength);
+    message += ciphertext;
+
+    unsigned char tag[32];
+    unsigned int tagLength = 0;
+    HMAC(EVP_sha256(), hmacKey, 32, bytes(message), size_t(message.size()), tag, &tagLength);
+    message.append(reinterpret_cast<const char*>(tag), int(tagLength));
+
+    return "pswd" + message;
+}
+
+} // namespace openlock::test
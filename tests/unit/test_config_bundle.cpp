@@ -0,0 +1,223 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "browser/DomainBlocklist.h"
+#include "core/Config.h"
+#include "core/ConfigBundle.h"
+#include "protocol/SEBProtocol.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTimeZone>
+
+using namespace openlock;
+
+namespace {
+
+QDateTime at(int day, int hour, int minute = 0)
+{
+    return QDateTime(QDate(2026, 3, day), QTime(hour, minute), QTimeZone::utc());
+}
+
+ConfigBundle::Exam exam(const QString& id, const QDateTime& start = {},
+                        const QDateTime& end = {})
+{
+    ConfigBundle::Exam exam;
+    exam.id = id;
+    exam.windowStart = start;
+    exam.windowEnd = end;
+    exam.entry.format = ConfigFormat::OpenLock;
+    exam.entry.rawData = "{\"examName\": \"" + id.toUtf8() +
+                         "\", \"startUrl\": \"https://moodle.example.com/" + id.toUtf8() + "\"}";
+    return exam;
+}
+
+const QByteArray kSebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/current</string>
+    <key>URLFilterEnable</key>
+    <true/>
+</dict>
+</plist>
+)";
+
+} // namespace
+
+class ConfigBundleTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        if (!QCoreApplication::instance()) {
+            static int argc = 1;
+            static char* argv[] = { const_cast<char*>("test") };
+            static QCoreApplication app(argc, argv);
+        }
+    }
+
+    void SetUp() override {
+        ASSERT_TRUE(m_dir.isValid());
+        m_path = m_dir.filePath("lab.olbundle");
+    }
+
+    QTemporaryDir m_dir;
+    QString m_path;
+};
+
+TEST_F(ConfigBundleTest, FindsExamsById) {
+    QList<ConfigBundle::Exam> exams;
+    for (int i = 0; i < 100; i++) {
+        exams << exam(QString("exam-%1").arg(99 - i, 3, 10, QChar('0')));
+    }
+    exams << exam(QString::fromUtf8("prüfung"));
+    ASSERT_TRUE(ConfigBundle::write(m_path, exams));
+
+    ConfigBundle bundle;
+    ASSERT_TRUE(bundle.open(m_path));
+    EXPECT_EQ(bundle.examCount(), 101);
+
+    for (const ConfigBundle::Exam& expected : exams) {
+        const int index = bundle.find(expected.id);
+        ASSERT_GE(index, 0) << qPrintable(expected.id);
+        EXPECT_EQ(bundle.examId(index), expected.id);
+        const auto entry = bundle.entry(index);
+        ASSERT_TRUE(entry);
+        EXPECT_EQ(entry->format, ConfigFormat::OpenLock);
+        EXPECT_EQ(entry->rawData, expected.entry.rawData);
+    }
+    EXPECT_EQ(bundle.find("exam-100"), -1);
+    EXPECT_EQ(bundle.find("exam"), -1);
+    EXPECT_EQ(bundle.find(""), -1);
+    EXPECT_FALSE(bundle.windowStart(bundle.find("exam-000")).isValid());
+}
+
+TEST_F(ConfigBundleTest, FindsExamScheduledAtTime) {
+    ASSERT_TRUE(ConfigBundle::write(m_path, {
+        exam("afternoon", at(2, 13), at(2, 14, 30)),
+        exam("morning", at(2, 9), at(2, 10, 30)),
+        exam("next-day", at(3, 9), at(3, 10)),
+        exam("makeup"),
+    }));
+
+    ConfigBundle bundle;
+    ASSERT_TRUE(bundle.open(m_path));
+    auto idAt = [&](const QDateTime& time) { return bundle.examId(bundle.findAt(time)); };
+
+    EXPECT_EQ(idAt(at(2, 9)), "morning");
+    EXPECT_EQ(idAt(at(2, 10, 29)), "morning");
+    EXPECT_EQ(idAt(at(2, 10, 30)), "");         // windows end exclusively
+    EXPECT_EQ(idAt(at(2, 8, 59)), "");
+    EXPECT_EQ(idAt(at(2, 14)), "afternoon");
+    EXPECT_EQ(idAt(at(3, 9, 15)), "next-day");
+    EXPECT_EQ(idAt(at(4, 9)), "");
+    EXPECT_EQ(bundle.findAt(QDateTime()), -1);
+
+    const int morning = bundle.find("morning");
+    EXPECT_EQ(bundle.windowStart(morning), at(2, 9));
+    EXPECT_EQ(bundle.windowEnd(morning), at(2, 10, 30));
+}
+
+TEST_F(ConfigBundleTest, RejectsAmbiguousSchedules) {
+    EXPECT_FALSE(ConfigBundle::write(m_path, {exam("a"), exam("a")}));
+    EXPECT_FALSE(ConfigBundle::write(m_path, {exam("")}));
+    EXPECT_FALSE(ConfigBundle::write(m_path, {exam("a", at(2, 9), at(2, 9))}));
+    EXPECT_FALSE(ConfigBundle::write(m_path, {exam("a", at(2, 9), QDateTime())}));
+    EXPECT_FALSE(ConfigBundle::write(m_path, {
+        exam("a", at(2, 9), at(2, 11)),
+        exam("b", at(2, 10), at(2, 12)),
+    }));
+    // Back to back is fine
+    EXPECT_TRUE(ConfigBundle::write(m_path, {
+        exam("a", at(2, 9), at(2, 10)),
+        exam("b", at(2, 10), at(2, 11)),
+    }));
+}
+
+TEST_F(ConfigBundleTest, MapsCompiledBlocklistInPlace) {
+    DomainBlocklist compiled;
+    ASSERT_TRUE(compiled.build({"chat.example.ai", "answers.example.com"}));
+
+    ConfigBundle::Exam blocked = exam("blocked");
+    blocked.domainBlocklist = compiled.compiledImage();
+    ASSERT_TRUE(ConfigBundle::write(m_path, {exam("a-first"), blocked, exam("plain")}));
+
+    ConfigBundle bundle;
+    ASSERT_TRUE(bundle.open(m_path));
+    EXPECT_FALSE(bundle.domainBlocklist(bundle.find("plain")));
+
+    const auto blocklist = bundle.domainBlocklist(bundle.find("blocked"));
+    ASSERT_TRUE(blocklist);
+    EXPECT_EQ(blocklist->domainCount(), 2);
+    EXPECT_TRUE(blocklist->contains("www.chat.example.ai"));
+    EXPECT_FALSE(blocklist->contains("example.ai"));
+}
+
+TEST_F(ConfigBundleTest, RejectsDamagedFiles) {
+    ASSERT_TRUE(ConfigBundle::write(m_path, {exam("a"), exam("b")}));
+
+    QFile file(m_path);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    const QByteArray contents = file.readAll();
+
+    // Truncated
+    file.resize(contents.size() - 8);
+    file.close();
+    ConfigBundle bundle;
+    EXPECT_FALSE(bundle.open(m_path));
+    EXPECT_EQ(bundle.find("a"), -1);
+
+    // Not a bundle
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(QByteArray(256, 'x'));
+    file.close();
+    EXPECT_FALSE(bundle.open(m_path));
+    EXPECT_FALSE(bundle.open(m_dir.filePath("missing.olbundle")));
+}
+
+TEST_F(ConfigBundleTest, ConfigLoadsOneExam) {
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    ConfigBundle::Exam current = exam("current", now.addSecs(-600), now.addSecs(3000));
+    current.entry.format = ConfigFormat::SEB;
+    current.entry.rawData = kSebXml;
+    ASSERT_TRUE(ConfigBundle::write(m_path, {
+        exam("earlier", now.addSecs(-7200), now.addSecs(-3600)),
+        current,
+        exam("makeup"),
+    }));
+
+    Config scheduled;
+    ASSERT_TRUE(scheduled.loadFromBundle(m_path));
+    EXPECT_EQ(scheduled.format(), ConfigFormat::SEB);
+    EXPECT_TRUE(scheduled.examConfig().sebMode);
+    EXPECT_TRUE(scheduled.examConfig().urlFilterEnabled);
+    EXPECT_EQ(scheduled.examConfig().startUrl.toString(), "https://moodle.example.com/current");
+    ASSERT_TRUE(scheduled.sebSettings());
+    EXPECT_FALSE(scheduled.bundledDomainBlocklist());
+
+    // Keys come from the bundled plist, as if the .seb file had been opened
+    Config direct;
+    ASSERT_TRUE(direct.loadFromSebData(kSebXml));
+    const QByteArray binaryHash(32, 'b');
+    const auto bundledKeys = SEBProtocol::deriveKeys(scheduled, binaryHash);
+    const auto directKeys = SEBProtocol::deriveKeys(direct, binaryHash);
+    ASSERT_TRUE(bundledKeys && directKeys);
+    EXPECT_EQ(bundledKeys->configKeyHex(), directKeys->configKeyHex());
+    EXPECT_EQ(bundledKeys->examKey(), directKeys->examKey());
+    EXPECT_NE(bundledKeys->configKey(),
+              QCryptographicHash::hash(kSebXml, QCryptographicHash::Sha256));
+
+    Config byId;
+    ASSERT_TRUE(byId.loadFromBundle(m_path, "makeup"));
+    EXPECT_EQ(byId.format(), ConfigFormat::OpenLock);
+    EXPECT_EQ(byId.examConfig().examName, "makeup");
+    EXPECT_EQ(byId.examConfig().startUrl.toString(), "https://moodle.example.com/makeup");
+    EXPECT_FALSE(byId.examConfig().sebMode);
+    EXPECT_FALSE(byId.sebSettings());
+
+    Config missing;
+    EXPECT_FALSE(missing.loadFromBundle(m_path, "final"));
+}
@@ -0,0 +1,237 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "core/Config.h"
+#include "SEBTestData.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+using namespace openlock;
+
+namespace {
+
+const QByteArray kSebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/quiz</string>
+    <key>allowQuit</key>
+    <true/>
+</dict>
+</plist>)";
+
+// Minimal HTTP/1.1 server on localhost. Bodies are written in small pieces
+// with pauses in between so the client sees them arrive over time.
+class ConfigServer : public QObject {
+public:
+    struct File {
+        QByteArray body;
+        QByteArray etag;
+    };
+
+    ConfigServer()
+    {
+        QObject::connect(&m_server, &QTcpServer::newConnection, this, [this] {
+            while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::readyRead, this,
+                                 [this, socket] { readRequest(socket); });
+            }
+        });
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QUrl url(const QString& path) const
+    {
+        return QUrl(QString("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path));
+    }
+
+    void serve(const QString& path, const File& file) { m_files[path] = file; }
+
+    int requests = 0;
+    int notModified = 0;
+    QByteArray lastIfNoneMatch;
+    int chunkSize = 16;
+
+private:
+    void readRequest(QTcpSocket* socket)
+    {
+        QByteArray& request = m_pending[socket];
+        request += socket->readAll();
+        if (!request.contains("\r\n\r\n")) return;
+
+        ++requests;
+        const QList<QByteArray> lines = request.left(request.indexOf("\r\n\r\n")).split('\n');
+        const QString path = QString::fromLatin1(lines.first().split(' ').value(1));
+        lastIfNoneMatch.clear();
+        for (const QByteArray& line : lines) {
+            if (line.toLower().startsWith("if-none-match:")) {
+                lastIfNoneMatch = line.mid(line.indexOf(':') + 1).trimmed();
+            }
+        }
+        m_pending.remove(socket);
+
+        const auto it = m_files.constFind(path);
+        if (it == m_files.constEnd()) {
+            respond(socket, "404 Not Found", {}, {});
+        } else if (!it->etag.isEmpty() && lastIfNoneMatch == it->etag) {
+            ++notModified;
+            respond(socket, "304 Not Modified", it->etag, {});
+        } else {
+            respond(socket, "200 OK", it->etag, it->body);
+        }
+    }
+
+    void respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& etag,
+                 const QByteArray& body)
+    {
+        QByteArray head = "HTTP/1.1 " + status + "\r\n";
+        if (!etag.isEmpty()) head += "ETag: " + etag + "\r\n";
+        if (!status.startsWith("304")) {
+            head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        }
+        head += "Connection: close\r\n\r\n";
+        socket->write(head);
+        writeChunks(socket, body, 0);
+    }
+
+    void writeChunks(QPointer<QTcpSocket> socket, const QByteArray& body, qsizetype offset)
+    {
+        if (!socket) return;
+        if (offset >= body.size()) {
+            socket->disconnectFromHost();
+            return;
+        }
+        socket->write(body.mid(offset, chunkSize));
+        socket->flush();
+        QTimer::singleShot(2, this, [this, socket, body, offset] {
+            writeChunks(socket, body, offset + chunkSize);
+        });
+    }
+
+    QTcpServer m_server;
+    QHash<QString, File> m_files;
+    QHash<QTcpSocket*, QByteArray> m_pending;
+};
+
+} // namespace
+
+class ConfigDownloadTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        if (!QCoreApplication::instance()) {
+            static int argc = 1;
+            static char* argv[] = { const_cast<char*>("test") };
+            static QCoreApplication app(argc, argv);
+        }
+    }
+
+    // Runs the event loop until the download finishes; false on configError
+    bool waitForConfig(Config& config) {
+        QEventLoop loop;
+        bool loaded = false;
+        m_error.clear();
+        QObject::connect(&config, &Config::configLoaded, &loop, [&] {
+            loaded = true;
+            loop.quit();
+        });
+        QObject::connect(&config, &Config::configError, &loop, [&](const QString& message) {
+            m_error = message;
+            loop.quit();
+        });
+        QTimer::singleShot(10000, &loop, [&] {
+            m_error = "timed out";
+            loop.quit();
+        });
+        loop.exec();
+        return loaded;
+    }
+
+    ConfigServer m_server;
+    QString m_error;
+};
+
+TEST_F(ConfigDownloadTest, DownloadsSebConfig) {
+    m_server.serve("/exam.seb", {kSebXml, {}});
+
+    Config config;
+    ASSERT_TRUE(config.loadFromUrl(m_server.url("/exam.seb")));
+    EXPECT_TRUE(config.isLoading());
+    ASSERT_TRUE(waitForConfig(config)) << m_error.toStdString();
+
+    EXPECT_FALSE(config.isLoading());
+    EXPECT_EQ(config.format(), ConfigFormat::SEB);
+    EXPECT_TRUE(config.examConfig().sebMode);
+    EXPECT_EQ(config.examConfig().startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_TRUE(config.examConfig().allowQuit);
+    EXPECT_EQ(config.rawConfigData(), kSebXml);
+}
+
+TEST_F(ConfigDownloadTest, DownloadsAgainOnEveryLoad) {
+    m_server.serve("/exam.seb", {openlock::test::gzip(kSebXml), "\"v1\""});
+
+    Config first;
+    ASSERT_TRUE(first.loadFromUrl(m_server.url("/exam.seb")));
+    ASSERT_TRUE(waitForConfig(first)) << m_error.toStdString();
+
+    // No local copy to revalidate: a relaunch fetches the full config
+    Config relaunch;
+    ASSERT_TRUE(relaunch.loadFromUrl(m_server.url("/exam.seb")));
+    ASSERT_TRUE(waitForConfig(relaunch)) << m_error.toStdString();
+    EXPECT_TRUE(m_server.lastIfNoneMatch.isEmpty());
+    EXPECT_EQ(m_server.notModified, 0);
+    EXPECT_EQ(m_server.requests, 2);
+    EXPECT_EQ(relaunch.rawConfigData(), first.rawConfigData());
+}
+
+TEST_F(ConfigDownloadTest, DecryptsWhileDownloading) {
+    m_server.serve("/exam.seb", {openlock::test::encryptSeb(kSebXml, "exam-password"), {}});
+    m_server.chunkSize = 7;
+
+    Config config;
+    ASSERT_TRUE(config.loadFromUrl(m_server.url("/exam.seb"), "exam-password"));
+    ASSERT_TRUE(waitForConfig(config)) << m_error.toStdString();
+    EXPECT_EQ(config.examConfig().startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_EQ(config.rawConfigData(), kSebXml);
+
+    Config wrongPassword;
+    ASSERT_TRUE(wrongPassword.loadFromUrl(m_server.url("/exam.seb"), "guess"));
+    EXPECT_FALSE(waitForConfig(wrongPassword));
+    EXPECT_FALSE(m_error.isEmpty());
+    EXPECT_NE(m_error, "timed out");
+}
+
+TEST_F(ConfigDownloadTest, DownloadsOpenLockConfig) {
+    m_server.serve("/exam.openlock", {R"({"examName": "Final", "allowQuit": true})", {}});
+
+    Config config;
+    ASSERT_TRUE(config.loadFromUrl(m_server.url("/exam.openlock")));
+    ASSERT_TRUE(waitForConfig(config)) << m_error.toStdString();
+    EXPECT_EQ(config.format(), ConfigFormat::OpenLock);
+    EXPECT_EQ(config.examConfig().examName, "Final");
+}
+
+TEST_F(ConfigDownloadTest, MissingConfigIsAnError) {
+    Config config;
+    ASSERT_TRUE(config.loadFromUrl(m_server.url("/missing.seb")));
+    EXPECT_FALSE(waitForConfig(config));
+    EXPECT_TRUE(m_error.startsWith("Config download failed")) << m_error.toStdString();
+
+    EXPECT_FALSE(config.loadFromUrl(QUrl("ftp://example.com/exam.seb")));
+}
+
+TEST_F(ConfigDownloadTest, SebUrlsAreFetchedOverHttps) {
+    EXPECT_EQ(Config::configUrlFromSebUrl(QUrl("seb://lms.example.com/exam.seb")),
+              QUrl("https://lms.example.com/exam.seb"));
+    EXPECT_EQ(Config::configUrlFromSebUrl(QUrl("sebs://lms.example.com/exam.seb?id=4")),
+              QUrl("https://lms.example.com/exam.seb?id=4"));
+    EXPECT_EQ(Config::configUrlFromSebUrl(QUrl("http://localhost/exam.seb")),
+              QUrl("http://localhost/exam.seb"));
+}
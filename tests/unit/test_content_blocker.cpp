@@ -0,0 +1,143 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "browser/ContentBlocker.h"
+
+using namespace openlock;
+
+namespace {
+
+ContentBlocker::Request request(const QByteArray& url,
+                                ContentBlocker::ContentType type = ContentBlocker::Script,
+                                bool thirdParty = true,
+                                const QString& documentHost = "moodle.school.edu")
+{
+    ContentBlocker::Request r;
+    r.url = url;
+    r.type = type;
+    r.thirdParty = thirdParty;
+    r.documentHost = documentHost;
+    return r;
+}
+
+} // namespace
+
+TEST(ContentBlockerTest, DomainAnchor) {
+    ContentBlocker blocker;
+    blocker.setRules("||tracker.com^\n");
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://tracker.com/t.js")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://cdn.tracker.com/t.js")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://tracker.com")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://nottracker.com/t.js")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://tracker.com.evil.org/t.js")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://moodle.school.edu/?ref=tracker.com")));
+}
+
+TEST(ContentBlockerTest, WildcardsSeparatorsAndAnchors) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "/banner/*/ad_\n"
+        "&adslot=\n"
+        "|http://plain.example/\n"
+        ".swf|\n");
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/banner/300x250/ad_1.png")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/banner/ad_1.png")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/x?id=1&adslot=top")));
+    EXPECT_TRUE(blocker.shouldBlock(request("http://plain.example/index.html")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://plain.example/index.html")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/movie.swf")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/movie.swf?x=1")));
+}
+
+TEST(ContentBlockerTest, ExceptionsAndImportant) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "||widgets.com^\n"
+        "@@||widgets.com/quiz-timer/\n"
+        "||ads.com^$important\n"
+        "@@||ads.com^\n");
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://widgets.com/chat.js")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://widgets.com/quiz-timer/timer.js")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://ads.com/a.js")));
+}
+
+TEST(ContentBlockerTest, ImportantWinsOverExceptionWhenPlainRuleAlsoMatches) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "||chat.vendor.com^\n"
+        "||chat.vendor.com/widget/$important\n"
+        "@@||chat.vendor.com^\n");
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://chat.vendor.com/widget/load.js")));
+    // Only the plain rule matches here, so the exception applies
+    EXPECT_FALSE(blocker.shouldBlock(request("https://chat.vendor.com/status.js")));
+}
+
+TEST(ContentBlockerTest, PartyTypeAndDomainOptions) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "||cdn.chat.io^$third-party\n"
+        "/analytics.js$script\n"
+        "/pixel.$~image\n"
+        "||quizhelp.com^$domain=moodle.school.edu|~exam.school.edu\n");
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://cdn.chat.io/w.js")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://cdn.chat.io/w.js", ContentBlocker::Script, false)));
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/lib/analytics.js")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/lib/analytics.js", ContentBlocker::Image)));
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/pixel.gif", ContentBlocker::Xhr)));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/pixel.gif", ContentBlocker::Image)));
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://quizhelp.com/x")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://quizhelp.com/x", ContentBlocker::Script,
+                                             true, "other.edu")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://quizhelp.com/x", ContentBlocker::Script,
+                                             true, "exam.school.edu")));
+}
+
+TEST(ContentBlockerTest, DocumentsOnlyBlockedWhenRuleSaysSo) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "||tracker.com^\n"
+        "||cheatsite.com^$document\n");
+
+    EXPECT_FALSE(blocker.shouldBlock(request("https://tracker.com/", ContentBlocker::Document)));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://cheatsite.com/", ContentBlocker::Document)));
+}
+
+TEST(ContentBlockerTest, RegexAndMatchCase) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "/\\/ad[0-9]+\\.js/\n"
+        "/TrackMe/$match-case\n"
+        "/\\/promo\\/[0-9]+\\//\n");
+
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/AD42.js")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/adx.js")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/TrackMe/p")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/trackme/p")));
+    EXPECT_TRUE(blocker.shouldBlock(request("https://a.com/promo/123/x")));
+    EXPECT_FALSE(blocker.shouldBlock(request("https://a.com/promo/abc/x")));
+}
+
+TEST(ContentBlockerTest, SkipsCosmeticAndUnsupportedRules) {
+    ContentBlocker blocker;
+    blocker.setRules(
+        "[Adblock Plus 2.0]\n"
+        "! comment\n"
+        "example.com##.ad-banner\n"
+        "||popunder.com^$popup\n"
+        "||tracker.com^$csp=script-src 'none'\n"
+        "||tracker.com^\n");
+
+    EXPECT_EQ(blocker.ruleCount(), 1);
+    EXPECT_EQ(blocker.skippedRuleCount(), 3);
+    EXPECT_FALSE(blocker.shouldBlock(request("https://popunder.com/")));
+}
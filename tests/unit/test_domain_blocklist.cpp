@@ -0,0 +1,216 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "browser/DomainBlocklist.h"
+#include "browser/NavigationFilter.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include <cstring>
+
+using namespace openlock;
+
+class DomainBlocklistTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        if (!QCoreApplication::instance()) {
+            static int argc = 1;
+            static char* argv[] = { const_cast<char*>("test") };
+            static QCoreApplication app(argc, argv);
+        }
+    }
+
+    static QStringList sampleDomains() {
+        return {"chegg.com", "chat.openai.com", "quizlet.com", "course-hero.example", "a.b.c.d.e"};
+    }
+};
+
+TEST_F(DomainBlocklistTest, ParsesHostsAndPlainLists) {
+    QByteArray text =
+        "# answer sites\n"
+        "0.0.0.0 chegg.com www.chegg.com\n"
+        "127.0.0.1 localhost\n"
+        "::1 ip6-localhost\n"
+        "quizlet.com   # trailing comment\n"
+        "||brainly.com^\n"
+        "\n";
+
+    QStringList domains = DomainBlocklist::parseDomainList(text);
+    EXPECT_EQ(domains, QStringList({"chegg.com", "www.chegg.com", "quizlet.com", "brainly.com"}));
+}
+
+TEST_F(DomainBlocklistTest, MatchesDomainsAndSubdomains) {
+    DomainBlocklist blocklist;
+    ASSERT_TRUE(blocklist.build(sampleDomains()));
+    EXPECT_EQ(blocklist.domainCount(), 5);
+
+    EXPECT_TRUE(blocklist.contains("chegg.com"));
+    EXPECT_TRUE(blocklist.contains("www.chegg.com"));
+    EXPECT_TRUE(blocklist.contains("CHAT.openai.com"));
+    EXPECT_TRUE(blocklist.contains("x.chat.openai.com"));
+    EXPECT_TRUE(blocklist.contains("a.b.c.d.e"));
+
+    EXPECT_FALSE(blocklist.contains("openai.com"));
+    EXPECT_FALSE(blocklist.contains("b.c.d.e"));
+    EXPECT_FALSE(blocklist.contains("moodle.school.edu"));
+    EXPECT_FALSE(blocklist.contains(""));
+}
+
+TEST_F(DomainBlocklistTest, OnlyMatchesOnLabelBoundaries) {
+    DomainBlocklist blocklist;
+    ASSERT_TRUE(blocklist.build(sampleDomains()));
+
+    EXPECT_FALSE(blocklist.contains("notchegg.com"));
+    EXPECT_FALSE(blocklist.contains("chegg.com.evil.org"));
+    EXPECT_FALSE(blocklist.contains("chegg.co"));
+    EXPECT_FALSE(blocklist.contains("hegg.com"));
+}
+
+TEST_F(DomainBlocklistTest, BloomPrefilterDoesNotChangeResults) {
+    QStringList domains;
+    for (int i = 0; i < 5000; i++) {
+        domains << QString("site%1.example%2.com").arg(i).arg(i % 37);
+    }
+
+    DomainBlocklist withBloom;
+    DomainBlocklist withoutBloom;
+    ASSERT_TRUE(withBloom.build(domains, true));
+    ASSERT_TRUE(withoutBloom.build(domains, false));
+
+    for (int i = 0; i < 10000; i++) {
+        QString host = QString("www.site%1.example%2.com").arg(i).arg(i % 37);
+        bool expected = i < 5000;
+        EXPECT_EQ(withBloom.contains(host), expected) << qPrintable(host);
+        EXPECT_EQ(withoutBloom.contains(host), expected) << qPrintable(host);
+    }
+}
+
+TEST_F(DomainBlocklistTest, CompiledImageRoundTrip) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    DomainBlocklist built;
+    ASSERT_TRUE(built.build(sampleDomains()));
+    const QString imagePath = dir.filePath("blocklist.oldb");
+    ASSERT_TRUE(built.saveCompiled(imagePath));
+
+    DomainBlocklist mapped;
+    ASSERT_TRUE(mapped.loadFromFile(imagePath));
+    EXPECT_EQ(mapped.domainCount(), built.domainCount());
+    EXPECT_EQ(mapped.sizeInBytes(), built.sizeInBytes());
+    EXPECT_TRUE(mapped.contains("www.quizlet.com"));
+    EXPECT_FALSE(mapped.contains("openai.com"));
+}
+
+TEST_F(DomainBlocklistTest, TextListIsCompiledOnLoad) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    const QString listPath = dir.filePath("hosts.txt");
+    QFile list(listPath);
+    ASSERT_TRUE(list.open(QIODevice::WriteOnly));
+    list.write("0.0.0.0 chegg.com\nquizlet.com\n");
+    list.close();
+
+    DomainBlocklist blocklist;
+    ASSERT_TRUE(blocklist.loadFromFile(listPath));
+    EXPECT_TRUE(blocklist.contains("www.chegg.com"));
+    EXPECT_EQ(blocklist.domainCount(), 2);
+    EXPECT_EQ(QDir(dir.path()).entryList({"*.oldb"}, QDir::Files).size(), 0);
+}
+
+TEST_F(DomainBlocklistTest, LoadedImageIgnoresLaterFileChanges) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    DomainBlocklist built;
+    ASSERT_TRUE(built.build(sampleDomains()));
+    const QString imagePath = dir.filePath("blocklist.oldb");
+    ASSERT_TRUE(built.saveCompiled(imagePath));
+
+    DomainBlocklist loaded;
+    ASSERT_TRUE(loaded.loadFromFile(imagePath));
+
+    // Truncating a mapped image would fault on the next lookup
+    QFile image(imagePath);
+    ASSERT_TRUE(image.open(QIODevice::ReadWrite));
+    ASSERT_TRUE(image.resize(16));
+    image.close();
+
+    EXPECT_TRUE(loaded.contains("www.quizlet.com"));
+    EXPECT_FALSE(loaded.contains("openai.com"));
+}
+
+TEST_F(DomainBlocklistTest, RejectsCorruptImage) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    DomainBlocklist built;
+    ASSERT_TRUE(built.build(sampleDomains()));
+    const QString imagePath = dir.filePath("blocklist.oldb");
+    ASSERT_TRUE(built.saveCompiled(imagePath));
+    ASSERT_TRUE(QFile::resize(imagePath, built.sizeInBytes() - 8));
+
+    DomainBlocklist mapped;
+    EXPECT_FALSE(mapped.loadFromFile(imagePath));
+    EXPECT_FALSE(mapped.contains("chegg.com"));
+}
+
+TEST_F(DomainBlocklistTest, RejectsInconsistentDirectories) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    DomainBlocklist built;
+    ASSERT_TRUE(built.build(sampleDomains()));
+    const QByteArray image = built.compiledImage();
+
+    // Header fields: nodeCount at 16, loudsOffset at 40, selectOffset at 56
+    auto field = [&](int offset) {
+        quint64 value;
+        memcpy(&value, image.constData() + offset, sizeof(value));
+        return value;
+    };
+    auto patched = [&](quint64 offset, quint64 value, int bytes) {
+        QByteArray copy = image;
+        memcpy(copy.data() + offset, &value, bytes);
+        return copy;
+    };
+
+    const QList<QByteArray> corrupt = {
+        patched(16, field(16) + 1, 8),                        // node count
+        patched(16, quint64(1) << 62, 8),                     // absurd node count
+        patched(field(56), 0xFFFFFFF0u, 4),                   // select sample
+        patched(field(40), field(field(40)) ^ 2, 8),          // LOUDS bit
+    };
+    for (int i = 0; i < corrupt.size(); i++) {
+        const QString path = dir.filePath(QString("corrupt%1.oldb").arg(i));
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+        file.write(corrupt[i]);
+        file.close();
+
+        DomainBlocklist mapped;
+        EXPECT_FALSE(mapped.loadFromFile(path)) << i;
+        EXPECT_FALSE(mapped.loadImage(path, 0, corrupt[i].size())) << i;
+        EXPECT_FALSE(mapped.contains("chegg.com")) << i;
+    }
+}
+
+TEST_F(DomainBlocklistTest, NavigationFilterBlocksListedHosts) {
+    auto blocklist = std::make_shared<DomainBlocklist>();
+    ASSERT_TRUE(blocklist->build({"chegg.com", "login.chegg.com"}));
+
+    NavigationFilter filter;
+    filter.setDomainBlocklist(blocklist);
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://www.chegg.com/homework-help")), FilterResult::Blocked);
+    // Listed hosts lose the SSO exemption
+    EXPECT_EQ(filter.checkUrl(QUrl("https://login.chegg.com/")), FilterResult::Blocked);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://moodle.school.edu/")), FilterResult::Allowed);
+}
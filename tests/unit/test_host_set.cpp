@@ -0,0 +1,49 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "browser/HostSet.h"
+#include "lms/LMSAdapter.h"
+
+#include <QUrl>
+
+using namespace openlock;
+
+TEST(HostSetTest, ExactHostsAndUrls) {
+    HostSet hosts({"Moodle.School.edu", "https://lms.example.edu/course/view.php?id=3"});
+
+    EXPECT_EQ(hosts.size(), 2);
+    EXPECT_TRUE(hosts.contains("moodle.school.edu"));
+    EXPECT_TRUE(hosts.contains("lms.example.edu"));
+    EXPECT_FALSE(hosts.contains("cdn.moodle.school.edu"));
+    EXPECT_FALSE(hosts.contains("fonts.gstatic.com"));
+    EXPECT_FALSE(hosts.contains(""));
+}
+
+TEST(HostSetTest, SuffixEntriesMatchSubdomainsOnly) {
+    HostSet hosts({"*.quiz-lti.instructure.com", ".exams.edu"});
+
+    EXPECT_TRUE(hosts.contains("iad.quiz-lti.instructure.com"));
+    EXPECT_TRUE(hosts.contains("a.b.exams.edu"));
+    EXPECT_FALSE(hosts.contains("quiz-lti.instructure.com"));
+    EXPECT_FALSE(hosts.contains("evilexams.edu"));
+    EXPECT_FALSE(hosts.contains("exams.edu.evil.org"));
+}
+
+TEST(HostSetTest, IgnoresUnsupportedEntries) {
+    HostSet hosts({"", "  ", "*", "lms.*.edu"});
+    EXPECT_TRUE(hosts.isEmpty());
+}
+
+TEST(HostSetTest, SebHeaderHostsFromStartUrl) {
+    EXPECT_EQ(LMSAdapter::sebHeaderHosts(QUrl("https://moodle.school.edu/mod/quiz/view.php?id=7")),
+              QStringList({"moodle.school.edu"}));
+
+    HostSet canvas(LMSAdapter::sebHeaderHosts(QUrl("https://school.instructure.com/courses/1/quizzes/2")));
+    EXPECT_TRUE(canvas.contains("school.instructure.com"));
+    EXPECT_TRUE(canvas.contains("iad.quiz-lti.instructure.com"));
+    EXPECT_FALSE(canvas.contains("du11hjcvx0uqb.cloudfront.net"));
+
+    EXPECT_TRUE(LMSAdapter::sebHeaderHosts(QUrl()).isEmpty());
+}
@@ -0,0 +1,83 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "core/LatencyHistogram.h"
+
+#include <thread>
+#include <vector>
+
+using namespace openlock;
+
+TEST(LatencyHistogramTest, BucketsCoverValuesWithinPrecision) {
+    for (quint64 ns : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 999ull, 1000ull, 123456ull,
+                       1000000007ull, (1ull << 36) - 1}) {
+        const int bucket = LatencyHistogram::bucketFor(ns);
+        ASSERT_GE(bucket, 0);
+        ASSERT_LT(bucket, LatencyHistogram::kBucketCount);
+        EXPECT_LE(LatencyHistogram::bucketLowerBound(bucket), ns) << ns;
+        EXPECT_GE(LatencyHistogram::bucketUpperBound(bucket), ns) << ns;
+
+        const quint64 width = LatencyHistogram::bucketUpperBound(bucket) -
+                              LatencyHistogram::bucketLowerBound(bucket) + 1;
+        EXPECT_LE(width * LatencyHistogram::kSubBuckets, std::max<quint64>(ns, 8)) << ns;
+    }
+
+    // Consecutive buckets tile the range without gaps
+    for (int i = 1; i < LatencyHistogram::kBucketCount; i++) {
+        EXPECT_EQ(LatencyHistogram::bucketLowerBound(i),
+                  LatencyHistogram::bucketUpperBound(i - 1) + 1);
+    }
+    EXPECT_EQ(LatencyHistogram::bucketFor(1ull << 50), LatencyHistogram::kBucketCount - 1);
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+    for (quint64 ns = 1; ns <= 1000; ns++) {
+        histogram.add(LatencyHistogram::bucketFor(ns * 1000), 1);
+    }
+
+    EXPECT_EQ(histogram.count(), 1000u);
+    EXPECT_NEAR(double(histogram.percentile(50)), 500000.0, 500000.0 * 0.125);
+    EXPECT_NEAR(double(histogram.percentile(99)), 990000.0, 990000.0 * 0.125);
+    EXPECT_NEAR(double(histogram.maxNs()), 1000000.0, 1000000.0 * 0.125);
+    EXPECT_NEAR(histogram.meanNs(), 500500.0, 500500.0 * 0.125);
+    EXPECT_EQ(LatencyHistogram().percentile(50), 0u);
+}
+
+TEST(LatencyHistogramTest, RecorderMergesThreadsPerSeries) {
+    LatencyRecorder recorder(3);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&recorder]() {
+            for (int i = 0; i < 1000; i++) {
+                recorder.record(0, 500);
+                recorder.record(2, 2000000);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    recorder.record(1, 40);
+    recorder.record(7, 40);     // out of range, ignored
+
+    EXPECT_EQ(recorder.snapshot(0).count(), 4000u);
+    EXPECT_EQ(recorder.snapshot(1).count(), 1u);
+    EXPECT_EQ(recorder.snapshot(2).count(), 4000u);
+    EXPECT_GE(recorder.snapshot(2).percentile(50), 2000000u);
+    EXPECT_LE(recorder.snapshot(0).maxNs(), 600u);
+}
+
+TEST(LatencyHistogramTest, RecordersKeepSeparateCounters) {
+    LatencyRecorder first(1);
+    LatencyRecorder second(1);
+
+    // Alternating reuses each recorder's counters for this thread
+    for (int i = 0; i < 10; i++) {
+        first.record(0, 100);
+        second.record(0, 100);
+    }
+    EXPECT_EQ(first.snapshot(0).count(), 10u);
+    EXPECT_EQ(second.snapshot(0).count(), 10u);
+}
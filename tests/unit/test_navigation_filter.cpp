@@ -8,6 +8,10 @@
 #include <QCoreApplication>
 #include <QUrl>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace openlock;
 
 class NavigationFilterTest : public ::testing::Test {
@@ -67,3 +71,132 @@ TEST_F(NavigationFilterTest, BlocklistOverridesAllowlist) {
     EXPECT_EQ(filter.checkUrl(QUrl("https://www.example.com/quiz")), FilterResult::Allowed);
     EXPECT_EQ(filter.checkUrl(QUrl("https://www.example.com/admin/panel")), FilterResult::Blocked);
 }
+
+static UrlFilterRule sebRule(const QString& expression, UrlFilterAction action, bool regex = false)
+{
+    UrlFilterRule rule;
+    rule.expression = expression;
+    rule.action = action;
+    rule.regex = regex;
+    return rule;
+}
+
+TEST_F(NavigationFilterTest, SebRulesFirstMatchWins) {
+    filter.setUrlFilterRules({
+        sebRule("moodle.school.edu/admin", UrlFilterAction::Block),
+        sebRule("moodle.school.edu", UrlFilterAction::Allow),
+        sebRule("moodle.school.edu/mod/forum", UrlFilterAction::Block),
+    });
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://moodle.school.edu/mod/quiz/attempt.php")), FilterResult::Allowed);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://moodle.school.edu/admin/settings.php")), FilterResult::Blocked);
+    // Shadowed by the earlier allow rule
+    EXPECT_EQ(filter.checkUrl(QUrl("https://moodle.school.edu/mod/forum/view.php")), FilterResult::Allowed);
+}
+
+TEST_F(NavigationFilterTest, SebRulesBlockUnmatchedUrls) {
+    filter.setUrlFilterRules({ sebRule("moodle.school.edu", UrlFilterAction::Allow) });
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://moodle.school.edu/")), FilterResult::Allowed);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://www.wikipedia.org/")), FilterResult::Blocked);
+}
+
+TEST_F(NavigationFilterTest, SebRuleHostForms) {
+    filter.setUrlFilterRules({
+        sebRule(".exact.edu", UrlFilterAction::Allow),
+        sebRule("school.edu", UrlFilterAction::Allow),
+        sebRule("*.cdn.net", UrlFilterAction::Allow),
+        sebRule("https://secure.org:8443/exam", UrlFilterAction::Allow),
+    });
+
+    // Plain host also covers subdomains, leading dot does not
+    EXPECT_EQ(filter.checkUrl(QUrl("https://www.school.edu/")), FilterResult::Allowed);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://exact.edu/")), FilterResult::Allowed);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://www.exact.edu/")), FilterResult::Blocked);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://notschool.edu/")), FilterResult::Blocked);
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://a.b.cdn.net/lib.js")), FilterResult::Allowed);
+
+    // Scheme, port and path must all match when given
+    EXPECT_EQ(filter.checkUrl(QUrl("https://secure.org:8443/exam/start")), FilterResult::Allowed);
+    EXPECT_EQ(filter.checkUrl(QUrl("http://secure.org:8443/exam")), FilterResult::Blocked);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://secure.org/exam")), FilterResult::Blocked);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://secure.org:8443/examples")), FilterResult::Blocked);
+}
+
+TEST_F(NavigationFilterTest, SebRegexRules) {
+    filter.setUrlFilterRules({
+        sebRule("^https://[a-z]+\\.school\\.edu/quiz/[0-9]+$", UrlFilterAction::Allow, true),
+        sebRule("school.edu", UrlFilterAction::Block),
+    });
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://lms.school.edu/quiz/42")), FilterResult::Allowed);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://lms.school.edu/quiz/abc")), FilterResult::Blocked);
+}
+
+TEST_F(NavigationFilterTest, SebBlockRulesApplyToSSODomains) {
+    filter.setUrlFilterRules({
+        sebRule("login.microsoftonline.com/common/reprocess", UrlFilterAction::Block),
+        sebRule("moodle.school.edu", UrlFilterAction::Allow),
+    });
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://login.microsoftonline.com/common/reprocess")), FilterResult::Blocked);
+    // Other paths on the SSO host keep the exemption
+    EXPECT_EQ(filter.checkUrl(QUrl("https://login.microsoftonline.com/common/oauth2")), FilterResult::AllowedSSO);
+}
+
+TEST_F(NavigationFilterTest, InactiveSebRulesIgnored) {
+    UrlFilterRule inactive = sebRule("school.edu", UrlFilterAction::Block);
+    inactive.active = false;
+    filter.setUrlFilterRules({ inactive, sebRule("school.edu", UrlFilterAction::Allow) });
+
+    EXPECT_EQ(filter.checkUrl(QUrl("https://school.edu/")), FilterResult::Allowed);
+}
+
+TEST_F(NavigationFilterTest, EditsLeaveEarlierRulesUntouched) {
+    filter.addAllowedPattern("*.school.edu/*");
+    const auto before = filter.rules();
+
+    filter.addBlockedPattern("*.school.edu/admin/*");
+    EXPECT_EQ(filter.checkUrl(QUrl("https://lms.school.edu/admin/")), FilterResult::Blocked);
+
+    // A request already holding the old rules finishes with them
+    const QUrl admin("https://lms.school.edu/admin/");
+    EXPECT_EQ(before->check(admin, admin.toString()), FilterResult::Allowed);
+}
+
+TEST_F(NavigationFilterTest, SwapsCompiledRulesWhileChecking) {
+    auto open = std::make_shared<NavigationFilter::Rules>();
+    auto closed = std::make_shared<NavigationFilter::Rules>();
+    closed->setUrlFilterRules({ sebRule("school.edu", UrlFilterAction::Allow) });
+    filter.setRules(open);
+
+    // Every check sees one rule set or the other, never a mix
+    std::atomic<bool> done{false};
+    std::atomic<int> unexpected{0};
+    std::vector<std::thread> checkers;
+    for (int t = 0; t < 4; t++) {
+        checkers.emplace_back([&] {
+            const QUrl school("https://school.edu/quiz");
+            const QUrl other("https://www.wikipedia.org/");
+            while (!done) {
+                if (filter.checkUrl(school) != FilterResult::Allowed) unexpected++;
+                const FilterResult result = filter.checkUrl(other);
+                if (result != FilterResult::Allowed && result != FilterResult::Blocked) {
+                    unexpected++;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 2000; i++) {
+        filter.setRules(i % 2 ? open : closed);
+    }
+    done = true;
+    for (auto& checker : checkers) checker.join();
+    EXPECT_EQ(unexpected, 0);
+
+    filter.setRules(closed);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://www.wikipedia.org/")), FilterResult::Blocked);
+    filter.setRules(nullptr);
+    EXPECT_EQ(filter.checkUrl(QUrl("https://www.wikipedia.org/")), FilterResult::Allowed);
+}
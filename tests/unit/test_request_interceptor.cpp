@@ -0,0 +1,168 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "browser/ContentBlocker.h"
+#include "browser/NavigationFilter.h"
+#include "core/Config.h"
+#include "protocol/SEBProtocol.h"
+#include "protocol/SEBRequestInterceptor.h"
+
+#include <QCoreApplication>
+#include <QUrl>
+
+using namespace openlock;
+
+using Type = QWebEngineUrlRequestInfo::ResourceType;
+
+class RequestInterceptorTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        if (!QCoreApplication::instance()) {
+            static int argc = 1;
+            static char* argv[] = { const_cast<char*>("test") };
+            static QCoreApplication app(argc, argv);
+        }
+    }
+
+    bool blocked(const QString& url, Type type,
+                 const QString& firstParty = "https://moodle.tum.de/mod/quiz/attempt.php") {
+        return interceptor.evaluate(QUrl(url), QUrl(firstParty), type).block;
+    }
+
+    SEBRequestInterceptor interceptor;
+};
+
+namespace {
+
+QString site(QStringView host)
+{
+    return SEBRequestInterceptor::siteOf(host).toString();
+}
+
+} // namespace
+
+TEST(RequestInterceptorSiteTest, SiteIsTheRegistrableDomain) {
+    EXPECT_EQ(site(u"moodle.school.edu"), "school.edu");
+    EXPECT_EQ(site(u"a.b.school.edu"), "school.edu");
+    EXPECT_EQ(site(u"school.edu"), "school.edu");
+    EXPECT_EQ(site(u"localhost"), "localhost");
+
+    // Country codes with a registry second level
+    EXPECT_EQ(site(u"vle.ox.ac.uk"), "ox.ac.uk");
+    EXPECT_EQ(site(u"www.bbc.co.uk"), "bbc.co.uk");
+    EXPECT_EQ(site(u"lms.unimelb.edu.au"), "unimelb.edu.au");
+    EXPECT_EQ(site(u"co.uk"), "co.uk");
+
+    // Short second-level labels that are ordinary registrations
+    EXPECT_EQ(site(u"moodle.tum.de"), "tum.de");
+    EXPECT_EQ(site(u"www.tum.de"), "tum.de");
+    EXPECT_EQ(site(u"exam.uzh.ch"), "uzh.ch");
+}
+
+TEST(RequestInterceptorSiteTest, ThirdPartyComparesSites) {
+    const QUrl page("https://moodle.tum.de/mod/quiz/view.php");
+    EXPECT_FALSE(SEBRequestInterceptor::isThirdParty(QUrl("https://www.tum.de/logo.png"), page));
+    EXPECT_FALSE(SEBRequestInterceptor::isThirdParty(QUrl("http://cdn.moodle.tum.de/a.js"), page));
+    EXPECT_TRUE(SEBRequestInterceptor::isThirdParty(QUrl("https://fonts.gstatic.com/f.woff2"),
+                                                    page));
+    EXPECT_TRUE(SEBRequestInterceptor::isThirdParty(QUrl("https://lmu.de/x.png"), page));
+    EXPECT_TRUE(SEBRequestInterceptor::isThirdParty(QUrl("https://other.ac.uk/x.png"),
+                                                    QUrl("https://vle.ox.ac.uk/")));
+    // No first party (a top-level navigation) is never third-party
+    EXPECT_FALSE(SEBRequestInterceptor::isThirdParty(QUrl("https://example.com/"), QUrl()));
+}
+
+TEST(RequestInterceptorSiteTest, ResourceTypesFromConfigNames) {
+    const auto types = SEBRequestInterceptor::resourceTypesFromNames(
+        {"image", "Font", "media", "bogus", "ping"});
+    ASSERT_EQ(types.size(), 4);
+    EXPECT_EQ(types[0], QWebEngineUrlRequestInfo::ResourceTypeImage);
+    EXPECT_EQ(types[1], QWebEngineUrlRequestInfo::ResourceTypeFontResource);
+    EXPECT_EQ(types[2], QWebEngineUrlRequestInfo::ResourceTypeMedia);
+    EXPECT_EQ(types[3], QWebEngineUrlRequestInfo::ResourceTypePing);
+
+    EXPECT_EQ(SEBRequestInterceptor::resourceTypeName(
+                  QWebEngineUrlRequestInfo::ResourceTypeFontResource), "font");
+}
+
+TEST_F(RequestInterceptorTest, BlocksConfiguredThirdPartyTypes) {
+    interceptor.setThirdPartyBlockedTypes(
+        SEBRequestInterceptor::resourceTypesFromNames({"font", "media"}));
+
+    EXPECT_TRUE(blocked("https://fonts.gstatic.com/f.woff2", Type::ResourceTypeFontResource));
+    EXPECT_TRUE(blocked("https://video.example.com/v.mp4", Type::ResourceTypeMedia));
+    EXPECT_FALSE(blocked("https://fonts.gstatic.com/css", Type::ResourceTypeStylesheet));
+
+    // The exam's own subdomains are first-party
+    EXPECT_FALSE(blocked("https://www.tum.de/f.woff2", Type::ResourceTypeFontResource));
+    EXPECT_FALSE(blocked("https://moodle.tum.de/v.mp4", Type::ResourceTypeMedia));
+
+    // Frames are left to the navigation filter
+    EXPECT_FALSE(blocked("https://video.example.com/embed", Type::ResourceTypeSubFrame));
+
+    interceptor.setThirdPartyBlockedTypes({});
+    EXPECT_FALSE(blocked("https://fonts.gstatic.com/f.woff2", Type::ResourceTypeFontResource));
+}
+
+TEST_F(RequestInterceptorTest, PassiveResourcesOfAllowedFramesSkipTheFilter) {
+    NavigationFilter filter;
+    interceptor.setNavigationFilter(&filter);
+
+    const QString page = "https://moodle.tum.de/mod/quiz/attempt.php";
+    EXPECT_FALSE(blocked(page, Type::ResourceTypeMainFrame, QString()));
+
+    // Rules tightened after the frame was allowed
+    filter.addBlockedPattern("*/pluginfile.php/*");
+    const QString image = "https://moodle.tum.de/pluginfile.php/12/q.png";
+    EXPECT_FALSE(blocked(image, Type::ResourceTypeImage, page));
+    EXPECT_TRUE(blocked(image, Type::ResourceTypeXhr, page));
+    EXPECT_TRUE(blocked("https://www.tum.de/pluginfile.php/12/q.png",
+                        Type::ResourceTypeImage, page));
+
+    interceptor.clearOriginCache();
+    EXPECT_TRUE(blocked(image, Type::ResourceTypeImage, page));
+}
+
+TEST_F(RequestInterceptorTest, BlocksNonHttpSchemes) {
+    EXPECT_TRUE(blocked("file:///etc/passwd", Type::ResourceTypeMainFrame, QString()));
+    EXPECT_TRUE(blocked("data:text/html,hi", Type::ResourceTypeSubFrame));
+    EXPECT_FALSE(blocked("https://moodle.tum.de/", Type::ResourceTypeMainFrame, QString()));
+}
+
+TEST_F(RequestInterceptorTest, ContentRulesSeeTheEncodedUrl) {
+    auto blocker = std::make_shared<ContentBlocker>();
+    blocker->setRules(
+        "||xn--bcher-kva.example^\n"
+        "/track%20me/\n");
+    interceptor.setContentBlocker(blocker);
+
+    // IDN hosts arrive in punycode, escapes stay escaped
+    EXPECT_TRUE(blocked(QString::fromUtf8("https://bücher.example/a.js"), Type::ResourceTypeScript));
+    EXPECT_TRUE(blocked("https://cdn.example.com/track%20me/p.gif", Type::ResourceTypeImage));
+    EXPECT_FALSE(blocked("https://cdn.example.com/ok.gif", Type::ResourceTypeImage));
+}
+
+TEST_F(RequestInterceptorTest, SEBHeadersGoToListedHostsOnly) {
+    Config config;
+    SEBProtocol protocol;
+    ASSERT_TRUE(protocol.initialize(&config));
+    interceptor.setSEBProtocol(&protocol);
+
+    auto hasHeaders = [&](const QString& url) {
+        return !interceptor.evaluate(QUrl(url), QUrl("https://moodle.tum.de/"),
+                                     Type::ResourceTypeXhr).sebHeaders.requestHash.isEmpty();
+    };
+
+    // An empty set, as for a start URL without a host, sends nothing
+    EXPECT_FALSE(hasHeaders("https://moodle.tum.de/mod/quiz/attempt.php"));
+    EXPECT_FALSE(hasHeaders("https://tracker.example.com/collect"));
+
+    interceptor.setSEBHeaderHosts({"moodle.tum.de"});
+    EXPECT_TRUE(hasHeaders("https://moodle.tum.de/mod/quiz/attempt.php"));
+    EXPECT_FALSE(hasHeaders("https://tracker.example.com/collect"));
+
+    interceptor.setSEBHeadersToAllHosts(true);
+    EXPECT_TRUE(hasHeaders("https://tracker.example.com/collect"));
+}
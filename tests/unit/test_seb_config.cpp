@@ -3,9 +3,11 @@
 // file, You can obtain one at https://mozilla.org/MPL/2.0/.
 
 #include <gtest/gtest.h>
+#include "SEBTestData.h"
 #include "core/Config.h"
 
 #include <QCoreApplication>
+#include <QDir>
 #include <QTemporaryFile>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -82,6 +84,36 @@ TEST_F(ConfigTest, ParseOpenLockConfig) {
     EXPECT_FALSE(exam.allowWebRTC);
 }
 
+TEST_F(ConfigTest, ParseOpenLockThirdPartyResources) {
+    QByteArray json = R"({
+        "startUrl": "https://moodle.example.com/quiz",
+        "network": {
+            "blockThirdPartyResources": ["media", "font"]
+        }
+    })";
+
+    QTemporaryFile tmpFile;
+    tmpFile.setFileTemplate("XXXXXX.openlock");
+    ASSERT_TRUE(tmpFile.open());
+    tmpFile.write(json);
+    tmpFile.close();
+
+    Config config;
+    ASSERT_TRUE(config.loadFromFile(tmpFile.fileName()));
+    EXPECT_EQ(config.examConfig().blockedThirdPartyResources, QStringList({"media", "font"}));
+
+    // Nothing is blocked by type unless the config lists it
+    QTemporaryFile plainFile;
+    plainFile.setFileTemplate("XXXXXX.openlock");
+    ASSERT_TRUE(plainFile.open());
+    plainFile.write(R"({"startUrl": "https://moodle.example.com/quiz"})");
+    plainFile.close();
+
+    Config defaults;
+    ASSERT_TRUE(defaults.loadFromFile(plainFile.fileName()));
+    EXPECT_TRUE(defaults.examConfig().blockedThirdPartyResources.isEmpty());
+}
+
 TEST_F(ConfigTest, ParseSebConfig) {
     QByteArray sebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
 <!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd">
@@ -117,6 +149,171 @@ TEST_F(ConfigTest, ParseSebConfig) {
     EXPECT_FALSE(exam.allowDownloads);
 }
 
+TEST_F(ConfigTest, ParseSebUrlFilterRules) {
+    QByteArray sebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>URLFilterEnable</key>
+    <true/>
+    <key>URLFilterRules</key>
+    <array>
+        <dict>
+            <key>action</key>
+            <integer>1</integer>
+            <key>active</key>
+            <true/>
+            <key>expression</key>
+            <string>moodle.example.com</string>
+            <key>regex</key>
+            <false/>
+        </dict>
+        <dict>
+            <key>action</key>
+            <integer>0</integer>
+            <key>active</key>
+            <false/>
+            <key>expression</key>
+            <string>.*\.example\.org</string>
+            <key>regex</key>
+            <true/>
+        </dict>
+    </array>
+    <key>allowQuit</key>
+    <true/>
+</dict>
+</plist>)";
+
+    Config config;
+    ASSERT_TRUE(config.loadFromSebData(sebXml));
+
+    const auto& exam = config.examConfig();
+    EXPECT_TRUE(exam.urlFilterEnabled);
+    ASSERT_EQ(exam.urlFilterRules.size(), 2);
+
+    EXPECT_EQ(exam.urlFilterRules[0].expression, "moodle.example.com");
+    EXPECT_EQ(exam.urlFilterRules[0].action, UrlFilterAction::Allow);
+    EXPECT_TRUE(exam.urlFilterRules[0].active);
+    EXPECT_FALSE(exam.urlFilterRules[0].regex);
+
+    EXPECT_EQ(exam.urlFilterRules[1].action, UrlFilterAction::Block);
+    EXPECT_FALSE(exam.urlFilterRules[1].active);
+    EXPECT_TRUE(exam.urlFilterRules[1].regex);
+
+    // Keys after the rules array are still parsed
+    EXPECT_TRUE(exam.allowQuit);
+}
+
+TEST_F(ConfigTest, NestedKeysDoNotOverrideTopLevel) {
+    QByteArray sebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/quiz</string>
+    <key>additionalResources</key>
+    <array>
+        <dict>
+            <key>startURL</key>
+            <string>https://elsewhere.example.org/</string>
+            <key>allowQuit</key>
+            <true/>
+        </dict>
+    </array>
+</dict>
+</plist>)";
+
+    Config config;
+    ASSERT_TRUE(config.loadFromSebData(sebXml));
+
+    const auto& exam = config.examConfig();
+    EXPECT_EQ(exam.startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_FALSE(exam.allowQuit);
+
+    // The tree Config was populated from is kept for the Config Key
+    ASSERT_TRUE(config.sebSettings());
+    EXPECT_EQ(config.sebSettings()->root()[u"additionalResources"].size(), 1);
+}
+
+TEST_F(ConfigTest, PasswordProtectedSebConfig) {
+    const QByteArray sebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/quiz</string>
+</dict>
+</plist>)";
+    const QByteArray encrypted = openlock::test::encryptSeb(sebXml, "exam-password");
+
+    Config config;
+    ASSERT_TRUE(config.loadFromSebData(encrypted, "exam-password"));
+    EXPECT_EQ(config.examConfig().startUrl.toString(), "https://moodle.example.com/quiz");
+    // Keys are derived from the decrypted plist, as for a plain config
+    EXPECT_EQ(config.rawConfigData(), sebXml);
+
+    QString error;
+    Config wrongPassword;
+    QObject::connect(&wrongPassword, &Config::configError,
+                     [&error](const QString& message) { error = message; });
+    EXPECT_FALSE(wrongPassword.loadFromSebData(encrypted, "guess"));
+    EXPECT_FALSE(error.isEmpty());
+
+    Config noPassword;
+    EXPECT_FALSE(noPassword.loadFromSebData(encrypted));
+
+    QTemporaryFile file(QDir::tempPath() + "/XXXXXX.seb");
+    ASSERT_TRUE(file.open());
+    file.write(encrypted);
+    file.close();
+
+    Config fromFile;
+    ASSERT_TRUE(fromFile.loadFromFile(file.fileName(), "exam-password"));
+    EXPECT_EQ(fromFile.examConfig().startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_EQ(fromFile.examConfig().sebConfigPassword, "exam-password");
+    EXPECT_FALSE(Config().loadFromFile(file.fileName()));
+}
+
+TEST_F(ConfigTest, CompressedSebConfig) {
+    const QByteArray sebXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/quiz</string>
+</dict>
+</plist>)";
+
+    // gzip("plnd" + gzip(plist)), as SEB writes unencrypted configs
+    const QByteArray packed = openlock::test::gzip("plnd" + openlock::test::gzip(sebXml));
+
+    Config config;
+    ASSERT_TRUE(config.loadFromSebData(packed));
+    EXPECT_EQ(config.examConfig().startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_EQ(config.rawConfigData(), sebXml);
+}
+
+TEST_F(ConfigTest, BinarySebConfig) {
+    // startURL and allowQuit as a bplist00, the format SEB for macOS saves
+    const QByteArray bplist = QByteArray::fromHex(
+        "62706c6973743030d20102030458737461727455524c59616c6c6f77517569745f101f68747470733a2f2f6d"
+        "6f6f646c652e6578616d706c652e636f6d2f7175697a09080d16204200000000000001010000000000000005"
+        "00000000000000000000000000000043");
+
+    Config config;
+    const QByteArray packed = openlock::test::gzip("plnd" + openlock::test::gzip(bplist));
+    ASSERT_TRUE(config.loadFromSebData(packed));
+    EXPECT_EQ(config.examConfig().startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_TRUE(config.examConfig().allowQuit);
+
+    Config plain;
+    ASSERT_TRUE(plain.loadFromSebData(bplist));
+    EXPECT_EQ(plain.examConfig().startUrl, config.examConfig().startUrl);
+    EXPECT_FALSE(plain.loadFromSebData(bplist.chopped(1)));
+}
+
+TEST_F(ConfigTest, MalformedSebConfigFails) {
+    Config config;
+    EXPECT_FALSE(config.loadFromSebData("<plist><dict><key>startURL</key></plist>"));
+    EXPECT_FALSE(config.sebSettings());
+}
+
 TEST_F(ConfigTest, ConfigKeyHashComputed) {
     QByteArray json = R"({"examName": "Test"})";
 
@@ -133,6 +330,34 @@ TEST_F(ConfigTest, ConfigKeyHashComputed) {
     EXPECT_EQ(hash.size(), 32);  // SHA-256 = 32 bytes
 }
 
+TEST_F(ConfigTest, OpenLockLoadDropsEarlierSebTree) {
+    QTemporaryFile sebFile;
+    sebFile.setFileTemplate("XXXXXX.seb");
+    ASSERT_TRUE(sebFile.open());
+    sebFile.write(R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/quiz</string>
+</dict>
+</plist>)");
+    sebFile.close();
+
+    QTemporaryFile jsonFile;
+    jsonFile.setFileTemplate("XXXXXX.openlock");
+    ASSERT_TRUE(jsonFile.open());
+    jsonFile.write(R"({"startUrl": "https://canvas.example.com/"})");
+    jsonFile.close();
+
+    Config config;
+    ASSERT_TRUE(config.loadFromFile(sebFile.fileName()));
+    ASSERT_TRUE(config.sebSettings());
+
+    ASSERT_TRUE(config.loadFromFile(jsonFile.fileName()));
+    EXPECT_EQ(config.format(), ConfigFormat::OpenLock);
+    EXPECT_FALSE(config.sebSettings());
+}
+
 TEST_F(ConfigTest, InvalidJsonFails) {
     QTemporaryFile tmpFile;
     tmpFile.setFileTemplate("XXXXXX.openlock");
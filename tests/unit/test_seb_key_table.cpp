@@ -0,0 +1,120 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "core/SEBKeyTable.h"
+#include "protocol/SEBKeyIndex.h"
+#include "protocol/SEBSettings.h"
+
+using namespace openlock;
+
+namespace {
+
+constexpr SEBKeyIndex<4> kIndex({u"startURL", u"allowQuit", u"URLFilterRules", u"a"});
+
+// Built and queried by the compiler
+static_assert(kIndex.indexOf(u"startURL") == 0);
+static_assert(kIndex.indexOf(u"allowQuit") == 1);
+static_assert(kIndex.indexOf(u"URLFilterRules") == 2);
+static_assert(kIndex.indexOf(u"a") == 3);
+static_assert(kIndex.indexOf(u"") == -1);
+static_assert(kIndex.indexOf(u"allowquit") == -1);
+
+std::shared_ptr<const SEBSettings> parse(const QByteArray& dictBody)
+{
+    return SEBSettings::fromXml("<plist version=\"1.0\"><dict>" + dictBody + "</dict></plist>");
+}
+
+} // namespace
+
+TEST(SEBKeyIndexTest, FindsEveryKeyAndNothingElse) {
+    EXPECT_EQ(kIndex.indexOf(QStringView(u"URLFilterRules")), 2);
+    EXPECT_EQ(kIndex.indexOf(QStringView(u"URLFilterRule")), -1);
+    EXPECT_EQ(kIndex.indexOf(QStringView(u"URLFilterRulesX")), -1);
+    EXPECT_EQ(kIndex.indexOf(QStringView(u"b")), -1);
+
+    for (int i = 0; i < SEBKeyTable::keyCount(); i++) {
+        const QStringView key = SEBKeyTable::keyAt(i);
+        EXPECT_TRUE(SEBKeyTable::isKnown(key)) << key.toString().toStdString();
+        EXPECT_NE(SEBKeyTable::expectedType(key), SEBSettings::Type::Invalid);
+        EXPECT_FALSE(SEBKeyTable::isKnown(key.chopped(1)));
+    }
+    EXPECT_FALSE(SEBKeyTable::isKnown(u"examKeySalt"));
+    EXPECT_EQ(SEBKeyTable::expectedType(u"startURL"), SEBSettings::Type::String);
+}
+
+TEST(SEBKeyTableTest, AppliesKnownKeys) {
+    const auto settings = parse(R"(
+        <key>startURL</key><string>https://moodle.example.com/quiz</string>
+        <key>allowQuit</key><true/>
+        <key>enablePrinting</key><true/>
+        <key>allowVirtualMachine</key><true/>
+        <key>originatorVersion</key><string>SEB_Win_3.7</string>
+        <key>URLFilterRules</key>
+        <array>
+            <dict>
+                <key>action</key><integer>1</integer>
+                <key>active</key><true/>
+                <key>expression</key><string>moodle.example.com</string>
+                <key>regex</key><false/>
+            </dict>
+        </array>
+        <key>prohibitedProcesses</key>
+        <array>
+            <dict><key>active</key><true/><key>executable</key><string>Teams.exe</string></dict>
+            <dict><key>active</key><false/><key>executable</key><string>vlc.exe</string></dict>
+        </array>)");
+    ASSERT_TRUE(settings);
+
+    ExamConfig config;
+    EXPECT_EQ(SEBKeyTable::apply(settings->root(), config), 6);
+    EXPECT_EQ(config.startUrl.toString(), "https://moodle.example.com/quiz");
+    EXPECT_TRUE(config.allowQuit);
+    EXPECT_TRUE(config.allowPrint);
+    EXPECT_FALSE(config.detectVM);
+    ASSERT_EQ(config.urlFilterRules.size(), 1);
+    EXPECT_EQ(config.urlFilterRules[0].action, UrlFilterAction::Allow);
+    EXPECT_EQ(config.processBlocklist, QStringList({"Teams.exe"}));
+}
+
+TEST(SEBKeyTableTest, AppliesKioskAndProcessKeys) {
+    const auto settings = parse(R"(
+        <key>browserViewMode</key><integer>0</integer>
+        <key>allowedDisplaysMaxNumber</key><integer>2</integer>
+        <key>allowSwitchToApplications</key><true/>
+        <key>enablePrintScreen</key><true/>
+        <key>permittedProcesses</key>
+        <array>
+            <dict><key>active</key><true/><key>executable</key><string>calc.exe</string></dict>
+            <dict><key>active</key><false/><key>executable</key><string>notepad.exe</string></dict>
+        </array>)");
+    ASSERT_TRUE(settings);
+
+    ExamConfig config;
+    EXPECT_EQ(SEBKeyTable::apply(settings->root(), config), 5);
+    EXPECT_FALSE(config.fullscreen);
+    EXPECT_FALSE(config.multiMonitorLockdown);
+    EXPECT_FALSE(config.blockTaskSwitching);
+    EXPECT_TRUE(config.allowScreenCapture);
+    EXPECT_EQ(config.additionalAllowedProcesses, QStringList({"calc.exe"}));
+}
+
+TEST(SEBKeyTableTest, IgnoresWrongTypesAndNestedKeys) {
+    const auto settings = parse(R"(
+        <key>allowQuit</key><string>yes</string>
+        <key>startURL</key><integer>1</integer>
+        <key>embeddedCertificates</key>
+        <array><dict><key>startURL</key><string>https://evil.example</string></dict></array>
+        <key>enableJavaScript</key><true/>
+        <key>enableJavaScript</key><false/>)");
+    ASSERT_TRUE(settings);
+
+    ExamConfig config;
+    config.allowQuit = false;
+    EXPECT_EQ(SEBKeyTable::apply(settings->root(), config), 2);
+    EXPECT_FALSE(config.allowQuit);
+    EXPECT_TRUE(config.startUrl.isEmpty());
+    // Duplicate keys: the last one wins
+    EXPECT_FALSE(config.enableJavaScript);
+}
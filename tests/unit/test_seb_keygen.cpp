@@ -0,0 +1,254 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "SEBTestData.h"
+#include "protocol/SEBConfigParser.h"
+#include "protocol/SEBKeyBatch.h"
+#include "protocol/SEBKeyMaterial.h"
+#include "protocol/SEBProtocol.h"
+#include "core/Config.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace openlock;
+using openlock::test::encryptSeb;
+using openlock::test::gzip;
+
+namespace {
+
+const QByteArray kPlistXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/mod/quiz/view.php?id=42</string>
+    <key>allowQuit</key>
+    <false/>
+</dict>
+</plist>)";
+
+void writeFile(const QString& path, const QByteArray& contents)
+{
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(contents);
+}
+
+} // namespace
+
+TEST(SEBConfigParserTest, DecryptsPasswordProtectedConfig) {
+    const QByteArray encrypted = encryptSeb(kPlistXml, "secret");
+    EXPECT_TRUE(SEBConfigParser::isPasswordProtected(encrypted));
+    EXPECT_FALSE(SEBConfigParser::isPasswordProtected(kPlistXml));
+
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(encrypted, "secret"), kPlistXml);
+    EXPECT_TRUE(SEBConfigParser::decryptSebFile(encrypted, "wrong").isEmpty());
+
+    SEBConfigParser::KeyCache cache;
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(encrypted, "secret", &cache), kPlistXml);
+}
+
+TEST(SEBConfigParserTest, DecodesGzipLayersInChunks) {
+    // SEB's own packing: gzip("pswd" + RNCryptor(gzip(plist)))
+    const QByteArray packed = gzip(encryptSeb(gzip(kPlistXml), "secret"));
+    EXPECT_TRUE(SEBConfigParser::isPasswordProtected(packed));
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(packed, "secret"), kPlistXml);
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(gzip("plnd" + gzip(kPlistXml)), {}), kPlistXml);
+
+    for (qsizetype chunkSize : {1, 7, 64}) {
+        QByteArray plist;
+        SEBConfigParser::Decoder decoder(
+            [&plist](const char* data, qsizetype size) {
+                plist.append(data, size);
+                return true;
+            },
+            "secret");
+        for (qsizetype pos = 0; pos < packed.size(); pos += chunkSize) {
+            ASSERT_TRUE(decoder.addData(QByteArrayView(packed).mid(pos, chunkSize)));
+        }
+        ASSERT_TRUE(decoder.finish()) << decoder.errorString().toStdString();
+        EXPECT_EQ(plist, kPlistXml);
+    }
+}
+
+TEST(SEBConfigParserTest, DecoderOutputIsBoundedByChunkSize) {
+    QByteArray largeXml = "<plist><dict>";
+    for (int i = 0; i < 20000; i++) {
+        largeXml += "<key>k" + QByteArray::number(i) + "</key><integer>" + QByteArray::number(i) +
+                    "</integer>";
+    }
+    largeXml += "</dict></plist>";
+
+    qsizetype total = 0;
+    qsizetype largest = 0;
+    SEBConfigParser::Decoder decoder(
+        [&](const char*, qsizetype size) {
+            total += size;
+            largest = std::max(largest, size);
+            return true;
+        },
+        "secret");
+    ASSERT_TRUE(decoder.addData(gzip(encryptSeb(gzip(largeXml), "secret"))));
+    ASSERT_TRUE(decoder.finish());
+    EXPECT_EQ(total, largeXml.size());
+    EXPECT_LE(largest, 16 * 1024);
+}
+
+TEST(SEBConfigParserTest, DecoderReportsWhyItFailed) {
+    using Error = SEBConfigParser::Decoder::Error;
+    auto decode = [](const QByteArray& file, const QString& password, bool accept = true) {
+        SEBConfigParser::Decoder decoder([accept](const char*, qsizetype) { return accept; },
+                                         password);
+        decoder.addData(file);
+        decoder.finish();
+        return decoder.error();
+    };
+    const QByteArray encrypted = encryptSeb(gzip(kPlistXml), "secret");
+
+    EXPECT_EQ(decode(encrypted, "secret"), Error::None);
+    EXPECT_EQ(decode(encrypted, {}), Error::PasswordRequired);
+    EXPECT_EQ(decode(encrypted, "wrong"), Error::WrongPassword);
+    // Garbage decrypted with a wrong key is still blamed on the password
+    EXPECT_EQ(decode(encrypted, "wrong", false), Error::WrongPassword);
+    EXPECT_EQ(decode(encrypted, "secret", false), Error::Rejected);
+    EXPECT_EQ(decode("phsk" + QByteArray(64, 'x'), {}), Error::Unsupported);
+    EXPECT_EQ(decode(gzip(kPlistXml).chopped(4), {}), Error::Corrupt);
+    EXPECT_EQ(decode("plnd" + kPlistXml, {}), Error::Corrupt);
+    EXPECT_EQ(decode({}, {}), Error::Corrupt);
+}
+
+TEST(SEBConfigParserTest, KeyCacheReusesKeysOfSharedSalts) {
+    SEBConfigParser::KeyCache cache;
+    const QByteArray first = encryptSeb(kPlistXml, "secret");
+    const QByteArray copy = encryptSeb(kPlistXml + "\n", "secret");
+    const QByteArray otherSalt = encryptSeb(kPlistXml, "secret", QByteArray(8, 'x'));
+
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(first, "secret", &cache), kPlistXml);
+    EXPECT_EQ(cache.misses(), 2u);
+    EXPECT_EQ(cache.hits(), 0u);
+
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(copy, "secret", &cache), kPlistXml + "\n");
+    EXPECT_EQ(cache.misses(), 2u);
+    EXPECT_EQ(cache.hits(), 2u);
+
+    // Only the encryption salt differs: one new derivation
+    EXPECT_EQ(SEBConfigParser::decryptSebFile(otherSalt, "secret", &cache), kPlistXml);
+    EXPECT_EQ(cache.misses(), 3u);
+    EXPECT_EQ(cache.hits(), 3u);
+
+    // A different password never hits another password's keys
+    EXPECT_TRUE(SEBConfigParser::decryptSebFile(first, "wrong", &cache).isEmpty());
+    EXPECT_EQ(cache.misses(), 5u);
+}
+
+TEST(SEBConfigParserTest, ConcurrentRequestsDeriveOnce) {
+    SEBConfigParser::KeyCache cache;
+    const QByteArray salt(8, 's');
+    const auto* saltBytes = reinterpret_cast<const unsigned char*>(salt.constData());
+
+    std::vector<QByteArray> keys(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < keys.size(); i++) {
+        threads.emplace_back([&, i] { keys[i] = cache.derive("secret", saltBytes, 8); });
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_EQ(keys[0].size(), 32);
+    for (const QByteArray& key : keys) EXPECT_EQ(key, keys[0]);
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(), 7u);
+}
+
+TEST(SEBKeyBatchTest, KeysMatchBrowserDerivation) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    ASSERT_TRUE(QDir(dir.path()).mkdir("physics"));
+    writeFile(dir.filePath("chemistry.seb"), kPlistXml);
+    writeFile(dir.filePath("physics/final.seb"), encryptSeb(kPlistXml, "pw2"));
+    writeFile(dir.filePath("broken.seb"), "not a config");
+    writeFile(dir.filePath("notes.txt"), kPlistXml);
+
+    const QByteArray binaryHash(32, 'b');
+    const QStringList files = SEBKeyBatch::sebFiles(dir.path(), true);
+    ASSERT_EQ(files.size(), 3);
+    EXPECT_TRUE(SEBKeyBatch::sebFiles(dir.path(), false).size() == 2);
+
+    SEBKeyBatch batch(binaryHash, {"pw1", "pw2"});
+    const QList<SEBKeyBatch::Entry> entries = batch.run(files, QDir(dir.path()));
+    ASSERT_EQ(entries.size(), 3);
+
+    // Same keys the browser derives for the config
+    Config config;
+    ASSERT_TRUE(config.loadFromSebData(kPlistXml));
+    const auto expected = SEBProtocol::deriveKeys(config, binaryHash);
+
+    EXPECT_EQ(entries[0].quiz, "broken");
+    EXPECT_FALSE(entries[0].error.isEmpty());
+
+    EXPECT_EQ(entries[1].quiz, "chemistry");
+    EXPECT_TRUE(entries[1].error.isEmpty()) << entries[1].error.toStdString();
+    EXPECT_EQ(entries[1].startUrl, "https://moodle.example.com/mod/quiz/view.php?id=42");
+    EXPECT_EQ(entries[1].browserExamKey, expected->examKeyHex());
+    EXPECT_EQ(entries[1].configKey, expected->configKeyHex());
+
+    EXPECT_EQ(entries[2].quiz, "physics/final");
+    EXPECT_TRUE(entries[2].error.isEmpty()) << entries[2].error.toStdString();
+    EXPECT_EQ(entries[2].configKey, expected->configKeyHex());
+
+    const QByteArray csv = SEBKeyBatch::toCsv(entries);
+    EXPECT_EQ(csv.count('\n'), 4);
+    EXPECT_TRUE(csv.contains("chemistry,"));
+
+    const QJsonArray json = QJsonDocument::fromJson(SEBKeyBatch::toJson(entries)).array();
+    ASSERT_EQ(json.size(), 3);
+    EXPECT_EQ(json[2].toObject()["quiz"].toString(), "physics/final");
+    EXPECT_EQ(json[2].toObject()["configKey"].toString(),
+              QString::fromLatin1(expected->configKeyHex()));
+    EXPECT_TRUE(json[0].toObject().contains("error"));
+}
+
+TEST(SEBKeyBatchTest, JsonKeepsQuizzesWithTheSameName) {
+    SEBKeyBatch::Entry spring{"final", "/exams/spring/final.seb", "https://a.example/",
+                              "aa", "11", {}};
+    SEBKeyBatch::Entry autumn{"final", "/exams/autumn/final.seb", "https://b.example/",
+                              "bb", "22", {}};
+
+    const QJsonArray json =
+        QJsonDocument::fromJson(SEBKeyBatch::toJson({spring, autumn})).array();
+    ASSERT_EQ(json.size(), 2);
+    EXPECT_EQ(json[0].toObject()["file"].toString(), spring.file);
+    EXPECT_EQ(json[1].toObject()["file"].toString(), autumn.file);
+    EXPECT_EQ(json[1].toObject()["configKey"].toString(), "22");
+}
+
+TEST(SEBKeyBatchTest, SharedSaltsDerivedOnce) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    for (int i = 0; i < 4; i++) {
+        writeFile(dir.filePath(QString("quiz%1.seb").arg(i)),
+                  encryptSeb(kPlistXml, "shared", QByteArray(8, char('a' + i))));
+    }
+
+    SEBKeyBatch batch(QByteArray(32, 'b'), {"shared"});
+    const auto entries = batch.run(SEBKeyBatch::sebFiles(dir.path(), false), QDir(dir.path()));
+    ASSERT_EQ(entries.size(), 4);
+    for (const auto& entry : entries) EXPECT_TRUE(entry.error.isEmpty());
+
+    // Every file has its own encryption salt but the same HMAC salt
+    EXPECT_EQ(batch.keyCache().misses(), 5u);
+    EXPECT_EQ(batch.keyCache().hits(), 3u);
+
+    SEBKeyBatch noPassword(QByteArray(32, 'b'));
+    const auto failed = noPassword.run(SEBKeyBatch::sebFiles(dir.path(), false), QDir(dir.path()));
+    for (const auto& entry : failed) EXPECT_FALSE(entry.error.isEmpty());
+}
@@ -0,0 +1,274 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "protocol/SEBKeyMaterial.h"
+#include "protocol/RequestHashCache.h"
+#include "protocol/BrowserExamKey.h"
+#include "protocol/ConfigKeyGenerator.h"
+#include "protocol/SEBJsonWriter.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace openlock;
+
+namespace {
+
+QByteArray referenceHash(const QString& url, const QByteArray& rawKey)
+{
+    QByteArray combined = url.toUtf8() + rawKey.toHex();
+    return QCryptographicHash::hash(combined, QCryptographicHash::Sha256).toHex();
+}
+
+void writeFile(const QString& path, const QByteArray& contents)
+{
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(contents);
+}
+
+QByteArray sha256(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+}
+
+} // namespace
+
+TEST(SEBKeyMaterialTest, HexFormsPrecomputed) {
+    QByteArray examKey(32, '\x01');
+    QByteArray configKey(32, '\xfe');
+    SEBKeyMaterial keys(examKey, configKey, 7);
+
+    EXPECT_EQ(keys.examKeyHex(), examKey.toHex());
+    EXPECT_EQ(keys.configKeyHex(), configKey.toHex());
+    EXPECT_EQ(keys.generation(), 7u);
+}
+
+TEST(SEBKeyMaterialTest, RequestHashMatchesSebDefinition) {
+    QByteArray examKey = QCryptographicHash::hash("bek", QCryptographicHash::Sha256);
+    QByteArray configKey = QCryptographicHash::hash("ck", QCryptographicHash::Sha256);
+    SEBKeyMaterial keys(examKey, configKey, 1);
+
+    QUrl url("https://moodle.example.edu/mod/quiz/attempt.php?attempt=42&page=3#q5");
+    QByteArray urlBytes = SEBKeyMaterial::requestUrlBytes(url);
+    EXPECT_EQ(urlBytes, QByteArray("https://moodle.example.edu/mod/quiz/attempt.php?attempt=42&page=3"));
+
+    const QString expectedUrl = "https://moodle.example.edu/mod/quiz/attempt.php?attempt=42&page=3";
+    EXPECT_EQ(keys.requestHash(urlBytes), referenceHash(expectedUrl, examKey));
+    EXPECT_EQ(keys.configKeyHash(urlBytes), referenceHash(expectedUrl, configKey));
+    EXPECT_EQ(keys.requestHash(urlBytes).size(), 64);
+}
+
+TEST(SEBKeyMaterialTest, ReusedBufferMatchesToUtf8) {
+    QByteArray buffer;
+    buffer.reserve(256);
+    const char* storage = buffer.constData();
+
+    const QStringList urls = {
+        "https://lms.example.edu/mod/quiz/attempt.php?attempt=42#q5",
+        QString::fromUtf8("https://lms.example.edu/kurs/Pr\xc3\xbc" "fung?q=\xe6\x97\xa5\xe6\x9c\xac"),
+        QString::fromUtf8("https://lms.example.edu/\xf0\x9f\x98\x80/x"),
+        "https://a.b/",
+    };
+    for (const QString& text : urls) {
+        const QUrl url(text);
+        SEBKeyMaterial::requestUrlBytes(url.toString(QUrl::RemoveFragment), buffer);
+        EXPECT_EQ(buffer, SEBKeyMaterial::requestUrlBytes(url)) << qPrintable(text);
+    }
+    // No reallocation once the buffer is large enough
+    EXPECT_EQ(buffer.constData(), storage);
+}
+
+TEST(SEBKeyMaterialTest, AgreesWithKeyGenerators) {
+    BrowserExamKey bek;
+    bek.setExamKeySalt(QByteArray(32, 's'));
+    bek.setConfigPlistXml("<plist><dict><key>startURL</key><string>x</string></dict></plist>");
+    bek.setBinaryFilesHash(QByteArray(32, 'b'));
+
+    ConfigKeyGenerator ck;
+    ck.setConfigData("raw config");
+
+    SEBKeyMaterial keys(bek.computeRawKey(), ck.computeRawKey(), 1);
+    QUrl url("https://lms.example.edu/quiz?id=1#top");
+    QByteArray urlBytes = SEBKeyMaterial::requestUrlBytes(url);
+
+    EXPECT_EQ(keys.requestHash(urlBytes), bek.computeRequestHash(url));
+    EXPECT_EQ(keys.configKeyHash(urlBytes), ck.computeRequestHash(url));
+}
+
+TEST(SEBJsonWriterTest, CanonicalForm) {
+    QVariantMap nested;
+    nested["zeta"] = 1;
+    nested["Alpha"] = QVariantList{true, 2.5, QString("x")};
+    nested["originatorVersion"] = "kept below the top level";
+
+    QVariantMap settings;
+    settings["originatorVersion"] = "SEB_Win_3.5.0";
+    settings["startURL"] = QString::fromUtf8("https://lms.example.edu/pr\xc3\xbc" "fung");
+    settings["allowQuit"] = false;
+    settings["browserWindowWidth"] = 1.0;
+    settings["URLFilterRules"] = QVariantList{nested};
+    settings["examKeySalt"] = QByteArray("\x01\x02\x03\x04", 4);
+    settings["proxyPort"] = 8080;
+    settings["ratio"] = 0.1;
+
+    const QByteArray expected =
+        "{\"allowQuit\":false,\"browserWindowWidth\":1.0,\"examKeySalt\":\"AQIDBA==\","
+        "\"proxyPort\":8080,\"ratio\":0.1,\"startURL\":\"https://lms.example.edu/pr\xc3\xbc" "fung\","
+        "\"URLFilterRules\":[{\"Alpha\":[true,2.5,\"x\"],"
+        "\"originatorVersion\":\"kept below the top level\",\"zeta\":1}]}";
+    EXPECT_EQ(SEBJsonWriter::toJson(settings), expected);
+
+    ConfigKeyGenerator ck;
+    ck.setSettingsMap(settings);
+    EXPECT_EQ(ck.computeRawKey(), QCryptographicHash::hash(expected, QCryptographicHash::Sha256));
+}
+
+TEST(SEBJsonWriterTest, EmbeddedDataStreamsThroughFixedBuffer) {
+    QByteArray resource(3 * 1024 * 1024 + 1, Qt::Uninitialized);
+    for (qsizetype i = 0; i < resource.size(); i++) resource[i] = char(i * 31);
+
+    QVariantMap settings;
+    settings["additionalResources"] = QVariantList{QVariantMap{{"resourceData", resource}}};
+    settings["startURL"] = "https://lms.example.edu/";
+
+    qsizetype largestChunk = 0;
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    SEBJsonWriter writer([&](const char* data, qsizetype size) {
+        largestChunk = std::max(largestChunk, size);
+        hash.addData(QByteArrayView(data, size));
+    });
+    writer.writeSettings(settings);
+
+    const QByteArray expected = "{\"additionalResources\":[{\"resourceData\":\"" +
+                                resource.toBase64() +
+                                "\"}],\"startURL\":\"https://lms.example.edu/\"}";
+    EXPECT_LE(largestChunk, SEBJsonWriter::kBufferSize);
+    EXPECT_EQ(writer.bytesWritten(), quint64(expected.size()));
+    EXPECT_EQ(hash.result(), QCryptographicHash::hash(expected, QCryptographicHash::Sha256));
+    EXPECT_EQ(SEBJsonWriter::sha256(settings), hash.result());
+}
+
+TEST(RequestHashCacheTest, RepeatedUrlIsServedFromCache) {
+    SEBKeyMaterial keys(QByteArray(32, 'e'), QByteArray(32, 'c'), 1);
+    RequestHashCache cache;
+    const QByteArray url = "https://moodle.example.edu/lib/ajax/service.php?sesskey=abc";
+
+    auto first = cache.headersFor(keys, url);
+    auto second = cache.headersFor(keys, url);
+
+    EXPECT_EQ(first.requestHash, keys.requestHash(url));
+    EXPECT_EQ(first.configKeyHash, keys.configKeyHash(url));
+    EXPECT_EQ(second.requestHash, first.requestHash);
+    EXPECT_EQ(second.configKeyHash, first.configKeyHash);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+    EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(RequestHashCacheTest, NewKeyGenerationInvalidates) {
+    SEBKeyMaterial oldKeys(QByteArray(32, '1'), QByteArray(32, '2'), 1);
+    SEBKeyMaterial newKeys(QByteArray(32, '3'), QByteArray(32, '4'), 2);
+    RequestHashCache cache;
+    const QByteArray url = "https://lms.example.edu/quiz/autosave";
+
+    cache.headersFor(oldKeys, url);
+    EXPECT_EQ(cache.headersFor(newKeys, url).requestHash, newKeys.requestHash(url));
+    EXPECT_EQ(cache.stats().misses, 2u);
+
+    // A request still holding the old snapshot gets its own keys' hash
+    // and leaves the current generation's entry in place
+    EXPECT_EQ(cache.headersFor(oldKeys, url).requestHash, oldKeys.requestHash(url));
+    EXPECT_EQ(cache.headersFor(newKeys, url).requestHash, newKeys.requestHash(url));
+    EXPECT_EQ(cache.stats().hits, 1u);
+}
+
+TEST(RequestHashCacheTest, StaysWithinCapacity) {
+    SEBKeyMaterial keys(QByteArray(32, 'e'), QByteArray(32, 'c'), 1);
+    RequestHashCache cache(64);
+    const QByteArray keepalive = "https://lms.example.edu/keepalive";
+
+    for (int i = 0; i < 1000; i++) {
+        cache.headersFor(keys, "https://lms.example.edu/page?id=" + QByteArray::number(i));
+        cache.headersFor(keys, keepalive);
+    }
+
+    EXPECT_LE(cache.size(), cache.capacity());
+    auto stats = cache.stats();
+    EXPECT_GT(stats.evictions, 0u);
+    // The polled URL keeps its reference bit and survives the sweep
+    EXPECT_GE(stats.hits, 990u);
+
+    QByteArray longUrl = "https://lms.example.edu/?q=" + QByteArray(RequestHashCache::kMaxUrlLength, 'x');
+    cache.clear();
+    cache.headersFor(keys, longUrl);
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(RequestHashCacheTest, ConcurrentLookupsAgree) {
+    SEBKeyMaterial keys(QByteArray(32, 'e'), QByteArray(32, 'c'), 1);
+    RequestHashCache cache(128);
+
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4, 0);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 2000; i++) {
+                QByteArray url = "https://lms.example.edu/r/" + QByteArray::number((i * 7 + t) % 300);
+                if (cache.headersFor(keys, url).requestHash != keys.requestHash(url)) {
+                    mismatches[t]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (int count : mismatches) EXPECT_EQ(count, 0);
+    EXPECT_LE(cache.size(), cache.capacity());
+    EXPECT_EQ(cache.stats().hits + cache.stats().misses, 8000u);
+}
+
+TEST(BinaryFilesHashTest, MatchesSequentialDefinition) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    const QByteArray app(300000, 'a');
+    writeFile(dir.filePath("openlock"), app);
+    writeFile(dir.filePath("libQt6WebEngineCore.so.6"), "webengine");
+    writeFile(dir.filePath("libempty.so"), "");
+    writeFile(dir.filePath("notes.txt"), "not a binary");
+
+    // Sorted paths: libQt6WebEngineCore.so.6, libempty.so, openlock
+    const QByteArray expected = sha256(sha256("webengine").toHex() + sha256("").toHex() +
+                                       sha256(app).toHex());
+
+    EXPECT_EQ(BrowserExamKey::computeBinaryFilesHash(dir.filePath("openlock")), expected);
+}
+
+TEST(BinaryFilesHashTest, ChangedFileChangesHash) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    const QString appPath = dir.filePath("openlock");
+    const QString libPath = dir.filePath("libopenlock core.so");
+    writeFile(appPath, "app");
+    writeFile(libPath, "lib v1");
+    const QByteArray original = BrowserExamKey::computeBinaryFilesHash(appPath);
+    EXPECT_EQ(original, sha256(sha256("lib v1").toHex() + sha256("app").toHex()));
+
+    // Nothing is carried over between runs, so an edited library shows up
+    writeFile(libPath, "lib v2 (updated)");
+    EXPECT_EQ(BrowserExamKey::computeBinaryFilesHash(appPath),
+              sha256(sha256("lib v2 (updated)").toHex() + sha256("app").toHex()));
+}
@@ -0,0 +1,384 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "protocol/PlistReader.h"
+#include "protocol/SEBJsonWriter.h"
+#include "protocol/SEBSettings.h"
+#include "protocol/ConfigKeyGenerator.h"
+
+#include <QDateTime>
+
+using namespace openlock;
+
+namespace {
+
+const QByteArray kSettingsXml = R"(<?xml version="1.0" encoding="UTF-8"?>
+<!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd">
+<plist version="1.0">
+<dict>
+    <key>startURL</key>
+    <string>https://moodle.example.com/quiz?id=7&amp;lang=de</string>
+    <key>allowQuit</key>
+    <false/>
+    <key>enableJavaScript</key>
+    <true/>
+    <key>browserWindowWidth</key>
+    <integer>-1024</integer>
+    <key>defaultPageZoomLevel</key>
+    <real>1.25</real>
+    <key>originatorVersion</key>
+    <string>SEB_Win_3.5.0</string>
+    <key>examKeySalt</key>
+    <data>
+    AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=
+    </data>
+    <key>created</key>
+    <date>2024-03-01T08:30:00Z</date>
+    <key>URLFilterRules</key>
+    <array>
+        <dict>
+            <key>action</key>
+            <integer>1</integer>
+            <key>expression</key>
+            <string>moodle.example.com</string>
+        </dict>
+        <array/>
+        <string>Übung</string>
+    </array>
+    <key>embedded</key>
+    <dict/>
+</dict>
+</plist>)";
+
+// kSettingsXml as macOS writes it in binary form (plistlib, keys unsorted):
+// 2-byte offsets, shared "moodle.example.com", UTF-16 "Übung"
+const QByteArray kSettingsBinary = QByteArray::fromHex(
+    "62706c6973743030da0102030405060708090a0b0c0d0e0f101112131b58737461727455524c59616c6c6f77"
+    "517569745f1010656e61626c654a6176615363726970745f101262726f7773657257696e646f775769647468"
+    "5f101464656661756c74506167655a6f6f6d4c6576656c5f10116f726967696e61746f7256657273696f6e5b"
+    "6578616d4b657953616c7457637265617465645e55524c46696c74657252756c657358656d6265646465645f"
+    "102c68747470733a2f2f6d6f6f646c652e6578616d706c652e636f6d2f7175697a3f69643d37266c616e673d"
+    "6465080913fffffffffffffc00233ff40000000000005d5345425f57696e5f332e352e304f10200001020304"
+    "05060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f3341c5c8e4c4000000a314191ad2151617"
+    "1856616374696f6e5a65787072657373696f6e10015f10126d6f6f646c652e6578616d706c652e636f6da065"
+    "00dc00620075006e0067d00008001d0026003000430058006f0083008f009700a600af00de00df00e000e900"
+    "f201000123012c01300135013c01470149015e015f016a0000000000000201000000000000001c0000000000"
+    "000000000000000000016b");
+
+// Binary plist from the given objects (marker byte and payload each),
+// with 1-byte offsets and references
+QByteArray bplist(const QList<QByteArray>& objects, quint64 top = 0)
+{
+    QByteArray plist = "bplist00";
+    QByteArray offsets;
+    for (const QByteArray& object : objects) {
+        offsets.append(char(plist.size()));
+        plist += object;
+    }
+    const quint64 table = quint64(plist.size());
+    plist += offsets;
+    plist += QByteArray(6, '\0') + char(1) + char(1);
+    for (quint64 value : {quint64(objects.size()), top, table}) {
+        for (int shift = 56; shift >= 0; shift -= 8) plist.append(char(value >> shift));
+    }
+    return plist;
+}
+
+// Records events as text to compare chunked and one-shot parses
+class EventLog : public PlistSink {
+public:
+    QStringList events;
+
+    void beginDict() override { events << "{"; }
+    void key(QStringView key) override { events << "key " + key.toString(); }
+    void endDict() override { events << "}"; }
+    void beginArray() override { events << "["; }
+    void endArray() override { events << "]"; }
+    void string(QStringView value) override { events << "string " + value.toString(); }
+    void data(const QByteArray& value) override { events << "data " + QString::fromLatin1(value.toHex()); }
+    void date(qint64 msecs) override { events << "date " + QString::number(msecs); }
+    void integer(qint64 value) override { events << "integer " + QString::number(value); }
+    void real(double value) override { events << "real " + QString::number(value); }
+    void boolean(bool value) override { events << (value ? "true" : "false"); }
+};
+
+// Notes where ASCII strings from a binary plist point
+class InPlaceLog : public EventLog {
+public:
+    QList<const char*> latin1;
+
+    void latin1Key(QLatin1String key) override
+    {
+        latin1 << key.data();
+        EventLog::latin1Key(key);
+    }
+    void latin1String(QLatin1String value) override
+    {
+        latin1 << value.data();
+        EventLog::latin1String(value);
+    }
+};
+
+} // namespace
+
+TEST(SEBSettingsTest, TypedTree) {
+    QString error;
+    auto settings = SEBSettings::fromXml(kSettingsXml, &error);
+    ASSERT_TRUE(settings) << error.toStdString();
+
+    const SEBSettings::Value root = settings->root();
+    ASSERT_TRUE(root.isDict());
+    EXPECT_EQ(root.size(), 10);
+    EXPECT_EQ(root.keyAt(0), u"startURL");
+
+    EXPECT_EQ(root[u"startURL"].type(), SEBSettings::Type::String);
+    EXPECT_EQ(root[u"startURL"].toString(), "https://moodle.example.com/quiz?id=7&lang=de");
+    EXPECT_FALSE(root[u"allowQuit"].toBool(true));
+    EXPECT_TRUE(root[u"enableJavaScript"].toBool());
+    EXPECT_EQ(root[u"browserWindowWidth"].toInteger(), -1024);
+    EXPECT_DOUBLE_EQ(root[u"defaultPageZoomLevel"].toReal(), 1.25);
+
+    const QByteArray salt = root[u"examKeySalt"].toData();
+    ASSERT_EQ(salt.size(), 32);
+    EXPECT_EQ(salt[31], char(31));
+
+    EXPECT_EQ(root[u"created"].toDateTime(),
+              QDateTime::fromString("2024-03-01T08:30:00Z", Qt::ISODate));
+
+    const SEBSettings::Value rules = root[u"URLFilterRules"];
+    ASSERT_TRUE(rules.isArray());
+    ASSERT_EQ(rules.size(), 3);
+    EXPECT_EQ(rules.at(0)[u"action"].toInteger(), 1);
+    EXPECT_EQ(rules.at(0)[u"expression"].stringView(), u"moodle.example.com");
+    EXPECT_TRUE(rules.at(1).isArray());
+    EXPECT_EQ(rules.at(1).size(), 0);
+    EXPECT_EQ(rules.at(2).toString(), QString::fromUtf8("Übung"));
+
+    EXPECT_TRUE(root[u"embedded"].isDict());
+    EXPECT_EQ(root[u"embedded"].size(), 0);
+}
+
+TEST(SEBSettingsTest, MissingAndMistypedValuesFallBack) {
+    auto settings = SEBSettings::fromXml(kSettingsXml);
+    ASSERT_TRUE(settings);
+    const SEBSettings::Value root = settings->root();
+
+    EXPECT_FALSE(root[u"noSuchKey"].isValid());
+    EXPECT_FALSE(root[u"noSuchKey"][u"deeper"].isValid());
+    EXPECT_TRUE(root[u"noSuchKey"].toBool(true));
+    EXPECT_EQ(root[u"startURL"].toInteger(42), 42);
+    EXPECT_EQ(root[u"allowQuit"].toString("fallback"), "fallback");
+    EXPECT_FALSE(root[u"URLFilterRules"].at(3).isValid());
+    EXPECT_TRUE(root[u"startURL"].keyAt(0).isNull());
+    // Keys are case-sensitive, as in SEB
+    EXPECT_FALSE(root[u"starturl"].isValid());
+}
+
+TEST(SEBSettingsTest, ChunkedInputMatchesWholeDocument) {
+    EventLog whole;
+    ASSERT_TRUE(PlistXmlReader::parse(kSettingsXml, whole));
+
+    for (qsizetype chunkSize : {1, 7, 64}) {
+        EventLog chunked;
+        PlistXmlReader reader(chunked);
+        for (qsizetype i = 0; i < kSettingsXml.size(); i += chunkSize) {
+            ASSERT_TRUE(reader.addData(QByteArrayView(kSettingsXml).mid(i, chunkSize)));
+        }
+        ASSERT_TRUE(reader.finish()) << reader.errorString().toStdString();
+        EXPECT_EQ(chunked.events, whole.events) << "chunk size " << chunkSize;
+    }
+}
+
+TEST(SEBSettingsTest, RejectsMalformedInput) {
+    QString error;
+
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><key>a</key><string>x</dict></plist>", &error));
+    EXPECT_FALSE(error.isEmpty());
+
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><key>a</key><integer>1x</integer></dict></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><key>a</key><date>soon</date></dict></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><key>a</key><uid>1</uid></dict></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict/><dict/></plist>"));
+
+    // Keys and values must pair up inside dicts, and only there
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><string>x</string></dict></plist>", &error));
+    EXPECT_EQ(error, "Value <string> in <dict> without a <key>");
+    EXPECT_FALSE(SEBSettings::fromXml(
+        "<plist><dict><key>a</key><true/><array/></dict></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml(
+        "<plist><dict><key>a</key><key>b</key><true/></dict></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><key>a</key></dict></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml(
+        "<plist><dict><key>a</key><array><key>b</key><true/></array></dict></plist>", &error));
+    EXPECT_EQ(error, "<key> outside a <dict>");
+
+    // Truncated: the reader waits for more data, finish() rejects it
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><dict><key>a</key>", &error));
+    EXPECT_FALSE(error.isEmpty());
+
+    // Well-formed, but not a settings dictionary
+    EXPECT_FALSE(SEBSettings::fromXml("<plist><array/></plist>"));
+    EXPECT_FALSE(SEBSettings::fromXml(""));
+}
+
+TEST(SEBSettingsTest, RejectsDeeplyNestedXml) {
+    // Downloaded configs are untrusted; the tree is walked recursively
+    auto nested = [](int depth) {
+        QByteArray xml = "<plist><dict><key>a</key>";
+        xml += QByteArray("<array>").repeated(depth);
+        xml += QByteArray("</array>").repeated(depth);
+        xml += "</dict></plist>";
+        return xml;
+    };
+
+    QString error;
+    EXPECT_FALSE(SEBSettings::fromXml(nested(100000), &error));
+    EXPECT_EQ(error, "Property list nests too deeply");
+    EXPECT_TRUE(SEBSettings::fromXml(nested(100)));
+}
+
+TEST(SEBSettingsTest, JsonMatchesVariantMapPath) {
+    auto settings = SEBSettings::fromXml(kSettingsXml);
+    ASSERT_TRUE(settings);
+
+    const QVariantMap map = settings->root().toVariant().toMap();
+    ASSERT_EQ(map.size(), 10);
+    EXPECT_EQ(map["URLFilterRules"].toList().size(), 3);
+
+    const QByteArray json = SEBJsonWriter::toJson(*settings);
+    EXPECT_EQ(json, SEBJsonWriter::toJson(map));
+    EXPECT_EQ(SEBJsonWriter::sha256(*settings), SEBJsonWriter::sha256(map));
+    EXPECT_FALSE(json.contains("originatorVersion"));
+    EXPECT_TRUE(json.startsWith("{\"allowQuit\":false,\"browserWindowWidth\":-1024,"));
+    EXPECT_TRUE(json.contains("\"defaultPageZoomLevel\":1.25"));
+    EXPECT_TRUE(json.contains("\"created\":\"2024-03-01T08:30:00Z\""));
+}
+
+TEST(SEBSettingsTest, ConfigKeyUsesSharedTree) {
+    auto settings = SEBSettings::fromXml(kSettingsXml);
+    ASSERT_TRUE(settings);
+
+    ConfigKeyGenerator fromTree;
+    fromTree.setConfigData(kSettingsXml);
+    fromTree.setSettings(settings);
+
+    ConfigKeyGenerator fromMap;
+    fromMap.setSettingsMap(settings->root().toVariant().toMap());
+
+    EXPECT_EQ(fromTree.computeRawKey(), fromMap.computeRawKey());
+    EXPECT_EQ(fromTree.computeRawKey(), SEBJsonWriter::sha256(*settings));
+}
+
+TEST(SEBSettingsTest, BinaryPlistMatchesXml) {
+    EventLog xml;
+    ASSERT_TRUE(PlistXmlReader::parse(kSettingsXml, xml));
+
+    EventLog binary;
+    QString error;
+    ASSERT_TRUE(PlistBinaryReader::parse(kSettingsBinary, binary, &error)) << error.toStdString();
+    EXPECT_EQ(binary.events, xml.events);
+
+    auto settings = SEBSettings::fromBinary(kSettingsBinary, &error);
+    ASSERT_TRUE(settings) << error.toStdString();
+    const SEBSettings::Value root = settings->root();
+    EXPECT_EQ(root.size(), 10);
+    EXPECT_EQ(root[u"browserWindowWidth"].toInteger(), -1024);
+    EXPECT_EQ(root[u"created"].toDateTime(),
+              QDateTime::fromString("2024-03-01T08:30:00Z", Qt::ISODate));
+    EXPECT_EQ(root[u"URLFilterRules"].at(2).toString(), QString::fromUtf8("Übung"));
+    EXPECT_EQ(SEBJsonWriter::toJson(*settings),
+              SEBJsonWriter::toJson(*SEBSettings::fromXml(kSettingsXml)));
+}
+
+TEST(SEBSettingsTest, BinaryStringsAreReadInPlace) {
+    InPlaceLog log;
+    ASSERT_TRUE(PlistBinaryReader::parse(kSettingsBinary, log));
+
+    // Twelve keys and three ASCII strings; "Übung" is UTF-16 and gets swapped
+    EXPECT_EQ(log.latin1.size(), 12 + 3);
+    for (const char* text : log.latin1) {
+        EXPECT_GE(text, kSettingsBinary.constData());
+        EXPECT_LT(text, kSettingsBinary.constData() + kSettingsBinary.size());
+    }
+}
+
+TEST(SEBSettingsTest, ParserDetectsBinaryPlist) {
+    const QByteArray expected = SEBJsonWriter::toJson(*SEBSettings::fromXml(kSettingsXml));
+
+    for (qsizetype chunkSize : {1, 5, 4096}) {
+        SEBSettings::Parser parser;
+        for (qsizetype i = 0; i < kSettingsBinary.size(); i += chunkSize) {
+            ASSERT_TRUE(parser.addData(QByteArrayView(kSettingsBinary).mid(i, chunkSize)));
+        }
+        QString error;
+        auto settings = parser.finish(&error);
+        ASSERT_TRUE(settings) << error.toStdString();
+        EXPECT_EQ(SEBJsonWriter::toJson(*settings), expected) << "chunk size " << chunkSize;
+    }
+
+    // UTF-16 keys, 16-byte integers
+    auto settings = SEBSettings::fromBinary(bplist({
+        QByteArray::fromHex("d10102"),
+        QByteArray::fromHex("6200c40062"),
+        QByteArray::fromHex("1400000000000000000000000000000007"),
+    }));
+    ASSERT_TRUE(settings);
+    EXPECT_EQ(settings->root().keyAt(0), u"\u00c4b");
+    EXPECT_EQ(settings->root()[u"\u00c4b"].toInteger(), 7);
+}
+
+TEST(SEBSettingsTest, RejectsCorruptBinaryPlist) {
+    const QByteArray key = QByteArray::fromHex("5161");
+    QString error;
+
+    // Truncated anywhere: the trailer is gone or points past the data
+    for (qsizetype size : {qsizetype(8), qsizetype(40), kSettingsBinary.size() - 1}) {
+        EXPECT_FALSE(SEBSettings::fromBinary(kSettingsBinary.left(size), &error)) << size;
+        EXPECT_FALSE(error.isEmpty());
+    }
+    EXPECT_FALSE(SEBSettings::fromBinary(QByteArray("bplist01") + kSettingsBinary.mid(8)));
+
+    // An array that contains itself
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("d10102"), key,
+                                                 QByteArray::fromHex("a102")}),
+                                         &error));
+    EXPECT_FALSE(error.isEmpty());
+
+    // Reference past the object count, non-string key, counts past the data
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("d10109"), key})));
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("d10102"),
+                                                 QByteArray::fromHex("09"), key})));
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("d10102"), key,
+                                                 QByteArray::fromHex("4f13ffffffffffffff00")})));
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("d10102"), key,
+                                                 QByteArray::fromHex("5761626364")})));
+    // UIDs and sets have no place in a settings plist
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("d10102"), key,
+                                                 QByteArray::fromHex("8001")})));
+
+    // Valid, but not a dictionary
+    EXPECT_FALSE(SEBSettings::fromBinary(bplist({QByteArray::fromHex("a0")}), &error));
+    EXPECT_EQ(error, "Property list has no settings dictionary");
+}
+
+TEST(SEBSettingsTest, RejectsSharedLeafExpansion) {
+    // {a: [data, data, ...]} with every element referencing one 200-byte
+    // data object: a few hundred bytes that would expand to 20 KB
+    auto sharedLeaf = [](int references) {
+        QByteArray array = QByteArray::fromHex("af10") + char(references);
+        array += QByteArray(references, char(3));
+        return bplist({QByteArray::fromHex("d10102"), QByteArray::fromHex("5161"), array,
+                       QByteArray::fromHex("4f10c8") + QByteArray(200, 'x')});
+    };
+
+    QString error;
+    EXPECT_FALSE(SEBSettings::fromBinary(sharedLeaf(100), &error));
+    EXPECT_EQ(error, "Property list expands too far through shared objects");
+
+    // Sharing as such is fine
+    auto settings = SEBSettings::fromBinary(sharedLeaf(2), &error);
+    ASSERT_TRUE(settings) << error.toStdString();
+    EXPECT_EQ(settings->root()[u"a"].size(), 2);
+}
@@ -0,0 +1,97 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#include <gtest/gtest.h>
+#include "integrity/Sha256Batch.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+
+using namespace openlock;
+
+namespace {
+
+QList<QByteArray> sampleBuffers()
+{
+    // Every length around the one- and two-padding-block boundaries,
+    // plus a few multi-block sizes of different lengths
+    QRandomGenerator rng(42);
+    QList<QByteArray> buffers;
+    for (int size = 0; size <= 200; size++) {
+        QByteArray buffer(size, Qt::Uninitialized);
+        for (char& c : buffer) c = char(rng.generate());
+        buffers << buffer;
+    }
+    for (int size : {1000, 4096, 65537, 1 << 20}) {
+        QByteArray buffer(size, Qt::Uninitialized);
+        for (char& c : buffer) c = char(rng.generate());
+        buffers << buffer;
+    }
+    return buffers;
+}
+
+void expectMatchesQt(Sha256Batch::Backend backend)
+{
+    const QList<QByteArray> buffers = sampleBuffers();
+    QList<QByteArrayView> views;
+    for (const QByteArray& buffer : buffers) views << QByteArrayView(buffer);
+
+    const QList<QByteArray> digests = Sha256Batch::hash(views, backend);
+    ASSERT_EQ(digests.size(), buffers.size());
+    for (qsizetype i = 0; i < buffers.size(); i++) {
+        EXPECT_EQ(digests[i], QCryptographicHash::hash(buffers[i], QCryptographicHash::Sha256))
+            << "length " << buffers[i].size();
+    }
+}
+
+} // namespace
+
+TEST(Sha256BatchTest, OpenSslBackendMatchesQt) {
+    expectMatchesQt(Sha256Batch::Backend::OpenSsl);
+}
+
+TEST(Sha256BatchTest, Avx2BackendMatchesQt) {
+    if (!Sha256Batch::isSupported(Sha256Batch::Backend::Avx2x8)) {
+        GTEST_SKIP() << "CPU has no AVX2";
+    }
+    expectMatchesQt(Sha256Batch::Backend::Avx2x8);
+}
+
+TEST(Sha256BatchTest, HashFiles) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    const QString full = dir.filePath("libfull.so");
+    const QString empty = dir.filePath("libempty.so");
+    {
+        QFile file(full);
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(100000, 'z'));
+        QFile(empty).open(QIODevice::WriteOnly);
+    }
+
+    const QList<QByteArray> digests =
+        Sha256Batch::hashFiles({full, dir.filePath("missing.so"), empty});
+    ASSERT_EQ(digests.size(), 3);
+    EXPECT_EQ(digests[0], QCryptographicHash::hash(QByteArray(100000, 'z'),
+                                                   QCryptographicHash::Sha256));
+    EXPECT_TRUE(digests[1].isEmpty());
+    EXPECT_EQ(digests[2], QCryptographicHash::hash(QByteArray(), QCryptographicHash::Sha256));
+}
+
+TEST(Sha256BatchTest, HashFilesStreamsProcfs) {
+    // procfs reports size 0 for files that have content
+    QFile cmdline("/proc/self/cmdline");
+    if (!cmdline.open(QIODevice::ReadOnly)) {
+        GTEST_SKIP() << "no procfs";
+    }
+    const QByteArray contents = cmdline.readAll();
+    ASSERT_FALSE(contents.isEmpty());
+
+    const QList<QByteArray> digests = Sha256Batch::hashFiles({"/proc/self/cmdline"});
+    ASSERT_EQ(digests.size(), 1);
+    EXPECT_EQ(digests[0], QCryptographicHash::hash(contents, QCryptographicHash::Sha256));
+}
@@ -5,6 +5,10 @@
 #include <gtest/gtest.h>
 #include "integrity/VMDetector.h"
 
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+
 using namespace openlock;
 
 class VMDetectorTest : public ::testing::Test {
@@ -32,3 +36,227 @@ TEST_F(VMDetectorTest, ConfidenceScoreInRange) {
     EXPECT_GE(result.confidenceScore, 0);
     EXPECT_LE(result.confidenceScore, 100);
 }
+
+namespace {
+
+VMDetector::Check check(const QString& name, int sleepMs, bool positive,
+                        const QString& hypervisor = {}, int deadlineMs = 2000)
+{
+    return {name, deadlineMs, [=] {
+        QThread::msleep(sleepMs);
+        return VMDetector::Finding{positive, hypervisor};
+    }};
+}
+
+} // namespace
+
+class VMDetectorSchedulingTest : public ::testing::Test {
+protected:
+    void SetUp() override { pool.setMaxThreadCount(8); }
+
+    VMDetectionResult detect(VMDetector& detector, qint64* elapsedMs) {
+        detector.setThreadPool(&pool);
+        QElapsedTimer timer;
+        timer.start();
+        VMDetectionResult result = detector.detect();
+        *elapsedMs = timer.elapsed();
+        return result;
+    }
+
+    QThreadPool pool;
+};
+
+TEST_F(VMDetectorSchedulingTest, ChecksRunConcurrently) {
+    VMDetector detector({
+        check("a", 200, false), check("b", 200, false),
+        check("c", 200, false), check("d", 200, false),
+    });
+    qint64 elapsed = 0;
+    const auto result = detect(detector, &elapsed);
+    EXPECT_FALSE(result.detected);
+    EXPECT_TRUE(result.timedOutChecks.isEmpty());
+    EXPECT_LT(elapsed, 600);
+}
+
+TEST_F(VMDetectorSchedulingTest, SlowCheckMissesItsDeadline) {
+    VMDetector detector({
+        check("fast", 0, false),
+        check("wedged", 3000, true, "KVM", 50),
+    });
+    qint64 elapsed = 0;
+    const auto result = detect(detector, &elapsed);
+    EXPECT_FALSE(result.detected);
+    EXPECT_EQ(result.timedOutChecks, QStringList({"wedged"}));
+    EXPECT_LT(elapsed, 1500);
+}
+
+TEST_F(VMDetectorSchedulingTest, LongerDeadlineReplacesTheChecksOwn) {
+    VMDetector detector({check("slow", 300, false, {}, 50)});
+    detector.setThreadPool(&pool);
+    EXPECT_EQ(detector.detect().timedOutChecks, QStringList({"slow"}));
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto result = detector.detect(2000);
+    EXPECT_TRUE(result.timedOutChecks.isEmpty());
+    EXPECT_LT(timer.elapsed(), 1500);
+}
+
+TEST_F(VMDetectorSchedulingTest, WedgedCheckDoesNotHoldUpDestruction) {
+    QElapsedTimer timer;
+    timer.start();
+    {
+        VMDetector detector({check("wedged", 3000, true, "KVM", 50)});
+        EXPECT_EQ(detector.detect().timedOutChecks, QStringList({"wedged"}));
+    }
+    EXPECT_LT(timer.elapsed(), 1500);
+}
+
+TEST_F(VMDetectorSchedulingTest, ReturnsOnceThresholdIsReached) {
+    VMDetector detector({
+        check("dmi", 0, true, "QEMU"), check("modules", 0, true, "QEMU/KVM"),
+        check("slow-1", 800, false), check("slow-2", 800, false),
+    });
+    detector.setConfidenceThreshold(50);
+    qint64 elapsed = 0;
+    const auto result = detect(detector, &elapsed);
+    EXPECT_TRUE(result.detected);
+    EXPECT_EQ(result.confidenceScore, 50);
+    EXPECT_EQ(result.hypervisorName, "QEMU");
+    EXPECT_TRUE(result.timedOutChecks.isEmpty());
+    EXPECT_LT(elapsed, 500);
+}
+
+TEST_F(VMDetectorSchedulingTest, HypervisorNamedInCheckOrder) {
+    VMDetector detector({
+        check("systemd", 100, true, "kvm"),
+        check("mac", 0, true, "QEMU/KVM"),
+        check("cpuinfo", 0, false),
+    });
+    detector.setConfidenceThreshold(100);
+    qint64 elapsed = 0;
+    const auto result = detect(detector, &elapsed);
+    EXPECT_TRUE(result.detected);
+    EXPECT_EQ(result.hypervisorName, "kvm");
+    EXPECT_EQ(result.confidenceScore, 66);
+}
+
+TEST_F(VMDetectorSchedulingTest, DeadlinesStartWhenChecksBegin) {
+    // One thread runs the checks back to back, each well within its deadline
+    pool.setMaxThreadCount(1);
+    VMDetector detector({
+        check("a", 60, false, {}, 150), check("b", 60, false, {}, 150),
+        check("c", 60, true, "KVM", 150),
+    });
+    detector.setConfidenceThreshold(100);
+    qint64 elapsed = 0;
+    const auto result = detect(detector, &elapsed);
+    EXPECT_TRUE(result.detected);
+    EXPECT_EQ(result.hypervisorName, "KVM");
+    EXPECT_TRUE(result.timedOutChecks.isEmpty());
+}
+
+TEST_F(VMDetectorSchedulingTest, DetectsFromInsideSaturatedPool) {
+    // As SystemIntegrity::performFullCheck() runs on a small machine's pool
+    QThreadPool saturated;
+    saturated.setMaxThreadCount(1);
+    for (QThreadPool* checkPool : {&saturated, static_cast<QThreadPool*>(nullptr)}) {
+        VMDetector detector({
+            check("dmi", 0, true, "QEMU", 50), check("mac", 0, true, "QEMU/KVM", 50),
+            check("cpuinfo", 0, false, {}, 50),
+        });
+        detector.setConfidenceThreshold(100);
+        detector.setThreadPool(checkPool);
+        VMDetectionResult result;
+        saturated.start([&] { result = detector.detect(); });
+        ASSERT_TRUE(saturated.waitForDone(5000));
+        EXPECT_TRUE(result.detected);
+        EXPECT_EQ(result.confidenceScore, 66);
+        EXPECT_EQ(result.hypervisorName, "QEMU");
+        EXPECT_TRUE(result.timedOutChecks.isEmpty());
+    }
+}
+
+TEST_F(VMDetectorSchedulingTest, WedgedCheckOutsideSaturatedPoolMissesItsDeadline) {
+    // The check the pool never starts runs elsewhere, under its deadline too
+    QThreadPool saturated;
+    saturated.setMaxThreadCount(1);
+    VMDetector detector({check("dmi", 0, true, "QEMU", 50),
+                         check("wedged", 3000, true, "KVM", 50)});
+    detector.setConfidenceThreshold(100);
+    detector.setThreadPool(&saturated);
+    VMDetectionResult result;
+    qint64 elapsed = 0;
+    saturated.start([&] {
+        QElapsedTimer timer;
+        timer.start();
+        result = detector.detect();
+        elapsed = timer.elapsed();
+    });
+    ASSERT_TRUE(saturated.waitForDone(5000));
+    EXPECT_EQ(result.hypervisorName, "QEMU");
+    EXPECT_EQ(result.timedOutChecks, QStringList({"wedged"}));
+    EXPECT_LT(elapsed, 1500);
+}
+
+// Trees captured from real guests, reduced to the files the checks read
+class VMDetectorFixtureTest : public ::testing::Test {
+protected:
+    static VMDetectionResult detectIn(const QString& tree) {
+        VMDetector detector(VMDetector::defaultChecks(
+            QStringLiteral(OPENLOCK_TEST_DATA_DIR "/vm/") + tree));
+        detector.setConfidenceThreshold(100);   // run every check
+        return detector.detect();
+    }
+};
+
+TEST_F(VMDetectorFixtureTest, Kvm) {
+    const auto result = detectIn("kvm");
+    EXPECT_TRUE(result.detected);
+    EXPECT_EQ(result.hypervisorName, "kvm");
+    EXPECT_EQ(result.confidenceScore, 83);     // no SCSI disks on virtio-blk
+}
+
+TEST_F(VMDetectorFixtureTest, VirtualBox) {
+    const auto result = detectIn("virtualbox");
+    EXPECT_EQ(result.hypervisorName, "oracle");
+    EXPECT_EQ(result.confidenceScore, 100);
+}
+
+TEST_F(VMDetectorFixtureTest, VMware) {
+    const auto result = detectIn("vmware");
+    EXPECT_EQ(result.hypervisorName, "vmware");
+    EXPECT_EQ(result.confidenceScore, 100);
+}
+
+TEST_F(VMDetectorFixtureTest, HyperV) {
+    const auto result = detectIn("hyperv");
+    EXPECT_EQ(result.hypervisorName, "microsoft");
+    EXPECT_EQ(result.confidenceScore, 100);
+}
+
+TEST_F(VMDetectorFixtureTest, XenGuestWithoutDmi) {
+    const auto result = detectIn("xen");
+    EXPECT_EQ(result.hypervisorName, "xen");
+    EXPECT_EQ(result.confidenceScore, 50);
+}
+
+TEST_F(VMDetectorFixtureTest, ContainerOnBareMetal) {
+    const auto result = detectIn("container");
+    EXPECT_TRUE(result.detected);
+    EXPECT_EQ(result.hypervisorName, "podman");
+    EXPECT_EQ(result.confidenceScore, 16);
+}
+
+TEST_F(VMDetectorFixtureTest, BareMetal) {
+    const auto result = detectIn("baremetal");
+    EXPECT_FALSE(result.detected);
+    EXPECT_TRUE(result.hypervisorName.isEmpty());
+    EXPECT_EQ(result.confidenceScore, 0);
+    EXPECT_TRUE(result.timedOutChecks.isEmpty());
+}
+
+TEST_F(VMDetectorFixtureTest, MissingTreeDetectsNothing) {
+    const auto result = detectIn("does-not-exist");
+    EXPECT_FALSE(result.detected);
+}